@@ -0,0 +1,221 @@
+#include "AsyncLogger.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QStandardPaths>
+#include <QThread>
+#include <cstdio>
+#include <thread>
+
+std::atomic<int> AsyncLogger::s_minLevel{AsyncLogger::Info};
+
+namespace {
+
+const char *levelName(AsyncLogger::Level level)
+{
+    switch (level) {
+    case AsyncLogger::Debug:
+        return "debug";
+    case AsyncLogger::Info:
+        return "info";
+    case AsyncLogger::Warning:
+        return "warning";
+    case AsyncLogger::Error:
+        return "error";
+    }
+    return "info";
+}
+
+} // namespace
+
+// 进程内唯一实例，退出时不析构（可能仍有线程在写日志）
+AsyncLogger *AsyncLogger::instance()
+{
+    static AsyncLogger *logger = new AsyncLogger();
+    return logger;
+}
+
+AsyncLogger::AsyncLogger()
+    : m_dropped(0)
+    , m_running(false)
+    , m_writerActive(false)
+    , m_producers(0)
+{}
+
+// 启动后台写线程并接管 Qt 日志输出
+void AsyncLogger::start(const QString &logDir, Level minLevel)
+{
+    if (m_running.exchange(true))
+        return;
+    setMinLevel(minLevel);
+
+    QString dir = logDir;
+    if (dir.isEmpty())
+        dir = QDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)).filePath("logs");
+    QDir().mkpath(dir);
+    m_path = QDir(dir).filePath("flight.jsonl");
+
+    qInstallMessageHandler(&AsyncLogger::messageHandler);
+    m_writerActive.store(true);
+    m_writer = std::thread([this]() { writerLoop(); });
+}
+
+// 写完队列后退出后台线程
+void AsyncLogger::stop()
+{
+    if (!m_running.exchange(false))
+        return;
+    qInstallMessageHandler(nullptr);
+    // 已通过检查的生产者可能仍在入队：等它们全部离开后再让写线程退出，
+    // 写线程退出前的最后一次写出一定能看到这些记录
+    while (m_producers.load() != 0)
+        std::this_thread::yield();
+    m_writerActive.store(false);
+    m_wake.notify_one();
+    if (m_writer.joinable())
+        m_writer.join();
+}
+
+// 设置最低级别；同时关闭 Qt 日志分类的低级别输出，
+// 使 qCDebug / QML console.log 在格式化之前就被过滤
+void AsyncLogger::setMinLevel(Level level)
+{
+    s_minLevel.store(level, std::memory_order_relaxed);
+    QStringList rules;
+    rules << QString("*.debug=%1").arg(level <= Debug ? "true" : "false");
+    rules << QString("*.info=%1").arg(level <= Info ? "true" : "false");
+    QLoggingCategory::setFilterRules(rules.join('\n'));
+}
+
+// 入队：队列满时直接丢弃
+bool AsyncLogger::log(Level level, const char *category, const QString &message)
+{
+    // 先登记再检查（均为顺序一致），与 stop() 先关闭再等待配对：stop 要么看到本次登记，要么本次看到已关闭
+    m_producers.fetch_add(1);
+    if (!m_running.load()) {
+        m_producers.fetch_sub(1);
+        // 写线程未启动（启动前/退出后）时直接输出到标准错误
+        fprintf(stderr, "[%s] %s\n", category, qUtf8Printable(message));
+        return true;
+    }
+
+    Record record;
+    record.timestampMs = QDateTime::currentMSecsSinceEpoch();
+    record.level = level;
+    record.category = category;
+    record.threadId = quintptr(QThread::currentThreadId());
+    record.message = message;
+    const bool pushed = m_ring.tryPush(std::move(record));
+    m_producers.fetch_sub(1);
+    if (!pushed) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // 错误日志尽快落盘
+    if (level >= Error)
+        m_wake.notify_one();
+    return true;
+}
+
+void AsyncLogger::writerLoop()
+{
+    QFile file(m_path);
+    file.open(QIODevice::Append | QIODevice::Text);
+    while (m_writerActive.load()) {
+        if (!drainOnce(file)) {
+            std::unique_lock<std::mutex> lock(m_wakeLock);
+            m_wake.wait_for(lock, std::chrono::milliseconds(50));
+        }
+    }
+    drainOnce(file);
+    file.close();
+}
+
+// 写出当前队列中的全部记录
+bool AsyncLogger::drainOnce(QFile &file)
+{
+    bool wrote = false;
+    Record entry;
+    while (m_ring.tryPop(&entry)) {
+        QJsonObject record;
+        record["ts"] = QDateTime::fromMSecsSinceEpoch(entry.timestampMs).toString(Qt::ISODateWithMs);
+        record["level"] = levelName(entry.level);
+        record["cat"] = entry.category;
+        record["tid"] = QString::number(entry.threadId, 16);
+        record["msg"] = entry.message;
+        const Level level = entry.level;
+
+        const QByteArray line = QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n';
+        if (file.isOpen())
+            file.write(line);
+        if (level >= Warning)
+            fputs(line.constData(), stderr);
+        wrote = true;
+    }
+
+    if (wrote && file.isOpen()) {
+        file.flush();
+        if (file.size() >= kRotateBytes)
+            rotate(file);
+    }
+    return wrote;
+}
+
+// 轮转：flight.jsonl -> flight.1.jsonl -> ... -> flight.<kKeepFiles>.jsonl（最旧的删除）
+void AsyncLogger::rotate(QFile &file)
+{
+    file.close();
+    const QString base = m_path.left(m_path.size() - QString(".jsonl").size());
+    QFile::remove(QString("%1.%2.jsonl").arg(base).arg(kKeepFiles));
+    for (int i = kKeepFiles - 1; i >= 1; --i)
+        QFile::rename(QString("%1.%2.jsonl").arg(base).arg(i), QString("%1.%2.jsonl").arg(base).arg(i + 1));
+    QFile::rename(m_path, QString("%1.1.jsonl").arg(base));
+    file.setFileName(m_path);
+    file.open(QIODevice::Append | QIODevice::Text);
+}
+
+// 接管 qDebug/qWarning/console.log：按级别过滤后入队
+void AsyncLogger::messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg)
+{
+    Level level = Info;
+    switch (type) {
+    case QtDebugMsg:
+        level = Debug;
+        break;
+    case QtInfoMsg:
+        level = Info;
+        break;
+    case QtWarningMsg:
+        level = Warning;
+        break;
+    case QtCriticalMsg:
+    case QtFatalMsg:
+        level = Error;
+        break;
+    }
+    if (!enabled(level))
+        return;
+    // 分类名需要在写线程使用时仍然有效，Qt 的分类名是静态字符串
+    instance()->log(level, context.category ? context.category : "default", msg);
+    if (type == QtFatalMsg) {
+        instance()->stop();
+        abort();
+    }
+}
+
+AsyncLogger::Line::Line(Level level, const char *category)
+    : m_level(level)
+    , m_category(category)
+    , m_stream(new QDebug(&m_buffer))
+{}
+
+AsyncLogger::Line::~Line()
+{
+    // QDebug 析构时才把缓冲的文本写入字符串，先结束流再入队
+    m_stream.reset();
+    AsyncLogger::instance()->log(m_level, m_category, m_buffer.trimmed());
+}
@@ -0,0 +1,98 @@
+#ifndef ASYNCLOGGER_H
+#define ASYNCLOGGER_H
+
+#include <QDebug>
+#include <QString>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "MpscRing.h"
+
+// 异步结构化日志：调用线程只做级别判断和格式化，记录放入无锁环形队列（多生产者单消费者），
+// 后台线程写成 JSON Lines 文件并按大小轮转；队列满时丢弃并计数，从不阻塞查询
+//
+// 用法：FLOG_INFO("db") << "连接成功" << dsn;
+// 级别不够时整条语句不会执行（参数不会求值、不会格式化）
+class AsyncLogger
+{
+public:
+    enum Level { Debug = 0, Info, Warning, Error };
+
+    static AsyncLogger *instance();
+
+    // 启动后台写线程并接管 qDebug/console.log 输出（main 中调用一次）
+    // 日志目录为空时使用应用数据目录下的 logs/
+    void start(const QString &logDir = QString(), Level minLevel = Info);
+    void stop(); // 写完队列中的记录后退出后台线程
+
+    static bool enabled(Level level) { return level >= s_minLevel.load(std::memory_order_relaxed); }
+    void setMinLevel(Level level);
+
+    // 入队（队列满时返回 false 并计入丢弃数）
+    bool log(Level level, const char *category, const QString &message);
+
+    quint64 droppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    // 一条日志：析构时入队
+    class Line
+    {
+    public:
+        Line(Level level, const char *category);
+        ~Line();
+        QDebug &stream() { return *m_stream; }
+
+    private:
+        Level m_level;
+        const char *m_category;
+        QString m_buffer;
+        std::unique_ptr<QDebug> m_stream; // 先于 m_buffer 析构，保证内容已写入缓冲区
+    };
+
+private:
+    AsyncLogger();
+
+    // 一条待写出的记录
+    struct Record
+    {
+        qint64 timestampMs = 0;
+        Level level = Info;
+        const char *category = nullptr;
+        quintptr threadId = 0;
+        QString message;
+    };
+
+    static constexpr qint64 kRotateBytes = 8LL * 1024 * 1024;
+    static constexpr int kKeepFiles = 5;
+
+    void writerLoop();
+    bool drainOnce(class QFile &file); // 写出当前队列中的全部记录，返回是否写出过
+    void rotate(class QFile &file);
+    static void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg);
+
+    static std::atomic<int> s_minLevel;
+
+    MpscRing<Record, 8192> m_ring;
+    std::atomic<quint64> m_dropped;
+
+    QString m_path;
+    std::thread m_writer;
+    std::atomic<bool> m_running;      // 接受新记录（stop 时先关闭）
+    std::atomic<bool> m_writerActive; // 写线程继续循环（生产者全部离开后才关闭）
+    std::atomic<int> m_producers;     // 已通过 m_running 检查、尚未完成入队的生产者数
+    std::mutex m_wakeLock; // 只用于后台线程休眠，生产者不获取
+    std::condition_variable m_wake;
+};
+
+#define FLOG_AT(level, category) \
+    if (!AsyncLogger::enabled(level)) { \
+    } else \
+        AsyncLogger::Line(level, category).stream()
+
+#define FLOG_DEBUG(category) FLOG_AT(AsyncLogger::Debug, category)
+#define FLOG_INFO(category) FLOG_AT(AsyncLogger::Info, category)
+#define FLOG_WARN(category) FLOG_AT(AsyncLogger::Warning, category)
+#define FLOG_ERROR(category) FLOG_AT(AsyncLogger::Error, category)
+
+#endif // ASYNCLOGGER_H
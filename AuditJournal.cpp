@@ -0,0 +1,268 @@
+#include "AuditJournal.h"
+#include "AsyncLogger.h"
+#include "SqlBatch.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStandardPaths>
+#include <QStringList>
+#include <chrono>
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+AuditJournal::AuditJournal()
+    : m_segmentIndex(0)
+    , m_connectionName("QT_ODBC_AUDIT")
+    , m_running(false)
+    , m_appended(0)
+    , m_dropped(0)
+    , m_syncWrites(0)
+    , m_fileCommitted(0)
+    , m_dbCommitted(0)
+    , m_batches(0)
+{}
+
+AuditJournal::~AuditJournal()
+{
+    stop();
+}
+
+// 启动后台线程
+void AuditJournal::start(const Options &options)
+{
+    if (m_running.exchange(true))
+        return;
+    m_options = options;
+    if (m_options.dir.isEmpty()) {
+        m_options.dir = QDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation))
+                            .filePath("audit");
+    }
+    QDir().mkpath(m_options.dir);
+    m_writer = std::thread([this]() { writerLoop(); });
+}
+
+// 提交剩余记录后退出
+void AuditJournal::stop()
+{
+    if (!m_running.exchange(false))
+        return;
+    m_wake.notify_one();
+    if (m_writer.joinable())
+        m_writer.join();
+}
+
+// 记录一条审计
+bool AuditJournal::append(Entry entry)
+{
+    if (entry.timestampMs == 0)
+        entry.timestampMs = QDateTime::currentMSecsSinceEpoch();
+    // tryPush 按值接收，传副本（字符串隐式共享，不拷贝内容），失败时 entry 仍可重试或同步写入
+    bool queued = m_ring.tryPush(entry);
+    if (!queued && m_running.load(std::memory_order_relaxed)) {
+        // 队列满：唤醒后台线程并短暂等待它腾出空间
+        m_wake.notify_one();
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_options.appendWaitMs);
+        while (!queued && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            queued = m_ring.tryPush(entry);
+        }
+    }
+    m_appended.fetch_add(1, std::memory_order_relaxed);
+    if (!queued) {
+        // 仍然满：同步写分段文件，写库交给后台线程（未启动时还没有分段目录，无处可写）
+        m_syncWrites.fetch_add(1, std::memory_order_relaxed);
+        if (!m_running.load(std::memory_order_relaxed) || !writeSegment({entry})) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            FLOG_ERROR("audit") << "审计队列已满且同步写文件失败，记录丢失：" << entry.action << entry.target;
+            return false;
+        }
+        m_fileCommitted.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(m_overflowLock);
+        m_overflow.append(std::move(entry));
+        return true;
+    }
+    // 排队达到一批时提前唤醒，不必等满间隔
+    if (m_ring.approximateSize() >= quint64(m_options.maxBatch))
+        m_wake.notify_one();
+    return true;
+}
+
+QVariantMap AuditJournal::stats() const
+{
+    QVariantMap map;
+    map["appended"] = m_appended.load();
+    map["dropped"] = m_dropped.load();
+    map["sync_writes"] = m_syncWrites.load();
+    map["file_committed"] = m_fileCommitted.load();
+    map["db_committed"] = m_dbCommitted.load();
+    map["batches"] = m_batches.load();
+    map["flush_interval_ms"] = m_options.flushIntervalMs;
+    return map;
+}
+
+// 每个间隔（或排队满一批时）取出全部记录组提交
+void AuditJournal::writerLoop()
+{
+    QVector<Entry> batch;
+    while (m_running.load(std::memory_order_relaxed)) {
+        {
+            std::unique_lock<std::mutex> lock(m_wakeLock);
+            m_wake.wait_for(lock, std::chrono::milliseconds(m_options.flushIntervalMs));
+        }
+        commitBatch(batch);
+    }
+    commitBatch(batch);
+    if (QSqlDatabase::contains(m_connectionName)) {
+        QSqlDatabase::database(m_connectionName, false).close();
+        QSqlDatabase::removeDatabase(m_connectionName);
+    }
+}
+
+void AuditJournal::commitBatch(QVector<Entry> &batch)
+{
+    batch.clear();
+    Entry entry;
+    while (m_ring.tryPop(&entry))
+        batch.append(std::move(entry));
+    {
+        // 队列满时调用方已同步写入文件的记录，只需写库
+        std::lock_guard<std::mutex> lock(m_overflowLock);
+        m_retry += m_overflow;
+        m_overflow.clear();
+    }
+
+    // 新记录先落本地文件（持久化点），再与之前写库失败的记录一起写库
+    if (!batch.isEmpty()) {
+        if (writeSegment(batch))
+            m_fileCommitted.fetch_add(batch.size(), std::memory_order_relaxed);
+        m_retry += batch;
+        m_batches.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (m_retry.isEmpty())
+        return;
+
+    for (int offset = 0; offset < m_retry.size(); offset += m_options.maxBatch) {
+        const QVector<Entry> rows = m_retry.mid(offset, m_options.maxBatch);
+        if (!insertRows(rows)) {
+            m_retry.remove(0, offset);
+            // 超出保留上限时丢弃最旧的（分段文件中仍有完整记录）
+            if (m_retry.size() > m_options.maxRetained)
+                m_retry.remove(0, m_retry.size() - m_options.maxRetained);
+            return;
+        }
+        m_dbCommitted.fetch_add(rows.size(), std::memory_order_relaxed);
+    }
+    m_retry.clear();
+}
+
+// 追加写入分段文件（JSON Lines），超过大小上限时换新文件
+bool AuditJournal::writeSegment(const QVector<Entry> &batch)
+{
+    std::lock_guard<std::mutex> lock(m_segmentLock);
+    if (m_segmentPath.isEmpty() || QFileInfo(m_segmentPath).size() >= m_options.segmentBytes) {
+        m_segmentPath = QDir(m_options.dir)
+                            .filePath(QString("audit-%1-%2.jsonl")
+                                          .arg(QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss"))
+                                          .arg(m_segmentIndex++));
+    }
+
+    QByteArray data;
+    for (const Entry &entry : batch) {
+        QJsonObject record;
+        record["ts"] = QDateTime::fromMSecsSinceEpoch(entry.timestampMs).toString(Qt::ISODateWithMs);
+        record["actor_kind"] = entry.actorKind;
+        record["actor_id"] = entry.actorId;
+        record["actor_name"] = entry.actorName;
+        record["action"] = entry.action;
+        record["target"] = entry.target;
+        record["detail"] = entry.detail;
+        data += QJsonDocument(record).toJson(QJsonDocument::Compact);
+        data += '\n';
+    }
+
+    QFile file(m_segmentPath);
+    if (!file.open(QIODevice::Append) || file.write(data) != data.size() || !file.flush()) {
+        FLOG_ERROR("audit") << "写入审计分段失败：" << m_segmentPath << file.errorString();
+        return false;
+    }
+    if (m_options.syncToDisk) {
+#ifdef Q_OS_WIN
+        _commit(file.handle());
+#else
+        ::fsync(file.handle());
+#endif
+    }
+    return true;
+}
+
+// 多行 INSERT 写入数据库
+bool AuditJournal::insertRows(const QVector<Entry> &batch)
+{
+    if (!ensureConnection())
+        return false;
+
+    QList<QVariantList> columns(7); // 按列组织参数
+    for (const Entry &entry : batch) {
+        columns[0].append(QDateTime::fromMSecsSinceEpoch(entry.timestampMs));
+        columns[1].append(entry.actorKind);
+        columns[2].append(entry.actorId);
+        columns[3].append(entry.actorName);
+        columns[4].append(entry.action);
+        columns[5].append(entry.target);
+        columns[6].append(entry.detail);
+    }
+    QSqlDatabase db = QSqlDatabase::database(m_connectionName, false);
+    QString error;
+    if (!SqlBatch::exec(db,
+                        "INSERT INTO audit_log (ts, actor_kind, actor_id, actor_name, action, target, detail) VALUES ",
+                        columns, QString(), m_options.maxBatch, &error)) {
+        FLOG_WARN("audit") << "审计写库失败，稍后重试：" << error;
+        db.close(); // 下次重连
+        return false;
+    }
+    return true;
+}
+
+// 后台线程自己的连接（QSqlDatabase 不能跨线程使用）
+bool AuditJournal::ensureConnection()
+{
+    if (!QSqlDatabase::contains(m_connectionName)) {
+        if (!QSqlDatabase::contains(m_options.sourceConnection))
+            return false;
+        QSqlDatabase::cloneDatabase(m_options.sourceConnection, m_connectionName);
+    }
+    QSqlDatabase db = QSqlDatabase::database(m_connectionName, false);
+    if (db.isOpen())
+        return true;
+    if (!db.open()) {
+        FLOG_WARN("audit") << "审计连接失败：" << db.lastError().text();
+        return false;
+    }
+    QSqlQuery query(db);
+    if (!query.exec(R"(
+        CREATE TABLE IF NOT EXISTS audit_log (
+            id         BIGINT AUTO_INCREMENT PRIMARY KEY,
+            ts         DATETIME(3) NOT NULL,
+            actor_kind VARCHAR(16) NOT NULL,
+            actor_id   INT NOT NULL,
+            actor_name VARCHAR(64),
+            action     VARCHAR(32) NOT NULL,
+            target     VARCHAR(64),
+            detail     TEXT,
+            KEY idx_audit_target (target),
+            KEY idx_audit_ts (ts)
+        )
+    )")) {
+        FLOG_WARN("audit") << "创建 audit_log 失败：" << query.lastError().text();
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+#ifndef AUDITJOURNAL_H
+#define AUDITJOURNAL_H
+
+#include <QString>
+#include <QVariantMap>
+#include <QVector>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "MpscRing.h"
+
+// 变更审计日志：DBManager 的变更操作只把审计记录放入无锁队列（不增加写延迟），
+// 后台线程按批“组提交”：先追加写入本地只追加的分段文件并刷盘，再用多行 INSERT 写入 audit_log 表
+// 丢失窗口由 flushIntervalMs 决定：进程崩溃时最多丢失最近一个间隔内尚未刷盘的记录
+// 队列满时调用方短暂等待后台线程腾出空间，仍满则由调用方同步写分段文件，审计记录不丢弃
+class AuditJournal
+{
+public:
+    struct Options
+    {
+        QString dir;                                  // 分段文件目录（空则使用应用数据目录下的 audit/）
+        QString sourceConnection = "QT_ODBC_CONN";    // 复制其连接参数，后台线程使用独立连接
+        int flushIntervalMs = 200;                    // 组提交间隔（即最大丢失窗口）
+        int maxBatch = 256;                           // 单批最多条数，排队达到该数量时提前提交
+        qint64 segmentBytes = 16LL * 1024 * 1024;     // 分段文件大小上限
+        bool syncToDisk = true;                       // 每批写入后 fsync
+        int maxRetained = 10000;                      // 数据库不可用时内存中保留待重试的条数
+        int appendWaitMs = 20;                        // 队列满时调用方最多等待的时间，超时后同步写文件
+    };
+
+    struct Entry
+    {
+        qint64 timestampMs = 0;
+        QString actorKind; // admin / user / system
+        int actorId = -1;
+        QString actorName;
+        QString action;    // 如 update_flight_price、delete_order
+        QString target;    // 操作对象（航班号、订单号、用户ID）
+        QString detail;    // 变更内容（如新旧值）
+    };
+
+    AuditJournal();
+    ~AuditJournal();
+
+    void start(const Options &options); // 启动后台线程（重复调用无效）
+    void stop();                        // 提交剩余记录后退出
+
+    bool append(Entry entry); // 记录一条审计（任意线程；队列满时短暂等待或同步写文件，写文件失败返回 false）
+    QVariantMap stats() const;
+
+private:
+    void writerLoop();
+    void commitBatch(QVector<Entry> &batch);
+    bool writeSegment(const QVector<Entry> &batch); // 追加写入分段文件
+    bool insertRows(const QVector<Entry> &batch);   // 多行 INSERT 写入数据库
+    bool ensureConnection();
+
+    Options m_options;
+    MpscRing<Entry, 4096> m_ring;
+    QVector<Entry> m_retry; // 写库失败、待重试的记录（只由后台线程访问）
+    std::mutex m_segmentLock; // 分段文件：后台线程与队列满时同步写入的调用方共用
+    QString m_segmentPath;
+    int m_segmentIndex;
+    std::mutex m_overflowLock;
+    QVector<Entry> m_overflow; // 队列满时已同步写入文件、待后台线程写库的记录
+    QString m_connectionName;
+
+    std::thread m_writer;
+    std::atomic<bool> m_running;
+    std::mutex m_wakeLock;
+    std::condition_variable m_wake;
+
+    std::atomic<quint64> m_appended;
+    std::atomic<quint64> m_dropped;     // 同步写文件也失败的记录
+    std::atomic<quint64> m_syncWrites;  // 队列满时同步写文件的记录
+    std::atomic<quint64> m_fileCommitted;
+    std::atomic<quint64> m_dbCommitted;
+    std::atomic<quint64> m_batches;
+};
+
+#endif // AUDITJOURNAL_H
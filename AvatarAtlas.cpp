@@ -0,0 +1,259 @@
+#include "AvatarAtlas.h"
+#include <QBuffer>
+#include <QImageReader>
+#include <QPainter>
+#include <QVariantMap>
+
+AvatarAtlas::AvatarAtlas()
+    : m_nextCell(0)
+    , m_tick(0)
+{
+    MemoryGovernor::instance()->registerCache(this);
+}
+
+AvatarAtlas::~AvatarAtlas()
+{
+    MemoryGovernor::instance()->unregisterCache(this);
+}
+
+// 已在图集中返回格子
+bool AvatarAtlas::lookup(int userId, Slot *slot)
+{
+    QMutexLocker locker(&m_lock);
+    auto it = m_slots.constFind(userId);
+    if (it == m_slots.constEnd())
+        return false;
+    m_lastUsed[userId] = ++m_tick;
+    if (slot)
+        *slot = *it;
+    return true;
+}
+
+bool AvatarAtlas::knownWithoutAvatar(int userId) const
+{
+    QMutexLocker locker(&m_lock);
+    return m_withoutAvatar.contains(userId);
+}
+
+// 放入缩略图（图集已满且格子都被固定时返回无效格子）
+AvatarAtlas::Slot AvatarAtlas::insert(int userId, const QImage &thumbnail)
+{
+    QMutexLocker locker(&m_lock);
+    const int pages = m_pages.size();
+    m_withoutAvatar.remove(userId);
+    Slot slot = m_slots.value(userId);
+    if (!slot.isValid()) {
+        slot = allocateLocked();
+        if (!slot.isValid())
+            return slot;
+        m_slots.insert(userId, slot);
+    }
+    m_lastUsed[userId] = ++m_tick;
+
+    QPainter painter(&m_pages[slot.page]);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.fillRect(slot.rect, Qt::transparent);
+    painter.drawImage(slot.rect, thumbnail);
+    painter.end();
+    ++m_revisions[slot.page];
+
+    // 新建了图集页：释放自身锁后再通知 MemoryGovernor
+    const bool grew = m_pages.size() > pages;
+    locker.unlock();
+    if (grew)
+        MemoryGovernor::instance()->notifyGrowth();
+    return slot;
+}
+
+void AvatarAtlas::markWithoutAvatar(int userId)
+{
+    QMutexLocker locker(&m_lock);
+    m_withoutAvatar.insert(userId);
+}
+
+// 头像变化时移除，格子留给后续用户
+void AvatarAtlas::remove(int userId)
+{
+    QMutexLocker locker(&m_lock);
+    m_withoutAvatar.remove(userId);
+    auto it = m_slots.find(userId);
+    if (it == m_slots.end())
+        return;
+    m_free.append(*it);
+    m_slots.erase(it);
+    m_lastUsed.remove(userId);
+}
+
+QImage AvatarAtlas::page(int index) const
+{
+    QMutexLocker locker(&m_lock);
+    return index >= 0 && index < m_pages.size() ? m_pages.at(index) : QImage();
+}
+
+QString AvatarAtlas::pageUrl(int index) const
+{
+    QMutexLocker locker(&m_lock);
+    if (index < 0 || index >= m_pages.size())
+        return QString();
+    return QString("image://avatars/%1?v=%2").arg(index).arg(m_revisions.at(index));
+}
+
+// 给 QML 的格子描述
+QVariantMap AvatarAtlas::describe(const Slot &slot) const
+{
+    QVariantMap map;
+    if (!slot.isValid())
+        return map;
+    map["url"] = pageUrl(slot.page);
+    map["x"] = slot.rect.x();
+    map["y"] = slot.rect.y();
+    map["size"] = kCell;
+    map["pageSize"] = kPageSize;
+    return map;
+}
+
+// 固定一批头像（如一次 loadAvatarAtlas 请求的全部用户），同一批插入时不会互相挤掉格子
+void AvatarAtlas::pin(const QList<int> &userIds)
+{
+    QMutexLocker locker(&m_lock);
+    for (int userId : userIds)
+        ++m_pinned[userId];
+}
+
+void AvatarAtlas::unpin(const QList<int> &userIds)
+{
+    QMutexLocker locker(&m_lock);
+    for (int userId : userIds) {
+        auto it = m_pinned.find(userId);
+        if (it != m_pinned.end() && --it.value() <= 0)
+            m_pinned.erase(it);
+    }
+}
+
+qint64 AvatarAtlas::bytesUsed() const
+{
+    QMutexLocker locker(&m_lock);
+    return qint64(m_pages.size()) * kPageSize * kPageSize * 4;
+}
+
+// 从最后一页起整页释放（格子序号按页连续分配，释放末页后可从该页起重新分配）；
+// 页中有固定的头像时停止，这些用户之后重新加载头像时会放回图集
+qint64 AvatarAtlas::evictBytes(qint64 bytes)
+{
+    QMutexLocker locker(&m_lock);
+    const int perPage = (kPageSize / kCell) * (kPageSize / kCell);
+    const qint64 pageBytes = qint64(kPageSize) * kPageSize * 4;
+    qint64 freed = 0;
+    while (freed < bytes && !m_pages.isEmpty()) {
+        const int last = m_pages.size() - 1;
+        QList<int> users;
+        bool pinned = false;
+        for (auto it = m_slots.constBegin(); it != m_slots.constEnd(); ++it) {
+            if (it->page != last)
+                continue;
+            if (m_pinned.contains(it.key())) {
+                pinned = true;
+                break;
+            }
+            users.append(it.key());
+        }
+        if (pinned)
+            break;
+        for (int userId : users) {
+            m_slots.remove(userId);
+            m_lastUsed.remove(userId);
+        }
+        for (int i = m_free.size() - 1; i >= 0; --i) {
+            if (m_free.at(i).page == last)
+                m_free.removeAt(i);
+        }
+        m_pages.removeLast();
+        ++m_revisions[last]; // 重建该页时地址不同，QML 不会沿用旧纹理
+        m_nextCell = qMin(m_nextCell, last * perPage);
+        freed += pageBytes;
+    }
+    return freed;
+}
+
+// 解码头像并居中裁剪为正方形缩略图
+QImage AvatarAtlas::makeThumbnail(const QByteArray &blob, const QString &format)
+{
+    QByteArray data = blob;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer, format.toUtf8());
+    reader.setAutoTransform(true);
+
+    // 先按短边缩小解码，再裁剪中间的正方形
+    const QSize source = reader.size();
+    if (source.isValid() && reader.supportsOption(QImageIOHandler::ScaledSize)) {
+        const QSize scaled = source.scaled(kCell, kCell, Qt::KeepAspectRatioByExpanding);
+        if (scaled.width() < source.width())
+            reader.setScaledSize(scaled);
+    }
+    QImage img = reader.read();
+    if (img.isNull())
+        return QImage();
+    if (qMin(img.width(), img.height()) != kCell)
+        img = img.scaled(kCell, kCell, Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
+    const QRect crop((img.width() - kCell) / 2, (img.height() - kCell) / 2, kCell, kCell);
+    return img.copy(crop).convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
+
+// 分配空格子
+AvatarAtlas::Slot AvatarAtlas::allocateLocked()
+{
+    if (!m_free.isEmpty())
+        return m_free.takeLast();
+
+    const int perRow = kPageSize / kCell;
+    const int perPage = perRow * perRow;
+    if (m_nextCell < perPage * kMaxPages) {
+        const int cell = m_nextCell++;
+        Slot slot;
+        slot.page = cell / perPage;
+        const int index = cell % perPage;
+        slot.rect = QRect((index % perRow) * kCell, (index / perRow) * kCell, kCell, kCell);
+        // 按需创建图集页（释放过的页沿用原版本号继续递增）
+        while (m_pages.size() <= slot.page) {
+            QImage page(kPageSize, kPageSize, QImage::Format_ARGB32_Premultiplied);
+            page.fill(Qt::transparent);
+            m_pages.append(page);
+            if (m_revisions.size() < m_pages.size())
+                m_revisions.append(1);
+        }
+        return slot;
+    }
+
+    // 图集已满：复用最久未用且未固定的格子
+    int victim = -1;
+    qint64 oldest = 0;
+    for (auto it = m_lastUsed.constBegin(); it != m_lastUsed.constEnd(); ++it) {
+        if (m_pinned.contains(it.key()))
+            continue;
+        if (victim < 0 || it.value() < oldest) {
+            victim = it.key();
+            oldest = it.value();
+        }
+    }
+    if (victim < 0)
+        return Slot();
+    Slot slot = m_slots.take(victim);
+    m_lastUsed.remove(victim);
+    return slot;
+}
+
+AvatarAtlasProvider::AvatarAtlasProvider(AvatarAtlas *atlas)
+    : QQuickImageProvider(QQuickImageProvider::Image)
+    , m_atlas(atlas)
+{}
+
+// 返回整页图集（版本号只用于让 QML 在内容变化后重新加载）
+QImage AvatarAtlasProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
+{
+    Q_UNUSED(requestedSize)
+    const QImage image = m_atlas->page(id.section('?', 0, 0).toInt());
+    if (size)
+        *size = image.size();
+    return image;
+}
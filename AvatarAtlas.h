@@ -0,0 +1,83 @@
+#ifndef AVATARATLAS_H
+#define AVATARATLAS_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QQuickImageProvider>
+#include <QRect>
+#include <QSet>
+#include <QString>
+#include "MemoryGovernor.h"
+
+// 头像图集：用户列表的头像缩略图打包进少数几张大图（图集页），
+// 列表中所有头像共用同一个 image://avatars/<页> 地址，只上传一张 GPU 纹理，
+// 每个头像通过裁剪显示自己所在的格子
+// 图集页在 MemoryGovernor 中登记，内存紧张时从最后一页起整页释放（页中有固定的头像则不释放）
+class AvatarAtlas : public GovernedCache
+{
+public:
+    static constexpr int kCell = 64;       // 每个头像格子边长
+    static constexpr int kPageSize = 2048; // 图集页边长（每页 32x32=1024 个头像）
+    static constexpr int kMaxPages = 2;    // 最多页数，满后复用最久未用的格子
+
+    struct Slot
+    {
+        int page = -1;
+        QRect rect;
+        bool isValid() const { return page >= 0; }
+    };
+
+    AvatarAtlas();
+    ~AvatarAtlas() override;
+
+    bool lookup(int userId, Slot *slot);                      // 已在图集中返回格子
+    bool knownWithoutAvatar(int userId) const;                // 已确认没有头像（不必再查询）
+    Slot insert(int userId, const QImage &thumbnail);         // 放入缩略图
+    void markWithoutAvatar(int userId);                       // 记录没有头像的用户
+    void remove(int userId);                                  // 头像变化时移除
+    QImage page(int index) const;                             // 图集页图像
+    QString pageUrl(int index) const;                         // image://avatars/<页>?v=<版本>
+    QVariantMap describe(const Slot &slot) const;             // 给 QML 的格子描述（地址/坐标/尺寸）
+    void pin(const QList<int> &userIds);                      // 固定一批头像：复用格子和释放页时跳过
+    void unpin(const QList<int> &userIds);                    // 取消固定（与 pin 成对调用）
+
+    // GovernedCache
+    QString cacheName() const override { return "avatar_atlas"; }
+    qint64 bytesUsed() const override;
+    qint64 evictBytes(qint64 bytes) override;
+    double evictionCost() const override { return 1.5; } // 需要重新读取并解码头像
+
+    // 解码头像并居中裁剪为正方形缩略图（解码器支持时直接缩小解码）
+    static QImage makeThumbnail(const QByteArray &blob, const QString &format);
+
+private:
+    Slot allocateLocked(); // 分配空格子，没有空格子时淘汰最久未用且未固定的，全部固定时返回无效格子
+
+    mutable QMutex m_lock;
+    QList<QImage> m_pages;
+    QList<quint32> m_revisions;   // 每页版本号，内容变化时递增使 QML 重新加载纹理（释放页后保留，重建时继续递增）
+    QHash<int, Slot> m_slots;     // 用户 -> 格子
+    QHash<int, qint64> m_lastUsed;
+    QList<Slot> m_free;           // 已释放的格子
+    QSet<int> m_withoutAvatar;
+    QHash<int, int> m_pinned;     // 用户 -> 固定次数
+    int m_nextCell;               // 尚未使用过的下一个格子序号
+    qint64 m_tick;
+};
+
+// image://avatars/<页>?v=<版本> 的图片提供者
+class AvatarAtlasProvider : public QQuickImageProvider
+{
+public:
+    explicit AvatarAtlasProvider(AvatarAtlas *atlas);
+
+    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override;
+
+private:
+    AvatarAtlas *m_atlas;
+};
+
+#endif // AVATARATLAS_H
@@ -0,0 +1,231 @@
+#include "BlobStore.h"
+#include "AsyncLogger.h"
+#include <QSqlError>
+#include <QSqlQuery>
+
+const char *BlobStore::kAvatar = "avatar";
+const char *BlobStore::kPost = "post";
+
+// 建表（已存在则跳过）
+bool BlobStore::ensureSchema(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    const bool ok = query.exec(R"(
+        CREATE TABLE IF NOT EXISTS blob_chunks (
+            owner_kind VARCHAR(16) NOT NULL,
+            owner_id   INT NOT NULL,
+            seq        INT NOT NULL,
+            data       MEDIUMBLOB NOT NULL,
+            PRIMARY KEY (owner_kind, owner_id, seq)
+        )
+    )");
+    const bool versions = ok && query.exec(R"(
+        CREATE TABLE IF NOT EXISTS blob_versions (
+            owner_kind VARCHAR(16) NOT NULL,
+            owner_id   INT NOT NULL,
+            version    BIGINT NOT NULL DEFAULT 0,
+            PRIMARY KEY (owner_kind, owner_id)
+        )
+    )");
+    if (!versions)
+        FLOG_ERROR("db") << "[DB] 创建 blob_chunks/blob_versions 失败：" << query.lastError().text();
+    return versions;
+}
+
+// 写入整段数据
+bool BlobStore::write(QSqlDatabase &db, const QString &kind, int ownerId, const QByteArray &data)
+{
+    // 按块切片，QByteArray::fromRawData 不拷贝数据
+    bool ok = removeChunks(db, kind, ownerId);
+    for (int seq = 0, offset = 0; ok && offset < data.size(); ++seq, offset += kChunkSize) {
+        const int length = qMin(kChunkSize, int(data.size()) - offset);
+        ok = insertChunk(db, kind, ownerId, seq, QByteArray::fromRawData(data.constData() + offset, length));
+    }
+    return ok && bumpVersion(db, kind, ownerId);
+}
+
+// 从设备流式写入，任意时刻只持有一块数据
+bool BlobStore::write(QSqlDatabase &db, const QString &kind, int ownerId, QIODevice *source)
+{
+    if (!source || !source->isReadable())
+        return false;
+    bool ok = removeChunks(db, kind, ownerId);
+    for (int seq = 0; ok; ++seq) {
+        const QByteArray chunk = source->read(kChunkSize);
+        if (chunk.isEmpty())
+            break;
+        ok = insertChunk(db, kind, ownerId, seq, chunk);
+    }
+    return ok && bumpVersion(db, kind, ownerId);
+}
+
+// 按顺序逐块读取
+bool BlobStore::readChunks(QSqlDatabase &db,
+                           const QString &kind,
+                           int ownerId,
+                           const std::function<bool(const QByteArray &, int)> &consumer)
+{
+    QSqlQuery query(db);
+    query.setForwardOnly(true); // 不在客户端缓存已读行
+    query.prepare("SELECT seq, data FROM blob_chunks WHERE owner_kind = :kind AND owner_id = :id "
+                  "ORDER BY seq");
+    query.bindValue(":kind", kind);
+    query.bindValue(":id", ownerId);
+    if (!query.exec()) {
+        FLOG_WARN("db") << "读取分块失败：" << kind << ownerId << query.lastError().text();
+        return false;
+    }
+    bool any = false;
+    while (query.next()) {
+        any = true;
+        if (!consumer(query.value(1).toByteArray(), query.value(0).toInt()))
+            break;
+    }
+    return any;
+}
+
+// 读取并拼接全部分块
+QByteArray BlobStore::readAll(QSqlDatabase &db, const QString &kind, int ownerId)
+{
+    QByteArray data;
+    readChunks(db, kind, ownerId, [&data](const QByteArray &chunk, int) {
+        data.append(chunk);
+        return true;
+    });
+    return data;
+}
+
+// 删除全部分块
+bool BlobStore::remove(QSqlDatabase &db, const QString &kind, int ownerId)
+{
+    return removeChunks(db, kind, ownerId) && bumpVersion(db, kind, ownerId);
+}
+
+bool BlobStore::removeChunks(QSqlDatabase &db, const QString &kind, int ownerId)
+{
+    QSqlQuery query(db);
+    query.prepare("DELETE FROM blob_chunks WHERE owner_kind = :kind AND owner_id = :id");
+    query.bindValue(":kind", kind);
+    query.bindValue(":id", ownerId);
+    if (!query.exec()) {
+        FLOG_DEBUG("db") << "删除分块失败：" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+// 是否存在分块
+bool BlobStore::exists(QSqlDatabase &db, const QString &kind, int ownerId)
+{
+    QSqlQuery query(db);
+    query.prepare("SELECT 1 FROM blob_chunks WHERE owner_kind = :kind AND owner_id = :id AND seq = 0");
+    query.bindValue(":kind", kind);
+    query.bindValue(":id", ownerId);
+    return query.exec() && query.next();
+}
+
+// 内容版本
+qint64 BlobStore::version(QSqlDatabase &db, const QString &kind, int ownerId)
+{
+    QSqlQuery query(db);
+    query.prepare("SELECT version FROM blob_versions WHERE owner_kind = :kind AND owner_id = :id");
+    query.bindValue(":kind", kind);
+    query.bindValue(":id", ownerId);
+    if (!query.exec()) {
+        FLOG_DEBUG("db") << "读取分块版本失败：" << kind << ownerId << query.lastError().text();
+        return -1;
+    }
+    return query.next() ? query.value(0).toLongLong() : 0;
+}
+
+bool BlobStore::bumpVersion(QSqlDatabase &db, const QString &kind, int ownerId)
+{
+    QSqlQuery query(db);
+    query.prepare("INSERT INTO blob_versions (owner_kind, owner_id, version) VALUES (:kind, :id, 1) "
+                  "ON DUPLICATE KEY UPDATE version = version + 1");
+    query.bindValue(":kind", kind);
+    query.bindValue(":id", ownerId);
+    if (!query.exec()) {
+        FLOG_DEBUG("db") << "更新分块版本失败：" << kind << ownerId << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool BlobStore::insertChunk(QSqlDatabase &db, const QString &kind, int ownerId, int seq, const QByteArray &chunk)
+{
+    QSqlQuery query(db);
+    query.prepare("INSERT INTO blob_chunks (owner_kind, owner_id, seq, data) VALUES (:kind, :id, :seq, :data)");
+    query.bindValue(":kind", kind);
+    query.bindValue(":id", ownerId);
+    query.bindValue(":seq", seq);
+    query.bindValue(":data", chunk);
+    if (!query.exec()) {
+        FLOG_DEBUG("db") << "写入分块失败：" << kind << ownerId << seq << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+BlobChunkReader::BlobChunkReader(QSqlDatabase db, const QString &kind, int ownerId, QObject *parent)
+    : QIODevice(parent)
+    , m_db(db)
+    , m_kind(kind)
+    , m_ownerId(ownerId)
+    , m_nextSeq(0)
+    , m_offset(0)
+    , m_finished(false)
+{
+    open(QIODevice::ReadOnly);
+}
+
+qint64 BlobChunkReader::bytesAvailable() const
+{
+    return m_chunk.size() - m_offset + QIODevice::bytesAvailable();
+}
+
+bool BlobChunkReader::atEnd() const
+{
+    return m_finished && m_offset >= m_chunk.size() && QIODevice::bytesAvailable() == 0;
+}
+
+// 当前块读完时才查询下一块
+qint64 BlobChunkReader::readData(char *data, qint64 maxSize)
+{
+    qint64 copied = 0;
+    while (copied < maxSize) {
+        if (m_offset >= m_chunk.size() && !fetchNext())
+            break;
+        const qint64 length = qMin(maxSize - copied, qint64(m_chunk.size()) - m_offset);
+        memcpy(data + copied, m_chunk.constData() + m_offset, size_t(length));
+        m_offset += length;
+        copied += length;
+    }
+    return (copied == 0 && m_finished) ? -1 : copied;
+}
+
+bool BlobChunkReader::fetchNext()
+{
+    if (m_finished)
+        return false;
+    QSqlQuery query(m_db);
+    query.prepare("SELECT data FROM blob_chunks WHERE owner_kind = :kind AND owner_id = :id AND seq = :seq");
+    query.bindValue(":kind", m_kind);
+    query.bindValue(":id", m_ownerId);
+    query.bindValue(":seq", m_nextSeq);
+    const bool executed = query.exec();
+    if (!executed) {
+        FLOG_WARN("db") << "读取分块失败：" << m_kind << m_ownerId << m_nextSeq << query.lastError().text();
+        setErrorString(query.lastError().text());
+    }
+    if (!executed || !query.next()) {
+        m_finished = true;
+        m_chunk.clear();
+        m_offset = 0;
+        return false;
+    }
+    m_chunk = query.value(0).toByteArray();
+    m_offset = 0;
+    ++m_nextSeq;
+    return !m_chunk.isEmpty();
+}
@@ -0,0 +1,71 @@
+#ifndef BLOBSTORE_H
+#define BLOBSTORE_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QSqlDatabase>
+#include <QString>
+#include <functional>
+
+// 分块大字段存储：图片按固定大小切块写入 blob_chunks(owner_kind, owner_id, seq, data)，
+// 单条语句只携带一块数据，不受 max_allowed_packet 限制，服务端也不需要一次性拼出整张图片
+// 所有方法都使用调用方传入的连接（QSqlDatabase 不能跨线程使用）
+class BlobStore
+{
+public:
+    static constexpr int kChunkSize = 256 * 1024; // 每块大小（远小于 MySQL 默认 max_allowed_packet）
+
+    static const char *kAvatar; // owner_kind：用户头像（owner_id = Uid）
+    static const char *kPost;   // owner_kind：帖子图片（owner_id = posts.id）
+
+    static bool ensureSchema(QSqlDatabase &db); // 建表（已存在则跳过）
+
+    // 写入：先删除旧分块再按顺序写入；由调用方开启事务，失败时回滚
+    static bool write(QSqlDatabase &db, const QString &kind, int ownerId, const QByteArray &data);
+    static bool write(QSqlDatabase &db, const QString &kind, int ownerId, QIODevice *source); // 从设备流式写入
+
+    // 按顺序逐块读取，回调返回 false 时停止；返回是否读到至少一块
+    static bool readChunks(QSqlDatabase &db,
+                           const QString &kind,
+                           int ownerId,
+                           const std::function<bool(const QByteArray &chunk, int seq)> &consumer);
+    static QByteArray readAll(QSqlDatabase &db, const QString &kind, int ownerId); // 读取并拼接全部分块
+    static bool remove(QSqlDatabase &db, const QString &kind, int ownerId);         // 删除全部分块
+    static bool exists(QSqlDatabase &db, const QString &kind, int ownerId);         // 是否存在分块
+    // 内容版本：每次写入/删除递增（blob_versions），缓存据此判断是否过期；从未写过为 0，查询失败为 -1
+    static qint64 version(QSqlDatabase &db, const QString &kind, int ownerId);
+
+private:
+    static bool removeChunks(QSqlDatabase &db, const QString &kind, int ownerId);
+    static bool bumpVersion(QSqlDatabase &db, const QString &kind, int ownerId);
+    static bool insertChunk(QSqlDatabase &db, const QString &kind, int ownerId, int seq, const QByteArray &chunk);
+};
+
+// 分块读取设备：按需逐块查询，QImageReader 等解码器可以边取边解码，
+// 渐进式 JPEG / PNG 在最后一块到达前即可开始解码
+class BlobChunkReader : public QIODevice
+{
+public:
+    BlobChunkReader(QSqlDatabase db, const QString &kind, int ownerId, QObject *parent = nullptr);
+
+    bool isSequential() const override { return true; }
+    qint64 bytesAvailable() const override;
+    bool atEnd() const override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *, qint64) override { return -1; }
+
+private:
+    bool fetchNext(); // 取下一块，没有更多分块时返回 false
+
+    QSqlDatabase m_db;
+    QString m_kind;
+    int m_ownerId;
+    int m_nextSeq;
+    QByteArray m_chunk; // 当前块
+    qint64 m_offset;    // 当前块已读位置
+    bool m_finished;
+};
+
+#endif // BLOBSTORE_H
@@ -0,0 +1,295 @@
+#include "BookingPipeline.h"
+#include "AsyncLogger.h"
+#include "SqlStatements.h"
+#include <QDateTime>
+#include <QRandomGenerator>
+#include <QRegularExpression>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <vector>
+
+BookingPipeline::BookingPipeline()
+    : m_connectionName("QT_ODBC_BOOKING")
+    , m_running(false)
+    , m_requests(0)
+    , m_batches(0)
+    , m_failures(0)
+    , m_retries(0)
+    , m_maxBatchSeen(0)
+{}
+
+BookingPipeline::~BookingPipeline()
+{
+    stop();
+}
+
+// 启动工作线程
+void BookingPipeline::start(const Options &options)
+{
+    if (m_running.exchange(true))
+        return;
+    m_options = options;
+    m_worker = std::thread([this]() { workerLoop(); });
+}
+
+// 执行完已排队的请求后退出
+void BookingPipeline::stop()
+{
+    if (!m_running.exchange(false))
+        return;
+    m_wake.notify_one();
+    if (m_worker.joinable())
+        m_worker.join();
+}
+
+// 提交并等待所在批次完成
+BookingPipeline::Result BookingPipeline::book(const Request &request)
+{
+    std::future<Result> future;
+    {
+        std::lock_guard<std::mutex> locker(m_lock);
+        if (!m_running.load()) {
+            Result result;
+            result.error = "订票服务未启动";
+            return result;
+        }
+        Pending pending;
+        pending.request = request;
+        future = pending.promise.get_future();
+        m_queue.push_back(std::move(pending));
+    }
+    m_wake.notify_one();
+    return future.get();
+}
+
+QVariantMap BookingPipeline::stats() const
+{
+    QVariantMap map;
+    const quint64 requests = m_requests.load();
+    const quint64 batches = m_batches.load();
+    map["requests"] = requests;
+    map["batches"] = batches;
+    map["failures"] = m_failures.load();
+    map["retries"] = m_retries.load();
+    map["avg_batch"] = batches ? double(requests) / batches : 0.0;
+    map["max_batch"] = m_maxBatchSeen.load();
+    return map;
+}
+
+// ORD + yyyyMMddHHmmsszzz + 6 位十六进制进程标记（共 26 位）；同一毫秒内的多个订单顺延到下一毫秒，
+// 进程标记在进程启动时随机生成，多个客户端进程同一毫秒下单也不会生成相同的订单号
+QString BookingPipeline::nextOrderId()
+{
+    static const QString processTag
+        = QString("%1").arg(QRandomGenerator::system()->generate() & 0xFFFFFF, 6, 16, QChar('0')).toUpper();
+    static std::atomic<qint64> last{0};
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 previous = last.load();
+    qint64 next = 0;
+    do {
+        next = BookingProtocol::nextSequence(previous, now);
+    } while (!last.compare_exchange_weak(previous, next));
+    return QString("ORD%1%2").arg(QDateTime::fromMSecsSinceEpoch(next).toString("yyyyMMddHHmmsszzz"), processTag);
+}
+
+// 队列里已有多个请求时再等一个窗口（或攒够一批）合并执行；只有一个请求时立即执行，
+// 执行期间到达的请求自然攒成下一批，单个调用方不必多等一个窗口
+void BookingPipeline::workerLoop()
+{
+    for (;;) {
+        std::deque<Pending> batch;
+        {
+            std::unique_lock<std::mutex> locker(m_lock);
+            m_wake.wait(locker, [this]() { return !m_queue.empty() || !m_running.load(); });
+            if (m_queue.empty() && !m_running.load())
+                break;
+            if (m_queue.size() > 1) {
+                const auto deadline = std::chrono::steady_clock::now()
+                                      + std::chrono::milliseconds(m_options.windowMs);
+                m_wake.wait_until(locker, deadline, [this]() {
+                    return int(m_queue.size()) >= m_options.maxBatch || !m_running.load();
+                });
+            }
+            while (!m_queue.empty() && int(batch.size()) < m_options.maxBatch) {
+                batch.push_back(std::move(m_queue.front()));
+                m_queue.pop_front();
+            }
+        }
+        executeBatch(batch);
+    }
+
+    if (QSqlDatabase::contains(m_connectionName)) {
+        QSqlDatabase::database(m_connectionName, false).close();
+        QSqlDatabase::removeDatabase(m_connectionName);
+    }
+}
+
+// 驱动错误归类：连接错误、死锁、锁等待超时表示事务已被整体回滚，其余只是本条语句失败
+// QMYSQL 的 nativeErrorCode 是服务端错误码；QODBC 为 SQLSTATE 与错误码，死锁的 SQLSTATE 为 40001
+BookingProtocol::Outcome BookingPipeline::classify(const QSqlError &error)
+{
+    if (error.type() == QSqlError::ConnectionError)
+        return BookingProtocol::Outcome::Aborted;
+    const QString code = error.nativeErrorCode();
+    if (code.contains("40001"))
+        return BookingProtocol::Outcome::Aborted;
+    for (const QString &part : code.split(QRegularExpression("[^0-9]+"), Qt::SkipEmptyParts)) {
+        if (BookingProtocol::abortsTransaction(part.toInt()))
+            return BookingProtocol::Outcome::Aborted;
+    }
+    return BookingProtocol::Outcome::Failed;
+}
+
+BookingProtocol::Outcome BookingPipeline::outcome(QSqlQuery &query, bool executed)
+{
+    if (!executed)
+        return classify(query.lastError());
+    return query.numRowsAffected() > 0 ? BookingProtocol::Outcome::Ok : BookingProtocol::Outcome::NoRows;
+}
+
+// 一个事务执行整批，语句顺序与错误处理由 BookingProtocol::Batch 决定：
+// 每个请求一个保存点，余票不足或插入失败只回滚到自己的保存点；事务被整体回滚时整批重试；
+// 提交成功后才把结果交给调用方
+void BookingPipeline::executeBatch(std::deque<Pending> &batch)
+{
+    using BookingProtocol::Outcome;
+    using BookingProtocol::Step;
+    if (batch.empty())
+        return;
+    m_requests.fetch_add(batch.size());
+    m_batches.fetch_add(1);
+    quint64 seen = m_maxBatchSeen.load();
+    while (batch.size() > seen && !m_maxBatchSeen.compare_exchange_weak(seen, batch.size())) {}
+
+    BookingProtocol::Batch protocol(int(batch.size()), m_options.maxAttempts);
+    std::vector<Result> results(batch.size());
+    QSqlDatabase db;
+    QSqlQuery savepoint;
+    QSqlQuery seatQuery;
+    QSqlQuery orderQuery;
+    QString lastError;
+    bool connected = true;
+    while (!protocol.finished()) {
+        const int i = protocol.item();
+        const QString name = QString("b%1").arg(i);
+        Outcome outcome = Outcome::Ok;
+        switch (protocol.step()) {
+        case Step::Begin:
+            // 每次尝试重新取连接并预处理（上一次可能因连接中断而关闭）
+            if (!ensureConnection()) {
+                connected = false;
+                outcome = Outcome::Failed;
+                break;
+            }
+            db = QSqlDatabase::database(m_connectionName, false);
+            if (!db.transaction()) {
+                lastError = db.lastError().text();
+                db.close(); // 连接可能已失效，下一批重新连接
+                outcome = Outcome::Failed;
+                break;
+            }
+            if (protocol.attempt() > 1)
+                m_retries.fetch_add(1);
+            savepoint = QSqlQuery(db);
+            seatQuery = QSqlQuery(db);
+            seatQuery.prepare(Sql::Statement<Sql::Id::TakeSeat>::sql);
+            orderQuery = QSqlQuery(db);
+            orderQuery.prepare(Sql::Statement<Sql::Id::InsertOrder>::sql);
+            break;
+        case Step::Savepoint:
+            outcome = savepoint.exec("SAVEPOINT " + name) ? Outcome::Ok : classify(savepoint.lastError());
+            if (outcome != Outcome::Ok)
+                lastError = savepoint.lastError().text();
+            break;
+        case Step::TakeSeat:
+            Sql::bind<Sql::Id::TakeSeat>(seatQuery, batch[size_t(i)].request.flightId);
+            outcome = BookingPipeline::outcome(seatQuery, seatQuery.exec());
+            if (outcome == Outcome::NoRows)
+                results[size_t(i)].error = "航班已无余票或航班不存在";
+            else if (outcome != Outcome::Ok)
+                results[size_t(i)].error = lastError = "创建订单失败：" + seatQuery.lastError().text();
+            break;
+        case Step::InsertOrder: {
+            const Request &request = batch[size_t(i)].request;
+            results[size_t(i)].orderId = nextOrderId(); // 每次尝试都用新订单号
+            Sql::bind<Sql::Id::InsertOrder>(orderQuery, results[size_t(i)].orderId, request.userId,
+                                            request.flightId, request.passengerName, request.passengerIdcard,
+                                            request.requestKey, request.requestHash);
+            outcome = orderQuery.exec() ? Outcome::Ok : classify(orderQuery.lastError());
+            if (outcome != Outcome::Ok)
+                results[size_t(i)].error = lastError = "创建订单失败：" + orderQuery.lastError().text();
+            break;
+        }
+        case Step::ReleaseSavepoint:
+        case Step::RollbackToSavepoint: {
+            const QString sql = protocol.step() == Step::ReleaseSavepoint ? "RELEASE SAVEPOINT "
+                                                                           : "ROLLBACK TO SAVEPOINT ";
+            // 失败（如保存点已不存在）说明事务已被回滚，由协议整批重试
+            if (!savepoint.exec(sql + name)) {
+                lastError = savepoint.lastError().text();
+                outcome = Outcome::Aborted;
+            }
+            break;
+        }
+        case Step::Commit:
+            if (!db.commit()) {
+                lastError = db.lastError().text();
+                outcome = Outcome::Failed;
+            }
+            break;
+        case Step::Rollback:
+            FLOG_WARN("booking") << "批量下单第" << protocol.attempt() << "次尝试失败，整批回滚：" << lastError;
+            if (!db.rollback() || classify(db.lastError()) == Outcome::Aborted)
+                db.close(); // 连接可能已失效，下次尝试重新连接
+            break;
+        default:
+            break;
+        }
+        protocol.advance(outcome);
+    }
+
+    if (!protocol.committed()) {
+        QString error = "创建订单失败：数据库繁忙，请重试";
+        if (protocol.failure() == BookingProtocol::Batch::BeginFailed)
+            error = connected ? "创建订单失败：事务开启失败" : "创建订单失败：数据库未连接";
+        else if (protocol.failure() == BookingProtocol::Batch::CommitFailed)
+            error = "创建订单失败：事务提交失败";
+        FLOG_ERROR("booking") << "批量下单失败（" << batch.size() << "个请求，尝试" << protocol.attempt()
+                              << "次）：" << lastError;
+        for (size_t i = 0; i < batch.size(); ++i) {
+            Result result;
+            result.orderId = results[i].orderId;
+            result.error = error;
+            batch[i].promise.set_value(result);
+        }
+        m_failures.fetch_add(batch.size());
+        return;
+    }
+    for (size_t i = 0; i < batch.size(); ++i) {
+        Result &result = results[i];
+        result.success = protocol.succeeded(int(i));
+        if (!result.success)
+            m_failures.fetch_add(1);
+        batch[i].promise.set_value(result);
+    }
+    FLOG_DEBUG("booking") << "批量下单" << batch.size() << "个请求，一次提交（尝试" << protocol.attempt() << "次）";
+}
+
+// 工作线程自己的连接（QSqlDatabase 不能跨线程使用）
+bool BookingPipeline::ensureConnection()
+{
+    if (!QSqlDatabase::contains(m_connectionName)) {
+        if (!QSqlDatabase::contains(m_options.sourceConnection))
+            return false;
+        QSqlDatabase::cloneDatabase(m_options.sourceConnection, m_connectionName);
+    }
+    QSqlDatabase db = QSqlDatabase::database(m_connectionName, false);
+    if (db.isOpen())
+        return true;
+    if (!db.open()) {
+        FLOG_ERROR("booking") << "订票连接失败：" << db.lastError().text();
+        return false;
+    }
+    return true;
+}
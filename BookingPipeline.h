@@ -0,0 +1,90 @@
+#ifndef BOOKINGPIPELINE_H
+#define BOOKINGPIPELINE_H
+
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QString>
+#include <QVariantMap>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include "BookingProtocol.h"
+
+// 订票组提交：并发的下单请求在一个很短的窗口内（或攒够 N 个）合并到同一个事务执行，
+// 每个请求用独立的保存点，失败只回滚自己；整批只提交一次（一次刷盘）
+// 死锁等使整个事务回滚的错误整批重试；调用方阻塞等待自己那一批提交完成，各自拿到成功或失败结果
+class BookingPipeline
+{
+public:
+    struct Options
+    {
+        QString sourceConnection = "QT_ODBC_CONN"; // 复制其连接参数，工作线程使用独立连接
+        int windowMs = 2;                          // 队列中已有多个请求时最多再等待的时间
+        int maxBatch = 32;                         // 单批最多请求数
+        int maxAttempts = 3;                       // 事务被整体回滚（死锁、锁等待超时）时整批最多尝试次数
+    };
+
+    struct Request
+    {
+        int userId = 0;
+        QString flightId;
+        QString passengerName;
+        QString passengerIdcard;
+        QString requestKey;  // 幂等键（可为空），随订单写入
+        QString requestHash; // 下单参数摘要
+    };
+
+    struct Result
+    {
+        bool success = false;
+        QString orderId; // 失败时为最后一次尝试的订单号（提交结果不确定时供调用方按幂等键核对）
+        QString error;   // 失败原因（给界面显示）
+    };
+
+    BookingPipeline();
+    ~BookingPipeline();
+
+    void start(const Options &options); // 启动工作线程（重复调用无效）
+    void stop();                        // 执行完已排队的请求后退出
+    bool isRunning() const { return m_running.load(); }
+
+    Result book(const Request &request); // 提交并等待所在批次完成（任意线程）
+    QVariantMap stats() const;
+
+    static QString nextOrderId(); // ORD + 毫秒时间戳 + 进程标记，同一毫秒内顺延，跨进程不重复
+
+    // 驱动返回值归类为协议结果（DBManager 的下单/删除事务同样使用）
+    static BookingProtocol::Outcome classify(const QSqlError &error);
+    static BookingProtocol::Outcome outcome(QSqlQuery &query, bool executed); // 写语句：按影响行数区分
+
+private:
+    struct Pending
+    {
+        Request request;
+        std::promise<Result> promise;
+    };
+
+    void workerLoop();
+    void executeBatch(std::deque<Pending> &batch);
+    bool ensureConnection();
+
+    Options m_options;
+    QString m_connectionName;
+    std::thread m_worker;
+    std::atomic<bool> m_running;
+
+    std::mutex m_lock;
+    std::condition_variable m_wake;
+    std::deque<Pending> m_queue;
+
+    std::atomic<quint64> m_requests;
+    std::atomic<quint64> m_batches;
+    std::atomic<quint64> m_failures;
+    std::atomic<quint64> m_retries; // 整批重试次数
+    std::atomic<quint64> m_maxBatchSeen;
+};
+
+#endif // BOOKINGPIPELINE_H
@@ -0,0 +1,115 @@
+#include "BookingProcedure.h"
+#include "AsyncLogger.h"
+#include <QSqlError>
+#include <QVariant>
+
+const char *BookingProcedure::kName = "sp_book_seat";
+
+// 当前库中该过程的版本：COMMENT 为 "v<版本>"
+int BookingProcedure::installedVersion(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    query.prepare("SELECT ROUTINE_COMMENT FROM information_schema.ROUTINES "
+                  "WHERE ROUTINE_SCHEMA = DATABASE() AND ROUTINE_TYPE = 'PROCEDURE' AND ROUTINE_NAME = ?");
+    query.addBindValue(QString(kName));
+    if (!query.exec() || !query.next())
+        return 0;
+    const QString comment = query.value(0).toString();
+    return comment.startsWith('v') ? qMax(1, comment.mid(1).toInt()) : 1;
+}
+
+// 创建存储过程：已是当前版本则跳过（不每次 DROP + CREATE，避免其他客户端正在调用时过程短暂不存在）；
+// 版本不同时删除重建，只在升级时出现一次短暂缺失
+bool BookingProcedure::install(QSqlDatabase &db)
+{
+    const int version = installedVersion(db);
+    if (version == kVersion)
+        return true;
+
+    QSqlQuery query(db);
+    if (version != 0) {
+        FLOG_INFO("db") << "[DB] 存储过程" << kName << "版本" << version << "->" << kVersion << "，重建";
+        if (!query.exec(QString("DROP PROCEDURE IF EXISTS %1").arg(kName))) {
+            FLOG_ERROR("db") << "[DB] 删除旧存储过程" << kName << "失败：" << query.lastError().text();
+            return false;
+        }
+    }
+
+    // 客户端逐条发送语句，不需要 DELIMITER
+    const bool ok = query.exec(QString(R"(
+        CREATE PROCEDURE sp_book_seat(
+            IN p_order_id VARCHAR(32),
+            IN p_user_id INT,
+            IN p_flight_id VARCHAR(32),
+            IN p_passenger_name VARCHAR(64),
+            IN p_passenger_idcard VARCHAR(32),
+            IN p_request_key VARCHAR(64),
+            IN p_request_hash CHAR(40),
+            OUT p_error VARCHAR(512))
+        COMMENT 'v%1'
+        BEGIN
+            DECLARE EXIT HANDLER FOR SQLEXCEPTION
+            BEGIN
+                DECLARE v_errno INT;
+                DECLARE v_message TEXT;
+                GET DIAGNOSTICS CONDITION 1 v_errno = MYSQL_ERRNO, v_message = MESSAGE_TEXT;
+                ROLLBACK;
+                SET p_error = LEFT(CONCAT(v_errno, ': ', v_message), 512);
+                SELECT 2 AS status, NULL AS order_id, p_error AS error;
+            END;
+
+            SET p_error = NULL;
+            START TRANSACTION;
+            UPDATE flight SET remain_seats = remain_seats - 1
+             WHERE Flight_id = p_flight_id AND remain_seats > 0;
+            IF ROW_COUNT() = 0 THEN
+                ROLLBACK;
+                SELECT 1 AS status, NULL AS order_id, NULL AS error;
+            ELSE
+                INSERT INTO `order` (order_id, user_id, flight_id, passenger_name, passenger_idcard,
+                                     request_key, request_hash)
+                VALUES (p_order_id, p_user_id, p_flight_id, p_passenger_name, p_passenger_idcard,
+                        NULLIF(p_request_key, ''), NULLIF(p_request_hash, ''));
+                COMMIT;
+                SELECT 0 AS status, p_order_id AS order_id, NULL AS error;
+            END IF;
+        END
+    )").arg(kVersion));
+    if (!ok) {
+        // 并发安装时另一个客户端可能已经建好
+        if (installedVersion(db) == kVersion)
+            return true;
+        FLOG_ERROR("db") << "[DB] 创建存储过程" << kName << "失败：" << query.lastError().text();
+    }
+    return ok;
+}
+
+// 读取 CALL 返回的 (status, order_id, error)
+BookingProcedure::Result BookingProcedure::readResult(QSqlQuery &call)
+{
+    Result result;
+    if (!call.next()) {
+        result.error = "创建订单失败：存储过程未返回结果";
+        return result;
+    }
+    const int status = call.value(0).toInt();
+    switch (status) {
+    case Booked:
+        result.status = Booked;
+        result.orderId = call.value(1).toString();
+        break;
+    case SoldOut:
+        result.status = SoldOut;
+        result.error = "航班已无余票或航班不存在";
+        break;
+    default: {
+        result.status = Failed;
+        const QString error = call.value(2).toString();
+        if (!error.isEmpty())
+            FLOG_ERROR("db") << "[DB] 下单存储过程失败（已回滚）：" << error;
+        result.error = error.isEmpty() ? "创建订单失败：服务端已回滚" : "创建订单失败：" + error;
+        break;
+    }
+    }
+    return result;
+}
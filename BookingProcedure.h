@@ -0,0 +1,42 @@
+#ifndef BOOKINGPROCEDURE_H
+#define BOOKINGPROCEDURE_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+
+// 服务端下单存储过程 sp_book_seat：扣减余票与插入订单在服务端一个事务内完成，
+// 客户端只需一次 CALL 往返（原来 BEGIN / UPDATE / INSERT / COMMIT 四次往返，行锁跨网络持有）
+// 订单号仍由客户端生成（BookingPipeline::nextOrderId）作为参数传入，幂等键与参数摘要随订单写入（可为空），
+// 过程返回一行 (status, order_id, error)；
+// SQL 异常的错误码与信息同时写入 OUT 参数 p_error（客户端传 @sp_book_seat_error，从结果行读取，不多一次往返）
+// 过程定义带版本号（记在 COMMENT 中），版本变化时删除重建
+class BookingProcedure
+{
+public:
+    static const char *kName;         // 存储过程名
+    static constexpr int kVersion = 3; // 过程定义版本，修改过程体时递增
+
+    // 返回码（与过程内 SELECT 的 status 一致）
+    enum Status {
+        Booked = 0,  // 下单成功
+        SoldOut = 1, // 航班已无余票或航班不存在
+        Failed = 2,  // 插入订单失败等 SQL 异常，已在服务端回滚
+    };
+
+    struct Result
+    {
+        Status status = Failed;
+        QString orderId;
+        QString error; // 失败原因（给界面显示）
+        bool success() const { return status == Booked; }
+    };
+
+    static bool install(QSqlDatabase &db);   // 创建存储过程（已是当前版本则跳过，旧版本删除重建）
+    static int installedVersion(QSqlDatabase &db); // 当前库中该过程的版本（不存在为 0，无版本的旧定义为 1）
+
+    // 读取已执行的 CALL 语句返回的结果行
+    static Result readResult(QSqlQuery &call);
+};
+
+#endif // BOOKINGPROCEDURE_H
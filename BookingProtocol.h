@@ -0,0 +1,349 @@
+#ifndef BOOKINGPROTOCOL_H
+#define BOOKINGPROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 订票事务的语句协议：只决定“下一条执行什么语句、上一条的结果如何处理”，不访问数据库
+// 调用方循环 step() 执行对应语句，再用 advance() 交回结果分类，直到 finished()
+// 全部错误处理都在这里，执行者只负责把驱动返回值归类为 Outcome；
+// DBManager、BookingPipeline 与 booking_sim（内存数据库上的并发仿真）执行的是同一份协议
+namespace BookingProtocol {
+
+enum class Step {
+    Begin,
+    Savepoint,           // SAVEPOINT b<item>
+    TakeSeat,            // Sql::Id::TakeSeat
+    InsertOrder,         // Sql::Id::InsertOrder（执行前生成新的订单号）
+    OrderFlight,         // Sql::Id::OrderFlight（找到订单为 Ok，否则 NoRows）
+    DeleteOrder,         // Sql::Id::DeleteOrder
+    ReleaseSeat,         // Sql::Id::ReleaseSeat
+    ReleaseSavepoint,    // RELEASE SAVEPOINT b<item>
+    RollbackToSavepoint, // ROLLBACK TO SAVEPOINT b<item>
+    Commit,
+    Rollback,
+    Done,
+};
+
+// 一条语句的执行结果
+enum class Outcome {
+    Ok,      // 成功且影响了行
+    NoRows,  // 成功但没有影响行
+    Failed,  // 只有本条语句失败，事务仍然有效
+    Aborted, // 事务已被整体回滚：死锁、锁等待超时、连接中断、保存点已不存在
+};
+
+// MySQL 错误码：死锁时整个事务被回滚；锁等待超时按最坏情况（innodb_rollback_on_timeout）处理
+constexpr int kDeadlock = 1213;
+constexpr int kLockWaitTimeout = 1205;
+constexpr int kServerGone = 2006;
+constexpr int kServerLost = 2013;
+
+// 按服务端错误码判断失败是否让整个事务失效
+inline bool abortsTransaction(int nativeError)
+{
+    return nativeError == kDeadlock || nativeError == kLockWaitTimeout || nativeError == kServerGone
+           || nativeError == kServerLost;
+}
+
+// 订单号序号：进程内按毫秒单调递增，同一毫秒内顺延；不同进程由订单号中的进程标记区分
+inline std::int64_t nextSequence(std::int64_t last, std::int64_t nowMs)
+{
+    return nowMs > last ? nowMs : last + 1;
+}
+
+// 单笔下单（DBManager::createOrder 的事务路径）：BEGIN → TakeSeat → InsertOrder → COMMIT，失败时 ROLLBACK
+class Create
+{
+public:
+    enum Result {
+        Pending,
+        Booked,       // 已提交
+        SoldOut,      // 航班已无余票或航班不存在
+        BeginFailed,  // 事务开启失败
+        Error,        // 语句失败或事务已被回滚
+        CommitFailed, // 提交失败（结果不确定）
+    };
+
+    Step step() const { return m_step; }
+    bool finished() const { return m_step == Step::Done; }
+    Result result() const { return m_result; }
+
+    void advance(Outcome outcome)
+    {
+        const bool ok = outcome == Outcome::Ok || outcome == Outcome::NoRows;
+        switch (m_step) {
+        case Step::Begin:
+            if (ok)
+                m_step = Step::TakeSeat;
+            else
+                finish(BeginFailed);
+            return;
+        case Step::TakeSeat:
+            if (outcome == Outcome::Ok)
+                m_step = Step::InsertOrder;
+            else
+                rollback(outcome == Outcome::NoRows ? SoldOut : Error);
+            return;
+        case Step::InsertOrder:
+            if (ok)
+                m_step = Step::Commit;
+            else
+                rollback(Error);
+            return;
+        case Step::Commit:
+            if (ok)
+                finish(Booked);
+            else
+                rollback(CommitFailed);
+            return;
+        case Step::Rollback:
+            m_step = Step::Done;
+            return;
+        default:
+            return;
+        }
+    }
+
+private:
+    void rollback(Result result)
+    {
+        m_result = result;
+        m_step = Step::Rollback;
+    }
+
+    void finish(Result result)
+    {
+        m_result = result;
+        m_step = Step::Done;
+    }
+
+    Result m_result = Pending;
+    Step m_step = Step::Begin;
+};
+
+// 删除订单（DBManager::deleteOrder 的单库路径）：BEGIN → OrderFlight → DeleteOrder → ReleaseSeat → COMMIT，
+// 失败时 ROLLBACK；调用方在 OrderFlight 成功时记下订单所属航班，供 ReleaseSeat 使用
+class Delete
+{
+public:
+    enum Result {
+        Pending,
+        Deleted,      // 已提交
+        NotFound,     // 订单不存在
+        BeginFailed,  // 事务开启失败
+        Error,        // 语句失败、订单已被并发删除或事务已被回滚
+        SeatFailed,   // 释放座位失败（余票已满或航班不存在），订单删除已回滚
+        CommitFailed, // 提交失败（结果不确定）
+    };
+
+    Step step() const { return m_step; }
+    bool finished() const { return m_step == Step::Done; }
+    Result result() const { return m_result; }
+
+    void advance(Outcome outcome)
+    {
+        const bool ok = outcome == Outcome::Ok || outcome == Outcome::NoRows;
+        switch (m_step) {
+        case Step::Begin:
+            if (ok)
+                m_step = Step::OrderFlight;
+            else
+                finish(BeginFailed);
+            return;
+        case Step::OrderFlight:
+            if (outcome == Outcome::Ok)
+                m_step = Step::DeleteOrder;
+            else
+                rollback(outcome == Outcome::NoRows ? NotFound : Error);
+            return;
+        case Step::DeleteOrder:
+            if (outcome == Outcome::Ok)
+                m_step = Step::ReleaseSeat;
+            else
+                rollback(Error);
+            return;
+        case Step::ReleaseSeat:
+            if (outcome == Outcome::Ok)
+                m_step = Step::Commit;
+            else
+                rollback(outcome == Outcome::NoRows ? SeatFailed : Error);
+            return;
+        case Step::Commit:
+            if (ok)
+                finish(Deleted);
+            else
+                rollback(CommitFailed);
+            return;
+        case Step::Rollback:
+            m_step = Step::Done;
+            return;
+        default:
+            return;
+        }
+    }
+
+private:
+    void rollback(Result result)
+    {
+        m_result = result;
+        m_step = Step::Rollback;
+    }
+
+    void finish(Result result)
+    {
+        m_result = result;
+        m_step = Step::Done;
+    }
+
+    Result m_result = Pending;
+    Step m_step = Step::Begin;
+};
+
+// 组提交批次：一个事务，每个请求一个保存点；余票不足或插入失败只回滚到自己的保存点
+// 事务被整体回滚时（含回滚/释放保存点失败）整批重试，超过次数整批失败；只有 COMMIT 成功后结果才有效
+class Batch
+{
+public:
+    enum Verdict {
+        Pending, // 未执行或所在尝试已作废
+        Booked,  // 已写入（提交成功后生效）
+        SoldOut, // 航班已无余票或航班不存在
+        Error,   // 插入订单等语句失败
+    };
+
+    enum Failure {
+        None,
+        BeginFailed,  // 事务开启失败
+        Aborted,      // 事务多次被整体回滚
+        CommitFailed, // 提交失败（结果不确定，可能是应答丢失，不重试）
+    };
+
+    explicit Batch(int size, int maxAttempts = 3)
+        : m_verdicts(std::size_t(size > 0 ? size : 0), Pending)
+        , m_maxAttempts(maxAttempts > 0 ? maxAttempts : 1)
+    {}
+
+    Step step() const { return m_step; }
+    int item() const { return m_item; }         // 当前请求序号
+    int attempt() const { return m_attempt; }   // 第几次尝试（从 1 开始）
+    bool finished() const { return m_step == Step::Done; }
+    bool committed() const { return m_committed; }
+    Failure failure() const { return m_failure; }
+    Verdict verdict(int i) const { return m_verdicts[std::size_t(i)]; }
+    bool succeeded(int i) const { return m_committed && m_verdicts[std::size_t(i)] == Booked; }
+
+    void advance(Outcome outcome)
+    {
+        const bool ok = outcome == Outcome::Ok || outcome == Outcome::NoRows;
+        switch (m_step) {
+        case Step::Begin:
+            if (!ok) {
+                m_failure = BeginFailed;
+                m_step = Step::Done;
+                return;
+            }
+            m_item = 0;
+            m_step = m_verdicts.empty() ? Step::Commit : Step::Savepoint;
+            return;
+        case Step::Savepoint:
+            if (!ok)
+                abortAttempt();
+            else
+                m_step = Step::TakeSeat;
+            return;
+        case Step::TakeSeat:
+            if (outcome == Outcome::Ok)
+                m_step = Step::InsertOrder;
+            else
+                reject(outcome, outcome == Outcome::NoRows ? SoldOut : Error);
+            return;
+        case Step::InsertOrder:
+            if (ok)
+                m_step = Step::ReleaseSavepoint;
+            else
+                reject(outcome, Error);
+            return;
+        case Step::ReleaseSavepoint:
+            if (!ok) {
+                abortAttempt();
+                return;
+            }
+            m_verdicts[std::size_t(m_item)] = Booked;
+            nextItem();
+            return;
+        case Step::RollbackToSavepoint:
+            // 保存点回滚失败说明事务已不在（或状态未知），已执行的请求都不可信
+            if (!ok)
+                abortAttempt();
+            else
+                nextItem();
+            return;
+        case Step::Commit:
+            if (ok) {
+                m_committed = true;
+                m_step = Step::Done;
+                return;
+            }
+            m_failure = CommitFailed;
+            m_retry = false;
+            m_step = Step::Rollback;
+            return;
+        case Step::Rollback:
+            // ROLLBACK 的结果不影响判断：事务要么已回滚，要么随连接断开而回滚
+            if (m_retry && m_attempt < m_maxAttempts) {
+                ++m_attempt;
+                m_retry = false;
+                m_failure = None;
+                m_verdicts.assign(m_verdicts.size(), Pending);
+                m_step = Step::Begin;
+                return;
+            }
+            m_step = Step::Done;
+            return;
+        case Step::OrderFlight:
+        case Step::DeleteOrder:
+        case Step::ReleaseSeat:
+        case Step::Done:
+            return;
+        }
+    }
+
+private:
+    void reject(Outcome outcome, Verdict verdict)
+    {
+        if (outcome == Outcome::Aborted) {
+            abortAttempt();
+            return;
+        }
+        m_verdicts[std::size_t(m_item)] = verdict;
+        m_step = Step::RollbackToSavepoint;
+    }
+
+    void abortAttempt()
+    {
+        m_failure = Aborted;
+        m_retry = true;
+        m_step = Step::Rollback;
+    }
+
+    void nextItem()
+    {
+        ++m_item;
+        m_step = m_item < int(m_verdicts.size()) ? Step::Savepoint : Step::Commit;
+    }
+
+    std::vector<Verdict> m_verdicts;
+    int m_maxAttempts;
+    int m_attempt = 1;
+    int m_item = 0;
+    bool m_retry = false;
+    bool m_committed = false;
+    Failure m_failure = None;
+    Step m_step = Step::Begin;
+};
+
+} // namespace BookingProtocol
+
+#endif // BOOKINGPROTOCOL_H
@@ -17,6 +17,10 @@ HusRectangle{
         "phone":"",
         "idcard":""
     }
+    // 头像在图集中的位置（DBManager.loadAvatarAtlas 返回），没有头像时为 undefined
+    property var avatar_slot
+
+
 
 
     RowLayout{
@@ -25,6 +29,23 @@ HusRectangle{
         width:parent.width
         height:parent.height
         spacing:10
+        //头像：整页图集只加载一次，这里裁剪出自己的格子
+        Item{
+            Layout.preferredWidth: 48
+            Layout.preferredHeight: 48
+            clip: true
+            visible: !!avatar_slot
+            Image{
+                property real ratio: avatar_slot ? 48 / avatar_slot.size : 1
+                source: avatar_slot ? avatar_slot.url : ""
+                x: avatar_slot ? -avatar_slot.x * ratio : 0
+                y: avatar_slot ? -avatar_slot.y * ratio : 0
+                width: avatar_slot ? avatar_slot.pageSize * ratio : 0
+                height: width
+                smooth: true
+            }
+        }
+
         HusText{
             id:uidText
             width:30
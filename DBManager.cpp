@@ -1,13 +1,63 @@
 #include "DBManager.h"
+#include "AsyncLogger.h"
+#include "BlobStore.h"
+#include "BookingPipeline.h"
+#include "BookingProcedure.h"
+#include "Executor.h"
+#include "ImageCodec.h"
+#include "SqlBatch.h"
+#include "WorkloadTrace.h"
 #include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QImageReader>
 #include <QRegularExpression>
 #include <QSqlError>
 #include <QSqlQuery>
 #include <QUrl>
+#include <QUuid>
+#include <limits>
+#include <vector>
+
+namespace {
+// 座位意图登记后超过该时间仍未删除，视为操作中途中断，由对账处理
+constexpr int kSeatIntentGraceSeconds = 60;
+// 已缓存的头像地址在该时间内直接使用，超过后先核对版本（其他客户端可能已更换头像）
+constexpr qint64 kAvatarRecheckMs = 30 * 1000;
+// `order`.request_key 列宽
+constexpr int kRequestKeyMaxLength = 64;
+
+// 请求参数摘要（SHA-1 十六进制，40 位）：同一个幂等键被用于不同参数时据此拒绝
+QString argumentsHash(const QVariantList &args)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    for (const QVariant &arg : args) {
+        hash.addData(arg.typeId() == QMetaType::QByteArray ? arg.toByteArray() : arg.toString().toUtf8());
+        hash.addData(QByteArray(1, '\x1f')); // 分隔符，避免参数拼接后相同
+    }
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+// 收藏航班一行转为界面使用的字段
+QVariantMap collectedFlightMap(const QSqlRecord &record)
+{
+    QVariantMap flightMap;
+    flightMap["Flight_id"] = record.value("Flight_id").toString();
+    flightMap["Departure"] = record.value("Departure").toString();
+    flightMap["Destination"] = record.value("Destination").toString();
+    flightMap["depart_time"] = record.value("depart_time").toDateTime().toString("yyyy-MM-dd HH:mm:ss");
+    flightMap["arrive_time"] = record.value("arrive_time").toDateTime().toString("yyyy-MM-dd HH:mm:ss");
+    flightMap["price"] = record.value("price").toDouble();
+    flightMap["total_seats"] = record.value("total_seats").toInt();
+    flightMap["remain_seats"] = record.value("remain_seats").toInt();
+    flightMap["status"] = record.value("status").toInt();
+    return flightMap;
+}
+} // namespace
 
 // 初始化静态成员
 DBManager *DBManager::m_instance = nullptr;
-QMutex DBManager::m_mutex;
+QRecursiveMutex DBManager::m_mutex;
 
 DBManager::DBManager(QObject *parent)
     : QObject(parent)
@@ -16,19 +66,45 @@ DBManager::DBManager(QObject *parent)
     // 新增：用户相关成员变量初始化
     , m_isUserLoggedIn(false)
     , m_currentUserId(-1)
+    , m_bookingProcedureReady(false)
+    , m_useBookingPipeline(false)
+    , m_hotspotTicks(0)
 {
     initDBConfig();
-    // 加载 ODBC 驱动（仅初始化一次）
+    // 加载数据库驱动（仅初始化一次）；原生驱动不可用时退回 ODBC
+    // 连接名沿用 QT_ODBC_CONN，审计、订票等工作线程按此名复制连接参数
+    if (m_driver != "QODBC" && !QSqlDatabase::isDriverAvailable(m_driver)) {
+        FLOG_WARN("db") << "[DB] 驱动" << m_driver << "不可用，改用 QODBC";
+        m_driver = "QODBC";
+    }
     if (QSqlDatabase::contains("QT_ODBC_CONN")) {
         m_db = QSqlDatabase::database("QT_ODBC_CONN");
     } else {
-        m_db = QSqlDatabase::addDatabase("QODBC",
+        m_db = QSqlDatabase::addDatabase(m_driver,
                                          "QT_ODBC_CONN"); // 自定义连接名，避免与其他连接冲突
     }
+
+    // 航班数据变化时缓存整体失效，热点航班由定时器重新预热
+    connect(this, &DBManager::flightsChanged, this, [this]() { m_flightCache.invalidateAll(); });
+    connect(this, &DBManager::flightSeatsChanged, this, [this](const QString &flightId) {
+        m_flightCache.invalidate(flightId);
+    });
+    m_hotspotTimer = new QTimer(this);
+    m_hotspotTimer->setInterval(30 * 1000);
+    connect(m_hotspotTimer, &QTimer::timeout, this, &DBManager::onHotspotTick);
+    m_hotspotTimer->start();
+
+    // 点赞/喜欢定时批量写库
+    m_interactionTimer = new QTimer(this);
+    m_interactionTimer->setInterval(2000);
+    connect(m_interactionTimer, &QTimer::timeout, this, [this]() { flushInteractions(); });
+    m_interactionTimer->start();
 }
 
 DBManager::~DBManager()
 {
+    m_bookingPipeline.stop(); // 执行完已排队的下单请求
+    m_audit.stop();           // 提交剩余审计记录
     disconnectDB();
 }
 
@@ -44,18 +120,31 @@ DBManager *DBManager::getInstance(QObject *parent)
     return m_instance;
 }
 
-// 初始化 ODBC 连接参数
+// 初始化连接参数
 void DBManager::initDBConfig()
 {
-    m_dsn = "QtODBC_MySQL";                     // ODBC DSN 名称
-    m_user = "GYT";                             // 数据库用户名
-    m_password = "123456";                      // 数据库密码
-    m_databaseName = "flight_manage_system_db"; // 你要操作的数据库名
+    // 驱动：QODBC（默认，经 DSN）或 QMYSQL（原生客户端库，服务端预处理语句走二进制协议）
+    m_driver = qEnvironmentVariable("FLIGHT_DB_DRIVER", "QODBC").toUpper();
+    // 其余参数可用环境变量覆盖（回放、压测工具指向测试库）
+    m_dsn = qEnvironmentVariable("FLIGHT_DB_DSN", "QtODBC_MySQL");                 // ODBC DSN 名称
+    m_host = qEnvironmentVariable("FLIGHT_DB_HOST", "127.0.0.1");                  // QMYSQL 服务器地址
+    m_port = qEnvironmentVariableIsSet("FLIGHT_DB_PORT") ? qEnvironmentVariableIntValue("FLIGHT_DB_PORT")
+                                                         : 3306;                  // QMYSQL 端口
+    m_user = qEnvironmentVariable("FLIGHT_DB_USER", "GYT");                        // 数据库用户名
+    m_password = qEnvironmentVariable("FLIGHT_DB_PASSWORD", "123456");             // 数据库密码
+    m_databaseName = qEnvironmentVariable("FLIGHT_DB_NAME", "flight_manage_system_db"); // 你要操作的数据库名
+    m_queryTimeoutMs = 5000;                    // 查询默认截止时间（毫秒）
+    m_useBookingProcedure = qEnvironmentVariableIntValue("FLIGHT_BOOKING_PROCEDURE") != 0; // 下单走存储过程
+    m_useBookingPipeline = qEnvironmentVariableIntValue("FLIGHT_BOOKING_PIPELINE") != 0;   // 异步下单走组提交
+    // 用户数据分片：逗号分隔的库名（QMYSQL）或 DSN（QODBC），为空则不分片
+    m_shardNames = qEnvironmentVariable("FLIGHT_DB_SHARDS").split(',', Qt::SkipEmptyParts);
+    m_shards.configure(m_shardNames);
 }
 
 // 连接数据库
 bool DBManager::connectDB()
 {
+    WorkloadTrace::Scope trace("connectDB");
     QMutexLocker locker(&m_mutex); // 线程安全
 
     if (m_db.isOpen()) {
@@ -64,20 +153,54 @@ bool DBManager::connectDB()
         return true;
     }
 
-    // 配置连接参数（ODBC）
-    m_db.setDatabaseName(m_dsn);
+    // 配置连接参数
+    if (m_db.driverName() == "QMYSQL") {
+        m_db.setHostName(m_host);
+        m_db.setPort(m_port);
+        m_db.setDatabaseName(m_databaseName);
+        m_db.setConnectOptions("MYSQL_OPT_CONNECT_TIMEOUT=5");
+    } else {
+        m_db.setDatabaseName(m_dsn);
+    }
     m_db.setUserName(m_user);
     m_db.setPassword(m_password);
 
     // 打开连接
     bool success = m_db.open();
     if (success) {
-        qInfo() << "[DB] 连接成功！DSN:" << m_dsn;
+        FLOG_INFO("db") << "[DB] 连接成功！驱动:" << m_db.driverName()
+                        << (m_db.driverName() == "QMYSQL" ? m_host : m_dsn);
+        BlobStore::ensureSchema(m_db); // 图片分块表
+        ensureRequestKeyColumns(m_db); // 下单幂等键列（分片的 `order` 按主库表结构创建，先补主库）
+        m_bookingProcedureReady = m_useBookingProcedure && BookingProcedure::install(m_db);
+        // 主库仍有未迁移的用户时不启用分片（否则这些用户按 Uid 路由到分片后无法访问）
+        m_shards.configure(m_shardNames);
+        if (m_shards.isEnabled() && ShardRouter::homeHasUsers(m_db)) {
+            FLOG_ERROR("db") << "[DB] 主库 user_info 中仍有用户，迁移到分片前不启用分片";
+            m_shards.configure(QStringList());
+        }
+        if (m_shards.isEnabled()) {
+            if (!m_shards.open(m_db))
+                FLOG_WARN("db") << "[DB] 部分分片不可用，相关用户的操作将失败";
+            for (int i = 0; i < m_shards.shardCount(); ++i) {
+                QSqlDatabase shard = m_shards.database(i);
+                if (shard.isOpen())
+                    ensureRequestKeyColumns(shard); // 启用幂等键之前建好的分片表
+                QSqlQuery session(shard);
+                session.exec(QString("SET SESSION MAX_EXECUTION_TIME = %1").arg(qMax(0, m_queryTimeoutMs)));
+            }
+        }
+        prepareStatements(); // 登记语句预处理（分片时用户目录、座位意图表已补建）
+        if (m_shards.isEnabled())
+            reconcileSeatIntents();
+        m_audit.start(AuditJournal::Options());
+        if (m_useBookingPipeline)
+            m_bookingPipeline.start(BookingPipeline::Options());
         emit connectionStateChanged(true);
         emit operateResult(true, "数据库连接成功！");
     } else {
         QString errMsg = "[DB] 连接失败：" + m_db.lastError().text();
-        qCritical() << errMsg;
+        FLOG_ERROR("db") << errMsg;
         emit connectionStateChanged(false);
         emit operateResult(false, errMsg);
     }
@@ -87,11 +210,16 @@ bool DBManager::connectDB()
 // 断开连接
 void DBManager::disconnectDB()
 {
+    WorkloadTrace::Scope trace("disconnectDB");
+    flushInteractions(); // 断开前写入待写入的点赞/喜欢
     QMutexLocker locker(&m_mutex);
 
     if (m_db.isOpen()) {
+        releaseStatements();
+        m_shards.close();
         m_db.close();
-        qInfo() << "[DB] 连接已断开";
+        m_bookingProcedureReady = false;
+        FLOG_INFO("db") << "[DB] 连接已断开";
         emit connectionStateChanged(false);
         emit operateResult(true, "数据库已断开连接！");
     }
@@ -106,6 +234,7 @@ void DBManager::disconnectDB()
 // 检查连接状态
 bool DBManager::isConnected() const
 {
+    WorkloadTrace::Scope trace("isConnected");
     return m_db.isOpen();
 }
 
@@ -151,16 +280,17 @@ bool DBManager::isValidPasswordStrength(const QString &password)
 bool DBManager::isUsernameExists(const QString &User_name)
 {
     if (!m_db.isOpen()) {
-        qCritical() << "[DB] 检查用户名失败：数据库未连接！";
+        FLOG_ERROR("db") << "[DB] 检查用户名失败：数据库未连接！";
         return false;
     }
 
-    QSqlQuery query(m_db);
-    query.prepare("SELECT User_name FROM user_info WHERE User_name = :User_name");
-    query.bindValue(":User_name", User_name);
+    // 分片时用户名的唯一性由主库用户目录保证
+    QMutexLocker locker(&m_mutex);
+    QSqlQuery &query = m_shards.isEnabled() ? bound<Sql::Id::DirectoryNameTaken>(User_name)
+                                            : bound<Sql::Id::UserNameTaken>(User_name);
 
     if (!query.exec()) {
-        qCritical() << "[DB] 检查用户名失败：" << query.lastError().text();
+        FLOG_ERROR("db") << "[DB] 检查用户名失败：" << query.lastError().text();
         return false;
     }
 
@@ -171,16 +301,16 @@ bool DBManager::isUsernameExists(const QString &User_name)
 bool DBManager::isEmailExists(const QString &Email)
 {
     if (!m_db.isOpen()) {
-        qCritical() << "[DB] 检查邮箱失败：数据库未连接！";
+        FLOG_ERROR("db") << "[DB] 检查邮箱失败：数据库未连接！";
         return false;
     }
 
-    QSqlQuery query(m_db);
-    query.prepare("SELECT Email FROM user_info WHERE Email = :Email");
-    query.bindValue(":Email", Email);
+    QMutexLocker locker(&m_mutex);
+    QSqlQuery &query = m_shards.isEnabled() ? bound<Sql::Id::DirectoryEmailTaken>(Email)
+                                            : bound<Sql::Id::UserEmailTaken>(Email);
 
     if (!query.exec()) {
-        qCritical() << "[DB] 检查邮箱失败：" << query.lastError().text();
+        FLOG_ERROR("db") << "[DB] 检查邮箱失败：" << query.lastError().text();
         return false;
     }
 
@@ -197,9 +327,471 @@ QString DBManager::encryptPassword(const QString &password)
     return byteArray.toHex();
 }
 
+// 设置查询默认截止时间（毫秒，<=0 表示不限时）
+void DBManager::setQueryTimeout(int timeoutMs)
+{
+    WorkloadTrace::Scope trace("setQueryTimeout", [&]() { return QVariantList{timeoutMs}; });
+    m_queryTimeoutMs = timeoutMs;
+    // 预处理语句的文本固定，执行时间上限改用会话变量
+    QMutexLocker locker(&m_mutex);
+    if (m_db.isOpen()) {
+        QSqlQuery query(m_db);
+        query.exec(QString("SET SESSION MAX_EXECUTION_TIME = %1").arg(qMax(0, timeoutMs)));
+    }
+}
+
+// 下单改走服务端存储过程；未连接时只记录配置，连接后安装
+bool DBManager::setBookingProcedureEnabled(bool enabled)
+{
+    WorkloadTrace::Scope trace("setBookingProcedureEnabled", [&]() { return QVariantList{enabled}; });
+    QMutexLocker locker(&m_mutex);
+    m_useBookingProcedure = enabled;
+    m_bookingProcedureReady = enabled && m_db.isOpen() && BookingProcedure::install(m_db);
+    return !enabled || !m_db.isOpen() || m_bookingProcedureReady;
+}
+
+// 异步下单改走组提交；同步的 createOrder 始终直接执行（界面线程逐个调用时批次只有 1 个请求，
+// 组提交只多出保存点和跨线程等待），只有确有并发的异步下单才值得合并
+void DBManager::setBookingPipelineEnabled(bool enabled)
+{
+    WorkloadTrace::Scope trace("setBookingPipelineEnabled", [&]() { return QVariantList{enabled}; });
+    QMutexLocker locker(&m_mutex);
+    m_useBookingPipeline = enabled;
+    if (!enabled)
+        m_bookingPipeline.stop(); // 执行完已排队的下单请求（等待中的调用方不持有 m_mutex）
+    else if (m_db.isOpen())
+        m_bookingPipeline.start(BookingPipeline::Options());
+}
+
+// 取已预处理的登记语句（首次使用或预处理失败后重新预处理）
+QSqlQuery &DBManager::statement(Sql::Id id)
+{
+    std::unique_ptr<QSqlQuery> &slot = m_statements[std::size_t(id)];
+    if (slot) {
+        slot->finish(); // 释放上一次的结果集
+        return *slot;
+    }
+    const Sql::Entry &entry = Sql::kStatements[std::size_t(id)];
+    slot.reset(new QSqlQuery(m_db));
+    if (!slot->prepare(entry.sql)) {
+        FLOG_ERROR("db") << "[DB] 预处理失败：" << entry.name << slot->lastError().text();
+        QSqlQuery &failed = *slot;
+        m_failedStatement = std::move(slot); // 保留到下次调用，供调用方读取错误信息
+        return failed;
+    }
+    return *slot;
+}
+
+// 用户目录与座位意图表只在分片时创建，不分片时不预处理这些语句；下单存储过程未安装时不预处理 CALL
+bool DBManager::statementInUse(Sql::Id id) const
+{
+    switch (id) {
+    case Sql::Id::DirectoryNameTaken:
+    case Sql::Id::DirectoryEmailTaken:
+    case Sql::Id::DirectoryUidByName:
+    case Sql::Id::DirectoryUidByEmail:
+    case Sql::Id::InsertDirectory:
+    case Sql::Id::UpdateDirectoryName:
+    case Sql::Id::UpdateDirectoryEmail:
+    case Sql::Id::DeleteDirectory:
+    case Sql::Id::InsertSeatIntent:
+    case Sql::Id::DeleteSeatIntent:
+    case Sql::Id::StaleSeatIntents:
+    case Sql::Id::ResolveSeatIntent:
+    case Sql::Id::SeatIntentKind:
+    case Sql::Id::ForgetSeatIntent:
+    case Sql::Id::PurgeSeatIntents:
+        return m_shards.isEnabled();
+    case Sql::Id::BookSeat:
+        return m_bookingProcedureReady; // 过程未安装时预处理会失败
+    default:
+        return true;
+    }
+}
+
+// 连接建立（分片表已补建）后预处理登记语句
+void DBManager::prepareStatements()
+{
+    releaseStatements();
+    QElapsedTimer timer;
+    timer.start();
+    int prepared = 0;
+    int used = 0;
+    for (const Sql::Entry &entry : Sql::kStatements) {
+        if (!statementInUse(entry.id))
+            continue;
+        ++used;
+        statement(entry.id);
+        if (m_statements[std::size_t(entry.id)])
+            ++prepared;
+    }
+    QSqlQuery session(m_db);
+    session.exec(QString("SET SESSION MAX_EXECUTION_TIME = %1").arg(qMax(0, m_queryTimeoutMs)));
+    FLOG_INFO("db") << "[DB] 预处理语句" << prepared << "/" << used << "条，耗时" << timer.elapsed() << "ms";
+}
+
+// 会话级 MAX_EXECUTION_TIME 是默认上限；上下文剩余时间（向上取整到 100ms）与之不同时（已消耗部分时间，
+// 或调用方指定了本次的截止时间），本条语句执行前临时改为剩余时间，执行后恢复。
+// 新建的默认上下文取整后等于默认上限，不增加往返
+// 结果集在 exec 时已取回客户端（非 forwardOnly），恢复语句不影响随后的 next()
+bool DBManager::execWithDeadline(QSqlQuery &query, const QueryContext &ctx, const QSqlDatabase &db)
+{
+    const qint64 remaining = ctx.remainingMs();
+    if (remaining < 0)
+        return query.exec();
+    const int budget = int(qMax<qint64>(1, (remaining + 99) / 100 * 100));
+    if (m_queryTimeoutMs > 0 && budget == (m_queryTimeoutMs + 99) / 100 * 100)
+        return query.exec();
+    QSqlQuery session(db);
+    session.exec(QString("SET SESSION MAX_EXECUTION_TIME = %1").arg(budget));
+    const bool ok = query.exec();
+    session.exec(QString("SET SESSION MAX_EXECUTION_TIME = %1").arg(qMax(0, m_queryTimeoutMs)));
+    return ok;
+}
+
+// 查询条件按出发地(1)、目的地(2)、日期(4)组合成 8 种，各自一条能走索引的语句
+QSqlQuery &DBManager::flightSearch(const QString &departure, const QString &destination, const QString &departDate)
+{
+    const int mask = (departure.isEmpty() ? 0 : 1) | (destination.isEmpty() ? 0 : 2) | (departDate.isEmpty() ? 0 : 4);
+    switch (mask) {
+    case 1:
+        return bound<Sql::Id::FlightSearchDep>(departure);
+    case 2:
+        return bound<Sql::Id::FlightSearchDest>(destination);
+    case 3:
+        return bound<Sql::Id::FlightSearchRoute>(departure, destination);
+    case 4:
+        return bound<Sql::Id::FlightSearchDate>(departDate, departDate);
+    case 5:
+        return bound<Sql::Id::FlightSearchDepDate>(departure, departDate, departDate);
+    case 6:
+        return bound<Sql::Id::FlightSearchDestDate>(destination, departDate, departDate);
+    case 7:
+        return bound<Sql::Id::FlightSearchRouteDate>(departure, destination, departDate, departDate);
+    default:
+        return statement(Sql::Id::FlightSearch);
+    }
+}
+
+QSqlQuery &DBManager::collectedFlightSearch(int userId,
+                                            const QString &departure,
+                                            const QString &destination,
+                                            const QString &departDate)
+{
+    const int mask = (departure.isEmpty() ? 0 : 1) | (destination.isEmpty() ? 0 : 2) | (departDate.isEmpty() ? 0 : 4);
+    switch (mask) {
+    case 1:
+        return bound<Sql::Id::CollectedFlightsDep>(userId, departure);
+    case 2:
+        return bound<Sql::Id::CollectedFlightsDest>(userId, destination);
+    case 3:
+        return bound<Sql::Id::CollectedFlightsRoute>(userId, departure, destination);
+    case 4:
+        return bound<Sql::Id::CollectedFlightsDate>(userId, departDate, departDate);
+    case 5:
+        return bound<Sql::Id::CollectedFlightsDepDate>(userId, departure, departDate, departDate);
+    case 6:
+        return bound<Sql::Id::CollectedFlightsDestDate>(userId, destination, departDate, departDate);
+    case 7:
+        return bound<Sql::Id::CollectedFlightsRouteDate>(userId, departure, destination, departDate, departDate);
+    default:
+        return bound<Sql::Id::CollectedFlights>(userId);
+    }
+}
+
+// 释放预处理语句（断开连接前调用）
+void DBManager::releaseStatements()
+{
+    for (std::unique_ptr<QSqlQuery> &slot : m_statements)
+        slot.reset();
+    m_failedStatement.reset();
+}
+
+QSqlDatabase DBManager::userDatabase(int userId) const
+{
+    return m_shards.isEnabled() ? m_shards.database(m_shards.shardOf(userId)) : m_db;
+}
+
+// 用户目录只在分片时存在（主库），id 为 DirectoryUidByName / DirectoryUidByEmail，未找到返回 -1
+int DBManager::directoryUid(Sql::Id id, const QString &value)
+{
+    QSqlQuery &query = id == Sql::Id::DirectoryUidByEmail ? bound<Sql::Id::DirectoryUidByEmail>(value)
+                                                          : bound<Sql::Id::DirectoryUidByName>(value);
+    if (!query.exec()) {
+        FLOG_ERROR("db") << "[DB] 查询用户目录失败：" << query.lastError().text();
+        return -1;
+    }
+    return query.next() ? query.value(0).toInt() : -1;
+}
+
+// 用户名/邮箱变更先写目录（唯一约束在目录上），分片上的 user_info 随后更新
+// id 为 UpdateDirectoryName / UpdateDirectoryEmail
+bool DBManager::updateDirectory(Sql::Id id, int userId, const QString &value)
+{
+    if (!m_shards.isEnabled())
+        return true;
+    QSqlQuery &query = id == Sql::Id::UpdateDirectoryEmail ? bound<Sql::Id::UpdateDirectoryEmail>(value, userId)
+                                                           : bound<Sql::Id::UpdateDirectoryName>(value, userId);
+    if (!query.exec()) {
+        FLOG_ERROR("db") << "[DB] 更新用户目录失败：" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+// 一次 IN 查询取回一批航班，按航班号索引（订单、收藏在分片上，航班在主库，不能 JOIN）
+QHash<QString, QSqlRecord> DBManager::flightRecords(const QStringList &flightIds, const QString &columns)
+{
+    QHash<QString, QSqlRecord> flights;
+    QStringList ids = flightIds;
+    ids.removeDuplicates();
+    if (ids.isEmpty())
+        return flights;
+    QStringList placeholders;
+    for (int i = 0; i < ids.size(); ++i)
+        placeholders.append("?");
+    QSqlQuery query(m_db);
+    query.prepare(QString("SELECT Flight_id, %1 FROM flight WHERE Flight_id IN (%2)")
+                      .arg(columns, placeholders.join(", ")));
+    for (const QString &id : ids)
+        query.addBindValue(id);
+    if (!query.exec()) {
+        FLOG_ERROR("db") << "[DB] 批量查询航班失败：" << query.lastError().text();
+        return flights;
+    }
+    while (query.next())
+        flights.insert(query.value("Flight_id").toString(), query.record());
+    return flights;
+}
+
+// 生成查询上下文：timeoutMs > 0 为本次调用的截止时间（可长于或短于默认值），否则用默认截止时间
+QueryContext DBManager::makeQueryContext(int timeoutMs) const
+{
+    QueryContext ctx;
+    const int budget = timeoutMs > 0 ? timeoutMs : m_queryTimeoutMs;
+    if (budget > 0) {
+        ctx.deadline.setRemainingTime(budget);
+    }
+    return ctx;
+}
+
+// 查询超过截止时间：丢弃结果并通知界面
+void DBManager::reportAborted(const QString &operation)
+{
+    FLOG_WARN("db") << "[DB]" << operation << "超过截止时间，结果已丢弃";
+    emit queryTimedOut(operation);
+    emit operateResult(false, "查询超时，请稍后重试");
+}
+
+// 访问最多的航班（Count-Min Sketch 估计次数）
+QVariantList DBManager::hotFlights(int k) const
+{
+    WorkloadTrace::Scope trace("hotFlights", [&]() { return QVariantList{k}; });
+    return m_hotFlights.topEntries(k);
+}
+
+// 访问最多的航线（出发地->目的地）
+QVariantList DBManager::hotRoutes(int k) const
+{
+    WorkloadTrace::Scope trace("hotRoutes", [&]() { return QVariantList{k}; });
+    return m_hotRoutes.topEntries(k);
+}
+
+// 运行指标：热点航班/航线、航班缓存、各缓存内存占用
+QVariantMap DBManager::metrics() const
+{
+    WorkloadTrace::Scope trace("metrics");
+    QVariantMap result;
+    result["hot_flights"] = m_hotFlights.topEntries(10);
+    result["hot_routes"] = m_hotRoutes.topEntries(10);
+    result["flight_cache"] = m_flightCache.stats();
+    result["memory"] = MemoryGovernor::instance()->stats();
+    result["audit"] = m_audit.stats();
+    result["interactions"] = m_interactions.stats();
+    result["booking"] = m_bookingPipeline.stats();
+    result["executor"] = Executor::instance()->stats();
+    result["booking_procedure"] = m_bookingProcedureReady;
+    result["shards"] = m_shards.stats();
+    result["backend"] = m_db.driverName();
+    return result;
+}
+
+// 审计日志统计
+QVariantMap DBManager::auditStats() const
+{
+    WorkloadTrace::Scope trace("auditStats");
+    return m_audit.stats();
+}
+
+// 记录审计：操作者取当前登录的管理员，否则为当前用户
+void DBManager::audit(const QString &action, const QString &target, const QString &detail)
+{
+    AuditJournal::Entry entry;
+    if (m_isAdminLoggedIn) {
+        entry.actorKind = "admin";
+        entry.actorId = m_currentAdminId;
+        entry.actorName = m_currentAdminName;
+    } else if (m_isUserLoggedIn) {
+        entry.actorKind = "user";
+        entry.actorId = m_currentUserId;
+        entry.actorName = m_currentUserName;
+    } else {
+        entry.actorKind = "system";
+    }
+    entry.action = action;
+    entry.target = target;
+    entry.detail = detail;
+    m_audit.append(std::move(entry));
+}
+
+// 事务内先 SELECT ... FOR UPDATE 锁定航班行并读出旧值（审计记录新旧值），再执行 update
+// 值未变化时 update 影响 0 行，仍按成功处理（行已确认存在）
+int DBManager::updateFlightRow(const QString &flightId, QSqlQuery &update, QSqlRecord *before, QString *error)
+{
+    if (!m_db.transaction()) {
+        *error = m_db.lastError().text();
+        return -1;
+    }
+    QSqlQuery &current = bound<Sql::Id::FlightForUpdate>(flightId);
+    if (!current.exec()) {
+        *error = current.lastError().text();
+        m_db.rollback();
+        return -1;
+    }
+    if (!current.next()) {
+        m_db.rollback();
+        return 0;
+    }
+    *before = current.record();
+    if (!update.exec()) {
+        *error = update.lastError().text();
+        m_db.rollback();
+        return -1;
+    }
+    if (!m_db.commit()) {
+        *error = m_db.lastError().text();
+        m_db.rollback();
+        return -1;
+    }
+    return 1;
+}
+
+// 热点定时任务：预热并固定热点航班；每 10 分钟计数减半，让热点跟随近期流量
+void DBManager::onHotspotTick()
+{
+    warmHotFlights();
+    {
+        QMutexLocker locker(&m_mutex);
+        reconcileSeatIntents();
+    }
+    if (++m_hotspotTicks % 20 == 0) {
+        m_hotFlights.decay();
+        m_hotRoutes.decay();
+    }
+}
+
+// 用一次 IN 查询把 Top-K 热点航班载入缓存并固定
+void DBManager::warmHotFlights()
+{
+    const QStringList hotIds = m_hotFlights.topKeys(16);
+    m_flightCache.setPinned(hotIds);
+    if (hotIds.isEmpty())
+        return;
+
+    QMutexLocker locker(&m_mutex);
+    if (!m_db.isOpen())
+        return;
+
+    QStringList placeholders;
+    for (int i = 0; i < hotIds.size(); ++i) {
+        placeholders.append("?");
+    }
+    QSqlQuery query(m_db);
+    query.prepare(QString(R"(
+        SELECT Flight_id, Departure, Destination, depart_time, arrive_time,
+               status, price, total_seats, remain_seats
+        FROM flight
+        WHERE Flight_id IN (%1)
+    )").arg(placeholders.join(", ")));
+    for (const QString &id : hotIds) {
+        query.addBindValue(id);
+    }
+    if (!query.exec()) {
+        FLOG_WARN("db") << "[DB] 热点航班预热失败：" << query.lastError().text();
+        return;
+    }
+    while (query.next()) {
+        QVariantMap flightMap;
+        flightMap["Flight_id"] = query.value("Flight_id").toString();
+        flightMap["Departure"] = query.value("Departure").toString();
+        flightMap["Destination"] = query.value("Destination").toString();
+        flightMap["depart_time"]
+            = query.value("depart_time").toDateTime().toString("yyyy-MM-dd HH:mm:ss");
+        flightMap["arrive_time"]
+            = query.value("arrive_time").toDateTime().toString("yyyy-MM-dd HH:mm:ss");
+        flightMap["status"] = query.value("status").toInt();
+        flightMap["price"] = query.value("price").toDouble();
+        flightMap["total_seats"] = query.value("total_seats").toInt();
+        flightMap["remain_seats"] = query.value("remain_seats").toInt();
+        m_flightCache.insert(flightMap["Flight_id"].toString(), flightMap, true);
+    }
+}
+
+// 生成幂等键（客户端对同一次操作的重试需复用该键）
+QString DBManager::newRequestKey() const
+{
+    WorkloadTrace::Scope trace("newRequestKey");
+    return QUuid::createUuid().toString(QUuid::WithoutBraces);
+}
+
+// 按幂等键执行：首次执行，结果为最终结果（成功或确定的拒绝，默认只有 true）时记录，重复键直接返回首次结果；
+// 其余失败（连接或语句错误）放弃占用，客户端用同一个键重试会再次执行
+// 键带上操作名，不同操作误用同一个键时互不影响；记录中带参数摘要，同一个键换了参数时拒绝而不是返回首次结果
+// 只记在进程内：下单的幂等键随订单写入数据库（见 createOrder），不经这里
+QVariant DBManager::runIdempotent(const QString &operation,
+                                  const QString &requestKey,
+                                  const QVariantList &args,
+                                  const std::function<QVariant()> &op,
+                                  const std::function<bool(const QVariant &)> &isFinal)
+{
+    // 未连接时不记录，允许客户端连接恢复后使用同一个键重试
+    if (requestKey.isEmpty() || !isConnected()) {
+        return op();
+    }
+
+    const QString key = operation + ':' + requestKey;
+    const QString hash = argumentsHash(args);
+    QVariant cached;
+    switch (m_idempotency.begin(key, &cached)) {
+    case IdempotencyCache::Completed: {
+        const QVariantList record = cached.toList(); // (参数摘要, 首次结果)
+        if (record.value(0).toString() != hash) {
+            FLOG_WARN("db") << "[DB] 幂等键" << key << "已用于参数不同的请求，拒绝";
+            emit operateResult(false, "幂等键已用于其他请求");
+            return QVariant();
+        }
+        FLOG_INFO("db") << "[DB] 幂等键" << key << "重复提交，返回首次执行结果";
+        return record.value(1);
+    }
+    case IdempotencyCache::InFlight:
+        emit operateResult(false, "请求正在处理中，请勿重复提交");
+        return QVariant();
+    case IdempotencyCache::New:
+        break;
+    }
+
+    QVariant result = op();
+    if (isFinal ? isFinal(result) : result.toBool())
+        m_idempotency.complete(key, QVariantList{hash, result});
+    else
+        m_idempotency.abandon(key);
+    return result;
+}
+
 // 用户注册
 int DBManager::userRegister(const QString &Email, const QString &User_name, const QString &Password)
 {
+    WorkloadTrace::Scope trace("userRegister", [&]() { return QVariantList{Email, User_name, Password}; });
     QMutexLocker locker(&m_mutex); // 线程安全
 
     // 1. 检查数据库连接
@@ -247,33 +839,38 @@ int DBManager::userRegister(const QString &Email, const QString &User_name, cons
     // 7. 加密密码
     QString encryptedPwd = encryptPassword(Password);
 
-    // 8. 插入用户数据
-    QSqlQuery query(m_db);
-    QString insertSql = R"(
-        INSERT INTO user_info (Email, User_name, Password)
-        VALUES (:Email, :User_name, :Password)
-    )";
-
-    if (!query.prepare(insertSql)) {
-        QString errMsg = "[DB] 注册预处理失败：" + query.lastError().text();
-        qCritical() << errMsg;
-        emit userRegisterFailed("注册失败：数据库操作错误！");
-        return 0;
-    }
-
-    query.bindValue(":Email", Email);
-    query.bindValue(":User_name", User_name);
-    query.bindValue(":Password", encryptedPwd);
+    // 8. 插入用户数据（分片时先在主库用户目录分配 Uid，再写入该 Uid 所在的分片）
+    int userId = -1;
+    if (m_shards.isEnabled()) {
+        QSqlQuery &directory = bound<Sql::Id::InsertDirectory>(User_name, Email);
+        if (!directory.exec()) {
+            FLOG_ERROR("db") << "[DB] 登记用户目录失败：" << directory.lastError().text();
+            emit userRegisterFailed("注册失败：" + directory.lastError().text());
+            return 6;
+        }
+        userId = directory.lastInsertId().toInt();
+    }
+    // 分片写入失败时撤销目录登记，用户名/邮箱可以再次注册
+    auto undoDirectory = [&]() {
+        if (userId <= 0)
+            return;
+        bound<Sql::Id::DeleteDirectory>(userId).exec();
+    };
+    QSqlQuery &query = userId > 0
+                           ? userBound<Sql::Id::InsertUserWithUid>(userId, userId, Email, User_name, encryptedPwd)
+                           : bound<Sql::Id::InsertUser>(Email, User_name, encryptedPwd);
 
     bool success = query.exec();
+    if (!success)
+        undoDirectory();
     if (success) {
-        qInfo() << "[DB] 用户 " << User_name << " 注册成功！";
+        FLOG_INFO("db") << "[DB] 用户 " << User_name << " 注册成功！";
         emit userRegisterSuccess(User_name);
         emit operateResult(true, "注册成功！");
         return 5;
     } else {
         QString errMsg = "[DB] 注册插入失败：" + query.lastError().text();
-        qCritical() << errMsg;
+        FLOG_ERROR("db") << errMsg;
         emit userRegisterFailed("注册失败：" + query.lastError().text());
         return 6;
     }
@@ -282,6 +879,8 @@ int DBManager::userRegister(const QString &Email, const QString &User_name, cons
 // 用户登录
 int DBManager::userLogin(const QString &User_name, const QString &Password)
 {
+    WorkloadTrace::beginSession(); // 录制：登录开始新会话，回放时同一会话在同一进程内执行
+    WorkloadTrace::Scope trace("userLogin", [&]() { return QVariantList{User_name, Password}; });
     QMutexLocker locker(&m_mutex); // 线程安全
 
     // 1. 检查数据库连接
@@ -298,14 +897,20 @@ int DBManager::userLogin(const QString &User_name, const QString &Password)
         return 3;
     }
 
-    // 3. 查询用户信息
-    QSqlQuery query(m_db);
-    query.prepare("SELECT Uid, Email, Password, phone, idcard FROM user_info WHERE User_name = :User_name");
-    query.bindValue(":User_name", User_name);
+    // 3. 查询用户信息（分片时先从主库用户目录取得 Uid，再到其所在分片查询）
+    int directoryId = -1;
+    if (m_shards.isEnabled()) {
+        directoryId = directoryUid(Sql::Id::DirectoryUidByName, User_name);
+        if (directoryId <= 0) {
+            emit userLoginFailed("登录失败：用户名不存在！");
+            return 1;
+        }
+    }
+    QSqlQuery &query = userBound<Sql::Id::UserByName>(directoryId, User_name);
 
     if (!query.exec()) {
         QString errMsg = "[DB] 登录查询失败：" + query.lastError().text();
-        qCritical() << errMsg;
+        FLOG_ERROR("db") << errMsg;
         emit userLoginFailed("登录失败：数据库操作错误！");
         return 0;
     }
@@ -332,7 +937,7 @@ int DBManager::userLogin(const QString &User_name, const QString &Password)
     m_currentUserPhone = query.value("phone").toString();
     m_currentUserIdCard = query.value("idcard").toString();
 
-    qInfo() << "[DB] 用户 " << User_name << " 登录成功！";
+    FLOG_INFO("db") << "[DB] 用户 " << User_name << " 登录成功！";
     emit userLoginStateChanged(true);
     emit userLoginSuccess(User_name);
     emit operateResult(true, "登录成功！");
@@ -343,6 +948,7 @@ int DBManager::userLogin(const QString &User_name, const QString &Password)
 // 用户登出
 void DBManager::userLogout()
 {
+    WorkloadTrace::Scope trace("userLogout");
     QMutexLocker locker(&m_mutex); // 线程安全
 
     // 重置用户登录状态
@@ -351,7 +957,7 @@ void DBManager::userLogout()
     m_currentUserName.clear();
     m_currentUserEmail.clear();
 
-    qInfo() << "[DB] 用户已登出";
+    FLOG_INFO("db") << "[DB] 用户已登出";
     emit userLoginStateChanged(false);
     emit userLogoutSuccess();
     emit operateResult(true, "登出成功！");
@@ -361,6 +967,7 @@ void DBManager::userLogout()
 // 上传头像：传入用户ID+图片路径，自动处理所有逻辑（推荐调用这个）
 bool DBManager::uploadUserAvatar(int userId, const QString& imgPath, int quality)
 {
+    WorkloadTrace::Scope trace("uploadUserAvatar", [&]() { return QVariantList{userId, imgPath, quality}; });
     //将路径修改为合法路径
     QString path=imgPath.mid(8);
     path = path.replace('/', '\\');
@@ -371,17 +978,25 @@ bool DBManager::uploadUserAvatar(int userId, const QString& imgPath, int quality
         return false;
     }
 
-    QByteArray imgBlob = readImageToBlob(path, quality);
-    if (imgBlob.isEmpty()) {
-        emit operateResult(false, "头像图片读取失败");
-        return false;
-    }
-    // 获取图片格式
-    QString imgFormat = imgPath.split(".").last().toLower();
-    if (imgFormat == "jpeg")
-        imgFormat = "jpg";
-    // 调用二进制上传函数
-    return uploadUserAvatarByBlob(userId, imgBlob, imgFormat);
+    // 解码和编码（按内容选择 WebP/JPEG/PNG）在执行器上进行，完成后回到界面线程写库（连接属于界面线程）
+    // 返回 true 只表示已开始处理，结果经 operateResult 通知
+    auto *watcher = new QFutureWatcher<ImageCodec::Encoded>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, userId]() {
+        watcher->deleteLater();
+        const ImageCodec::Encoded encoded = watcher->isCanceled() ? ImageCodec::Encoded() : watcher->result();
+        if (encoded.isNull()) {
+            emit operateResult(false, "头像图片读取失败");
+            return;
+        }
+        emit imageEncoded("avatar", encoded.format, encoded.sourceBytes, encoded.blob.size(),
+                          encoded.legacyBytes);
+        // 调用二进制上传函数
+        uploadUserAvatarByBlob(userId, encoded.blob, encoded.format);
+    });
+    watcher->setFuture(Executor::instance()->run(Executor::Normal, [path, quality]() {
+        return ImageCodec::encodeFile(path, quality);
+    }));
+    return true;
 }
 
 // 上传头像：二进制+格式 版本（内部调用/备用）
@@ -389,22 +1004,48 @@ bool DBManager::uploadUserAvatarByBlob(int userId,
                                        const QByteArray &imgBlob,
                                        const QString &imgFormat)
 {
+    WorkloadTrace::Scope trace("uploadUserAvatarByBlob", [&]() { return QVariantList{userId, imgBlob, imgFormat}; });
     if (!isConnected() || userId <= 0 || imgBlob.isEmpty() || imgFormat.isEmpty()) {
         emit operateResult(false, "参数错误");
         return false;
     }
-    QSqlQuery query(m_db);
-    query.prepare("UPDATE user_info SET avatar_blob = :avatar_blob, avatar_format = :avatar_format "
-                  "WHERE Uid = :user_id");
-    query.bindValue(":avatar_blob", imgBlob);
-    query.bindValue(":avatar_format", imgFormat);
-    query.bindValue(":user_id", userId);
-
-    if (!query.exec() || query.numRowsAffected() == 0) {
-        qDebug() << "更新头像失败：" << query.lastError().text();
+    QMutexLocker locker(&m_mutex);
+    QSqlQuery &exists = userBound<Sql::Id::UserExists>(userId, userId);
+    if (!exists.exec() || !exists.next()) {
+        locker.unlock();
+        emit operateResult(false, "头像上传失败：用户不存在");
+        return false;
+    }
+
+    // 头像按块写入 blob_chunks，原 avatar_blob 字段置空（旧数据读取时仍兼容）
+    // 先写分块再更新格式：分片时 user_info 不在主库事务内，格式更新失败仍可回滚分块
+    m_db.transaction();
+    if (!BlobStore::write(m_db, BlobStore::kAvatar, userId, imgBlob)) {
+        FLOG_DEBUG("db") << "写入头像分块失败";
+        m_db.rollback();
+        locker.unlock();
+        emit operateResult(false, "头像上传失败");
+        return false;
+    }
+    QSqlQuery &query = userBound<Sql::Id::SetAvatarFormat>(userId, imgFormat, userId);
+    if (!query.exec()) {
+        FLOG_DEBUG("db") << "更新头像失败：" << query.lastError().text();
+        m_db.rollback();
+        locker.unlock();
         emit operateResult(false, "头像上传失败");
         return false;
     }
+    const qint64 version = BlobStore::version(m_db, BlobStore::kAvatar, userId);
+    if (!m_db.commit()) {
+        m_db.rollback();
+        locker.unlock();
+        emit operateResult(false, "头像上传失败：事务提交失败");
+        return false;
+    }
+    m_avatarStamps.insert(userId, {version, QDateTime::currentMSecsSinceEpoch()});
+    locker.unlock();
+    m_imageStore.put(ImageStore::avatarKey(userId), imgBlob, imgFormat);
+    m_avatarAtlas.remove(userId);
     emit operateResult(true, "头像上传成功");
     return true;
 }
@@ -412,11 +1053,15 @@ bool DBManager::uploadUserAvatarByBlob(int userId,
 // 获取用户头像二进制
 QByteArray DBManager::getUserAvatarBlob(int userId)
 {
+    WorkloadTrace::Scope trace("getUserAvatarBlob", [&]() { return QVariantList{userId}; });
     if (!isConnected() || userId <= 0)
         return QByteArray();
-    QSqlQuery query(m_db);
-    query.prepare("SELECT avatar_blob FROM user_info WHERE Uid = :user_id");
-    query.bindValue(":user_id", userId);
+    QMutexLocker locker(&m_mutex);
+    // 优先读取分块数据，没有分块时兼容旧的 avatar_blob 字段
+    QByteArray blob = readBlobStream(BlobStore::kAvatar, userId);
+    if (!blob.isEmpty())
+        return blob;
+    QSqlQuery &query = userBound<Sql::Id::UserAvatarBlob>(userId, userId);
     if (query.exec() && query.next()) {
         return query.value("avatar_blob").toByteArray();
     }
@@ -426,30 +1071,243 @@ QByteArray DBManager::getUserAvatarBlob(int userId)
 // 获取用户头像格式
 QString DBManager::getUserAvatarFormat(int userId)
 {
+    WorkloadTrace::Scope trace("getUserAvatarFormat", [&]() { return QVariantList{userId}; });
     if (!isConnected() || userId <= 0)
         return "";
-    QSqlQuery query(m_db);
-    query.prepare("SELECT avatar_format FROM user_info WHERE Uid = :user_id");
-    query.bindValue(":user_id", userId);
+    QMutexLocker locker(&m_mutex);
+    QSqlQuery &query = userBound<Sql::Id::UserAvatarFormat>(userId, userId);
     if (query.exec() && query.next()) {
         return query.value("avatar_format").toString();
     }
     return "";
 }
 
+// 获取用户头像地址（image://blobs/avatar/<uid>），头像字节不进入 QML
+// 已缓存的地址超过 kAvatarRecheckMs 后核对 blob_versions，版本变化（其他客户端更换/移除头像）时重新读取
+QString DBManager::getUserAvatarUrl(int userId)
+{
+    WorkloadTrace::Scope trace("getUserAvatarUrl", [&]() { return QVariantList{userId}; });
+    const QString key = ImageStore::avatarKey(userId);
+    QString url = m_imageStore.urlFor(key);
+    if (!isConnected() || userId <= 0)
+        return url;
+
+    QMutexLocker locker(&m_mutex);
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    AvatarStamp &stamp = m_avatarStamps[userId];
+    if (!url.isEmpty() && now - stamp.checkedAt < kAvatarRecheckMs)
+        return url;
+    const qint64 version = BlobStore::version(m_db, BlobStore::kAvatar, userId);
+    // 版本未变，或暂时无法核对时沿用缓存
+    if (!url.isEmpty() && (version == stamp.version || version < 0)) {
+        stamp.checkedAt = now;
+        return url;
+    }
+
+    QSqlQuery &query = userBound<Sql::Id::UserAvatar>(userId, userId);
+    if (!query.exec())
+        return url;
+    if (query.next()) {
+        QByteArray blob = query.value("avatar_blob").toByteArray();
+        if (blob.isEmpty())
+            blob = readBlobStream(BlobStore::kAvatar, userId);
+        url = m_imageStore.put(key, blob, query.value("avatar_format").toString()); // 没有头像时移除缓存
+    } else {
+        m_imageStore.remove(key); // 用户已删除
+        url.clear();
+    }
+    stamp = {version, now};
+    return url;
+}
+
+// C++ 侧图片缓存（供 image://blobs 图片提供者使用）
+ImageStore *DBManager::imageStore()
+{
+    return &m_imageStore;
+}
+
+// 批量加载头像到图集：未缓存的用户用一次查询取回（旧字段与分块一并关联；分片时每个分片一次），
+// 返回已在图集中的 { "uid": { url, x, y, size, pageSize } }，没有头像的用户不出现在结果中；
+// 缺失的头像在执行器上解码，放入图集后发出 avatarAtlasUpdated（整批的格子描述）
+QVariantMap DBManager::loadAvatarAtlas(const QVariantList &userIds)
+{
+    WorkloadTrace::Scope trace("loadAvatarAtlas", [&]() { return QVariantList{QVariant(userIds)}; });
+
+    // 固定本批全部用户：插入缺失头像复用格子时不会挤掉本批已在图集中或刚放入的头像，
+    // 内存紧张时也不会释放它们所在的页
+    QList<int> batch;
+    for (const QVariant &value : userIds)
+        batch.append(value.toInt());
+    m_avatarAtlas.pin(batch);
+
+    QList<int> missing;
+    for (const QVariant &value : userIds) {
+        const int userId = value.toInt();
+        if (userId > 0 && !m_avatarAtlas.lookup(userId, nullptr)
+            && !m_avatarAtlas.knownWithoutAvatar(userId) && !missing.contains(userId))
+            missing.append(userId);
+    }
+
+    auto describe = [this](const QVariantList &ids) {
+        QVariantMap result;
+        for (const QVariant &value : ids) {
+            AvatarAtlas::Slot slot;
+            if (m_avatarAtlas.lookup(value.toInt(), &slot))
+                result.insert(QString::number(value.toInt()), m_avatarAtlas.describe(slot));
+        }
+        return result;
+    };
+
+    bool decoding = false;
+    if (!missing.isEmpty() && isConnected()) {
+        // 先取回全部头像数据，再在执行器上并行解码缩略图，最后回到界面线程按顺序放入图集
+        struct Avatar
+        {
+            int userId;
+            QString format;
+            QByteArray blob;
+            QImage thumbnail;
+        };
+        std::vector<Avatar> avatars;
+        auto joinIds = [](const QList<int> &ids) {
+            QStringList list;
+            for (int userId : ids)
+                list.append(QString::number(userId)); // 整数拼接，无注入风险
+            return list.join(',');
+        };
+
+        QMutexLocker locker(&m_mutex);
+        if (!m_shards.isEnabled()) {
+            QSqlQuery query(m_db);
+            query.setForwardOnly(true);
+            const QString sql = QString(R"(
+                SELECT u.Uid, u.avatar_format, u.avatar_blob, c.data AS chunk
+                FROM user_info u
+                LEFT JOIN blob_chunks c ON c.owner_kind = 'avatar' AND c.owner_id = u.Uid
+                WHERE u.Uid IN (%1)
+                ORDER BY u.Uid, c.seq
+            )").arg(joinIds(missing));
+            if (query.exec(sql)) {
+                while (query.next()) {
+                    const int userId = query.value("Uid").toInt();
+                    if (avatars.empty() || avatars.back().userId != userId) {
+                        avatars.push_back({userId, query.value("avatar_format").toString(),
+                                           query.value("avatar_blob").toByteArray(), QImage()});
+                    }
+                    avatars.back().blob.append(query.value("chunk").toByteArray());
+                }
+            } else {
+                FLOG_ERROR("db") << "[DB] 批量加载头像失败：" << query.lastError().text();
+            }
+        } else {
+            // 分片时头像字段在各用户所在分片，分块在主库：每个分片一次查询，分块再一次查询
+            QHash<int, QList<int>> byShard;
+            for (int userId : missing)
+                byShard[m_shards.shardOf(userId)].append(userId);
+            for (auto it = byShard.constBegin(); it != byShard.constEnd(); ++it) {
+                QSqlQuery query(m_shards.database(it.key()));
+                query.setForwardOnly(true);
+                if (!query.exec(QString("SELECT Uid, avatar_format, avatar_blob FROM user_info WHERE Uid IN (%1)")
+                                    .arg(joinIds(it.value())))) {
+                    FLOG_ERROR("db") << "[DB] 批量加载头像失败：" << query.lastError().text();
+                    continue;
+                }
+                while (query.next()) {
+                    avatars.push_back({query.value("Uid").toInt(), query.value("avatar_format").toString(),
+                                       query.value("avatar_blob").toByteArray(), QImage()});
+                }
+            }
+            QHash<int, size_t> index;
+            QList<int> found;
+            for (size_t i = 0; i < avatars.size(); ++i) {
+                index.insert(avatars[i].userId, i);
+                found.append(avatars[i].userId);
+            }
+            QSqlQuery chunks(m_db);
+            chunks.setForwardOnly(true);
+            if (!found.isEmpty()
+                && !chunks.exec(QString("SELECT owner_id, data FROM blob_chunks WHERE owner_kind = 'avatar' "
+                                        "AND owner_id IN (%1) ORDER BY owner_id, seq")
+                                    .arg(joinIds(found)))) {
+                FLOG_ERROR("db") << "[DB] 批量加载头像失败：" << chunks.lastError().text();
+                avatars.clear(); // 分块不完整，不放入图集
+            }
+            while (chunks.isActive() && chunks.next())
+                avatars[index.value(chunks.value("owner_id").toInt())].blob.append(chunks.value("data").toByteArray());
+        }
+        locker.unlock();
+
+        // 解码期间本批保持固定，完成后再取消
+        auto *watcher = new QFutureWatcher<std::vector<Avatar>>(this);
+        connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, userIds, batch, describe]() {
+            watcher->deleteLater();
+            if (!watcher->isCanceled()) {
+                for (const Avatar &avatar : watcher->result()) {
+                    if (avatar.thumbnail.isNull())
+                        m_avatarAtlas.markWithoutAvatar(avatar.userId);
+                    else
+                        m_avatarAtlas.insert(avatar.userId, avatar.thumbnail);
+                }
+            }
+            emit avatarAtlasUpdated(describe(userIds));
+            m_avatarAtlas.unpin(batch);
+        });
+        // 工作线程内的 parallelFor 由该线程与其他工作线程分担，不阻塞界面线程
+        watcher->setFuture(Executor::instance()->run(Executor::Normal, [avatars = std::move(avatars)]() mutable {
+            Executor::instance()->parallelFor(int(avatars.size()), Executor::Normal, [&](int i) {
+                Avatar &avatar = avatars[size_t(i)];
+                if (!avatar.blob.isEmpty())
+                    avatar.thumbnail = AvatarAtlas::makeThumbnail(avatar.blob, avatar.format);
+            });
+            return avatars;
+        }));
+        decoding = true;
+    }
+
+    const QVariantMap result = describe(userIds);
+    if (!decoding)
+        m_avatarAtlas.unpin(batch);
+    return result;
+}
+
+// 头像图集（供 image://avatars 图片提供者使用）
+AvatarAtlas *DBManager::avatarAtlas()
+{
+    return &m_avatarAtlas;
+}
+
+// 打开分块图片的流式读取设备（只能在数据库连接所在线程使用，调用方负责释放）；没有分块时读到空数据
+QIODevice *DBManager::openBlobStream(const QString &kind, int ownerId)
+{
+    if (!isConnected() || ownerId <= 0)
+        return nullptr;
+    return new BlobChunkReader(m_db, kind, ownerId);
+}
+
+// 经分块读取设备取回图片：按序号逐块查询，客户端与服务端任意时刻只处理一块（调用方持有 m_mutex）
+QByteArray DBManager::readBlobStream(const QString &kind, int ownerId)
+{
+    std::unique_ptr<QIODevice> stream(openBlobStream(kind, ownerId));
+    return stream ? stream->readAll() : QByteArray();
+}
+
 // 移除头像：清空数据库的头像字段
 bool DBManager::removeUserAvatar(int userId)
 {
+    WorkloadTrace::Scope trace("removeUserAvatar", [&]() { return QVariantList{userId}; });
     if (!isConnected() || userId <= 0)
         return false;
-    QSqlQuery query(m_db);
-    query.prepare(
-        "UPDATE user_info SET avatar_blob = NULL, avatar_format = NULL WHERE Uid = :user_id");
-    query.bindValue(":user_id", userId);
-    if (!query.exec()) {
+    QMutexLocker locker(&m_mutex);
+    QSqlQuery &query = userBound<Sql::Id::ClearAvatar>(userId, userId);
+    if (!query.exec() || !BlobStore::remove(m_db, BlobStore::kAvatar, userId)) {
+        locker.unlock();
         emit operateResult(false, "移除头像失败");
         return false;
     }
+    m_avatarStamps.remove(userId);
+    locker.unlock();
+    m_imageStore.remove(ImageStore::avatarKey(userId));
+    m_avatarAtlas.remove(userId);
     emit operateResult(true, "头像已移除");
     return true;
 }
@@ -459,6 +1317,7 @@ int DBManager::forgetPassword(const QString &Email,
                               const QString &verifyCode,
                               const QString &newPassword)
 {
+    WorkloadTrace::Scope trace("forgetPassword", [&]() { return QVariantList{Email, verifyCode, newPassword}; });
     QMutexLocker locker(&m_mutex); // 线程安全
 
     // 1. 检查数据库连接状态
@@ -491,12 +1350,15 @@ int DBManager::forgetPassword(const QString &Email,
         return 4;
     }
 
-    // 6. 从数据库中获取用户名（用于后续成功信号）
-    QSqlQuery query(m_db);
-    query.prepare("SELECT User_name FROM user_info WHERE Email = :Email");
-    query.bindValue(":Email", Email);
+    // 6. 从数据库中获取用户名（用于后续成功信号）；分片时先按邮箱在用户目录中找到 Uid
+    const int userId = m_shards.isEnabled() ? directoryUid(Sql::Id::DirectoryUidByEmail, Email) : -1;
+    if (m_shards.isEnabled() && userId <= 0) {
+        emit passwordResetFailed("该邮箱未注册，无法重置密码");
+        return 2;
+    }
+    QSqlQuery &query = userBound<Sql::Id::UserNameByEmail>(userId, Email);
     if (!query.exec()) {
-        qDebug() << "查询用户信息失败：" << query.lastError().text();
+        FLOG_DEBUG("db") << "查询用户信息失败：" << query.lastError().text();
         emit passwordResetFailed("查询用户信息失败，请稍后重试");
         return 5;
     }
@@ -510,11 +1372,9 @@ int DBManager::forgetPassword(const QString &Email,
     QString encryptedPwd = encryptPassword(newPassword);
 
     // 8. 更新数据库中的密码
-    query.prepare("UPDATE user_info SET Password = :newPassword WHERE Email = :Email");
-    query.bindValue(":newPassword", encryptedPwd);
-    query.bindValue(":Email", Email);
-    if (!query.exec()) {
-        qDebug() << "更新密码失败：" << query.lastError().text();
+    QSqlQuery &update = userBound<Sql::Id::UpdatePasswordByEmail>(userId, encryptedPwd, Email);
+    if (!update.exec()) {
+        FLOG_DEBUG("db") << "更新密码失败：" << update.lastError().text();
         emit passwordResetFailed("密码重置失败，请稍后重试");
         return 5;
     }
@@ -527,29 +1387,39 @@ int DBManager::forgetPassword(const QString &Email,
 // 用户状态查询
 bool DBManager::isUserLoggedIn() const
 {
+    WorkloadTrace::Scope trace("isUserLoggedIn");
     return m_isUserLoggedIn;
 }
 
 // 获取Uid
 int DBManager::getCurrentUserId() const
 {
+    WorkloadTrace::Scope trace("getCurrentUserId");
     return m_currentUserId;
 }
 
 // 获取用户名
 QString DBManager::getCurrentUserName() const
 {
+    WorkloadTrace::Scope trace("getCurrentUserName");
     return m_currentUserName;
 }
 
 // 获取邮箱
 QString DBManager::getCurrentUserEmail() const
 {
+    WorkloadTrace::Scope trace("getCurrentUserEmail");
     return m_currentUserEmail;
 }
 
 // 查询所有航班
-QVariantList DBManager::queryAllFlights()
+QVariantList DBManager::queryAllFlights(int timeoutMs)
+{
+    WorkloadTrace::Scope trace("queryAllFlights", [&]() { return QVariantList{timeoutMs}; });
+    return queryAllFlights(makeQueryContext(timeoutMs));
+}
+
+QVariantList DBManager::queryAllFlights(const QueryContext &ctx)
 {
     QMutexLocker locker(&m_mutex);
     QVariantList result;
@@ -559,24 +1429,21 @@ QVariantList DBManager::queryAllFlights()
         return result;
     }
 
-    QSqlQuery query(m_db);
-
-    QString sql = R"(
-        SELECT Flight_id, Departure, Destination, depart_time, arrive_time,
-               status, price, total_seats, remain_seats
-        FROM flight
-        ORDER BY depart_time DESC
-    )";
-
-    if (!query.prepare(sql)) {
-        QString errMsg = "[DB] 查询预处理失败：" + query.lastError().text();
-        qCritical() << errMsg;
-        emit operateResult(false, errMsg);
+    // 排队期间已超时，不再访问数据库
+    if (ctx.expired()) {
+        reportAborted("queryAllFlights");
         return result;
     }
 
-    if (query.exec()) {
+    // 连接时已预处理；执行时间不超过上下文的剩余时间
+    QSqlQuery &query = statement(Sql::Id::AllFlights);
+
+    if (execWithDeadline(query, ctx)) {
         while (query.next()) {
+            if (ctx.expired()) {
+                reportAborted("queryAllFlights");
+                return QVariantList();
+            }
             QVariantMap flight;
             flight["Flight_id"] = query.value("Flight_id").toString();
             flight["Departure"] = query.value("Departure").toString();
@@ -594,7 +1461,7 @@ QVariantList DBManager::queryAllFlights()
         emit operateResult(true, QString("查询成功，共 %1 条航班数据").arg(result.size()));
     } else {
         QString errMsg = "[DB] 查询失败：" + query.lastError().text();
-        qCritical() << errMsg;
+        FLOG_ERROR("db") << errMsg;
         emit operateResult(false, errMsg);
     }
     return result;
@@ -602,8 +1469,24 @@ QVariantList DBManager::queryAllFlights()
 
 QVariantList DBManager::queryFlightsByCondition(const QString &departure,
                                                 const QString &destination,
-                                                const QString &departDate)
+                                                const QString &departDate,
+                                                int timeoutMs)
 {
+    WorkloadTrace::Scope trace("queryFlightsByCondition", [&]() {
+        return QVariantList{departure, destination, departDate, timeoutMs};
+    });
+    return queryFlightsByCondition(departure, destination, departDate, makeQueryContext(timeoutMs));
+}
+
+QVariantList DBManager::queryFlightsByCondition(const QString &departure,
+                                                const QString &destination,
+                                                const QString &departDate,
+                                                const QueryContext &ctx)
+{
+    if (!departure.isEmpty() && !destination.isEmpty()) {
+        m_hotRoutes.record(departure + "->" + destination);
+    }
+
     QMutexLocker locker(&m_mutex);
     QVariantList result;
 
@@ -612,51 +1495,25 @@ QVariantList DBManager::queryFlightsByCondition(const QString &departure,
         return result;
     }
 
-    QString sql = "SELECT * FROM flight";
-    QList<QString> conditions;
-    QVariantMap params; // 存储参数绑定（键：参数名，值：参数值）
-
-    if (!departure.isEmpty()) {
-        conditions.append("Departure = :departure");
-        params[":departure"] = departure;
-    }
-
-    // 处理目的地条件（非空则添加）
-    if (!destination.isEmpty()) {
-        conditions.append("Destination = :destination");
-        params[":destination"] = destination;
-    }
-
-    // 处理出发日期条件（非空则添加，匹配日期部分，忽略时间）
-    if (!departDate.isEmpty()) {
-        // MySQL：DATE(depart_time) 提取日期部分
-        conditions.append("DATE(depart_time) = :departDate");
-        params[":departDate"] = departDate;
-    }
-
-    // 拼接WHERE条件（多个条件用AND连接）
-    if (!conditions.isEmpty()) {
-        sql += " WHERE " + conditions.join(" AND ");
+    // 排队期间已超时，不再访问数据库
+    if (ctx.expired()) {
+        reportAborted("queryFlightsByCondition");
+        return result;
     }
 
-    sql += " ORDER BY depart_time ASC";
-
-    // 执行查询
-    QSqlQuery query(m_db);
-    query.prepare(sql);
-
-    // 绑定参数（遍历params，给SQL语句的参数赋值）
-    for (auto it = params.constBegin(); it != params.constEnd(); ++it) {
-        query.bindValue(it.key(), it.value());
-    }
+    // 每种条件组合一条登记语句（只含非空条件，可走索引），连接时已预处理
+    QSqlQuery &query = flightSearch(departure, destination, departDate);
 
-    if (!query.exec()) {
-        qDebug() << "查询航班失败：" << query.lastError().text();
-        qDebug() << "执行的SQL：" << sql;
+    if (!execWithDeadline(query, ctx)) {
+        FLOG_DEBUG("db") << "查询航班失败：" << query.lastError().text();
         return result;
     }
 
     while (query.next()) {
+        if (ctx.expired()) {
+            reportAborted("queryFlightsByCondition");
+            return QVariantList();
+        }
         QVariantMap flightMap;
         // 封装航班字段
         flightMap["Flight_id"] = query.value("Flight_id").toString();
@@ -678,34 +1535,45 @@ QVariantList DBManager::queryFlightsByCondition(const QString &departure,
 }
 
 // 按航班号查询航班
-QVariantList DBManager::queryFlightByNum(const QString &flightId)
+QVariantList DBManager::queryFlightByNum(const QString &flightId, int timeoutMs)
 {
-    QMutexLocker locker(&m_mutex);
-    QVariantList result;
+    WorkloadTrace::Scope trace("queryFlightByNum", [&]() { return QVariantList{flightId, timeoutMs}; });
+    return queryFlightByNum(flightId, makeQueryContext(timeoutMs));
+}
+
+QVariantList DBManager::queryFlightByNum(const QString &flightId, const QueryContext &ctx)
+{
+    m_hotFlights.record(flightId);
+
+    // 热点航班命中缓存，无需访问数据库
+    QVariantMap cached;
+    if (m_flightCache.lookup(flightId, &cached)) {
+        emit operateResult(true, "查询成功！");
+        return QVariantList{cached};
+    }
+
+    QMutexLocker locker(&m_mutex);
+    QVariantList result;
 
     if (!m_db.isOpen()) {
         emit operateResult(false, "查询失败：数据库未连接！");
         return result;
     }
 
-    // 用 bindValue 绑定参数，避免 SQL 注入
-    QSqlQuery query(m_db);
-    QString sql = R"(
-        SELECT Flight_id, Departure, Destination, depart_time, arrive_time,
-               status, price, total_seats, remain_seats
-        FROM flight
-        WHERE Flight_id = :flightId
-    )";
-
-    if (!query.prepare(sql)) {
-        QString errMsg = "[DB] 查询预处理失败：" + query.lastError().text();
-        qCritical() << errMsg;
-        emit operateResult(false, errMsg);
+    // 排队期间已超时，不再访问数据库
+    if (ctx.expired()) {
+        reportAborted("queryFlightByNum");
         return result;
     }
 
-    query.bindValue(":flightId", flightId);
-    if (query.exec() && query.next()) {
+    // 用绑定参数，避免 SQL 注入
+    QSqlQuery &query = bound<Sql::Id::FlightById>(flightId);
+    const bool found = execWithDeadline(query, ctx) && query.next();
+    if (ctx.expired()) {
+        reportAborted("queryFlightByNum");
+        return QVariantList();
+    }
+    if (found) {
         QVariantMap flightMap;
         flightMap["Flight_id"] = query.value("Flight_id").toString();
         flightMap["Departure"] = query.value("Departure").toString();
@@ -718,6 +1586,7 @@ QVariantList DBManager::queryFlightByNum(const QString &flightId)
         flightMap["price"] = query.value("price").toDouble();
         flightMap["total_seats"] = query.value("total_seats").toInt();
         flightMap["remain_seats"] = query.value("remain_seats").toInt();
+        m_flightCache.insert(flightId, flightMap);
         emit operateResult(true, "查询成功！");
 
         result.append(flightMap);
@@ -735,8 +1604,23 @@ bool DBManager::addFlight(const QString &flightId,
                           const QString &arriveTime,
                           double price,
                           int totalSeats,
-                          int remainSeats)
-{
+                          int remainSeats,
+                          const QString &requestKey)
+{
+    WorkloadTrace::Scope trace("addFlight", [&]() {
+        return QVariantList{flightId, departure, destination, departTime, arriveTime, price, totalSeats,
+                            remainSeats, requestKey};
+    });
+    if (!requestKey.isEmpty()) {
+        const QVariantList args{flightId, departure, destination, departTime, arriveTime, price, totalSeats,
+                                remainSeats};
+        return runIdempotent("addFlight", requestKey, args, [&]() {
+                   return QVariant(addFlight(flightId, departure, destination, departTime,
+                                             arriveTime, price, totalSeats, remainSeats));
+               })
+            .toBool();
+    }
+
     QMutexLocker locker(&m_mutex);
 
     if (!m_db.isOpen()) {
@@ -766,50 +1650,30 @@ bool DBManager::addFlight(const QString &flightId,
     }
 
     // 检查航班号是否已存在
-    QSqlQuery checkQuery(m_db);
-    checkQuery.prepare("SELECT Flight_id FROM flight WHERE Flight_id = :flightId");
-    checkQuery.bindValue(":flightId", flightId);
+    QSqlQuery &checkQuery = bound<Sql::Id::FlightExists>(flightId);
     if (checkQuery.exec() && checkQuery.next()) {
         emit operateResult(false, "添加失败：航班号 " + flightId + " 已存在！");
         return false;
     }
 
-    // 插入数据
-    QSqlQuery query(m_db);
-    QString sql = R"(
-        INSERT INTO flight (
-            Flight_id, Departure, Destination, depart_time, arrive_time,
-            price, total_seats, remain_seats
-        ) VALUES (
-            :flightId, :departure, :destination, :departTime, :arriveTime,
-            :price, :totalSeats, :remainSeats
-        )
-    )";
-
-    if (!query.prepare(sql)) {
-        QString errMsg = "[DB] 插入预处理失败：" + query.lastError().text();
-        qCritical() << errMsg;
-        emit operateResult(false, errMsg);
-        return false;
-    }
-
-    // 绑定所有参数
-    query.bindValue(":flightId", flightId);
-    query.bindValue(":departure", departure);
-    query.bindValue(":destination", destination);
-    query.bindValue(":departTime", departTime); // 直接传字符串，SQL 自动解析为 datetime
-    query.bindValue(":arriveTime", arriveTime);
-    query.bindValue(":price", price); // double 适配 decimal(10,2)
-    query.bindValue(":totalSeats", totalSeats);
-    query.bindValue(":remainSeats", remainSeats);
+    // 插入数据：时间直接传字符串，SQL 自动解析为 datetime；double 适配 decimal(10,2)
+    QSqlQuery &query = bound<Sql::Id::InsertFlight>(flightId, departure, destination, departTime, arriveTime,
+                                                    price, totalSeats, remainSeats);
 
     bool success = query.exec();
     if (success) {
         locker.unlock();
+        audit("add_flight", flightId,
+              QString("%1->%2 price=%3 seats=%4/%5")
+                  .arg(departure, destination)
+                  .arg(price)
+                  .arg(remainSeats)
+                  .arg(totalSeats));
+        emit flightsChanged();
         emit operateResult(true, "航班添加成功！航班号: " + flightId);
     } else {
         QString errMsg = "[DB] 插入失败：" + query.lastError().text();
-        qCritical() << errMsg;
+        FLOG_ERROR("db") << errMsg;
         emit operateResult(false, errMsg);
     }
     return success;
@@ -818,6 +1682,7 @@ bool DBManager::addFlight(const QString &flightId,
 // 更新航班价格
 bool DBManager::updateFlightPrice(const QString &Flight_id, double newPrice)
 {
+    WorkloadTrace::Scope trace("updateFlightPrice", [&]() { return QVariantList{Flight_id, newPrice}; });
     QMutexLocker locker(&m_mutex);
 
     if (!m_db.isOpen()) {
@@ -829,39 +1694,32 @@ bool DBManager::updateFlightPrice(const QString &Flight_id, double newPrice)
         return false;
     }
 
-    QSqlQuery query(m_db);
-    QString sql = "UPDATE flight SET price = :newPrice WHERE Flight_id = :Flight_id";
-
-    if (!query.prepare(sql)) {
-        QString errMsg = "[DB] 更新预处理失败：" + query.lastError().text();
-        qCritical() << errMsg;
-        emit operateResult(false, errMsg);
-        return false;
-    }
-
-    query.bindValue(":newPrice", newPrice);
-    query.bindValue(":Flight_id", Flight_id);
-    bool success = query.exec();
-
-    if (success && query.numRowsAffected() > 0) {
+    QSqlRecord before;
+    QString error;
+    const int updated
+        = updateFlightRow(Flight_id, bound<Sql::Id::UpdateFlightPrice>(newPrice, Flight_id), &before, &error);
+    if (updated > 0) {
         locker.unlock();
+        audit("update_flight_price", Flight_id,
+              QString("price=%1->%2").arg(before.value("price").toDouble(), 0, 'f', 2).arg(newPrice, 0, 'f', 2));
+        emit flightsChanged();
         emit operateResult(true,
                            "航班 " + Flight_id + " 价格更新为 " + QString::number(newPrice, 'f', 2)
                                + " 元！");
-    } else if (success && query.numRowsAffected() == 0) {
+    } else if (updated == 0) {
         emit operateResult(false, "更新失败：未找到航班 " + Flight_id + "！");
-        success = false;
     } else {
-        QString errMsg = "[DB] 更新失败：" + query.lastError().text();
-        qCritical() << errMsg;
+        QString errMsg = "[DB] 更新失败：" + error;
+        FLOG_ERROR("db") << errMsg;
         emit operateResult(false, errMsg);
     }
-    return success;
+    return updated > 0;
 }
 
 // 更新剩余座位数
 bool DBManager::updateFlightSeats(const QString &Flight_id, int newRemainSeats)
 {
+    WorkloadTrace::Scope trace("updateFlightSeats", [&]() { return QVariantList{Flight_id, newRemainSeats}; });
     QMutexLocker locker(&m_mutex);
 
     if (!m_db.isOpen()) {
@@ -869,9 +1727,7 @@ bool DBManager::updateFlightSeats(const QString &Flight_id, int newRemainSeats)
         return false;
     }
 
-    QSqlQuery getTotalSeatsQuery(m_db);
-    getTotalSeatsQuery.prepare("SELECT total_seats FROM flight WHERE Flight_id = :Flight_id");
-    getTotalSeatsQuery.bindValue(":Flight_id", Flight_id);
+    QSqlQuery &getTotalSeatsQuery = bound<Sql::Id::FlightTotalSeats>(Flight_id);
     if (!getTotalSeatsQuery.exec() || !getTotalSeatsQuery.next()) {
         emit operateResult(false, "更新失败：未找到航班 " + Flight_id + "! ");
         return false;
@@ -884,40 +1740,32 @@ bool DBManager::updateFlightSeats(const QString &Flight_id, int newRemainSeats)
         return false;
     }
 
-    QSqlQuery query(m_db);
-    QString sql = "UPDATE flight SET remain_seats = :newRemainSeats WHERE Flight_id = :Flight_id";
-
-    if (!query.prepare(sql)) {
-        QString errMsg = "[DB]  更新预处理失败：" + query.lastError().text();
-        qCritical() << errMsg;
-        emit operateResult(false, errMsg);
-        return false;
-    }
-
-    query.bindValue(":newRemainSeats", newRemainSeats);
-    query.bindValue(":Flight_id", Flight_id);
-    bool success = query.exec();
-
-    if (success && query.numRowsAffected() > 0) {
+    QSqlRecord before;
+    QString error;
+    const int updated = updateFlightRow(Flight_id, bound<Sql::Id::UpdateFlightSeats>(newRemainSeats, Flight_id),
+                                        &before, &error);
+    if (updated > 0) {
         locker.unlock();
+        audit("update_flight_seats", Flight_id,
+              QString("remain_seats=%1->%2").arg(before.value("remain_seats").toInt()).arg(newRemainSeats));
+        emit flightsChanged();
         emit operateResult(true,
                            "航班 " + Flight_id + " 剩余座位更新为 "
                                + QString::number(newRemainSeats) + "！");
-    }
-    else if(success && query.numRowsAffected() == 0){
-        emit operateResult(true,"未修改");
-    }
-    else {
-        QString errMsg = "[DB] 更新失败：" + query.lastError().text();
-        qCritical() << errMsg;
+    } else if (updated == 0) {
+        emit operateResult(false, "更新失败：未找到航班 " + Flight_id + "！");
+    } else {
+        QString errMsg = "[DB] 更新失败：" + error;
+        FLOG_ERROR("db") << errMsg;
         emit operateResult(false, errMsg);
     }
-    return success;
+    return updated > 0;
 }
 
 // 更新航班状态
 bool DBManager::updateFlightStatus(const QString &Flight_id, int newstatus)
 {
+    WorkloadTrace::Scope trace("updateFlightStatus", [&]() { return QVariantList{Flight_id, newstatus}; });
     QMutexLocker locker(&m_mutex);
 
     if (!m_db.isOpen()) {
@@ -930,39 +1778,32 @@ bool DBManager::updateFlightStatus(const QString &Flight_id, int newstatus)
         return false;
     }
 
-    QSqlQuery query(m_db);
-    QString sql = "UPDATE flight SET status = :newstatus WHERE Flight_id = :Flight_id";
-
-    if (!query.prepare(sql)) {
-        QString errMsg = "[DB] 更新预处理失败：" + query.lastError().text();
-        qCritical() << errMsg;
-        emit operateResult(false, errMsg);
-        return false;
-    }
-
-    query.bindValue(":newstatus", newstatus);
-    query.bindValue(":Flight_id", Flight_id);
-    bool success = query.exec();
-
-    if (success && query.numRowsAffected() > 0) {
+    QSqlRecord before;
+    QString error;
+    const int updated
+        = updateFlightRow(Flight_id, bound<Sql::Id::UpdateFlightStatus>(newstatus, Flight_id), &before, &error);
+    if (updated > 0) {
         locker.unlock();
+        audit("update_flight_status", Flight_id,
+              QString("status=%1->%2").arg(before.value("status").toInt()).arg(newstatus));
+        emit flightsChanged();
         emit operateResult(true,
                            "航班 " + Flight_id + " 状态更新为 " + QString::number(newstatus)
                                + "！ ");
-    } else if (success && query.numRowsAffected() == 0) {
+    } else if (updated == 0) {
         emit operateResult(false, "更新失败：未找到航班 " + Flight_id + "！");
-        success = false;
     } else {
-        QString errMsg = "[DB] 更新失败：" + query.lastError().text();
-        qCritical() << errMsg;
+        QString errMsg = "[DB] 更新失败：" + error;
+        FLOG_ERROR("db") << errMsg;
         emit operateResult(false, errMsg);
     }
-    return success;
+    return updated > 0;
 }
 
 // 删除航班
 bool DBManager::deleteFlight(const QString &Flight_id)
 {
+    WorkloadTrace::Scope trace("deleteFlight", [&]() { return QVariantList{Flight_id}; });
     QMutexLocker locker(&m_mutex);
 
     if (!m_db.isOpen()) {
@@ -970,35 +1811,52 @@ bool DBManager::deleteFlight(const QString &Flight_id)
         return false;
     }
 
-    QSqlQuery query(m_db);
-    QString sql = "DELETE FROM flight WHERE Flight_id = :Flight_id";
-    if (!query.prepare(sql)) {
-        QString errMsg = "[DB] 删除预处理失败：" + query.lastError().text();
-        qCritical() << errMsg;
-        emit operateResult(false, errMsg);
-        return false;
-    }
-
-    query.bindValue(":Flight_id", Flight_id);
+    QSqlQuery &query = bound<Sql::Id::DeleteFlight>(Flight_id);
     bool success = query.exec();
 
     if (success && query.numRowsAffected() > 0) {
+        // 主库的订单与收藏随外键级联删除；分片表没有外键，逐个分片删除该航班的订单与收藏
+        // （失败只留下孤立行，查询时航班不存在的行会被过滤）
+        if (m_shards.isEnabled()) {
+            m_shards.recordScatter();
+            for (int shard = 0; shard < m_shards.shardCount(); ++shard) {
+                QSqlQuery &orders = m_shards.bound<Sql::Id::DeleteFlightOrders>(shard, Flight_id);
+                QSqlQuery &collects = m_shards.bound<Sql::Id::DeleteFlightCollects>(shard, Flight_id);
+                if (!orders.exec() || !collects.exec())
+                    FLOG_WARN("db") << "[DB] 分片" << shard << "删除航班" << Flight_id << "的订单/收藏失败："
+                                    << orders.lastError().text() << collects.lastError().text();
+            }
+        }
         locker.unlock();
+        audit("delete_flight", Flight_id);
+        emit flightsChanged();
         emit operateResult(true, "航班删除成功！ 航班号：" + Flight_id + " ");
     } else if (success && query.numRowsAffected() == 0) {
         emit operateResult(false, "删除失败：未找到航班 " + Flight_id + "！");
         success = false;
     } else {
         QString errMsg = "[DB] 删除失败：" + query.lastError().text();
-        qCritical() << errMsg;
+        FLOG_ERROR("db") << errMsg;
         emit operateResult(false, errMsg);
     }
     return success;
 }
 
 // 收藏航班
-int DBManager::collectFlight(int userId, const QString &flightId)
+int DBManager::collectFlight(int userId, const QString &flightId, const QString &requestKey)
 {
+    WorkloadTrace::Scope trace("collectFlight", [&]() { return QVariantList{userId, flightId, requestKey}; });
+    if (!requestKey.isEmpty()) {
+        // 收藏成功（100）与已收藏（401）是最终结果，其余（未连接、失败）允许用同一个键重试
+        return runIdempotent(
+                   "collectFlight",
+                   requestKey,
+                   {userId, flightId},
+                   [&]() { return QVariant(collectFlight(userId, flightId)); },
+                   [](const QVariant &code) { return code.toInt() == 100 || code.toInt() == 401; })
+            .toInt();
+    }
+
     QMutexLocker locker(&m_mutex);
 
     if (!m_db.isOpen()) {
@@ -1011,16 +1869,10 @@ int DBManager::collectFlight(int userId, const QString &flightId)
         return 401;
     }
 
-    QSqlQuery query(m_db);
-    query.prepare(R"(
-        INSERT INTO user_collect_flights (user_id, flight_id)
-        VALUES (:user_id, :flight_id)
-    )");
-    query.bindValue(":user_id", userId);
-    query.bindValue(":flight_id", flightId);
+    QSqlQuery &query = userBound<Sql::Id::CollectFlight>(userId, userId, flightId);
 
     if (!query.exec()) {
-        qDebug() << "收藏航班失败：" << query.lastError().text();
+        FLOG_DEBUG("db") << "收藏航班失败：" << query.lastError().text();
         emit operateResult(false, "收藏航班失败：" + query.lastError().text());
         return 502;
     }
@@ -1032,6 +1884,7 @@ int DBManager::collectFlight(int userId, const QString &flightId)
 // 取消收藏航班
 bool DBManager::cancelCollectFlight(int userId, const QString &flightId)
 {
+    WorkloadTrace::Scope trace("cancelCollectFlight", [&]() { return QVariantList{userId, flightId}; });
     QMutexLocker locker(&m_mutex);
 
     if (!m_db.isOpen()) {
@@ -1044,16 +1897,10 @@ bool DBManager::cancelCollectFlight(int userId, const QString &flightId)
         return false;
     }
 
-    QSqlQuery query(m_db);
-    query.prepare(R"(
-        DELETE FROM user_collect_flights
-        WHERE user_id = :user_id AND flight_id = :flight_id
-    )");
-    query.bindValue(":user_id", userId);
-    query.bindValue(":flight_id", flightId);
+    QSqlQuery &query = userBound<Sql::Id::UncollectFlight>(userId, userId, flightId);
 
     if (!query.exec()) {
-        qDebug() << "取消收藏失败：" << query.lastError().text();
+        FLOG_DEBUG("db") << "取消收藏失败：" << query.lastError().text();
         emit operateResult(false, "取消收藏失败：" + query.lastError().text());
         return false;
     }
@@ -1066,6 +1913,7 @@ bool DBManager::cancelCollectFlight(int userId, const QString &flightId)
 // 查询用户收藏的所有航班
 QVariantList DBManager::queryCollectedFlights(int userId)
 {
+    WorkloadTrace::Scope trace("queryCollectedFlights", [&]() { return QVariantList{userId}; });
     QMutexLocker locker(&m_mutex);
     QVariantList flightList;
 
@@ -1077,37 +1925,18 @@ QVariantList DBManager::queryCollectedFlights(int userId)
         emit operateResult(false, "查询失败：用户Id非法！");
         return flightList;
     }
+    if (m_shards.isEnabled())
+        return shardCollectedFlights(userId, QString(), nullptr);
 
-    QSqlQuery query(m_db);
-    query.prepare(R"(
-        SELECT f.* FROM flight f
-        INNER JOIN user_collect_flights ucf ON f.Flight_id = ucf.flight_id
-        WHERE ucf.user_id = :user_id
-        ORDER BY ucf.create_time DESC
-    )");
-    query.bindValue(":user_id", userId);
+    QSqlQuery &query = bound<Sql::Id::CollectedFlights>(userId);
 
     if (!query.exec()) {
-        qDebug() << "查询收藏航班失败：" << query.lastError().text();
+        FLOG_DEBUG("db") << "查询收藏航班失败：" << query.lastError().text();
         return flightList;
     }
 
-    while (query.next()) {
-        QVariantMap flightMap;
-        flightMap["Flight_id"] = query.value("Flight_id").toString();
-        flightMap["Departure"] = query.value("Departure").toString();
-        flightMap["Destination"] = query.value("Destination").toString();
-        flightMap["depart_time"]
-            = query.value("depart_time").toDateTime().toString("yyyy-MM-dd HH:mm:ss");
-        flightMap["arrive_time"]
-            = query.value("arrive_time").toDateTime().toString("yyyy-MM-dd HH:mm:ss");
-        flightMap["price"] = query.value("price").toDouble();
-        flightMap["total_seats"] = query.value("total_seats").toInt();
-        flightMap["remain_seats"] = query.value("remain_seats").toInt();
-        flightMap["status"] = query.value("status").toInt();
-
-        flightList.append(flightMap);
-    }
+    while (query.next())
+        flightList.append(collectedFlightMap(query.record()));
 
     return flightList;
 }
@@ -1115,6 +1944,7 @@ QVariantList DBManager::queryCollectedFlights(int userId)
 // 按航班号查询收藏航班
 QVariantList DBManager::queryCollectedFlightByNum(int userId, const QString &Flight_id)
 {
+    WorkloadTrace::Scope trace("queryCollectedFlightByNum", [&]() { return QVariantList{userId, Flight_id}; });
     QMutexLocker locker(&m_mutex);
     QVariantList flightList;
 
@@ -1126,38 +1956,18 @@ QVariantList DBManager::queryCollectedFlightByNum(int userId, const QString &Fli
         emit operateResult(false, "查询失败：用户Id非法！");
         return flightList;
     }
+    if (m_shards.isEnabled())
+        return shardCollectedFlights(userId, Flight_id, nullptr);
 
-    QSqlQuery query(m_db);
-    query.prepare(R"(
-        SELECT f.* FROM flight f
-        INNER JOIN user_collect_flights ucf ON f.Flight_id = ucf.flight_id
-        WHERE ucf.user_id = :user_id and ucf.flight_id = :flight_id
-        ORDER BY ucf.create_time DESC
-    )");
-    query.bindValue(":user_id", userId);
-    query.bindValue(":flight_id", Flight_id);
+    QSqlQuery &query = bound<Sql::Id::CollectedFlightById>(userId, Flight_id);
 
     if (!query.exec()) {
-        qDebug() << "按航班号查询收藏航班失败：" << query.lastError().text();
+        FLOG_DEBUG("db") << "按航班号查询收藏航班失败：" << query.lastError().text();
         return flightList;
     }
 
-    while (query.next()) {
-        QVariantMap flightMap;
-        flightMap["Flight_id"] = query.value("Flight_id").toString();
-        flightMap["Departure"] = query.value("Departure").toString();
-        flightMap["Destination"] = query.value("Destination").toString();
-        flightMap["depart_time"]
-            = query.value("depart_time").toDateTime().toString("yyyy-MM-dd HH:mm:ss");
-        flightMap["arrive_time"]
-            = query.value("arrive_time").toDateTime().toString("yyyy-MM-dd HH:mm:ss");
-        flightMap["price"] = query.value("price").toDouble();
-        flightMap["total_seats"] = query.value("total_seats").toInt();
-        flightMap["remain_seats"] = query.value("remain_seats").toInt();
-        flightMap["status"] = query.value("status").toInt();
-
-        flightList.append(flightMap);
-    }
+    while (query.next())
+        flightList.append(collectedFlightMap(query.record()));
 
     return flightList;
 }
@@ -1168,6 +1978,9 @@ QVariantList DBManager::queryCollectedFlightsByCondition(int userId,
                                                          const QString &destination,
                                                          const QString &departDate)
 {
+    WorkloadTrace::Scope trace("queryCollectedFlightsByCondition", [&]() {
+        return QVariantList{userId, departure, destination, departDate};
+    });
     QMutexLocker locker(&m_mutex);
     QVariantList flightList;
 
@@ -1179,61 +1992,24 @@ QVariantList DBManager::queryCollectedFlightsByCondition(int userId,
         emit operateResult(false, "查询失败：用户Id非法！");
         return flightList;
     }
-
-    QSqlQuery query(m_db);
-    QString sql = R"(
-        SELECT f.* FROM flight f
-        INNER JOIN user_collect_flights ucf ON f.Flight_id = ucf.flight_id
-        WHERE ucf.user_id = :user_id
-    )";
-
-    QList<QString> conditions;
-    if (!departure.isEmpty()) {
-        conditions.append("f.Departure = :departure");
-    }
-    if (!destination.isEmpty()) {
-        conditions.append("f.Destination = :destination");
-    }
-    if (!departDate.isEmpty()) {
-        conditions.append("f.DATE(depart_time) = :departDate");
-    }
-
-    // 拼接WHERE子句
-    if (!conditions.isEmpty()) {
-        sql += " AND " + conditions.join(" AND ");
+    if (m_shards.isEnabled()) {
+        return shardCollectedFlights(userId, QString(), [&](const QSqlRecord &flight) {
+            return (departure.isEmpty() || flight.value("Departure").toString() == departure)
+                   && (destination.isEmpty() || flight.value("Destination").toString() == destination)
+                   && (departDate.isEmpty()
+                       || flight.value("depart_time").toDate().toString("yyyy-MM-dd") == departDate);
+        });
     }
 
-    // 按收藏时间降序排列（最新收藏的在前）
-    sql += " ORDER BY ucf.create_time DESC";
-
-    query.prepare(sql);
-
-    query.bindValue(":user_id", userId);
-    query.bindValue(":departure", departure);
-    query.bindValue(":destination", destination);
-    query.bindValue(":departDate", departDate);
+    QSqlQuery &query = collectedFlightSearch(userId, departure, destination, departDate);
 
     if (!query.exec()) {
-        qDebug() << "查询收藏航班失败：" << query.lastError().text();
+        FLOG_DEBUG("db") << "查询收藏航班失败：" << query.lastError().text();
         return flightList;
     }
 
-    while (query.next()) {
-        QVariantMap flightMap;
-        flightMap["Flight_id"] = query.value("Flight_id").toString();
-        flightMap["Departure"] = query.value("Departure").toString();
-        flightMap["Destination"] = query.value("Destination").toString();
-        flightMap["depart_time"]
-            = query.value("depart_time").toDateTime().toString("yyyy-MM-dd HH:mm:ss");
-        flightMap["arrive_time"]
-            = query.value("arrive_time").toDateTime().toString("yyyy-MM-dd HH:mm:ss");
-        flightMap["price"] = query.value("price").toDouble();
-        flightMap["total_seats"] = query.value("total_seats").toInt();
-        flightMap["remain_seats"] = query.value("remain_seats").toInt();
-        flightMap["status"] = query.value("status").toInt();
-
-        flightList.append(flightMap);
-    }
+    while (query.next())
+        flightList.append(collectedFlightMap(query.record()));
 
     return flightList;
 }
@@ -1241,7 +2017,8 @@ QVariantList DBManager::queryCollectedFlightsByCondition(int userId,
 // 判断用户是否已收藏某航班
 bool DBManager::isFlightCollected(int userId, const QString &flightId)
 {
-    // QMutexLocker locker(&m_mutex);
+    WorkloadTrace::Scope trace("isFlightCollected", [&]() { return QVariantList{userId, flightId}; });
+    QMutexLocker locker(&m_mutex);
 
     if (!m_db.isOpen()) {
         emit operateResult(false, "判断失败：数据库未连接！");
@@ -1252,14 +2029,7 @@ bool DBManager::isFlightCollected(int userId, const QString &flightId)
         return false;
     }
 
-    QSqlQuery query(m_db);
-    query.prepare(R"(
-        SELECT 1 FROM user_collect_flights
-        WHERE user_id = :user_id AND flight_id = :flight_id
-        LIMIT 1
-    )");
-    query.bindValue(":user_id", userId);
-    query.bindValue(":flight_id", flightId);
+    QSqlQuery &query = userBound<Sql::Id::FlightCollected>(userId, userId, flightId);
 
     if (query.exec() && query.next()) {
         return true; // 已收藏
@@ -1267,32 +2037,61 @@ bool DBManager::isFlightCollected(int userId, const QString &flightId)
     return false; // 未收藏
 }
 
+// 分片时收藏在用户所在分片、航班在主库：先按收藏时间倒序取航班号，再一次取回航班，在应用侧关联
+QVariantList DBManager::shardCollectedFlights(int userId,
+                                              const QString &flightId,
+                                              const std::function<bool(const QSqlRecord &)> &accept)
+{
+    QVariantList flightList;
+    QSqlQuery &query = flightId.isEmpty() ? userBound<Sql::Id::ShardCollectedIds>(userId, userId)
+                                          : userBound<Sql::Id::ShardCollectedId>(userId, userId, flightId);
+    if (!query.exec()) {
+        FLOG_DEBUG("db") << "查询收藏航班失败：" << query.lastError().text();
+        return flightList;
+    }
+    QStringList flightIds;
+    while (query.next())
+        flightIds.append(query.value("flight_id").toString());
+
+    const QHash<QString, QSqlRecord> flights
+        = flightRecords(flightIds, "Departure, Destination, depart_time, arrive_time, price, total_seats, "
+                                   "remain_seats, status");
+    for (const QString &id : flightIds) {
+        auto it = flights.constFind(id);
+        if (it != flights.constEnd() && (!accept || accept(*it)))
+            flightList.append(collectedFlightMap(*it));
+    }
+    return flightList;
+}
+
 // 打印航班（id）
 void DBManager::printFlight(const QVariantMap &flight)
 {
+    WorkloadTrace::Scope trace("printFlight", [&]() { return QVariantList{flight}; });
     if (flight.isEmpty()) {
-        qInfo() << "查询结果：无此航班\n";
+        FLOG_INFO("db") << "查询结果：无此航班\n";
         return;
     }
-    qInfo() << "\n===== 单个航班详情 =====";
-    qInfo() << "航班号：" << flight["flightId"].toString();
-    qInfo() << "出发地：" << flight["departure"].toString();
-    qInfo() << "目的地：" << flight["destination"].toString();
-    qInfo() << "起飞时间：" << flight["departTime"].toString();
-    qInfo() << "降落时间：" << flight["arriveTime"].toString();
-    qInfo() << "票价：" << flight["price"].toDouble() << "元";
-    qInfo() << "总座位：" << flight["totalSeats"].toInt();
-    qInfo() << "剩余座位：" << flight["remainSeats"].toInt();
-    qInfo() << "======================\n";
+    FLOG_INFO("db") << "\n===== 单个航班详情 =====";
+    FLOG_INFO("db") << "航班号：" << flight["flightId"].toString();
+    FLOG_INFO("db") << "出发地：" << flight["departure"].toString();
+    FLOG_INFO("db") << "目的地：" << flight["destination"].toString();
+    FLOG_INFO("db") << "起飞时间：" << flight["departTime"].toString();
+    FLOG_INFO("db") << "降落时间：" << flight["arriveTime"].toString();
+    FLOG_INFO("db") << "票价：" << flight["price"].toDouble() << "元";
+    FLOG_INFO("db") << "总座位：" << flight["totalSeats"].toInt();
+    FLOG_INFO("db") << "剩余座位：" << flight["remainSeats"].toInt();
+    FLOG_INFO("db") << "======================\n";
 }
 
 // 打印航班列表
 void DBManager::printFlightList(const QVariantList &flightList)
 {
-    qInfo() << "\n===== 航班列表（共" << flightList.size() << "条）=====";
+    WorkloadTrace::Scope trace("printFlightList", [&]() { return QVariantList{flightList}; });
+    FLOG_INFO("db") << "\n===== 航班列表（共" << flightList.size() << "条）=====";
     for (const auto &flightVar : flightList) {
         QVariantMap flight = flightVar.toMap();
-        qInfo() << QString("航班号：%1 | 出发地：%2 | 目的地：%3 | 起飞时间：%4 | 票价：%5 元 | "
+        FLOG_INFO("db") << QString("航班号：%1 | 出发地：%2 | 目的地：%3 | 起飞时间：%4 | 票价：%5 元 | "
                            "剩余座位：%6")
                        .arg(flight["flightId"].toString())
                        .arg(flight["departure"].toString())
@@ -1301,16 +2100,18 @@ void DBManager::printFlightList(const QVariantList &flightList)
                        .arg(flight["price"].toDouble(), 0, 'f', 2)
                        .arg(flight["remainSeats"].toInt());
     }
-    qInfo() << "========================================\n";
+    FLOG_INFO("db") << "========================================\n";
 }
 
 // 管理员登录验证
 bool DBManager::verifyAdminLogin(const QString &adminName, const QString &password)
 {
+    WorkloadTrace::beginSession();
+    WorkloadTrace::Scope trace("verifyAdminLogin", [&]() { return QVariantList{adminName, password}; });
     QMutexLocker locker(&m_mutex);
 
     if (!m_db.isOpen()) {
-        qWarning() << "Database is not connected";
+        FLOG_WARN("db") << "Database is not connected";
         emit adminLoginFailed("数据库未连接");
         return false;
     }
@@ -1320,13 +2121,10 @@ bool DBManager::verifyAdminLogin(const QString &adminName, const QString &passwo
         return false;
     }
 
-    QSqlQuery query(m_db);
-    query.prepare("SELECT Aid, Admin_name FROM admin_info WHERE Admin_name = ? AND Password = ?");
-    query.addBindValue(adminName);
-    query.addBindValue(password);
+    QSqlQuery &query = bound<Sql::Id::AdminLogin>(adminName, password);
 
     if (!query.exec()) {
-        qWarning() << "Login query failed:" << query.lastError();
+        FLOG_WARN("db") << "Login query failed:" << query.lastError();
         emit adminLoginFailed("查询失败: " + query.lastError().text());
         return false;
     }
@@ -1338,7 +2136,7 @@ bool DBManager::verifyAdminLogin(const QString &adminName, const QString &passwo
 
         emit adminLoginStateChanged(true);
         emit adminLoginSuccess(m_currentAdminName);
-        qDebug() << "Admin login successful:" << m_currentAdminName;
+        FLOG_DEBUG("db") << "Admin login successful:" << m_currentAdminName;
         return true;
     } else {
         m_isAdminLoggedIn = false;
@@ -1346,7 +2144,7 @@ bool DBManager::verifyAdminLogin(const QString &adminName, const QString &passwo
         m_currentAdminName.clear();
 
         emit adminLoginFailed("用户名或密码错误");
-        qWarning() << "Admin login failed: invalid credentials";
+        FLOG_WARN("db") << "Admin login failed: invalid credentials";
         return false;
     }
 }
@@ -1354,34 +2152,44 @@ bool DBManager::verifyAdminLogin(const QString &adminName, const QString &passwo
 // 是否管理员登录
 bool DBManager::isAdminLoggedIn() const
 {
+    WorkloadTrace::Scope trace("isAdminLoggedIn");
     return m_isAdminLoggedIn;
 }
 
 // 管理员登出
 void DBManager::adminLogout()
 {
+    WorkloadTrace::Scope trace("adminLogout");
     m_isAdminLoggedIn = false;
     m_currentAdminId = -1;
     m_currentAdminName.clear();
 
     emit adminLoginStateChanged(false);
     emit adminLogoutSuccess();
-    qDebug() << "Admin logged out";
+    FLOG_DEBUG("db") << "Admin logged out";
 }
 
 // 获取当前管理员名
 QString DBManager::getCurrentAdminName() const
 {
+    WorkloadTrace::Scope trace("getCurrentAdminName");
     return m_currentAdminName;
 }
 
 // 获取当前管理员Id
 int DBManager::getCurrentAdminId() const
 {
+    WorkloadTrace::Scope trace("getCurrentAdminId");
     return m_currentAdminId;
 }
 // 查看我的所有订单
-QVariantList DBManager::queryMyOrders(int userId)
+QVariantList DBManager::queryMyOrders(int userId, int timeoutMs)
+{
+    WorkloadTrace::Scope trace("queryMyOrders", [&]() { return QVariantList{userId, timeoutMs}; });
+    return queryMyOrders(userId, makeQueryContext(timeoutMs));
+}
+
+QVariantList DBManager::queryMyOrders(int userId, const QueryContext &ctx)
 {
     QMutexLocker locker(&m_mutex);
     QVariantList result;
@@ -1392,68 +2200,37 @@ QVariantList DBManager::queryMyOrders(int userId)
         return result;
     }
 
-    if (userId <= 0) {
-        emit queryMyOrdersFailed("查询失败：用户ID无效！");
-        emit operateResult(false, "查询失败：用户ID无效！");
+    // 排队期间已超时，不再访问数据库
+    if (ctx.expired()) {
+        reportAborted("queryMyOrders");
         return result;
     }
 
-    QSqlQuery query(m_db);
-    QString sql = R"(
-        SELECT
-            o.order_id,
-            o.flight_id,
-            o.passenger_name,
-            o.passenger_idcard,
-            o.order_time,
-            o.status AS o_status,
-            f.Departure,
-            f.Destination,
-            f.depart_time,
-            f.arrive_time,
-            f.status AS f_status,
-            f.price,
-            f.remain_seats
-        FROM `order` o
-        INNER JOIN flight f ON o.flight_id = f.Flight_id
-        WHERE o.user_id = :userId
-        ORDER BY o.order_time DESC
-    )";
-
-    if (!query.prepare(sql)) {
-        QString errMsg = "[DB] 查询订单预处理失败：" + query.lastError().text();
-        qCritical() << errMsg;
-        emit queryMyOrdersFailed("查询失败：数据库操作错误！");
-        emit operateResult(false, errMsg);
+    if (userId <= 0) {
+        emit queryMyOrdersFailed("查询失败：用户ID无效！");
+        emit operateResult(false, "查询失败：用户ID无效！");
         return result;
     }
 
-    query.bindValue(":userId", userId);
+    // 分片时只查用户所在分片的订单表，航班字段随后从主库取回
+    QSqlQuery &query = m_shards.isEnabled() ? userBound<Sql::Id::ShardOrders>(userId, userId)
+                                            : bound<Sql::Id::MyOrders>(userId);
 
-    if (query.exec()) {
+    if (execWithDeadline(query, ctx, userDatabase(userId))) {
+        QList<QSqlRecord> orders;
         while (query.next()) {
-            QVariantMap order;
-            order["order_id"] = query.value("order_id").toString();
-            order["flight_id"] = query.value("flight_id").toString();
-            order["passenger_name"] = query.value("passenger_name").toString();
-            order["passenger_idcard"] = query.value("passenger_idcard").toString();
-            order["order_time"] = query.value("order_time").toDateTime().toString("yyyy-MM-dd HH:mm:ss");
-            order["o_status"] = query.value("o_status").toInt();
-            order["departure"] = query.value("Departure").toString();
-            order["destination"] = query.value("Destination").toString();
-            order["depart_time"] = query.value("depart_time").toDateTime().toString("yyyy-MM-dd HH:mm:ss");
-            order["arrive_time"] = query.value("arrive_time").toDateTime().toString("yyyy-MM-dd HH:mm:ss");
-            order["f_status"] = query.value("f_status").toInt();
-            order["price"] = query.value("price").toDouble();
-            order["remain_seats"] = query.value("remain_seats").toInt();
-
-            result.append(order);
+            if (ctx.expired()) {
+                reportAborted("queryMyOrders");
+                return QVariantList();
+            }
+            orders.append(query.record());
         }
+        result = orderMaps(orders);
         emit queryMyOrdersSuccess(result);
         emit operateResult(true, QString("查询成功，共 %1 个订单").arg(result.size()));
     } else {
         QString errMsg = "[DB] 查询订单失败：" + query.lastError().text();
-        qCritical() << errMsg;
+        FLOG_ERROR("db") << errMsg;
         emit queryMyOrdersFailed("查询失败：" + query.lastError().text());
         emit operateResult(false, errMsg);
     }
@@ -1462,7 +2239,22 @@ QVariantList DBManager::queryMyOrders(int userId)
 }
 
 // 查询所有订单
-QVariantList DBManager::queryAllOrders()
+QVariantList DBManager::queryAllOrders(int timeoutMs)
+{
+    WorkloadTrace::Scope trace("queryAllOrders", [&]() { return QVariantList{timeoutMs}; });
+    return queryAllOrders(makeQueryContext(timeoutMs));
+}
+
+// 分页查询所有订单
+QVariantList DBManager::queryOrdersPage(int offset, int limit, int timeoutMs)
+{
+    WorkloadTrace::Scope trace("queryOrdersPage", [&]() { return QVariantList{offset, limit, timeoutMs}; });
+    return queryAllOrders(makeQueryContext(timeoutMs), qMax(0, offset), qMax(0, limit));
+}
+
+// 分片时分散到全部分片再归并：每个分片按同样的顺序取前 offset + limit 条，
+// 多路归并后跳过 offset 条，取 limit 条（limit < 0 表示不分页）
+QVariantList DBManager::queryAllOrders(const QueryContext &ctx, int offset, int limit)
 {
     QMutexLocker locker(&m_mutex);
     QVariantList result;
@@ -1473,69 +2265,138 @@ QVariantList DBManager::queryAllOrders()
         return result;
     }
 
-    QSqlQuery query(m_db);
-    QString sql = R"(
-        SELECT
-            o.order_id,
-            o.flight_id,
-            o.passenger_name,
-            o.passenger_idcard,
-            o.order_time,
-            o.status AS o_status,
-            f.Departure,
-            f.Destination,
-            f.depart_time,
-            f.arrive_time,
-            f.status AS f_status,
-            f.price,
-            f.remain_seats
-        FROM `order` o
-        INNER JOIN flight f ON o.flight_id = f.Flight_id
-        ORDER BY o.order_time DESC
-    )";
-
-    if (!query.prepare(sql)) {
-        QString errMsg = "[DB] 查询订单预处理失败：" + query.lastError().text();
-        qCritical() << errMsg;
-        emit queryMyOrdersFailed("查询失败：数据库操作错误！");
-        emit operateResult(false, errMsg);
+    // 排队期间已超时，不再访问数据库
+    if (ctx.expired()) {
+        reportAborted("queryAllOrders");
         return result;
     }
 
-    if (query.exec()) {
-        while (query.next()) {
-            QVariantMap order;
-            order["order_id"] = query.value("order_id").toString();
-            order["flight_id"] = query.value("flight_id").toString();
-            order["passenger_name"] = query.value("passenger_name").toString();
-            order["passenger_idcard"] = query.value("passenger_idcard").toString();
-            order["order_time"] = query.value("order_time").toDateTime().toString("yyyy-MM-dd HH:mm:ss");
-            order["o_status"] = query.value("o_status").toInt();
-            order["departure"] = query.value("Departure").toString();
-            order["destination"] = query.value("Destination").toString();
-            order["depart_time"] = query.value("depart_time").toDateTime().toString("yyyy-MM-dd HH:mm:ss");
-            order["arrive_time"] = query.value("arrive_time").toDateTime().toString("yyyy-MM-dd HH:mm:ss");
-            order["f_status"] = query.value("f_status").toInt();
-            order["price"] = query.value("price").toDouble();
-            order["remain_seats"] = query.value("remain_seats").toInt();
-
-            result.append(order);
+    const int unlimited = std::numeric_limits<int>::max();
+    QList<QVariantList> parts;
+    QString error;
+    if (!m_shards.isEnabled()) {
+        // 连接时已预处理；不分页时 LIMIT 取最大值
+        QSqlQuery &query = bound<Sql::Id::AllOrdersPage>(limit < 0 ? unlimited : limit, offset);
+        if (!execWithDeadline(query, ctx)) {
+            error = query.lastError().text();
+        } else {
+            QList<QSqlRecord> orders;
+            while (query.next()) {
+                if (ctx.expired()) {
+                    reportAborted("queryAllOrders");
+                    return QVariantList();
+                }
+                orders.append(query.record());
+            }
+            result = orderMaps(orders);
+        }
+    } else {
+        m_shards.recordScatter();
+        const int perShard = limit < 0 ? unlimited : int(qMin<qint64>(qint64(offset) + limit, unlimited));
+        for (int shard = 0; shard < m_shards.shardCount() && error.isEmpty(); ++shard) {
+            // 航班不存在的订单在关联时被过滤，每个分片要取够 perShard 条有效订单：
+            // 过滤后不足且分片还有更多订单时加倍再取
+            int fetch = perShard;
+            for (;;) {
+                QSqlQuery &query = m_shards.bound<Sql::Id::ShardOrdersTop>(shard, fetch);
+                if (!execWithDeadline(query, ctx, m_shards.database(shard))) {
+                    error = query.lastError().text();
+                    break;
+                }
+                QList<QSqlRecord> orders;
+                while (query.next()) {
+                    if (ctx.expired()) {
+                        reportAborted("queryAllOrders");
+                        return QVariantList();
+                    }
+                    orders.append(query.record());
+                }
+                QVariantList part = orderMaps(orders);
+                if (part.size() >= perShard || orders.size() < fetch || fetch == unlimited) {
+                    if (part.size() > perShard)
+                        part.erase(part.begin() + perShard, part.end());
+                    parts.append(part);
+                    break;
+                }
+                fetch = int(qMin<qint64>(qint64(fetch) * 2, unlimited));
+            }
         }
+        // 与单库一致：下单时间倒序，同一时间按订单号倒序
+        result = ShardRouter::mergeSorted(parts, [](const QVariant &a, const QVariant &b) {
+            const QVariantMap x = a.toMap();
+            const QVariantMap y = b.toMap();
+            const QString timeX = x.value("order_time").toString();
+            const QString timeY = y.value("order_time").toString();
+            if (timeX != timeY)
+                return timeX > timeY;
+            return x.value("order_id").toString() > y.value("order_id").toString();
+        }, offset, limit);
+    }
+
+    if (error.isEmpty()) {
         emit queryMyOrdersSuccess(result);
         emit operateResult(true, QString("查询成功，共 %1 个订单").arg(result.size()));
     } else {
-        QString errMsg = "[DB] 查询订单失败：" + query.lastError().text();
-        qCritical() << errMsg;
-        emit queryMyOrdersFailed("查询失败：" + query.lastError().text());
+        QString errMsg = "[DB] 查询订单失败：" + error;
+        FLOG_ERROR("db") << errMsg;
+        emit queryMyOrdersFailed("查询失败：" + error);
         emit operateResult(false, errMsg);
+        result.clear();
     }
 
     return result;
 }
 
+// 订单行转为界面字段；单库时 JOIN 结果已带航班字段，分片时航班字段从主库一次取回后在应用侧关联
+QVariantList DBManager::orderMaps(const QList<QSqlRecord> &orders)
+{
+    QVariantList result;
+    QHash<QString, QSqlRecord> flights;
+    if (m_shards.isEnabled()) {
+        QStringList flightIds;
+        for (const QSqlRecord &order : orders)
+            flightIds.append(order.value("flight_id").toString());
+        flights = flightRecords(flightIds, "Departure, Destination, depart_time, arrive_time, "
+                                           "status AS f_status, price, remain_seats");
+    }
+    for (const QSqlRecord &order : orders) {
+        QSqlRecord flight = order;
+        if (m_shards.isEnabled()) {
+            auto it = flights.constFind(order.value("flight_id").toString());
+            if (it == flights.constEnd())
+                continue; // 与 INNER JOIN 一致：航班不存在的订单不返回
+            flight = *it;
+        }
+        QVariantMap map;
+        map["order_id"] = order.value("order_id").toString();
+        map["flight_id"] = order.value("flight_id").toString();
+        map["passenger_name"] = order.value("passenger_name").toString();
+        map["passenger_idcard"] = order.value("passenger_idcard").toString();
+        map["order_time"] = order.value("order_time").toDateTime().toString("yyyy-MM-dd HH:mm:ss");
+        map["o_status"] = order.value("o_status").toInt();
+        map["departure"] = flight.value("Departure").toString();
+        map["destination"] = flight.value("Destination").toString();
+        map["depart_time"] = flight.value("depart_time").toDateTime().toString("yyyy-MM-dd HH:mm:ss");
+        map["arrive_time"] = flight.value("arrive_time").toDateTime().toString("yyyy-MM-dd HH:mm:ss");
+        map["f_status"] = flight.value("f_status").toInt();
+        map["price"] = flight.value("price").toDouble();
+        map["remain_seats"] = flight.value("remain_seats").toInt();
+        result.append(map);
+    }
+    return result;
+}
+
 // 删除订单
-bool DBManager::deleteOrder(const QString& orderId)
+bool DBManager::deleteOrder(const QString& orderId, const QString &requestKey)
 {
+    WorkloadTrace::Scope trace("deleteOrder", [&]() { return QVariantList{orderId, requestKey}; });
+    if (!requestKey.isEmpty()) {
+        return runIdempotent("deleteOrder", requestKey, {orderId}, [&]() {
+                   return QVariant(deleteOrder(orderId));
+               })
+            .toBool();
+    }
+
     QMutexLocker locker(&m_mutex);
 
     if (!m_db.isOpen()) {
@@ -1543,97 +2404,292 @@ bool DBManager::deleteOrder(const QString& orderId)
         return false;
     }
 
-    m_db.transaction();
-
-    // 查询该订单对应的航班ID（先确认订单存在）
     QString flightId = "";
-    QSqlQuery queryGetFlight(m_db);
-    queryGetFlight.prepare("SELECT flight_id FROM `order` WHERE order_id = :order_id LIMIT 1");
-    queryGetFlight.bindValue(":order_id", orderId);
-    if (!queryGetFlight.exec() || !queryGetFlight.next()) {
-        m_db.rollback(); // 回滚事务
-        qDebug() << "删除订单失败：订单不存在（ID=" << orderId << "）";
+    if (m_shards.isEnabled()) {
+        if (!deleteShardOrder(orderId, &flightId))
+            return false;
+    } else {
+        // 语句顺序与错误处理由 BookingProtocol::Delete 决定（booking_sim 用同一协议做并发仿真）
+        using BookingProtocol::Outcome;
+        using BookingProtocol::Step;
+        BookingProtocol::Delete protocol;
+        QString error;
+        while (!protocol.finished()) {
+            Outcome outcome = Outcome::Ok;
+            switch (protocol.step()) {
+            case Step::Begin:
+                if (!m_db.transaction()) {
+                    error = m_db.lastError().text();
+                    outcome = Outcome::Failed;
+                }
+                break;
+            case Step::OrderFlight: {
+                // 查询该订单对应的航班ID（先确认订单存在）
+                QSqlQuery &queryGetFlight = bound<Sql::Id::OrderFlight>(orderId);
+                if (!queryGetFlight.exec()) {
+                    error = queryGetFlight.lastError().text();
+                    outcome = BookingPipeline::classify(queryGetFlight.lastError());
+                } else if (queryGetFlight.next()) {
+                    flightId = queryGetFlight.value("flight_id").toString();
+                } else {
+                    outcome = Outcome::NoRows;
+                }
+                break;
+            }
+            case Step::DeleteOrder: {
+                QSqlQuery &queryDeleteOrder = bound<Sql::Id::DeleteOrder>(orderId);
+                outcome = BookingPipeline::outcome(queryDeleteOrder, queryDeleteOrder.exec());
+                error = queryDeleteOrder.lastError().text();
+                break;
+            }
+            case Step::ReleaseSeat: {
+                // 更新航班剩余座位数（+1，且不超过总座位数）
+                QSqlQuery &queryUpdateSeat = bound<Sql::Id::ReleaseSeat>(flightId);
+                outcome = BookingPipeline::outcome(queryUpdateSeat, queryUpdateSeat.exec());
+                error = queryUpdateSeat.lastError().text();
+                break;
+            }
+            case Step::Commit:
+                if (!m_db.commit()) {
+                    error = m_db.lastError().text();
+                    outcome = Outcome::Failed;
+                }
+                break;
+            case Step::Rollback:
+                m_db.rollback();
+                break;
+            default:
+                break;
+            }
+            protocol.advance(outcome);
+        }
+
+        switch (protocol.result()) {
+        case BookingProtocol::Delete::Deleted:
+            break;
+        case BookingProtocol::Delete::NotFound:
+            FLOG_DEBUG("db") << "删除订单失败：订单不存在（ID=" << orderId << "）";
+            emit operateResult(false, "订单不存在");
+            return false;
+        case BookingProtocol::Delete::SeatFailed:
+            FLOG_DEBUG("db") << "更新剩余座位数失败：" << error;
+            emit operateResult(false, "删除订单成功，但更新座位数失败（已回滚订单删除）");
+            return false;
+        default:
+            FLOG_DEBUG("db") << "删除订单失败：" << error;
+            emit operateResult(false, "删除订单失败");
+            return false;
+        }
+    }
+
+    locker.unlock();
+    FLOG_DEBUG("db") << "删除订单成功（ID=" << orderId << "），航班（ID=" << flightId << "）剩余座位数+1";
+    audit("delete_order", orderId, QString("flight=%1").arg(flightId));
+    emit flightSeatsChanged(flightId, 1);
+    emit operateResult(true, "删除订单成功，剩余座位数已恢复");
+    return true;
+}
+
+// 分片时删除订单：订单号不含用户 Id，先在各分片查找订单；订单（分片）与余票（主库）不在同一个库，
+// 通过主库的座位意图保证删除订单与释放座位最终一致
+bool DBManager::deleteShardOrder(const QString &orderId, QString *flightId)
+{
+    m_shards.recordScatter();
+    int shard = -1;
+    for (int i = 0; i < m_shards.shardCount() && shard < 0; ++i) {
+        QSqlQuery &queryGetFlight = m_shards.bound<Sql::Id::OrderFlight>(i, orderId);
+        if (queryGetFlight.exec() && queryGetFlight.next()) {
+            shard = i;
+            *flightId = queryGetFlight.value("flight_id").toString();
+        }
+    }
+    if (shard < 0) {
+        FLOG_DEBUG("db") << "删除订单失败：订单不存在（ID=" << orderId << "）";
         emit operateResult(false, "订单不存在");
         return false;
     }
-    flightId = queryGetFlight.value("flight_id").toString();
 
-    // 删除订单
-    QSqlQuery queryDeleteOrder(m_db);
-    queryDeleteOrder.prepare("DELETE FROM `order` WHERE order_id = :order_id");
-    queryDeleteOrder.bindValue(":order_id", orderId);
+    // 先登记释放意图，再删除分片订单，最后在主库一个事务内释放座位并删除意图；
+    // 删除订单后中途退出，由 reconcileSeatIntents 发现订单已不存在后释放座位
+    if (!openSeatIntent(orderId, *flightId, shard, SeatRelease, nullptr)) {
+        emit operateResult(false, "删除订单失败");
+        return false;
+    }
+    QSqlQuery &queryDeleteOrder = m_shards.bound<Sql::Id::DeleteOrder>(shard, orderId);
     if (!queryDeleteOrder.exec() || queryDeleteOrder.numRowsAffected() == 0) {
-        m_db.rollback(); // 回滚事务
-        qDebug() << "删除订单失败：" << queryDeleteOrder.lastError().text();
+        FLOG_DEBUG("db") << "删除订单失败：" << queryDeleteOrder.lastError().text();
+        closeSeatIntent(orderId, *flightId, false);
         emit operateResult(false, "删除订单失败");
         return false;
     }
+    if (closeSeatIntent(orderId, *flightId, true) < 0)
+        FLOG_WARN("db") << "[DB] 订单" << orderId << "已删除，座位稍后由对账释放";
+    return true;
+}
 
-    // 更新航班剩余座位数（+1，且不超过总座位数）
-    QSqlQuery queryUpdateSeat(m_db);
-    queryUpdateSeat.prepare(R"(
-        UPDATE flight
-        SET remain_seats = remain_seats + 1
-        WHERE Flight_id = :flight_id AND remain_seats < total_seats
-    )");
-    queryUpdateSeat.bindValue(":flight_id", flightId);
-    if (!queryUpdateSeat.exec() || queryUpdateSeat.numRowsAffected() == 0) {
-        m_db.rollback(); // 回滚事务（订单已删，需恢复）
-        qDebug() << "更新剩余座位数失败：" << queryUpdateSeat.lastError().text();
-        emit operateResult(false, "删除订单成功，但更新座位数失败（已回滚订单删除）");
+// 主库登记座位变更意图；占座意图在同一事务内扣减余票（余票不足时 *soldOut 为 true）
+bool DBManager::openSeatIntent(const QString &orderId, const QString &flightId, int shard, SeatIntent kind, bool *soldOut)
+{
+    if (soldOut)
+        *soldOut = false;
+    if (!m_db.transaction()) {
+        FLOG_ERROR("db") << "[DB] 开启事务失败：" << m_db.lastError().text();
         return false;
     }
-
-    // 提交事务（所有操作成功，确认生效）
-    if (m_db.commit()) {
-        locker.unlock();
-        qDebug() << "删除订单成功（ID=" << orderId << "），航班（ID=" << flightId << "）剩余座位数+1";
-        emit operateResult(true, "删除订单成功，剩余座位数已恢复");
-        return true;
-    } else {
+    if (kind == SeatHold) {
+        QSqlQuery &takeSeat = bound<Sql::Id::TakeSeat>(flightId);
+        if (!takeSeat.exec() || takeSeat.numRowsAffected() == 0) {
+            if (soldOut)
+                *soldOut = takeSeat.lastError().type() == QSqlError::NoError;
+            m_db.rollback();
+            return false;
+        }
+    }
+    QSqlQuery &intent = bound<Sql::Id::InsertSeatIntent>(orderId, flightId, shard, int(kind));
+    if (!intent.exec() || !m_db.commit()) {
+        FLOG_ERROR("db") << "[DB] 登记座位意图失败：" << intent.lastError().text() << m_db.lastError().text();
         m_db.rollback();
-        qDebug() << "事务提交失败：" << m_db.lastError().text();
-        emit operateResult(false, "删除订单失败");
         return false;
     }
+    return true;
 }
 
-// 辅助函数：读取图片文件为二进制（带压缩）
-QByteArray DBManager::readImageToBlob(const QString &imgPath, int quality)
+// 删除未决的座位意图，release 为 true 时同一事务内释放座位
+// 返回 1 已删除；意图已被对账裁决时按裁决返回 0 对账已释放座位 / 2 对账保留了座位；
+// -1 出错（意图保留，由对账处理）
+int DBManager::closeSeatIntent(const QString &orderId, const QString &flightId, bool release)
 {
-    // 检查文件是否存在
-    QFile file(imgPath);
-    if (!file.exists()) {
-        qDebug() << "图片文件不存在：" << imgPath;
-        return QByteArray();
+    if (!m_db.transaction())
+        return -1;
+    QSqlQuery &intent = bound<Sql::Id::DeleteSeatIntent>(orderId);
+    if (!intent.exec()) {
+        FLOG_ERROR("db") << "[DB] 删除座位意图失败：" << intent.lastError().text();
+        m_db.rollback();
+        return -1;
     }
-
-    // 读取图片为QImage
-    QImage img;
-    if (!img.load(imgPath)) {
-        qDebug() << "不是有效图片文件：" << imgPath;
-        return QByteArray();
+    if (intent.numRowsAffected() == 0) {
+        m_db.rollback();
+        return takeSeatVerdict(orderId);
     }
+    if (release) {
+        // 影响 0 行表示余票已满（总座位数被调整），意图照常删除
+        QSqlQuery &releaseSeat = bound<Sql::Id::ReleaseSeat>(flightId);
+        if (!releaseSeat.exec()) {
+            FLOG_ERROR("db") << "[DB] 释放座位失败：" << releaseSeat.lastError().text();
+            m_db.rollback();
+            return -1;
+        }
+    }
+    if (!m_db.commit()) {
+        m_db.rollback();
+        return -1;
+    }
+    return 1;
+}
 
-    // 压缩图片（限制最大尺寸，可选）
-    if (img.width() > 1920 || img.height() > 1080) {
-        img = img.scaled(1920, 1080, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+// 写入方晚于对账：读取对账留下的裁决后删除它
+// 返回 0 对账已释放座位；2 对账保留了座位（或裁决已过期清除，座位状态不明时不撤销订单）；-1 出错
+int DBManager::takeSeatVerdict(const QString &orderId)
+{
+    QSqlQuery &verdict = bound<Sql::Id::SeatIntentKind>(orderId);
+    if (!verdict.exec()) {
+        FLOG_ERROR("db") << "[DB] 读取座位意图裁决失败：" << orderId << verdict.lastError().text();
+        return -1;
+    }
+    const int kind = verdict.next() ? verdict.value(0).toInt() : -1;
+    verdict.finish();
+    if (kind < 0) {
+        FLOG_WARN("db") << "[DB] 座位意图及裁决均不存在：" << orderId;
+        return 2;
     }
+    QSqlQuery &forget = bound<Sql::Id::ForgetSeatIntent>(orderId);
+    if (!forget.exec())
+        FLOG_WARN("db") << "[DB] 删除座位意图裁决失败（稍后由对账清除）：" << orderId << forget.lastError().text();
+    return kind == SeatReleased ? 0 : 2;
+}
 
-    // 正确获取文件格式（从路径后缀判断，替代错误的Format_PNG）
-    QString fileSuffix = imgPath.split(".").last().toLower();
-    // 兼容格式：jpg/jpeg统一为JPG，png为PNG
-    QString saveFormat = (fileSuffix == "png") ? "PNG" : "JPG";
+// 对账裁决一个未决意图：不删除，而是原地改为裁决（SeatReleased / SeatKept），release 时同一事务释放座位；
+// 条件更新只在意图仍为 openKind 时生效，与写入方的删除、其他进程的对账由行锁串行，只有一方生效
+bool DBManager::resolveSeatIntent(const QString &orderId, const QString &flightId, int openKind, bool release)
+{
+    if (!m_db.transaction())
+        return false;
+    QSqlQuery &resolve
+        = bound<Sql::Id::ResolveSeatIntent>(int(release ? SeatReleased : SeatKept), orderId, openKind);
+    if (!resolve.exec() || resolve.numRowsAffected() == 0) {
+        if (resolve.lastError().type() != QSqlError::NoError)
+            FLOG_ERROR("db") << "[DB] 裁决座位意图失败：" << resolve.lastError().text();
+        m_db.rollback();
+        return false;
+    }
+    if (release) {
+        QSqlQuery &releaseSeat = bound<Sql::Id::ReleaseSeat>(flightId);
+        if (!releaseSeat.exec()) {
+            FLOG_ERROR("db") << "[DB] 释放座位失败：" << releaseSeat.lastError().text();
+            m_db.rollback();
+            return false;
+        }
+    }
+    if (!m_db.commit()) {
+        m_db.rollback();
+        return false;
+    }
+    return true;
+}
 
-    // QImage转二进制BLOB（使用正确的格式字符串）
-    QByteArray blob;
-    QBuffer buffer(&blob);
-    buffer.open(QIODevice::WriteOnly);
-    img.save(&buffer, saveFormat.toUtf8().constData(), quality);
-    buffer.close();
+// 座位意图对账：处理登记超过 kSeatIntentGraceSeconds 仍未删除的意图（进程中途退出或提交结果未知）
+// 占座：订单已写入分片则保留座位，否则释放座位；释放：订单已删除则释放座位，
+// 订单仍在（删除没有执行）则保留一天后裁决为保留座位。
+// 裁决留在表中，写入方迟到时据此决定是否撤销订单；一天后无人读取的裁决在这里清除
+void DBManager::reconcileSeatIntents()
+{
+    if (!m_shards.isEnabled() || !m_db.isOpen())
+        return;
+    QSqlQuery &purge = bound<Sql::Id::PurgeSeatIntents>(24 * 3600);
+    if (!purge.exec())
+        FLOG_WARN("db") << "[DB] 清除座位意图裁决失败：" << purge.lastError().text();
+    QSqlQuery &query = bound<Sql::Id::StaleSeatIntents>(kSeatIntentGraceSeconds);
+    if (!query.exec()) {
+        FLOG_WARN("db") << "[DB] 查询座位意图失败：" << query.lastError().text();
+        return;
+    }
+    QList<QSqlRecord> intents;
+    while (query.next())
+        intents.append(query.record());
+    query.finish();
+
+    int released = 0;
+    int cleared = 0;
+    for (const QSqlRecord &intent : intents) {
+        const QString orderId = intent.value("order_id").toString();
+        const QString flightId = intent.value("flight_id").toString();
+        const int shard = intent.value("shard").toInt();
+        const int kind = intent.value("kind").toInt();
+        if (shard < 0 || shard >= m_shards.shardCount()) {
+            FLOG_WARN("db") << "[DB] 座位意图的分片不存在：" << orderId << shard;
+            continue;
+        }
+        QSqlQuery &find = m_shards.bound<Sql::Id::OrderFlight>(shard, orderId);
+        if (!find.exec())
+            continue; // 分片不可用，下次再处理
+        const bool exists = find.next();
+        bool release = !exists;
+        if (kind == SeatRelease && exists) {
+            if (intent.value("age").toLongLong() < 24 * 3600)
+                continue;
+            release = false;
+        }
+        if (resolveSeatIntent(orderId, flightId, kind, release))
+            ++(release ? released : cleared);
+    }
+    if (released || cleared)
+        FLOG_WARN("db") << "[DB] 座位意图对账：释放座位" << released << "个，保留座位" << cleared << "个";
+}
 
-    qDebug() << "图片读取成功，压缩后大小：" << blob.size() << "字节";
-    return blob;
+// 辅助函数：读取图片文件为二进制（带压缩）
+QByteArray DBManager::readImageToBlob(const QString &imgPath, int quality, QString *format)
+{
+    return ImageCodec::readImageToBlob(imgPath, quality, format);
 }
 
 // 发布帖子
@@ -1641,28 +2697,50 @@ bool DBManager::publishPost(const QString &title,
                             const QString &content,
                             int userId,
                             const QByteArray &imgBlob,
-                            const QString &imgFormat)
+                            const QString &imgFormat,
+                            const QString &requestKey)
 {
+    WorkloadTrace::Scope trace("publishPost", [&]() {
+        return QVariantList{title, content, userId, imgBlob, imgFormat, requestKey};
+    });
+    if (!requestKey.isEmpty()) {
+        return runIdempotent("publishPost", requestKey, {title, content, userId, imgBlob, imgFormat}, [&]() {
+                   return QVariant(publishPost(title, content, userId, imgBlob, imgFormat));
+               })
+            .toBool();
+    }
+
     if (!isConnected() || title.isEmpty() || content.isEmpty() || userId <= 0) {
         emit operateResult(false, "标题/正文不能为空");
         return false;
     }
 
-    QSqlQuery query(m_db);
-    query.prepare(R"(
-        INSERT INTO posts (title, content, user_id, img_blob, img_format)
-        VALUES (:title, :content, :user_id, :img_blob, :img_format)
-    )");
-    query.bindValue(":title", title);
-    query.bindValue(":content", content);
-    query.bindValue(":user_id", userId);
-    query.bindValue(":img_blob", imgBlob); // 空则存NULL
-    query.bindValue(":img_format", imgFormat);
+    // 图片不再作为单个参数绑定（受 max_allowed_packet 限制），帖子行写入后按块写入 blob_chunks
+    // 事务期间持锁，避免其他调用在同一连接上的语句混入本事务
+    QMutexLocker locker(&m_mutex);
+    m_db.transaction();
+    QSqlQuery &query = bound<Sql::Id::InsertPost>(title, content, userId, imgFormat);
 
     if (!query.exec()) {
+        m_db.rollback();
         emit operateResult(false, "发布失败：" + query.lastError().text());
         return false;
     }
+    if (!imgBlob.isEmpty()) {
+        QSqlQuery &idQuery = statement(Sql::Id::LastInsertId);
+        if (!idQuery.exec() || !idQuery.next()
+            || !BlobStore::write(m_db, BlobStore::kPost, idQuery.value(0).toInt(), imgBlob)) {
+            m_db.rollback();
+            emit operateResult(false, "发布失败：图片写入失败");
+            return false;
+        }
+    }
+    if (!m_db.commit()) {
+        m_db.rollback();
+        emit operateResult(false, "发布失败：事务提交失败");
+        return false;
+    }
+    locker.unlock();
     emit operateResult(true, "发布成功");
     return true;
 }
@@ -1671,8 +2749,13 @@ bool DBManager::publishPost(const QString &title,
 bool DBManager::publishPostWithPath(const QString &title,
                                     const QString &content,
                                     int userId,
-                                    const QString &imgPath)
+                                    const QString &imgPath,
+                                    const QString &requestKey)
 {
+    WorkloadTrace::Scope trace("publishPostWithPath", [&]() {
+        return QVariantList{title, content, userId, imgPath, requestKey};
+    });
+
     //将路径修改为合法路径
     QString path = imgPath.mid(8);
     path = path.replace('/', '\\');
@@ -1683,36 +2766,42 @@ bool DBManager::publishPostWithPath(const QString &title,
         return false;
     }
 
-    // C++读取图片文件为二进制（带压缩）
-    QByteArray imgBlob = readImageToBlob(path, 80);
-    if (imgBlob.isEmpty()) {
-        emit operateResult(false, "图片读取失败或不是有效图片");
-        return false;
-    }
-
-    // 获取图片格式（后缀）
-    QString imgFormat = path.split(".").last().toLower();
-    // 兼容jpg/jpeg
-    if (imgFormat == "jpeg")
-        imgFormat = "jpg";
-
-    // 复用原有publishPost函数存入数据库
-    return publishPost(title, content, userId, imgBlob, imgFormat);
+    // 图片解码和编码（带压缩，格式按内容选择）在执行器上进行，完成后回到界面线程入库
+    // 返回 true 只表示已开始处理，结果经 operateResult 通知；请求键交给 publishPost 去重
+    auto *watcher = new QFutureWatcher<ImageCodec::Encoded>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [=]() {
+        watcher->deleteLater();
+        const ImageCodec::Encoded encoded = watcher->isCanceled() ? ImageCodec::Encoded() : watcher->result();
+        if (encoded.isNull()) {
+            emit operateResult(false, "图片读取失败或不是有效图片");
+            return;
+        }
+        emit imageEncoded("post", encoded.format, encoded.sourceBytes, encoded.blob.size(),
+                          encoded.legacyBytes);
+
+        // 复用原有publishPost函数存入数据库
+        publishPost(title, content, userId, encoded.blob, encoded.format, requestKey);
+    });
+    watcher->setFuture(Executor::instance()->run(Executor::Normal, [path]() {
+        return ImageCodec::encodeFile(path, 80);
+    }));
+    return true;
 }
 
 // 获取最新帖子的ID（无帖子返回-1）
 int DBManager::getLatestPostId()
 {
+    WorkloadTrace::Scope trace("getLatestPostId");
     if (!isConnected()) {
-        qDebug() << "获取最新帖子ID失败：数据库未连接";
+        FLOG_DEBUG("db") << "获取最新帖子ID失败：数据库未连接";
         return -1;
     }
 
-    QSqlQuery query(m_db);
-    query.prepare("SELECT MAX(id) AS latest_id FROM posts");
+    QMutexLocker locker(&m_mutex);
+    QSqlQuery &query = statement(Sql::Id::LatestPostId);
 
     if (!query.exec()) {
-        qDebug() << "查询最新帖子ID失败：" << query.lastError().text();
+        FLOG_DEBUG("db") << "查询最新帖子ID失败：" << query.lastError().text();
         return -1;
     }
 
@@ -1725,41 +2814,48 @@ int DBManager::getLatestPostId()
         }
     }
 
-    qDebug() << "当前最新帖子ID：" << (latestId > 0 ? QString::number(latestId) : "无帖子");
+    FLOG_DEBUG("db") << "当前最新帖子ID：" << (latestId > 0 ? QString::number(latestId) : "无帖子");
     return latestId;
 }
 
 // 查询帖子详情
 QVariantMap DBManager::queryPostDetail(int postId, int currentUserId)
 {
+    WorkloadTrace::Scope trace("queryPostDetail", [&]() { return QVariantList{postId, currentUserId}; });
     QMutexLocker locker(&m_mutex);
 
     QVariantMap postMap = QVariantMap();
     if (!isConnected() || postId <= 0)
         return postMap;
 
-    // 查询帖子基础信息
-    QSqlQuery query(m_db);
-    query.prepare(R"(
-        SELECT id, title, content, create_time, img_blob, img_format
-        FROM posts WHERE id = :post_id AND status = 'normal'
-    )");
-    query.bindValue(":post_id", postId);
+    // 查询帖子基础信息（图片已在 C++ 侧缓存时不再读取大字段）
+    const QString imageKey = ImageStore::postKey(postId);
+    QString imageUrl = m_imageStore.urlFor(imageKey);
+    QSqlQuery &query = imageUrl.isEmpty() ? bound<Sql::Id::PostDetail>(postId)
+                                          : bound<Sql::Id::PostDetailNoImage>(postId);
 
     if (!query.exec() || !query.next()) {
-        qDebug() << "查询帖子失败：" << query.lastError().text();
+        FLOG_DEBUG("db") << "查询帖子失败：" << query.lastError().text();
         return postMap;
     }
 
-    qDebug()<<"查询帖子成功";
+    FLOG_DEBUG("db")<<"查询帖子成功";
 
     // 封装核心字段
     postMap["id"] = query.value("id").toInt();
     postMap["title"] = query.value("title").toString();
     postMap["content"] = query.value("content").toString();
     postMap["create_time"] = query.value("create_time").toString();
-    postMap["img_blob"] = query.value("img_blob").toByteArray();
     postMap["img_format"] = query.value("img_format").toString();
+    // 图片字节留在 C++ 侧，QML 通过 image://blobs/ 地址加载
+    if (imageUrl.isEmpty()) {
+        // 新帖子的图片在 blob_chunks 中，旧帖子仍在 img_blob 字段
+        QByteArray blob = query.value("img_blob").toByteArray();
+        if (blob.isEmpty())
+            blob = readBlobStream(BlobStore::kPost, postId);
+        imageUrl = m_imageStore.put(imageKey, blob, query.value("img_format").toString());
+    }
+    postMap["image_url"] = imageUrl;
 
     // 查询当前用户的操作状态（是否点赞/喜欢）
     postMap["is_liked"] = isPostLiked(currentUserId, postId);
@@ -1768,30 +2864,16 @@ QVariantMap DBManager::queryPostDetail(int postId, int currentUserId)
     return postMap;
 }
 
-// 点赞
+// 点赞（写入延迟队列，定时批量写库）
 bool DBManager::likePost(int userId, int postId)
 {
+    WorkloadTrace::Scope trace("likePost", [&]() { return QVariantList{userId, postId}; });
     if (!isConnected() || userId <= 0 || postId <= 0)
         return false;
-    if (isPostLiked(userId, postId)) {
+    if (!setInteraction(userId, postId, InteractionWriteBehind::Like, true)) {
         emit operateResult(false, "已点赞");
         return false;
     }
-
-    m_db.transaction();
-    // 插入点赞记录
-    QSqlQuery query(m_db);
-    query.prepare("INSERT INTO user_post_likes (user_id, post_id) VALUES (:user_id, :post_id)");
-    query.bindValue(":user_id", userId);
-    query.bindValue(":post_id", postId);
-
-    if (!query.exec()) {
-        m_db.rollback();
-        emit operateResult(false, "点赞失败：" + query.lastError().text());
-        return false;
-    }
-
-    m_db.commit();
     emit operateResult(true, "点赞成功");
     return true;
 }
@@ -1799,69 +2881,39 @@ bool DBManager::likePost(int userId, int postId)
 // 取消点赞
 bool DBManager::cancelLikePost(int userId, int postId)
 {
+    WorkloadTrace::Scope trace("cancelLikePost", [&]() { return QVariantList{userId, postId}; });
     if (!isConnected() || userId <= 0 || postId <= 0)
         return false;
-    if (!isPostLiked(userId, postId)) {
+    if (!setInteraction(userId, postId, InteractionWriteBehind::Like, false)) {
         emit operateResult(false, "未点赞");
         return false;
     }
-
-    m_db.transaction();
-    // 删除点赞记录
-    QSqlQuery query(m_db);
-    query.prepare("DELETE FROM user_post_likes WHERE user_id = :user_id AND post_id = :post_id");
-    query.bindValue(":user_id", userId);
-    query.bindValue(":post_id", postId);
-
-    if (!query.exec()) {
-        m_db.rollback();
-        emit operateResult(false, "取消点赞失败");
-        return false;
-    }
-
-    m_db.commit();
     emit operateResult(true, "取消点赞成功");
     return true;
 }
 
-// 是否点赞
+// 是否点赞（待写入的意图优先）
 bool DBManager::isPostLiked(int userId, int postId)
 {
+    WorkloadTrace::Scope trace("isPostLiked", [&]() { return QVariantList{userId, postId}; });
     if (!isConnected() || userId <= 0 || postId <= 0)
         return false;
-
-    QSqlQuery query(m_db);
-    query.prepare(
-        "SELECT 1 FROM user_post_likes WHERE user_id = :user_id AND post_id = :post_id LIMIT 1");
-    query.bindValue(":user_id", userId);
-    query.bindValue(":post_id", postId);
-
-    return query.exec() && query.next();
+    bool state = false;
+    if (m_interactions.pendingState({userId, postId, InteractionWriteBehind::Like}, &state))
+        return state;
+    return isInteractionStored(userId, postId, InteractionWriteBehind::Like);
 }
 
 // 喜欢
 bool DBManager::favoritePost(int userId, int postId)
 {
+    WorkloadTrace::Scope trace("favoritePost", [&]() { return QVariantList{userId, postId}; });
     if (!isConnected() || userId <= 0 || postId <= 0)
         return false;
-    if (isPostFavorited(userId, postId)) {
+    if (!setInteraction(userId, postId, InteractionWriteBehind::Favorite, true)) {
         emit operateResult(false, "已喜欢");
         return false;
     }
-
-    m_db.transaction();
-    QSqlQuery query(m_db);
-    query.prepare("INSERT INTO user_post_favorites (user_id, post_id) VALUES (:user_id, :post_id)");
-    query.bindValue(":user_id", userId);
-    query.bindValue(":post_id", postId);
-
-    if (!query.exec()) {
-        m_db.rollback();
-        emit operateResult(false, "喜欢失败");
-        return false;
-    }
-
-    m_db.commit();
     emit operateResult(true, "喜欢成功");
     return true;
 }
@@ -1869,51 +2921,136 @@ bool DBManager::favoritePost(int userId, int postId)
 // 取消喜欢
 bool DBManager::cancelFavoritePost(int userId, int postId)
 {
+    WorkloadTrace::Scope trace("cancelFavoritePost", [&]() { return QVariantList{userId, postId}; });
     if (!isConnected() || userId <= 0 || postId <= 0)
         return false;
-    if (!isPostFavorited(userId, postId)) {
+    if (!setInteraction(userId, postId, InteractionWriteBehind::Favorite, false)) {
         emit operateResult(false, "未喜欢");
         return false;
     }
-
-    m_db.transaction();
-    QSqlQuery query(m_db);
-    query.prepare(
-        "DELETE FROM user_post_favorites WHERE user_id = :user_id AND post_id = :post_id");
-    query.bindValue(":user_id", userId);
-    query.bindValue(":post_id", postId);
-
-    if (!query.exec()) {
-        m_db.rollback();
-        emit operateResult(false, "取消喜欢失败");
-        return false;
-    }
-
-    m_db.commit();
     emit operateResult(true, "取消喜欢成功");
     return true;
 }
 
-// 是否喜欢
+// 是否喜欢（待写入的意图优先）
 bool DBManager::isPostFavorited(int userId, int postId)
 {
+    WorkloadTrace::Scope trace("isPostFavorited", [&]() { return QVariantList{userId, postId}; });
     if (!isConnected() || userId <= 0 || postId <= 0)
         return false;
+    bool state = false;
+    if (m_interactions.pendingState({userId, postId, InteractionWriteBehind::Favorite}, &state))
+        return state;
+    return isInteractionStored(userId, postId, InteractionWriteBehind::Favorite);
+}
 
-    QSqlQuery query(m_db);
-    query.prepare("SELECT 1 FROM user_post_favorites WHERE user_id = :user_id AND post_id = "
-                  ":post_id LIMIT 1");
-    query.bindValue(":user_id", userId);
-    query.bindValue(":post_id", postId);
+// 记录点赞/喜欢意图；已处于目标状态时返回 false
+bool DBManager::setInteraction(int userId, int postId, InteractionWriteBehind::Kind kind, bool desired)
+{
+    const InteractionWriteBehind::Key key{userId, postId, kind};
+    bool current = false;
+    const bool pending = m_interactions.pendingState(key, &current);
+    const bool stored = pending ? !current : isInteractionStored(userId, postId, kind);
+    if (!pending)
+        current = stored;
+    if (current == desired)
+        return false;
+    m_interactions.record(key, desired, stored);
+    return true;
+}
 
+// 数据库中是否已有点赞/喜欢记录
+bool DBManager::isInteractionStored(int userId, int postId, InteractionWriteBehind::Kind kind)
+{
+    QMutexLocker locker(&m_mutex);
+    QSqlQuery &query = kind == InteractionWriteBehind::Like
+                           ? userBound<Sql::Id::PostLiked>(userId, userId, postId)
+                           : userBound<Sql::Id::PostFavorited>(userId, userId, postId);
     return query.exec() && query.next();
 }
 
+// 把待写入的点赞/喜欢批量写库：每张表一条多行 INSERT IGNORE 和一条多行 DELETE，同一事务
+bool DBManager::flushInteractions()
+{
+    WorkloadTrace::Scope trace("flushInteractions");
+    if (m_interactions.pendingCount() == 0)
+        return true;
+    // 取出与写回都在 m_mutex 内：与 deleteUser 串行，取出后失败放回的变更不会在用户删除后再写回
+    QMutexLocker locker(&m_mutex);
+    QList<InteractionWriteBehind::Change> changes = m_interactions.takeAll();
+    if (changes.isEmpty())
+        return true;
+
+    if (!m_db.isOpen()) {
+        m_interactions.restore(changes);
+        return false;
+    }
+
+    // 分片时先按用户所在分片分组，每个分片一个事务；写入失败的分片放回队列，下次重试
+    QHash<int, QList<InteractionWriteBehind::Change>> byShard;
+    for (const auto &change : changes)
+        byShard[m_shards.isEnabled() ? m_shards.shardOf(change.key.userId) : -1].append(change);
+
+    constexpr int kRowsPerStatement = 200;
+    bool flushed = true;
+    for (auto part = byShard.constBegin(); part != byShard.constEnd(); ++part) {
+        QSqlDatabase db = part.key() < 0 ? m_db : m_shards.database(part.key());
+
+        // 按 (表, 插入/删除) 分组
+        QHash<int, QList<QPair<int, int>>> groups;
+        for (const auto &change : part.value())
+            groups[int(change.key.kind) * 2 + (change.desired ? 1 : 0)].append({change.key.userId, change.key.postId});
+
+        db.transaction();
+        bool ok = true;
+        for (auto it = groups.constBegin(); ok && it != groups.constEnd(); ++it) {
+            const QString table = (it.key() / 2 == InteractionWriteBehind::Like) ? "user_post_likes"
+                                                                                  : "user_post_favorites";
+            const bool insert = (it.key() % 2) == 1;
+            QList<QVariantList> columns(2); // user_id 列、post_id 列
+            for (const auto &row : it.value()) {
+                columns[0].append(row.first);
+                columns[1].append(row.second);
+            }
+            QString error;
+            ok = insert ? SqlBatch::exec(db, QString("INSERT IGNORE INTO %1 (user_id, post_id) VALUES ").arg(table),
+                                         columns, QString(), kRowsPerStatement, &error)
+                        : SqlBatch::exec(db, QString("DELETE FROM %1 WHERE (user_id, post_id) IN (").arg(table),
+                                         columns, ")", kRowsPerStatement, &error);
+            if (!ok)
+                FLOG_ERROR("db") << "[DB] 点赞/喜欢批量写入失败：" << error;
+        }
+
+        if (ok && db.commit()) {
+            FLOG_DEBUG("db") << "点赞/喜欢批量写入" << part.value().size() << "条";
+            continue;
+        }
+        db.rollback();
+        m_interactions.restore(part.value());
+        flushed = false;
+    }
+    return flushed;
+}
+
+// 点赞/喜欢延迟写入统计
+QVariantMap DBManager::interactionStats() const
+{
+    WorkloadTrace::Scope trace("interactionStats");
+    return m_interactions.stats();
+}
+
 // Blob转QImage
 QString DBManager::blobToImage(const QByteArray &blob, const QString &format)
 {
-    QImage image;
-    image.loadFromData(blob, format.toUtf8());
+    WorkloadTrace::Scope trace("blobToImage", [&]() { return QVariantList{blob, format}; });
+    // 与分块读取设备相同，经 QImageReader 从设备解码（渐进式格式可边读边解码）
+    QBuffer source;
+    source.setData(blob);
+    source.open(QIODevice::ReadOnly);
+    QImageReader reader(&source, format.toUtf8());
+    const QImage image = reader.read();
+    if (image.isNull())
+        FLOG_WARN("db") << "图片解码失败：" << reader.errorString();
 
     // 转换为 base64
     QByteArray byteArray;
@@ -1925,15 +3062,30 @@ QString DBManager::blobToImage(const QByteArray &blob, const QString &format)
         .arg(format.toLower())
         .arg(QString(byteArray.toBase64()));
 }
+
+// 解码和重新编码在执行器上进行，界面线程只接收结果
+void DBManager::blobToImageAsync(const QByteArray &blob, const QString &format, const QString &tag)
+{
+    auto *watcher = new QFutureWatcher<QString>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, tag]() {
+        watcher->deleteLater();
+        emit imageConverted(tag, watcher->isCanceled() ? QString() : watcher->result());
+    });
+    watcher->setFuture(Executor::instance()->run(Executor::Normal, [this, blob, format]() {
+        return blobToImage(blob, format);
+    }));
+}
 // 获取当前登录用户的手机号
 QString DBManager::getCurrentUserPhone() const
 {
+    WorkloadTrace::Scope trace("getCurrentUserPhone");
     return m_currentUserPhone;
 }
 
 // 获取当前登录用户的身份证号
 QString DBManager::getCurrentUserIdCard() const
 {
+    WorkloadTrace::Scope trace("getCurrentUserIdCard");
     return m_currentUserIdCard;
 }
 
@@ -1942,20 +3094,22 @@ QString DBManager::getCurrentUserIdCard() const
 // 更新当前用户的手机号
 bool DBManager::updateUserPhone(const QString& phone)
 {
-    QSqlQuery query(m_db);
-    query.prepare("UPDATE user_info SET phone = ? WHERE Uid = ?");
-    query.addBindValue(phone);
-    query.addBindValue(m_currentUserId);
+    WorkloadTrace::Scope trace("updateUserPhone", [&]() { return QVariantList{phone}; });
+    QMutexLocker locker(&m_mutex);
+    QSqlQuery &query = userBound<Sql::Id::UpdateUserPhone>(m_currentUserId, phone, m_currentUserId);
+    const bool success = query.exec();
+    const QString error = query.lastError().text();
+    locker.unlock();
 
-    if (query.exec()) {
+    if (success) {
         m_currentUserPhone = phone;
         emit userInfoChanged();
         emit userPhoneUpdated(true, "手机号更新成功");
-        qDebug() << "用户手机号更新成功，用户ID：" << m_currentUserId << "，手机号：" << phone;
+        FLOG_DEBUG("db") << "用户手机号更新成功，用户ID：" << m_currentUserId << "，手机号：" << phone;
         return true;
     } else {
-        qCritical() << "更新手机号失败：" << query.lastError().text();
-        emit userPhoneUpdated(false, "更新手机号失败：" + query.lastError().text());
+        FLOG_ERROR("db") << "更新手机号失败：" << error;
+        emit userPhoneUpdated(false, "更新手机号失败：" + error);
         return false;
     }
 }
@@ -1963,173 +3117,448 @@ bool DBManager::updateUserPhone(const QString& phone)
 // 更新当前用户的身份证号
 bool DBManager::updateUserIdCard(const QString& idCard)
 {
-    QSqlQuery query(m_db);
-    query.prepare("UPDATE user_info SET idcard = ? WHERE Uid = ?");
-    query.addBindValue(idCard);
-    query.addBindValue(m_currentUserId);
+    WorkloadTrace::Scope trace("updateUserIdCard", [&]() { return QVariantList{idCard}; });
+    QMutexLocker locker(&m_mutex);
+    QSqlQuery &query = userBound<Sql::Id::UpdateUserIdCard>(m_currentUserId, idCard, m_currentUserId);
+    const bool success = query.exec();
+    const QString error = query.lastError().text();
+    locker.unlock();
 
-    if (query.exec()) {
+    if (success) {
         m_currentUserIdCard = idCard;
         emit userInfoChanged();
         emit userIdCardUpdated(true, "身份证号更新成功");
-        qDebug() << "用户身份证号更新成功，用户ID：" << m_currentUserId << "，身份证号：" << idCard;
+        FLOG_DEBUG("db") << "用户身份证号更新成功，用户ID：" << m_currentUserId << "，身份证号：" << idCard;
         return true;
     } else {
-        qCritical() << "更新身份证号失败：" << query.lastError().text();
-        emit userIdCardUpdated(false, "更新身份证号失败：" + query.lastError().text());
+        FLOG_ERROR("db") << "更新身份证号失败：" << error;
+        emit userIdCardUpdated(false, "更新身份证号失败：" + error);
         return false;
     }
 }
 
-bool DBManager::createOrder(int userId, const QString &flightId, const QString& passengerName, const QString& passengerIdcard)
+// `order` 补建幂等键列：request_key 唯一（NULL 不参与），与订单同一条 INSERT 写入，
+// 提交结果不确定或重试时按键查订单即可知道首次下单是否已落库（进程重启、其他客户端进程同样有效）
+bool DBManager::ensureRequestKeyColumns(QSqlDatabase &db)
 {
+    QSqlQuery query(db);
+    auto present = [&]() {
+        return query.exec("SELECT COUNT(*) FROM information_schema.COLUMNS WHERE TABLE_SCHEMA = DATABASE() "
+                          "AND TABLE_NAME = 'order' AND COLUMN_NAME = 'request_key'")
+               && query.next() && query.value(0).toInt() > 0;
+    };
+    if (present())
+        return true;
+    if (!query.exec("ALTER TABLE `order` ADD COLUMN request_key VARCHAR(64) NULL, "
+                    "ADD COLUMN request_hash CHAR(40) NULL, ADD UNIQUE KEY uk_request_key (request_key)")) {
+        const QString error = query.lastError().text();
+        if (present()) // 其他客户端并发补建
+            return true;
+        FLOG_ERROR("db") << "[DB] 补建订单幂等键列失败：" << error;
+        return false;
+    }
+    FLOG_INFO("db") << "[DB] 订单表已补建幂等键列（" << db.databaseName() << "）";
+    return true;
+}
+
+// 按幂等键查该用户所在库中的订单（调用方持有 m_mutex）
+DBManager::KeyedOrder DBManager::keyedOrder(int userId,
+                                            const QString &requestKey,
+                                            const QString &requestHash,
+                                            QString *orderId)
+{
+    QSqlQuery &query = userBound<Sql::Id::OrderByRequestKey>(userId, requestKey);
+    if (!query.exec()) {
+        FLOG_ERROR("db") << "[DB] 按幂等键查询订单失败：" << query.lastError().text();
+        return KeyUnknown;
+    }
+    if (!query.next())
+        return KeyAbsent;
+    *orderId = query.value(0).toString();
+    return query.value(1).toString() == requestHash ? KeyMatched : KeyConflict;
+}
+
+// 按键找到的结果告知界面：已有订单时返回首次下单的结果（不再扣减余票）
+bool DBManager::reportKeyedOrder(KeyedOrder state, const QString &requestKey)
+{
+    switch (state) {
+    case KeyMatched:
+        FLOG_INFO("db") << "[DB] 幂等键" << requestKey << "已下单，返回首次下单结果";
+        emit operateResult(true, "创建订单成功");
+        return true;
+    case KeyConflict:
+        FLOG_WARN("db") << "[DB] 幂等键" << requestKey << "已用于参数不同的下单，拒绝";
+        emit orderCreatedFailed("创建订单失败：幂等键已用于其他下单请求");
+        return false;
+    default:
+        emit orderCreatedFailed("创建订单失败：无法确认下单结果，请稍后用同一请求重试");
+        return false;
+    }
+}
+
+// 下单成功：审计并通知界面
+void DBManager::reportOrderCreated(int userId, const QString &flightId, const QString &orderId)
+{
+    FLOG_DEBUG("db") << "订单创建成功，订单ID：" << orderId; // 直接使用生成的 ID
+    audit("create_order", orderId, QString("user=%1 flight=%2").arg(userId).arg(flightId));
+    emit flightSeatsChanged(flightId, -1);
+    emit operateResult(true, "创建订单成功");
+}
+
+// 携带幂等键时：先按键查订单，已有则直接返回首次结果；下单时键与参数摘要随订单写入（唯一键），
+// 同一个键的并发请求只有一个能写入；下单失败（含提交结果不确定、连接中断、键冲突）后再按键查一次，
+// 以库中是否有该键的订单为准，不会因重试而重复订票
+bool DBManager::createOrder(int userId, const QString &flightId, const QString& passengerName, const QString& passengerIdcard, const QString &requestKey)
+{
+    WorkloadTrace::Scope trace("createOrder", [&]() {
+        return QVariantList{userId, flightId, passengerName, passengerIdcard, requestKey};
+    });
+    m_hotFlights.record(flightId);
+    QMutexLocker locker(&m_mutex);
     // 1. 基础校验：数据库连接
     if (!m_db.isOpen()) {
-        qCritical() << "数据库未连接";
+        FLOG_ERROR("db") << "数据库未连接";
         emit orderCreatedFailed("数据库未连接");
         return false;
     }
 
-    //  开启事务（必须在所有Query操作前，且保证闭环）
-    if (!m_db.transaction()) {
-        qCritical() << "开启事务失败：" << m_db.lastError().text();
-        emit orderCreatedFailed("创建订单失败：事务开启失败");
-        return false;
+    QString requestHash;
+    QString existing;
+    if (!requestKey.isEmpty()) {
+        if (requestKey.size() > kRequestKeyMaxLength) {
+            emit orderCreatedFailed("创建订单失败：幂等键过长");
+            return false;
+        }
+        requestHash = argumentsHash({userId, flightId, passengerName, passengerIdcard});
+        const KeyedOrder state = keyedOrder(userId, requestKey, requestHash, &existing);
+        if (state != KeyAbsent) {
+            locker.unlock();
+            return reportKeyedOrder(state, requestKey);
+        }
     }
 
-    // 2. 原子扣减余票（解决超卖）
-    QSqlQuery flightQuery(m_db);
-    flightQuery.prepare("UPDATE flight SET remain_seats = remain_seats - 1 WHERE Flight_id = ? AND remain_seats > 0");
-    flightQuery.addBindValue(flightId);
-    if (!flightQuery.exec() || flightQuery.numRowsAffected() == 0) {
-        m_db.rollback();
-        emit orderCreatedFailed("航班已无余票或航班不存在");
+    QString orderId;
+    QString error;
+    bool booked = placeOrder(userId, flightId, passengerName, passengerIdcard, requestKey, requestHash, &orderId, &error);
+    if (!booked && !requestKey.isEmpty()) {
+        const KeyedOrder state = keyedOrder(userId, requestKey, requestHash, &existing);
+        if (state == KeyMatched && existing == orderId) {
+            FLOG_WARN("db") << "[DB] 下单报错但订单已提交：" << orderId << error;
+            booked = true;
+        } else if (state != KeyAbsent) {
+            locker.unlock();
+            return reportKeyedOrder(state, requestKey); // 同一个键的并发请求已写入
+        }
+    }
+    locker.unlock();
+    if (!booked) {
+        emit orderCreatedFailed(error);
         return false;
     }
+    reportOrderCreated(userId, flightId, orderId);
+    return true;
+}
 
-    // 3. 手动生成自定义订单 ID（核心：替代自增 ID）
-    // 格式：ORD + 年月日(YYYYMMDD) + 时分秒(HHmmss) + 毫秒(zzz)
-    QString timeStr = QDateTime::currentDateTime().toString("yyyyMMddHHmmsszzz");
-    QString orderId = QString("ORD%1").arg(timeStr);
-
-    // 4. 创建订单（插入手动生成的 order_id）
-    QSqlQuery orderQuery(m_db);
+// 执行下单，按配置走分片、存储过程或直接事务；失败时 error 为给界面显示的原因
+bool DBManager::placeOrder(int userId,
+                           const QString &flightId,
+                           const QString &passengerName,
+                           const QString &passengerIdcard,
+                           const QString &requestKey,
+                           const QString &requestHash,
+                           QString *orderId,
+                           QString *error)
+{
+    if (m_shards.isEnabled()) {
+        // 分片时余票在主库、订单在用户所在分片，不能放在一个事务里（组提交与存储过程同理，分片时不用）：
+        // 主库一个事务扣减余票并登记占座意图，再写入分片订单，最后删除意图；
+        // 中途退出留下的意图由 reconcileSeatIntents 按订单是否存在清除意图或释放座位
+        *orderId = BookingPipeline::nextOrderId();
+        const int shard = m_shards.shardOf(userId);
+        bool soldOut = false;
+        if (!openSeatIntent(*orderId, flightId, shard, SeatHold, &soldOut)) {
+            *error = soldOut ? "航班已无余票或航班不存在" : "创建订单失败：扣减余票失败";
+            return false;
+        }
+        QSqlQuery &orderQuery = m_shards.bound<Sql::Id::InsertOrder>(shard, *orderId, userId, flightId, passengerName,
+                                                                     passengerIdcard, requestKey, requestHash);
+        if (!orderQuery.exec()) {
+            const QString detail = orderQuery.lastError().text();
+            if (closeSeatIntent(*orderId, flightId, true) < 0)
+                FLOG_WARN("db") << "[DB] 订单写入失败，座位稍后由对账释放，订单" << *orderId;
+            FLOG_ERROR("db") << "创建订单失败：" << detail;
+            *error = "创建订单失败：" + detail;
+            return false;
+        }
+        // 意图已被对账裁决（本次写入过慢）：裁决为已释放座位时撤销刚写入的订单；
+        // 裁决为保留座位（对账时订单已写入）则下单成功
+        if (closeSeatIntent(*orderId, flightId, false) == 0) {
+            QSqlQuery &undo = m_shards.bound<Sql::Id::DeleteOrder>(shard, *orderId);
+            if (!undo.exec())
+                FLOG_ERROR("db") << "[DB] 撤销订单失败：" << *orderId << undo.lastError().text();
+            *error = "创建订单失败：处理超时，请重试";
+            return false;
+        }
+        return true;
+    }
 
-    // 注意：INSERT 语句要包含 order_id 字段，值为我们生成的 ID
-    orderQuery.prepare("INSERT INTO `order` (order_id, user_id, flight_id, passenger_name, passenger_idcard) VALUES (?, ?, ?, ?, ?)");
-    orderQuery.addBindValue(orderId); // 绑定自定义订单 ID
-    orderQuery.addBindValue(userId);
-    orderQuery.addBindValue(flightId);
-    orderQuery.addBindValue(passengerName);
-    orderQuery.addBindValue(passengerIdcard);
+    if (m_bookingProcedureReady) {
+        // 扣减余票与插入订单在服务端一个事务内完成，只有一次 CALL 往返
+        *orderId = BookingPipeline::nextOrderId();
+        QSqlQuery &call = bound<Sql::Id::BookSeat>(*orderId, userId, flightId, passengerName, passengerIdcard,
+                                                   requestKey, requestHash);
+        if (!call.exec()) {
+            FLOG_ERROR("db") << "调用下单存储过程失败：" << call.lastError().text();
+            *error = "创建订单失败：" + call.lastError().text();
+            return false;
+        }
+        const BookingProcedure::Result result = BookingProcedure::readResult(call);
+        call.finish(); // CALL 之后还有一个状态结果，及时释放
+        if (!result.success()) {
+            *error = result.error;
+            return false;
+        }
+        *orderId = result.orderId;
+        return true;
+    }
 
+    // 语句顺序与错误处理由 BookingProtocol::Create 决定（booking_sim 用同一协议做并发仿真）
+    using BookingProtocol::Outcome;
+    using BookingProtocol::Step;
+    BookingProtocol::Create protocol;
+    QString detail;
+    while (!protocol.finished()) {
+        Outcome outcome = Outcome::Ok;
+        switch (protocol.step()) {
+        case Step::Begin:
+            if (!m_db.transaction()) {
+                detail = m_db.lastError().text();
+                outcome = Outcome::Failed;
+            }
+            break;
+        case Step::TakeSeat: {
+            // 原子扣减余票（解决超卖）
+            QSqlQuery &flightQuery = bound<Sql::Id::TakeSeat>(flightId);
+            outcome = BookingPipeline::outcome(flightQuery, flightQuery.exec());
+            detail = flightQuery.lastError().text();
+            break;
+        }
+        case Step::InsertOrder: {
+            // 客户端生成订单号（ORD + 毫秒时间 + 进程标记），插入时带上 order_id 与幂等键
+            *orderId = BookingPipeline::nextOrderId();
+            QSqlQuery &orderQuery = bound<Sql::Id::InsertOrder>(*orderId, userId, flightId, passengerName,
+                                                                passengerIdcard, requestKey, requestHash);
+            outcome = orderQuery.exec() ? Outcome::Ok : BookingPipeline::classify(orderQuery.lastError());
+            detail = orderQuery.lastError().text();
+            break;
+        }
+        case Step::Commit:
+            if (!m_db.commit()) {
+                detail = m_db.lastError().text();
+                outcome = Outcome::Failed;
+            }
+            break;
+        case Step::Rollback:
+            m_db.rollback();
+            break;
+        default:
+            break;
+        }
+        protocol.advance(outcome);
+    }
 
-    if (!orderQuery.exec()) {
-        m_db.rollback();
-        qCritical() << "创建订单失败：" << orderQuery.lastError().text();
-        emit orderCreatedFailed("创建订单失败：" + orderQuery.lastError().text());
+    switch (protocol.result()) {
+    case BookingProtocol::Create::Booked:
+        return true;
+    case BookingProtocol::Create::SoldOut:
+        *error = "航班已无余票或航班不存在";
+        return false;
+    case BookingProtocol::Create::BeginFailed:
+        FLOG_ERROR("db") << "开启事务失败：" << detail;
+        *error = "创建订单失败：事务开启失败";
+        return false;
+    case BookingProtocol::Create::CommitFailed:
+        FLOG_ERROR("db") << "提交事务失败：" << detail;
+        *error = "创建订单失败：事务提交失败";
+        return false;
+    default:
+        FLOG_ERROR("db") << "创建订单失败：" << detail;
+        *error = "创建订单失败：" + detail;
         return false;
     }
+}
 
-
-    // 5. 提交事务（无需调用 lastInsertId()，直接用生成的 orderId）
-    if (!m_db.commit()) {
-        m_db.rollback();
-        qCritical() << "提交事务失败：" << m_db.lastError().text();
-        emit orderCreatedFailed("创建订单失败：事务提交失败");
-        return false;
+// 异步下单：启用组提交时在执行器线程上提交到订票线程，与并发的其他下单合并到同一事务（各自一个保存点），
+// 结果回到界面线程后经信号返回；未启用组提交或分片、存储过程路径下直接同步执行 createOrder
+// 幂等键的处理与 createOrder 相同：提交前按键查一次，失败后再按键核对
+void DBManager::createOrderAsync(int userId,
+                                 const QString &flightId,
+                                 const QString &passengerName,
+                                 const QString &passengerIdcard,
+                                 const QString &requestKey)
+{
+    WorkloadTrace::Scope trace("createOrderAsync", [&]() {
+        return QVariantList{userId, flightId, passengerName, passengerIdcard, requestKey};
+    });
+    if (!m_bookingPipeline.isRunning() || m_shards.isEnabled() || m_bookingProcedureReady) {
+        createOrder(userId, flightId, passengerName, passengerIdcard, requestKey);
+        return;
+    }
+    m_hotFlights.record(flightId);
+    BookingPipeline::Request request;
+    request.userId = userId;
+    request.flightId = flightId;
+    request.passengerName = passengerName;
+    request.passengerIdcard = passengerIdcard;
+    if (!requestKey.isEmpty()) {
+        if (requestKey.size() > kRequestKeyMaxLength) {
+            emit orderCreatedFailed("创建订单失败：幂等键过长");
+            return;
+        }
+        request.requestKey = requestKey;
+        request.requestHash = argumentsHash({userId, flightId, passengerName, passengerIdcard});
+        QMutexLocker locker(&m_mutex);
+        QString existing;
+        const KeyedOrder state = keyedOrder(userId, requestKey, request.requestHash, &existing);
+        locker.unlock();
+        if (state != KeyAbsent) {
+            reportKeyedOrder(state, requestKey);
+            return;
+        }
     }
 
-    qDebug() << "订单创建成功，订单ID：" << orderId; // 直接使用生成的 ID
-    emit operateResult(true, "创建订单成功");
-    return true;
+    auto *watcher = new QFutureWatcher<BookingPipeline::Result>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, request]() {
+        const BookingPipeline::Result result = watcher->result();
+        watcher->deleteLater();
+        bool booked = result.success;
+        if (!booked && !request.requestKey.isEmpty()) {
+            QMutexLocker locker(&m_mutex);
+            QString existing;
+            const KeyedOrder state = keyedOrder(request.userId, request.requestKey, request.requestHash, &existing);
+            locker.unlock();
+            if (state == KeyMatched && existing == result.orderId) {
+                FLOG_WARN("db") << "[DB] 下单报错但订单已提交：" << result.orderId << result.error;
+                booked = true;
+            } else if (state != KeyAbsent) {
+                reportKeyedOrder(state, request.requestKey);
+                return;
+            }
+        }
+        if (!booked) {
+            emit orderCreatedFailed(result.error);
+            return;
+        }
+        reportOrderCreated(request.userId, request.flightId, result.orderId);
+    });
+    watcher->setFuture(Executor::instance()->run(Executor::Normal, [this, request]() {
+        return m_bookingPipeline.book(request); // 阻塞到所在批次提交
+    }));
 }
 
-
 bool DBManager::updateUserName(const QString& newUserName) {
+    WorkloadTrace::Scope trace("updateUserName", [&]() { return QVariantList{newUserName}; });
 
     if (newUserName.isEmpty()) {
-        qDebug() << "用户名不能为空";
+        FLOG_DEBUG("db") << "用户名不能为空";
         emit userNameUpdated(false, "用户名不能为空");
         return false;
     }
 
     if (!m_db.isOpen()) {
-        qDebug() << "数据库未连接";
+        FLOG_DEBUG("db") << "数据库未连接";
         emit userNameUpdated(false, "数据库未连接");
         return false;
     }
-    m_db.transaction();
+    // 分片时 user_info 在用户所在分片；用户目录先更新（唯一约束在目录上），分片更新失败再改回
+    QMutexLocker locker(&m_mutex);
+    QSqlDatabase users = userDatabase(m_currentUserId);
+    if (!updateDirectory(Sql::Id::UpdateDirectoryName, m_currentUserId, newUserName)) {
+        emit userNameUpdated(false, "更新用户名失败：用户名已被使用");
+        return false;
+    }
+    auto revertDirectory = [&]() { updateDirectory(Sql::Id::UpdateDirectoryName, m_currentUserId, m_currentUserName); };
+    users.transaction();
 
     try {
-        QSqlQuery query(m_db);
-        query.prepare("UPDATE user_info SET User_name = :newUserName WHERE Uid = :userId");
-        query.bindValue(":newUserName", newUserName);
-        query.bindValue(":userId", m_currentUserId);
+        QSqlQuery &query = userBound<Sql::Id::UpdateUserName>(m_currentUserId, newUserName, m_currentUserId);
 
         if (!query.exec()) {
-            m_db.rollback();
+            users.rollback();
+            revertDirectory();
             QString errorMsg = query.lastError().text();
-            qDebug() << "更新用户名失败:" << errorMsg;
+            FLOG_DEBUG("db") << "更新用户名失败:" << errorMsg;
             emit userNameUpdated(false, "更新用户名失败: " + errorMsg);
             return false;
         }
         if (query.numRowsAffected() <= 0) {
-            m_db.rollback();
-            qDebug() << "用户不存在或用户名未改变";
+            users.rollback();
+            revertDirectory();
+            FLOG_DEBUG("db") << "用户不存在或用户名未改变";
             emit userNameUpdated(false, "用户不存在或用户名未改变");
             return false;
         }
-        if (!m_db.commit()) {
-            m_db.rollback();
-            qDebug() << "事务提交失败";
+        if (!users.commit()) {
+            users.rollback();
+            revertDirectory();
+            FLOG_DEBUG("db") << "事务提交失败";
             emit userNameUpdated(false, "事务提交失败");
             return false;
         }
         QString oldUserName = m_currentUserName;
         m_currentUserName = newUserName;
-        qDebug() << "用户" << m_currentUserId << "用户名从" << oldUserName << "更新为" << newUserName;
+        FLOG_DEBUG("db") << "用户" << m_currentUserId << "用户名从" << oldUserName << "更新为" << newUserName;
         emit operateResult(true, "用户名更新成功");
         return true;
 
     } catch (const std::exception& e) {
-        m_db.rollback();
-        qDebug() << "更新用户名时发生异常:" << e.what();
+        users.rollback();
+        revertDirectory();
+        FLOG_DEBUG("db") << "更新用户名时发生异常:" << e.what();
         emit userNameUpdated(false, QString("更新用户名时发生异常: %1").arg(e.what()));
         return false;
     }
 }
 bool DBManager::updateUserEmail(const QString& newEmail) {
+    WorkloadTrace::Scope trace("updateUserEmail", [&]() { return QVariantList{newEmail}; });
 
     if (!m_db.isOpen()) {
-        qDebug() << "数据库未连接";
+        FLOG_DEBUG("db") << "数据库未连接";
         emit userEmailUpdated(false, "数据库未连接");
         return false;
     }
-    m_db.transaction();
+    // 分片时 user_info 在用户所在分片；用户目录先更新（唯一约束在目录上），分片更新失败再改回
+    QMutexLocker locker(&m_mutex);
+    QSqlDatabase users = userDatabase(m_currentUserId);
+    if (!updateDirectory(Sql::Id::UpdateDirectoryEmail, m_currentUserId, newEmail)) {
+        emit userEmailUpdated(false, "更新邮箱失败：邮箱已被使用");
+        return false;
+    }
+    auto revertDirectory = [&]() { updateDirectory(Sql::Id::UpdateDirectoryEmail, m_currentUserId, m_currentUserEmail); };
+    users.transaction();
 
     try {
-        QSqlQuery query(m_db);
-        query.prepare("UPDATE user_info SET Email = :newEmail WHERE Uid = :userId");
-        query.bindValue(":newEmail", newEmail);
-        query.bindValue(":userId", m_currentUserId);
+        QSqlQuery &query = userBound<Sql::Id::UpdateUserEmail>(m_currentUserId, newEmail, m_currentUserId);
 
         if (!query.exec()) {
-            m_db.rollback();
+            users.rollback();
+            revertDirectory();
             QString errorMsg = query.lastError().text();
-            qDebug() << "更新邮箱失败:" << errorMsg;
+            FLOG_DEBUG("db") << "更新邮箱失败:" << errorMsg;
             emit userEmailUpdated(false, "更新邮箱失败: " + errorMsg);
             return false;
         }
         if (query.numRowsAffected() <= 0) {
-            m_db.rollback();
-            qDebug() << "用户不存在或邮箱未改变";
+            users.rollback();
+            revertDirectory();
+            FLOG_DEBUG("db") << "用户不存在或邮箱未改变";
             emit userEmailUpdated(false, "用户不存在或邮箱未改变");
             return false;
         }
-        if (!m_db.commit()) {
-            m_db.rollback();
-            qDebug() << "事务提交失败";
+        if (!users.commit()) {
+            users.rollback();
+            revertDirectory();
+            FLOG_DEBUG("db") << "事务提交失败";
             emit userEmailUpdated(false, "事务提交失败");
             return false;
         }
@@ -2138,7 +3567,7 @@ bool DBManager::updateUserEmail(const QString& newEmail) {
         m_currentUserEmail = newEmail;
 
         // 11. 记录日志
-        qDebug() << "用户" << m_currentUserId << "邮箱从" << oldEmail << "更新为" << newEmail;
+        FLOG_DEBUG("db") << "用户" << m_currentUserId << "邮箱从" << oldEmail << "更新为" << newEmail;
 
         // 12. 发送成功信号
         emit userEmailUpdated(true, "邮箱更新成功");
@@ -2149,8 +3578,9 @@ bool DBManager::updateUserEmail(const QString& newEmail) {
         return true;
 
     } catch (const std::exception& e) {
-        m_db.rollback();
-        qDebug() << "更新邮箱时发生异常:" << e.what();
+        users.rollback();
+        revertDirectory();
+        FLOG_DEBUG("db") << "更新邮箱时发生异常:" << e.what();
         emit userEmailUpdated(false, QString("更新邮箱时发生异常: %1").arg(e.what()));
         return false;
     }
@@ -2158,33 +3588,35 @@ bool DBManager::updateUserEmail(const QString& newEmail) {
 
 // 删除用户
 bool DBManager::deleteUser(int userId) {
+    WorkloadTrace::Scope trace("deleteUser", [&]() { return QVariantList{userId}; });
     // 1. 检查管理员登录状态
     if (!m_isAdminLoggedIn) {
-        qDebug() << "需要管理员权限才能删除用户";
+        FLOG_DEBUG("db") << "需要管理员权限才能删除用户";
         emit operateResult(false, "需要管理员权限才能删除用户");
         return false;
     }
 
     // 2. 检查数据库连接
+    QMutexLocker locker(&m_mutex);
     if (!m_db.isOpen()) {
-        qDebug() << "数据库未连接";
+        FLOG_DEBUG("db") << "数据库未连接";
         emit operateResult(false, "数据库未连接");
         return false;
     }
 
-    // 3. 检查用户是否存在
-    QSqlQuery checkQuery(m_db);
-    checkQuery.prepare("SELECT Uid, User_name, Email FROM user_info WHERE Uid = :userId");
-    checkQuery.bindValue(":userId", userId);
+    // 3. 检查用户是否存在（分片时用户数据在其所在分片，帖子和图片分块在主库）
+    const bool sharded = m_shards.isEnabled();
+    QSqlDatabase users = userDatabase(userId);
+    QSqlQuery &checkQuery = userBound<Sql::Id::UserSummary>(userId, userId);
 
     if (!checkQuery.exec()) {
-        qDebug() << "检查用户失败:" << checkQuery.lastError().text();
+        FLOG_DEBUG("db") << "检查用户失败:" << checkQuery.lastError().text();
         emit operateResult(false, "检查用户失败: " + checkQuery.lastError().text());
         return false;
     }
 
     if (!checkQuery.next()) {
-        qDebug() << "用户不存在";
+        FLOG_DEBUG("db") << "用户不存在";
         emit operateResult(false, "用户不存在");
         return false;
     }
@@ -2193,97 +3625,130 @@ bool DBManager::deleteUser(int userId) {
     QString email = checkQuery.value("Email").toString();
 
     m_db.transaction();
+    if (sharded)
+        users.transaction();
+    auto rollbackAll = [&]() {
+        if (sharded)
+            users.rollback();
+        m_db.rollback();
+    };
 
     try {
         // 6. 先删除用户的关联数据（根据数据库外键级联设置，可选择是否执行）
         // 注意：这里假设有外键约束，如果没有外键约束，需要手动删除相关数据
 
         // 6.1 删除用户收藏的航班
-        QSqlQuery deleteFavQuery(m_db);
-        deleteFavQuery.prepare("DELETE FROM user_collect_flights WHERE user_id = :userId");
-        deleteFavQuery.bindValue(":userId", userId);
+        QSqlQuery &deleteFavQuery = userBound<Sql::Id::DeleteUserCollects>(userId, userId);
         if (!deleteFavQuery.exec()) {
-            qDebug() << "删除用户收藏失败:" << deleteFavQuery.lastError().text();
+            FLOG_DEBUG("db") << "删除用户收藏失败:" << deleteFavQuery.lastError().text();
             // 根据需求决定是否继续执行
         }
 
-        // 6.2 删除用户发布的帖子
-        QSqlQuery deletePostsQuery(m_db);
-        deletePostsQuery.prepare("DELETE FROM posts WHERE user_id = :userId");
-        deletePostsQuery.bindValue(":userId", userId);
+        // 6.2 删除用户发布的帖子（先删除帖子图片和头像的分块）
+        QSqlQuery &deleteChunksQuery = bound<Sql::Id::DeleteUserBlobChunks>(userId, userId);
+        if (!deleteChunksQuery.exec()) {
+            FLOG_DEBUG("db") << "删除用户图片分块失败:" << deleteChunksQuery.lastError().text();
+        }
+
+        QSqlQuery &deletePostsQuery = bound<Sql::Id::DeleteUserPosts>(userId);
         if (!deletePostsQuery.exec()) {
-            qDebug() << "删除用户帖子失败:" << deletePostsQuery.lastError().text();
+            FLOG_DEBUG("db") << "删除用户帖子失败:" << deletePostsQuery.lastError().text();
         }
 
         // 6.3 删除用户点赞记录
-        QSqlQuery deleteLikesQuery(m_db);
-        deleteLikesQuery.prepare("DELETE FROM user_post_likes WHERE user_id = :userId");
-        deleteLikesQuery.bindValue(":userId", userId);
+        QSqlQuery &deleteLikesQuery = userBound<Sql::Id::DeleteUserLikes>(userId, userId);
         if (!deleteLikesQuery.exec()) {
-            qDebug() << "删除用户点赞记录失败:" << deleteLikesQuery.lastError().text();
+            FLOG_DEBUG("db") << "删除用户点赞记录失败:" << deleteLikesQuery.lastError().text();
         }
 
         // 6.4 删除用户收藏的帖子
-        QSqlQuery deletePostFavQuery(m_db);
-        deletePostFavQuery.prepare("DELETE FROM user_post_favorites WHERE user_id = :userId");
-        deletePostFavQuery.bindValue(":userId", userId);
+        QSqlQuery &deletePostFavQuery = userBound<Sql::Id::DeleteUserFavorites>(userId, userId);
         if (!deletePostFavQuery.exec()) {
-            qDebug() << "删除用户收藏的帖子失败:" << deletePostFavQuery.lastError().text();
+            FLOG_DEBUG("db") << "删除用户收藏的帖子失败:" << deletePostFavQuery.lastError().text();
         }
 
         // 6.5 删除用户订单（假设订单表有外键约束，ON DELETE CASCADE）
-        QSqlQuery deleteOrdersQuery(m_db);
-        deleteOrdersQuery.prepare("DELETE FROM `order` WHERE user_id = :userId");
-        deleteOrdersQuery.bindValue(":userId", userId);
+        QSqlQuery &deleteOrdersQuery = userBound<Sql::Id::DeleteUserOrders>(userId, userId);
         if (!deleteOrdersQuery.exec()) {
-            qDebug() << "删除用户订单失败:" << deleteOrdersQuery.lastError().text();
+            FLOG_DEBUG("db") << "删除用户订单失败:" << deleteOrdersQuery.lastError().text();
         }
 
         // 7. 最后删除用户
-        QSqlQuery deleteUserQuery(m_db);
-        deleteUserQuery.prepare("DELETE FROM user_info WHERE Uid = :userId");
-        deleteUserQuery.bindValue(":userId", userId);
+        QSqlQuery &deleteUserQuery = userBound<Sql::Id::DeleteUser>(userId, userId);
 
         if (!deleteUserQuery.exec()) {
-            m_db.rollback();
+            rollbackAll();
             QString errorMsg = deleteUserQuery.lastError().text();
-            qDebug() << "删除用户失败:" << errorMsg;
+            FLOG_DEBUG("db") << "删除用户失败:" << errorMsg;
             emit operateResult(false, "删除用户失败: " + errorMsg);
             return false;
         }
 
         // 8. 检查是否成功删除
         if (deleteUserQuery.numRowsAffected() <= 0) {
-            m_db.rollback();
-            qDebug() << "用户不存在或删除失败";
+            rollbackAll();
+            FLOG_DEBUG("db") << "用户不存在或删除失败";
             emit operateResult(false, "用户不存在或删除失败");
             return false;
         }
 
-        // 9. 提交事务
+        // 分片时同时删除主库用户目录中的登记
+        if (sharded) {
+            QSqlQuery &deleteDirectoryQuery = bound<Sql::Id::DeleteDirectory>(userId);
+            if (!deleteDirectoryQuery.exec()) {
+                rollbackAll();
+                FLOG_DEBUG("db") << "删除用户目录失败:" << deleteDirectoryQuery.lastError().text();
+                emit operateResult(false, "删除用户失败: " + deleteDirectoryQuery.lastError().text());
+                return false;
+            }
+        }
+
+        // 9. 提交事务（分片时先提交主库：主库提交失败两边都回滚；分片提交失败时用户目录已删除、
+        //    分片上的用户数据仍在，管理员在用户列表中仍能看到该用户，再次删除即可清理）
         if (!m_db.commit()) {
-            m_db.rollback();
-            qDebug() << "事务提交失败";
+            rollbackAll();
+            FLOG_DEBUG("db") << "事务提交失败";
             emit operateResult(false, "事务提交失败");
             return false;
         }
+        if (sharded && !users.commit()) {
+            users.rollback();
+            FLOG_ERROR("db") << "[DB] 用户" << userId << "主库数据已删除，分片提交失败：" << users.lastError().text();
+            emit operateResult(false, "删除用户未完成：分片数据删除失败，请重试");
+            return false;
+        }
 
-        qDebug() << "管理员" << m_currentAdminName << "删除了用户" << username << "(ID:" << userId << ")";
+        // 删除已提交后再丢弃该用户待写入的点赞/喜欢（删除失败时用户仍在，这些意图要保留）；
+        // flushInteractions 同样持有 m_mutex，提交与丢弃之间不会被写回
+        const int discarded = m_interactions.discardUser(userId);
+        if (discarded > 0)
+            FLOG_DEBUG("db") << "删除用户" << userId << "，丢弃待写入的点赞/喜欢" << discarded << "条";
+        locker.unlock();
+        FLOG_DEBUG("db") << "管理员" << m_currentAdminName << "删除了用户" << username << "(ID:" << userId << ")";
+        m_imageStore.remove(ImageStore::avatarKey(userId));
+        m_avatarAtlas.remove(userId);
+        audit("delete_user", QString::number(userId), QString("username=%1").arg(username));
 
         emit operateResult(true, "用户删除成功");
 
         return true;
 
     } catch (const std::exception& e) {
-        m_db.rollback();
-        qDebug() << "删除用户时发生异常:" << e.what();
+        rollbackAll();
+        FLOG_DEBUG("db") << "删除用户时发生异常:" << e.what();
         emit operateResult(false, QString("删除用户时发生异常: %1").arg(e.what()));
         return false;
     }
 }
 
 // 查询所有用户
-QVariantList DBManager::queryAllUser()
+QVariantList DBManager::queryAllUser(int timeoutMs)
+{
+    WorkloadTrace::Scope trace("queryAllUser", [&]() { return QVariantList{timeoutMs}; });
+    return queryAllUser(makeQueryContext(timeoutMs));
+}
+
+QVariantList DBManager::queryAllUser(const QueryContext &ctx)
 {
     QMutexLocker locker(&m_mutex);
     QVariantList result;
@@ -2294,43 +3759,50 @@ QVariantList DBManager::queryAllUser()
         return result;
     }
 
-    QSqlQuery query(m_db);
-    QString sql = R"(
-        SELECT
-            Uid,
-            User_name,
-            phone,
-            Email,
-            idcard
-        FROM user_info
-        ORDER BY create_time DESC
-    )";
-
-    if (!query.prepare(sql)) {
-        QString errMsg = "[DB] 查询订单预处理失败：" + query.lastError().text();
-        qCritical() << errMsg;
-        emit operateResult(false, errMsg);
+    // 排队期间已超时，不再访问数据库
+    if (ctx.expired()) {
+        reportAborted("queryAllUser");
         return result;
     }
 
-    if (query.exec()) {
+    // 分片时分散到全部分片，各分片结果按注册时间归并
+    const int sources = m_shards.isEnabled() ? m_shards.shardCount() : 1;
+    if (m_shards.isEnabled())
+        m_shards.recordScatter();
+
+    QList<QVariantList> parts;
+    for (int source = 0; source < sources; ++source) {
+        QSqlQuery &query = m_shards.isEnabled() ? m_shards.statement(source, Sql::Id::AllUsers)
+                                                : statement(Sql::Id::AllUsers);
+        if (!execWithDeadline(query, ctx, m_shards.isEnabled() ? m_shards.database(source) : m_db)) {
+            QString errMsg = "[DB] 查询订单失败：" + query.lastError().text();
+            FLOG_ERROR("db") << errMsg;
+            emit operateResult(false, errMsg);
+            return result;
+        }
+        QVariantList part;
         while (query.next()) {
+            if (ctx.expired()) {
+                reportAborted("queryAllUser");
+                return QVariantList();
+            }
             QVariantMap user;
             user["Uid"] = query.value("Uid").toInt();
             user["User_name"] = query.value("User_name").toString();
             user["phone"] = query.value("phone").toString();
             user["Email"] = query.value("Email").toString();
             user["idcard"] = query.value("idcard").toString();
+            user["create_time"] = query.value("create_time").toDateTime().toString("yyyy-MM-dd HH:mm:ss");
 
-            result.append(user);
+            part.append(user);
         }
-        emit operateResult(true, QString("查询成功，共 %1 个用户").arg(result.size()));
-    } else {
-        QString errMsg = "[DB] 查询订单失败：" + query.lastError().text();
-        qCritical() << errMsg;
-        emit operateResult(false, errMsg);
+        parts.append(part);
     }
 
+    result = ShardRouter::mergeSorted(parts, [](const QVariant &a, const QVariant &b) {
+        return a.toMap().value("create_time").toString() > b.toMap().value("create_time").toString();
+    }, 0, -1);
+    emit operateResult(true, QString("查询成功，共 %1 个用户").arg(result.size()));
     return result;
 }
 
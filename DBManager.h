@@ -7,6 +7,7 @@
 #include <QDateTime>
 #include <QDebug>
 #include <QFile>
+#include <QHash>
 #include <QImage>
 #include <QMutex>
 #include <QObject>
@@ -14,8 +15,24 @@
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QSqlQuery>
+#include <QSqlRecord>
 #include <QString>
+#include <QTimer>
 #include <QVariant>
+#include <array>
+#include <functional>
+#include <memory>
+#include "AuditJournal.h"
+#include "AvatarAtlas.h"
+#include "BookingPipeline.h"
+#include "FlightCache.h"
+#include "HeavyHitters.h"
+#include "IdempotencyCache.h"
+#include "InteractionWriteBehind.h"
+#include "ImageStore.h"
+#include "QueryContext.h"
+#include "ShardRouter.h"
+#include "SqlStatements.h"
 
 // 数据库管理单例类
 class DBManager : public QObject
@@ -46,11 +63,19 @@ public:
     Q_INVOKABLE QString getCurrentAdminName() const;            // 获取当前管理员名
     Q_INVOKABLE int getCurrentAdminId() const;                  // 获取当前管理员ID
 
-    Q_INVOKABLE QVariantList queryAllFlights(); // 查询所有航班
+    // 查询类接口的 timeoutMs 为本次调用的截止时间（毫秒），<= 0 使用默认截止时间（setQueryTimeout）
+    Q_INVOKABLE QVariantList queryAllFlights(int timeoutMs = 0); // 查询所有航班
     Q_INVOKABLE QVariantList queryFlightsByCondition(const QString &departure,
                                                      const QString &destination,
-                                                     const QString &departDate); // 按地点，日期查询
-    Q_INVOKABLE QVariantList queryFlightByNum(const QString &Flight_id);         // 按航班号查询
+                                                     const QString &departDate,
+                                                     int timeoutMs = 0); // 按地点，日期查询
+    Q_INVOKABLE QVariantList queryFlightByNum(const QString &Flight_id, int timeoutMs = 0); // 按航班号查询
+    QVariantList queryAllFlights(const QueryContext &ctx); // 带截止时间的版本
+    QVariantList queryFlightsByCondition(const QString &departure,
+                                         const QString &destination,
+                                         const QString &departDate,
+                                         const QueryContext &ctx);
+    QVariantList queryFlightByNum(const QString &Flight_id, const QueryContext &ctx);
     Q_INVOKABLE bool addFlight(const QString &Flight_id,
                                const QString &Departure,
                                const QString &Destination,
@@ -58,13 +83,16 @@ public:
                                const QString &arrive_time,
                                double price,
                                int total_seats,
-                               int remain_seats);                                     // 添加航班
+                               int remain_seats,
+                               const QString &requestKey = QString());                // 添加航班
     Q_INVOKABLE bool updateFlightPrice(const QString &Flight_id, double newPrice);    // 更新价格
     Q_INVOKABLE bool updateFlightSeats(const QString &Flight_id, int newRemainSeats); // 更新剩余座位
     Q_INVOKABLE bool updateFlightStatus(const QString &Flight_id, int newststus); // 更新航班状态
     Q_INVOKABLE bool deleteFlight(const QString &Flight_id);                      // 删除航班
 
-    Q_INVOKABLE int collectFlight(int userId, const QString &flightId);       // 收藏航班
+    Q_INVOKABLE int collectFlight(int userId,
+                                  const QString &flightId,
+                                  const QString &requestKey = QString());  // 收藏航班
     Q_INVOKABLE bool cancelCollectFlight(int userId, const QString &flightId); // 取消收藏航班
     Q_INVOKABLE QVariantList queryCollectedFlights(int userId); // 查询用户收藏的所有航班
     Q_INVOKABLE QVariantList
@@ -89,13 +117,18 @@ public:
     Q_INVOKABLE bool uploadUserAvatar(
         int userId,
         const QString &imgPath,
-        int quality = 80); // 上传/更新用户头像（传图片路径，自动解析+转二进制存入数据库，推荐）
+        int quality = 80); // 上传/更新用户头像（传图片路径，后台编码后存入数据库，结果经 operateResult 通知，推荐）
     Q_INVOKABLE bool uploadUserAvatarByBlob(
         int userId,
         const QByteArray &imgBlob,
         const QString &imgFormat); // 上传/更新用户头像（传二进制+格式，备用）
     Q_INVOKABLE QByteArray getUserAvatarBlob(int userId); // 获取用户头像的二进制数据
     Q_INVOKABLE QString getUserAvatarFormat(int userId);  // 获取用户头像的格式
+    Q_INVOKABLE QString getUserAvatarUrl(int userId);     // 获取用户头像地址（image://blobs/...，无头像返回空）
+    ImageStore *imageStore();                             // C++ 侧图片缓存
+    Q_INVOKABLE QVariantMap loadAvatarAtlas(const QVariantList &userIds); // 批量加载头像到图集（一次查询），返回已在图集中的 uid -> 格子描述，其余解码后经 avatarAtlasUpdated 通知
+    AvatarAtlas *avatarAtlas();                           // 头像图集（供 image://avatars 使用）
+    QIODevice *openBlobStream(const QString &kind, int ownerId); // 分块图片流式读取（kind 为 BlobStore::kAvatar/kPost）
     Q_INVOKABLE bool removeUserAvatar(int userId);        // 移除用户头像（清空数据库的头像字段）
 
     Q_INVOKABLE bool isUserLoggedIn() const;         // 检查普通用户登录状态
@@ -107,22 +140,40 @@ public:
                                    const QString &verifyCode,
                                    const QString &newPassword); // 忘记密码（验证码默认为0000）
 
-    Q_INVOKABLE bool createOrder(int userId, const QString &flightId, const QString& passengerName, const QString& passergerIdcard);  // 创建订单
-    Q_INVOKABLE QVariantList queryMyOrders(int userId);  // 查看我的订单
-    Q_INVOKABLE QVariantList queryAllOrders();  // 查询所有订单
-    Q_INVOKABLE bool deleteOrder(const QString& orderId); // 删除订单
+    Q_INVOKABLE bool createOrder(int userId, const QString &flightId, const QString& passengerName, const QString& passergerIdcard, const QString &requestKey = QString());  // 创建订单
+    Q_INVOKABLE void createOrderAsync(int userId,
+                                      const QString &flightId,
+                                      const QString &passengerName,
+                                      const QString &passengerIdcard,
+                                      const QString &requestKey = QString()); // 异步下单（启用组提交时经订票线程合并提交，结果经信号返回）
+    Q_INVOKABLE QVariantList queryMyOrders(int userId, int timeoutMs = 0);  // 查看我的订单
+    Q_INVOKABLE QVariantList queryAllOrders(int timeoutMs = 0);  // 查询所有订单
+    Q_INVOKABLE QVariantList queryOrdersPage(int offset, int limit, int timeoutMs = 0); // 分页查询所有订单（按下单时间倒序）
+    QVariantList queryMyOrders(int userId, const QueryContext &ctx); // 带截止时间的版本
+    QVariantList queryAllOrders(const QueryContext &ctx, int offset = 0, int limit = -1);
+    Q_INVOKABLE bool deleteOrder(const QString& orderId, const QString &requestKey = QString()); // 删除订单
+    Q_INVOKABLE QString newRequestKey() const; // 生成幂等键（客户端重试时复用同一个键）
+    Q_INVOKABLE QVariantList hotFlights(int k = 10) const; // 访问最多的航班
+    Q_INVOKABLE QVariantList hotRoutes(int k = 10) const;  // 访问最多的航线
+    Q_INVOKABLE QVariantMap metrics() const;               // 运行指标汇总
+    Q_INVOKABLE QVariantMap auditStats() const;            // 审计日志统计（入队/落盘/入库条数）
+    Q_INVOKABLE bool flushInteractions();                  // 立即写入待写入的点赞/喜欢
+    Q_INVOKABLE QVariantMap interactionStats() const;      // 点赞/喜欢延迟写入统计（待写入/抵消/已写入）
 
     QByteArray readImageToBlob(const QString &imgPath,
-                               int quality = 80); // 辅助函数：读取图片文件为二进制（带压缩）
+                               int quality = 80,
+                               QString *format = nullptr); // 辅助函数：读取图片文件为二进制（带压缩，格式按内容选择；同步，勿在界面线程调用）
     Q_INVOKABLE bool publishPost(const QString &title,
                                  const QString &content,
                                  int userId,
                                  const QByteArray &imgBlob = QByteArray(),
-                                 const QString &imgFormat = ""); // 发布帖子
+                                 const QString &imgFormat = "",
+                                 const QString &requestKey = QString()); // 发布帖子
     Q_INVOKABLE bool publishPostWithPath(const QString &title,
                                          const QString &content,
                                          int userId,
-                                         const QString &imgPath);           // 通过文件路径存储发布
+                                         const QString &imgPath,
+                                         const QString &requestKey = QString()); // 通过文件路径存储发布（后台编码，结果经 operateResult 通知）
     Q_INVOKABLE int getLatestPostId();  // 获取最新帖子的ID（无帖子返回-1）
     Q_INVOKABLE QVariantMap queryPostDetail(int postId, int currentUserId); // 查询帖子详情
     Q_INVOKABLE bool likePost(int userId, int postId);                      // 点赞
@@ -132,7 +183,10 @@ public:
     Q_INVOKABLE bool cancelFavoritePost(int userId, int postId);            // 取消喜欢
     Q_INVOKABLE bool isPostFavorited(int userId, int postId);               // 是否喜欢
 
-    Q_INVOKABLE QString blobToImage(const QByteArray &blob, const QString &format); // Blob转QImage
+    Q_INVOKABLE QString blobToImage(const QByteArray &blob, const QString &format); // Blob转QImage（同步，可在工作线程调用）
+    Q_INVOKABLE void blobToImageAsync(const QByteArray &blob,
+                                      const QString &format,
+                                      const QString &tag); // 在执行器上转换，完成后发出 imageConverted
 
     Q_INVOKABLE QString getCurrentUserPhone() const;  // 获取当前登录用户的手机号
     Q_INVOKABLE QString getCurrentUserIdCard() const;  // 获取当前登录用户的身份证号
@@ -142,11 +196,27 @@ public:
     Q_INVOKABLE bool updateUserEmail(const QString& newEmail);    // 更新当前用户的邮箱
 
     Q_INVOKABLE bool deleteUser(int userId); // 删除用户
-    Q_INVOKABLE QVariantList queryAllUser();  // 查询所有用户
+    Q_INVOKABLE QVariantList queryAllUser(int timeoutMs = 0);  // 查询所有用户
+    QVariantList queryAllUser(const QueryContext &ctx); // 带截止时间的版本
+
+    Q_INVOKABLE void setQueryTimeout(int timeoutMs);        // 设置查询默认截止时间（毫秒）
+    Q_INVOKABLE bool setBookingProcedureEnabled(bool enabled); // 下单改走服务端存储过程（一次往返），返回是否生效
+    Q_INVOKABLE void setBookingPipelineEnabled(bool enabled);  // 异步下单改走组提交（并发下单合并为一个事务）
+    QueryContext makeQueryContext(int timeoutMs = 0) const; // 生成查询上下文（timeoutMs <= 0 为默认截止时间）
 
 signals:
     void connectionStateChanged(bool isConnected);        // 数据库连接信号
     void operateResult(bool success, const QString &msg); // 操作结果
+    void queryTimedOut(const QString &operation);         // 查询超过截止时间，结果已丢弃
+    void flightsChanged();                                // 航班数据发生变化（增删改航班）
+    void flightSeatsChanged(const QString &flightId, int delta); // 下单/退票后航班余票变化 delta 个
+    void imageEncoded(const QString &target,
+                      const QString &format,
+                      qint64 sourceBytes,
+                      qint64 storedBytes,
+                      qint64 legacyBytes); // 图片入库编码结果（用于统计格式选择节省的体积，legacyBytes 抽样，未测为 -1）
+    void imageConverted(const QString &tag, const QString &dataUrl); // blobToImageAsync 的结果（失败时为空）
+    void avatarAtlasUpdated(const QVariantMap &slots);              // loadAvatarAtlas 缺失的头像已放入图集（整批的格子描述）
 
     void adminLoginStateChanged(bool isLoggedIn);       // 管理员登录状态改变
     void adminLoginSuccess(const QString &adminName);   // 管理员登录成功
@@ -180,6 +250,9 @@ signals:
     void ordersQueriedByCondition(const QVariantList &orders);
     void userNameUpdated(bool success, const QString& message);
     void userEmailUpdated(bool success, const QString& message);
+private slots:
+    void onHotspotTick(); // 热点定时任务（预热缓存、计数衰减）
+
 private:
     explicit DBManager(QObject *parent = nullptr);
     ~DBManager() override;
@@ -193,11 +266,101 @@ private:
     bool isUsernameExists(const QString &username);        // 检查用户名是否已存在
     bool isEmailExists(const QString &email);              // 检查邮箱是否已存在
     QString encryptPassword(const QString &password);      // 密码加密（SHA256）
+    QVariant runIdempotent(const QString &operation,
+                           const QString &requestKey,
+                           const QVariantList &args,
+                           const std::function<QVariant()> &op,
+                           const std::function<bool(const QVariant &)> &isFinal
+                           = nullptr); // 按幂等键执行（重试返回首次的最终结果，参数不同则拒绝）
+    void warmHotFlights();                     // 预热并固定热点航班
+    void reportAborted(const QString &operation); // 查询超过截止时间
+    bool setInteraction(int userId, int postId, InteractionWriteBehind::Kind kind, bool desired); // 记录点赞/喜欢意图
+    bool isInteractionStored(int userId, int postId, InteractionWriteBehind::Kind kind); // 数据库中的点赞/喜欢状态
+    QSqlQuery &statement(Sql::Id id); // 取已预处理的登记语句
+    template<Sql::Id ID, typename... Args>
+    QSqlQuery &bound(Args &&...args) // 取登记语句并按登记的参数类型绑定
+    {
+        QSqlQuery &query = statement(ID);
+        Sql::bind<ID>(query, std::forward<Args>(args)...);
+        return query;
+    }
+    bool statementInUse(Sql::Id id) const; // 登记语句所用的表在当前配置下是否存在（连接时只预处理这些语句）
+    bool execWithDeadline(QSqlQuery &query, const QueryContext &ctx, const QSqlDatabase &db); // 在上下文截止时间内执行
+    bool execWithDeadline(QSqlQuery &query, const QueryContext &ctx) { return execWithDeadline(query, ctx, m_db); }
+    QSqlQuery &flightSearch(const QString &departure,
+                            const QString &destination,
+                            const QString &departDate); // 按非空条件选择航班查询语句
+    QSqlQuery &collectedFlightSearch(int userId,
+                                     const QString &departure,
+                                     const QString &destination,
+                                     const QString &departDate); // 按非空条件选择收藏航班查询语句
+    QSqlDatabase userDatabase(int userId) const; // 用户数据所在的连接（分片时为用户所在分片，否则为主库）
+    template<Sql::Id ID, typename... Args>
+    QSqlQuery &userBound(int userId, Args &&...args) // 按用户路由的登记语句
+    {
+        if (m_shards.isEnabled())
+            return m_shards.bound<ID>(m_shards.shardOf(userId), std::forward<Args>(args)...);
+        return bound<ID>(std::forward<Args>(args)...);
+    }
+    int directoryUid(Sql::Id id, const QString &value); // 分片时按用户名/邮箱在用户目录中查 Uid
+    bool updateDirectory(Sql::Id id, int userId, const QString &value); // 同步用户目录中的用户名/邮箱
+    QHash<QString, QSqlRecord> flightRecords(const QStringList &flightIds,
+                                             const QString &columns); // 按航班号批量取航班（分片时在应用侧关联）
+    QByteArray readBlobStream(const QString &kind, int ownerId); // 经分块读取设备取回图片数据
+    bool deleteShardOrder(const QString &orderId, QString *flightId); // 分片时删除订单并释放座位
+    enum SeatIntent {
+        SeatHold = 0,     // 下单占座（未决）
+        SeatRelease = 1,  // 删除订单释放座位（未决）
+        SeatReleased = 2, // 对账裁决：已释放座位
+        SeatKept = 3      // 对账裁决：订单存在，保留座位
+    };
+    bool openSeatIntent(const QString &orderId,
+                        const QString &flightId,
+                        int shard,
+                        SeatIntent kind,
+                        bool *soldOut); // 主库登记座位意图（占座时同一事务扣减余票）
+    int closeSeatIntent(const QString &orderId, const QString &flightId, bool release); // 删除意图（可同时释放座位）
+    int takeSeatVerdict(const QString &orderId); // 读取并删除对账留下的裁决
+    bool resolveSeatIntent(const QString &orderId, const QString &flightId, int openKind, bool release); // 对账裁决意图
+    void reconcileSeatIntents(); // 对账：处理中途中断留下的座位意图
+    QVariantList orderMaps(const QList<QSqlRecord> &orders); // 订单行转为界面字段（分片时关联主库航班）
+    QVariantList shardCollectedFlights(int userId,
+                                       const QString &flightId,
+                                       const std::function<bool(const QSqlRecord &)> &accept); // 分片时的收藏航班查询
+    void prepareStatements(); // 连接后预处理全部登记语句
+    void releaseStatements(); // 断开前释放
+    void audit(const QString &action,
+               const QString &target,
+               const QString &detail = QString()); // 记录审计（异步，不增加写延迟）
+    // 下单：幂等键与参数摘要随订单写入 `order`.request_key / request_hash（唯一键），与订单同一事务提交
+    enum KeyedOrder {
+        KeyAbsent,   // 没有该键的订单
+        KeyMatched,  // 已有该键的订单，参数相同
+        KeyConflict, // 已有该键的订单，参数不同
+        KeyUnknown   // 查询失败，结果不确定
+    };
+    static bool ensureRequestKeyColumns(QSqlDatabase &db); // `order` 补建幂等键列（已存在则跳过）
+    KeyedOrder keyedOrder(int userId, const QString &requestKey, const QString &requestHash, QString *orderId);
+    bool reportKeyedOrder(KeyedOrder state, const QString &requestKey); // 按键找到的结果告知界面
+    bool placeOrder(int userId,
+                    const QString &flightId,
+                    const QString &passengerName,
+                    const QString &passengerIdcard,
+                    const QString &requestKey,
+                    const QString &requestHash,
+                    QString *orderId,
+                    QString *error); // 执行下单（调用方持有 m_mutex），失败时 orderId 为最后一次尝试的订单号
+    void reportOrderCreated(int userId, const QString &flightId, const QString &orderId); // 下单成功的审计与通知
+    // 事务内锁定航班行、读出旧值后执行 update；返回 1 成功、0 航班不存在、-1 出错（error 为原因）
+    int updateFlightRow(const QString &flightId, QSqlQuery &update, QSqlRecord *before, QString *error);
 
     QSqlDatabase m_db; // 数据库连接对象
     static DBManager *m_instance;
-    static QMutex m_mutex;      // 线程安全锁（避免多线程冲突）
+    static QRecursiveMutex m_mutex; // 线程安全锁：保护连接和预处理语句（可重入，持锁的函数会调用其他加锁函数）
+    QString m_driver;           // 数据库驱动：QODBC / QMYSQL
     QString m_dsn;              // ODBC DSN 名称
+    QString m_host;             // QMYSQL 服务器地址
+    int m_port;                 // QMYSQL 端口
     QString m_user;             // 数据库用户名
     QString m_password;         // 数据库密码
     QString m_databaseName;     // 目标数据库名
@@ -210,6 +373,32 @@ private:
     QString m_currentUserEmail; // 当前登录用户邮箱
     QString m_currentUserPhone; // 当前登录用户手机号
     QString m_currentUserIdCard; // 当前登录用户身份证号
+    IdempotencyCache m_idempotency; // 变更操作的幂等键缓存
+    std::array<std::unique_ptr<QSqlQuery>, std::size_t(Sql::Id::Count)> m_statements; // 预处理语句（按编号）
+    std::unique_ptr<QSqlQuery> m_failedStatement; // 最近一次预处理失败的语句（保留错误信息）
+    int m_queryTimeoutMs;           // 查询默认截止时间（毫秒）
+    bool m_useBookingProcedure;     // 配置：下单走存储过程 sp_book_seat
+    bool m_bookingProcedureReady;   // 存储过程已安装（连接后检查）
+    bool m_useBookingPipeline;      // 配置：异步下单走组提交（只在确有并发下单时有收益）
+    HeavyHitters m_hotFlights; // 热点航班统计
+    HeavyHitters m_hotRoutes;  // 热点航线统计
+    FlightCache m_flightCache; // 航班详情缓存（热点航班固定）
+    ImageStore m_imageStore;   // 帖子图片/头像缓存（QML 通过 image://blobs 访问）
+    AvatarAtlas m_avatarAtlas; // 用户列表头像图集（QML 通过 image://avatars 访问）
+    struct AvatarStamp
+    {
+        qint64 version = -1;  // 缓存内容对应的 blob_versions 版本
+        qint64 checkedAt = 0; // 最近一次核对版本的时间（毫秒）
+    };
+    QHash<int, AvatarStamp> m_avatarStamps; // 已缓存头像的版本（受 m_mutex 保护）
+    AuditJournal m_audit;      // 变更审计日志（组提交到本地分段文件和 audit_log 表）
+    BookingPipeline m_bookingPipeline; // 下单组提交（createOrderAsync 的并发下单合并为一个事务，默认不启动）
+    InteractionWriteBehind m_interactions; // 点赞/喜欢延迟写入队列
+    ShardRouter m_shards;                  // 用户数据分片路由（未配置分片时全部走主库）
+    QStringList m_shardNames;              // 配置的分片（连接时确认已有用户已迁移后才启用）
+    QTimer *m_interactionTimer;            // 点赞/喜欢批量写库定时器
+    QTimer *m_hotspotTimer;    // 热点预热定时器
+    int m_hotspotTicks;        // 定时器触发次数
 };
 
 #endif // DBMANAGER_H
@@ -0,0 +1,189 @@
+#include "Executor.h"
+#include <QThread>
+
+namespace {
+thread_local int t_workerIndex = -1; // 当前线程在执行器中的序号，非工作线程为 -1
+}
+
+Executor::Executor()
+    : m_pending(0)
+    , m_stopping(false)
+    , m_submitted(0)
+    , m_executed(0)
+    , m_stolen(0)
+    , m_cancelled(0)
+{
+    const int count = qMax(2, QThread::idealThreadCount());
+    for (int i = 0; i < count; ++i)
+        m_local.push_back(std::make_unique<Queue>());
+    for (int i = 0; i < count; ++i)
+        m_workers.emplace_back([this, i]() { workerLoop(i); });
+}
+
+Executor::~Executor()
+{
+    stop();
+}
+
+Executor *Executor::instance()
+{
+    static Executor executor;
+    return &executor;
+}
+
+// 工作线程内提交到自己队列，其他线程提交到全局队列
+// 检查停止标志与入队都在 m_sleepLock 内：stop() 在同一把锁内置位，工作线程在同一把锁内判断退出，
+// 因此任务要么在停止前入队（计入 m_pending，工作线程取走后按已取消收尾），要么在这里直接按已取消收尾
+void Executor::submit(Priority priority, const CancellationToken &token, std::function<void(bool)> fn)
+{
+    {
+        std::unique_lock<std::mutex> sleepLocker(m_sleepLock);
+        if (!m_stopping.load()) {
+            Queue &queue = t_workerIndex >= 0 ? *m_local[size_t(t_workerIndex)] : m_global;
+            {
+                std::lock_guard<std::mutex> locker(queue.lock);
+                queue.tasks[priority].push_back({std::move(fn), token});
+            }
+            ++m_submitted;
+            m_pending.fetch_add(1);
+            sleepLocker.unlock();
+            m_wake.notify_one();
+            return;
+        }
+    }
+    ++m_cancelled;
+    fn(true);
+}
+
+// 按优先级取任务：自己队列尾部 → 全局队列头部 → 窃取其他线程队列头部
+bool Executor::takeTask(int self, Task *task)
+{
+    for (int priority = 0; priority < PriorityCount; ++priority) {
+        if (self >= 0) {
+            Queue &own = *m_local[size_t(self)];
+            std::lock_guard<std::mutex> locker(own.lock);
+            if (!own.tasks[priority].empty()) {
+                *task = std::move(own.tasks[priority].back());
+                own.tasks[priority].pop_back();
+                return true;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> locker(m_global.lock);
+            if (!m_global.tasks[priority].empty()) {
+                *task = std::move(m_global.tasks[priority].front());
+                m_global.tasks[priority].pop_front();
+                return true;
+            }
+        }
+        const int count = int(m_local.size());
+        for (int offset = 1; offset <= count; ++offset) {
+            const int victim = (qMax(self, 0) + offset) % count;
+            if (victim == self)
+                continue;
+            Queue &other = *m_local[size_t(victim)];
+            std::lock_guard<std::mutex> locker(other.lock);
+            if (!other.tasks[priority].empty()) {
+                *task = std::move(other.tasks[priority].front());
+                other.tasks[priority].pop_front();
+                ++m_stolen;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void Executor::workerLoop(int self)
+{
+    t_workerIndex = self;
+    for (;;) {
+        Task task;
+        if (takeTask(self, &task)) {
+            m_pending.fetch_sub(1);
+            const bool cancelled = m_stopping.load() || task.token.isCancelled();
+            if (cancelled)
+                ++m_cancelled;
+            else
+                ++m_executed;
+            task.fn(cancelled);
+            continue;
+        }
+        std::unique_lock<std::mutex> locker(m_sleepLock);
+        if (m_stopping.load() && m_pending.load() == 0)
+            break;
+        m_wake.wait(locker, [this]() { return m_pending.load() > 0 || m_stopping.load(); });
+        if (m_stopping.load() && m_pending.load() == 0)
+            break;
+    }
+}
+
+// 并行循环：共享下标计数器，辅助任务与调用线程一起领取下标，调用线程领完后等待在途的下标完成
+void Executor::parallelFor(int count, Priority priority, const std::function<void(int)> &body)
+{
+    if (count <= 0)
+        return;
+    if (count == 1 || m_stopping.load()) {
+        for (int i = 0; i < count; ++i)
+            body(i);
+        return;
+    }
+
+    struct State
+    {
+        std::atomic<int> next{0};
+        std::atomic<int> done{0};
+        std::mutex lock;
+        std::condition_variable finished;
+    };
+    auto state = std::make_shared<State>();
+    const int total = count;
+    // body 只在 parallelFor 返回前被调用（领不到下标的辅助任务不会触碰它）
+    auto drain = [state, total, &body]() {
+        for (int i = state->next.fetch_add(1); i < total; i = state->next.fetch_add(1)) {
+            body(i);
+            if (state->done.fetch_add(1) + 1 == total) {
+                std::lock_guard<std::mutex> locker(state->lock);
+                state->finished.notify_all();
+            }
+        }
+    };
+
+    const int helpers = qMin(count - 1, threadCount());
+    for (int i = 0; i < helpers; ++i) {
+        submit(priority, CancellationToken(), [drain](bool cancelled) {
+            if (!cancelled)
+                drain();
+        });
+    }
+    drain();
+    std::unique_lock<std::mutex> locker(state->lock);
+    state->finished.wait(locker, [&]() { return state->done.load() == total; });
+}
+
+// 丢弃未开始的任务并结束工作线程
+void Executor::stop()
+{
+    {
+        std::lock_guard<std::mutex> locker(m_sleepLock);
+        if (m_stopping.exchange(true))
+            return;
+    }
+    m_wake.notify_all();
+    for (std::thread &worker : m_workers) {
+        if (worker.joinable())
+            worker.join();
+    }
+}
+
+QVariantMap Executor::stats() const
+{
+    QVariantMap map;
+    map["threads"] = threadCount();
+    map["submitted"] = m_submitted.load();
+    map["executed"] = m_executed.load();
+    map["stolen"] = m_stolen.load();
+    map["cancelled"] = m_cancelled.load();
+    map["pending"] = m_pending.load();
+    return map;
+}
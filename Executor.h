@@ -0,0 +1,111 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <QFuture>
+#include <QPromise>
+#include <QVariantMap>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "QueryContext.h"
+
+// 共享 CPU 任务执行器：线程数等于核心数，所有子系统的计算型任务（图片编解码、搜索过滤等）都提交到这里，
+// 避免各自开线程导致超额订阅
+//
+// 工作窃取：每个工作线程有自己的双端队列，线程内提交的子任务压入自己队列尾部并从尾部取（缓存友好），
+// 外部线程提交的任务进入全局队列；空闲线程按 自己队列 → 全局队列 → 其他线程队列头部 的顺序取任务
+// 三个优先级分开排队，高优先级任务总是先于低优先级任务被取走；
+// 任务带取消令牌，开始执行前已取消的任务直接丢弃（QFuture 为 canceled），执行中的任务自行检查令牌
+class Executor
+{
+public:
+    enum Priority {
+        High = 0, // 交互路径（边输边搜等，用户在等结果）
+        Normal,   // 用户操作触发的处理（上传图片编码、头像缩略图）
+        Low,      // 后台整理、预热
+        PriorityCount
+    };
+
+    static Executor *instance();
+
+    // 提交任务，返回其 QFuture（可配合 QFutureWatcher 回到界面线程）
+    template<typename F>
+    auto run(Priority priority, const CancellationToken &token, F &&fn) -> QFuture<std::invoke_result_t<F>>
+    {
+        using R = std::invoke_result_t<F>;
+        auto promise = std::make_shared<QPromise<R>>();
+        QFuture<R> future = promise->future();
+        promise->start();
+        submit(priority, token, [promise, fn = std::forward<F>(fn)](bool cancelled) mutable {
+            if (cancelled) {
+                promise->future().cancel();
+            } else if constexpr (std::is_void_v<R>) {
+                fn();
+            } else {
+                promise->addResult(fn());
+            }
+            promise->finish();
+        });
+        return future;
+    }
+
+    template<typename F>
+    auto run(Priority priority, F &&fn)
+    {
+        return run(priority, CancellationToken(), std::forward<F>(fn));
+    }
+
+    // 并行执行 body(0..count-1) 并等待全部完成；调用线程也参与执行，
+    // 因此在工作线程内嵌套调用不会死锁。调用线程会阻塞到全部完成，界面线程不要直接调用，
+    // 应把整段工作用 run() 提交、在任务内调用 parallelFor，再用 QFutureWatcher 取结果
+    void parallelFor(int count, Priority priority, const std::function<void(int)> &body);
+
+    void stop(); // 丢弃未开始的任务并结束工作线程（程序退出前调用）；之后提交的任务直接按已取消收尾
+
+    int threadCount() const { return int(m_workers.size()); }
+    QVariantMap stats() const;
+
+private:
+    // 任务：参数为是否已取消（已取消时只做收尾）
+    struct Task
+    {
+        std::function<void(bool)> fn;
+        CancellationToken token;
+    };
+
+    // 一个优先级一组队列
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<Task> tasks[PriorityCount];
+    };
+
+    Executor();
+    ~Executor();
+
+    void submit(Priority priority, const CancellationToken &token, std::function<void(bool)> fn);
+    bool takeTask(int self, Task *task);
+    void workerLoop(int self);
+
+    std::vector<std::unique_ptr<Queue>> m_local; // 每个工作线程一个
+    Queue m_global;                              // 外部线程提交
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_sleepLock;
+    std::condition_variable m_wake;
+    std::atomic<int> m_pending;
+    std::atomic<bool> m_stopping;
+
+    std::atomic<quint64> m_submitted;
+    std::atomic<quint64> m_executed;
+    std::atomic<quint64> m_stolen;
+    std::atomic<quint64> m_cancelled;
+};
+
+#endif // EXECUTOR_H
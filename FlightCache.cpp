@@ -0,0 +1,163 @@
+#include "FlightCache.h"
+#include <QDateTime>
+
+FlightCache::FlightCache(int capacity, qint64 ttlMs)
+    : m_capacity(qMax(1, capacity))
+    , m_ttlMs(ttlMs)
+    , m_tick(0)
+    , m_bytes(0)
+    , m_hits(0)
+    , m_misses(0)
+{
+    MemoryGovernor::instance()->registerCache(this);
+}
+
+FlightCache::~FlightCache()
+{
+    MemoryGovernor::instance()->unregisterCache(this);
+}
+
+// 查询缓存
+bool FlightCache::lookup(const QString &flightId, QVariantMap *flight)
+{
+    QMutexLocker locker(&m_lock);
+    auto it = m_entries.find(flightId);
+    if (it == m_entries.end() || it->expireAt <= QDateTime::currentMSecsSinceEpoch()) {
+        if (it != m_entries.end()) {
+            m_bytes -= it->bytes;
+            m_entries.erase(it);
+        }
+        ++m_misses;
+        return false;
+    }
+    it->lastUsed = ++m_tick;
+    ++m_hits;
+    if (flight)
+        *flight = it->flight;
+    return true;
+}
+
+// 写入缓存
+void FlightCache::insert(const QString &flightId, const QVariantMap &flight, bool pinned)
+{
+    {
+        QMutexLocker locker(&m_lock);
+        auto it = m_entries.find(flightId);
+        if (it == m_entries.end()) {
+            if (m_entries.size() >= m_capacity)
+                evictOneLocked(false);
+            it = m_entries.insert(flightId, Entry());
+        }
+        m_bytes -= it->bytes;
+        it->flight = flight;
+        it->bytes = estimateBytes(flightId, flight);
+        it->expireAt = QDateTime::currentMSecsSinceEpoch() + m_ttlMs;
+        it->lastUsed = ++m_tick;
+        it->pinned = it->pinned || pinned;
+        m_bytes += it->bytes;
+    }
+    // 释放自身锁后再通知，避免与全局淘汰互相等待
+    MemoryGovernor::instance()->notifyGrowth();
+}
+
+// 只固定给定的航班，其余取消固定
+void FlightCache::setPinned(const QStringList &flightIds)
+{
+    QMutexLocker locker(&m_lock);
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        it->pinned = flightIds.contains(it.key());
+    }
+}
+
+// 移除单个航班（余票变化）
+void FlightCache::invalidate(const QString &flightId)
+{
+    QMutexLocker locker(&m_lock);
+    auto it = m_entries.find(flightId);
+    if (it == m_entries.end())
+        return;
+    m_bytes -= it->bytes;
+    m_entries.erase(it);
+}
+
+// 清空缓存
+void FlightCache::invalidateAll()
+{
+    QMutexLocker locker(&m_lock);
+    m_entries.clear();
+    m_bytes = 0;
+}
+
+// 统计信息
+QVariantMap FlightCache::stats() const
+{
+    QMutexLocker locker(&m_lock);
+    int pinned = 0;
+    for (const Entry &entry : m_entries) {
+        if (entry.pinned)
+            ++pinned;
+    }
+    QVariantMap result;
+    result["entries"] = m_entries.size();
+    result["pinned"] = pinned;
+    result["capacity"] = m_capacity;
+    result["bytes"] = m_bytes;
+    result["hits"] = m_hits;
+    result["misses"] = m_misses;
+    const quint64 lookups = m_hits + m_misses;
+    result["hit_ratio"] = lookups > 0 ? double(m_hits) / lookups : 0.0;
+    return result;
+}
+
+// 当前估计占用
+qint64 FlightCache::bytesUsed() const
+{
+    QMutexLocker locker(&m_lock);
+    return m_bytes;
+}
+
+// 内存预算不足：先淘汰非固定条目，仍不够再淘汰固定条目
+qint64 FlightCache::evictBytes(qint64 bytes)
+{
+    QMutexLocker locker(&m_lock);
+    qint64 freed = 0;
+    while (freed < bytes && !m_entries.isEmpty()) {
+        qint64 released = evictOneLocked(false);
+        if (released == 0)
+            released = evictOneLocked(true);
+        if (released == 0)
+            break;
+        freed += released;
+    }
+    return freed;
+}
+
+// 淘汰最久未用的条目（容量小，线性扫描即可）
+qint64 FlightCache::evictOneLocked(bool allowPinned)
+{
+    auto victim = m_entries.end();
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (it->pinned && !allowPinned)
+            continue;
+        if (victim == m_entries.end() || it->lastUsed < victim->lastUsed)
+            victim = it;
+    }
+    if (victim == m_entries.end())
+        return 0;
+    const qint64 released = victim->bytes;
+    m_bytes -= released;
+    m_entries.erase(victim);
+    return released;
+}
+
+// 估计一条航班记录的内存占用（字符串按 UTF-16 计，另加容器开销）
+qint64 FlightCache::estimateBytes(const QString &flightId, const QVariantMap &flight)
+{
+    qint64 bytes = 64 + flightId.size() * 2;
+    for (auto it = flight.constBegin(); it != flight.constEnd(); ++it) {
+        bytes += 48 + it.key().size() * 2;
+        if (it.value().typeId() == QMetaType::QString)
+            bytes += it.value().toString().size() * 2;
+    }
+    return bytes;
+}
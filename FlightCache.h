@@ -0,0 +1,55 @@
+#ifndef FLIGHTCACHE_H
+#define FLIGHTCACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVariantMap>
+#include "MemoryGovernor.h"
+
+// 航班详情缓存（按航班号），热点航班可预热并固定（不被容量淘汰）
+// 航班数据变化时整体失效，下单/退票只移除对应航班；普通条目带过期时间，避免长期显示过期余票
+// 向 MemoryGovernor 注册，内存预算不足时先淘汰非固定条目
+class FlightCache : public GovernedCache
+{
+public:
+    explicit FlightCache(int capacity = 256, qint64 ttlMs = 30 * 1000);
+    ~FlightCache() override;
+
+    bool lookup(const QString &flightId, QVariantMap *flight); // 查询缓存
+    void insert(const QString &flightId, const QVariantMap &flight, bool pinned = false);
+    void setPinned(const QStringList &flightIds); // 只固定给定的航班，其余取消固定
+    void invalidate(const QString &flightId);     // 移除单个航班（余票变化）
+    void invalidateAll();                         // 清空缓存
+    QVariantMap stats() const;                    // 命中率等统计
+
+    // GovernedCache
+    QString cacheName() const override { return "flight_cache"; }
+    qint64 bytesUsed() const override;
+    qint64 evictBytes(qint64 bytes) override;
+    double evictionCost() const override { return 1.0; } // 可随时从数据库重新加载
+
+private:
+    struct Entry
+    {
+        QVariantMap flight;
+        qint64 expireAt = 0;
+        qint64 lastUsed = 0;
+        bool pinned = false;
+        qint64 bytes = 0; // 估计占用
+    };
+
+    qint64 evictOneLocked(bool allowPinned); // 淘汰最久未用的条目，返回释放字节数
+    static qint64 estimateBytes(const QString &flightId, const QVariantMap &flight);
+
+    mutable QMutex m_lock;
+    QHash<QString, Entry> m_entries;
+    int m_capacity;
+    qint64 m_ttlMs;
+    qint64 m_tick;    // 逻辑时钟（LRU 排序用）
+    qint64 m_bytes;   // 当前估计占用
+    quint64 m_hits;
+    quint64 m_misses;
+};
+
+#endif // FLIGHTCACHE_H
@@ -0,0 +1,395 @@
+#include "FlightSearchController.h"
+#include <QDateTime>
+#include <QFutureWatcher>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+#include <algorithm>
+#include "AsyncLogger.h"
+#include "DBManager.h"
+#include "Executor.h"
+#include "SqlStatements.h"
+
+namespace {
+
+// 一行航班记录转换为界面使用的字段（与 DBManager 的航班查询一致）
+QVariantMap flightRow(const QSqlQuery &query)
+{
+    QVariantMap flight;
+    flight["Flight_id"] = query.value("Flight_id").toString();
+    flight["Departure"] = query.value("Departure").toString();
+    flight["Destination"] = query.value("Destination").toString();
+    flight["depart_time"] = query.value("depart_time").toDateTime().toString("yyyy-MM-dd HH:mm:ss");
+    flight["arrive_time"] = query.value("arrive_time").toDateTime().toString("yyyy-MM-dd HH:mm:ss");
+    flight["status"] = query.value("status").toInt();
+    flight["price"] = query.value("price").toDouble();
+    flight["total_seats"] = query.value("total_seats").toInt();
+    flight["remain_seats"] = query.value("remain_seats").toInt();
+    return flight;
+}
+
+template<Sql::Id ID, typename... Args>
+bool prepareBound(QSqlQuery &query, Args &&...args)
+{
+    if (!query.prepare(Sql::Statement<ID>::sql))
+        return false;
+    Sql::bind<ID>(query, std::forward<Args>(args)...);
+    return true;
+}
+
+// 与 DBManager::flightSearch 相同的选择：航班号优先，否则按非空条件选择能走索引的语句
+bool prepareSearch(QSqlQuery &query, const FlightSearchController::Criteria &c)
+{
+    if (!c.flightId.isEmpty())
+        return prepareBound<Sql::Id::FlightById>(query, c.flightId);
+    const int mask = (c.departure.isEmpty() ? 0 : 1) | (c.destination.isEmpty() ? 0 : 2)
+                     | (c.departDate.isEmpty() ? 0 : 4);
+    switch (mask) {
+    case 1:
+        return prepareBound<Sql::Id::FlightSearchDep>(query, c.departure);
+    case 2:
+        return prepareBound<Sql::Id::FlightSearchDest>(query, c.destination);
+    case 3:
+        return prepareBound<Sql::Id::FlightSearchRoute>(query, c.departure, c.destination);
+    case 4:
+        return prepareBound<Sql::Id::FlightSearchDate>(query, c.departDate, c.departDate);
+    case 5:
+        return prepareBound<Sql::Id::FlightSearchDepDate>(query, c.departure, c.departDate, c.departDate);
+    case 6:
+        return prepareBound<Sql::Id::FlightSearchDestDate>(query, c.destination, c.departDate, c.departDate);
+    case 7:
+        return prepareBound<Sql::Id::FlightSearchRouteDate>(query,
+                                                            c.departure,
+                                                            c.destination,
+                                                            c.departDate,
+                                                            c.departDate);
+    default:
+        return prepareBound<Sql::Id::FlightSearch>(query);
+    }
+}
+
+} // namespace
+
+FlightSearchController::FlightSearchController(QObject *parent)
+    : QObject(parent)
+    , m_db(DBManager::getInstance())
+    , m_generation(0)
+    , m_indexValid(false)
+    , m_indexBuilding(false)
+    , m_indexEpoch(0)
+    , m_searching(false)
+{
+    m_debounce.setSingleShot(true);
+    m_debounce.setInterval(250);
+    connect(&m_debounce, &QTimer::timeout, this, &FlightSearchController::runSearch);
+    // 航班增删改后索引失效；下单退票只修改对应航班的余票
+    connect(m_db, &DBManager::flightsChanged, this, &FlightSearchController::invalidateIndex);
+    connect(m_db, &DBManager::flightSeatsChanged, this, &FlightSearchController::applySeatDelta);
+}
+
+// 更新查询条件（去抖后执行）
+void FlightSearchController::updateQuery(const QString &flightId,
+                                         const QString &departure,
+                                         const QString &destination,
+                                         const QString &departDate)
+{
+    m_pending = {flightId.trimmed(), departure, destination, departDate};
+    // 旧查询已被新输入取代，立即取消
+    cancelInflight();
+    m_debounce.start();
+}
+
+// 立即执行当前条件
+void FlightSearchController::searchNow()
+{
+    m_debounce.stop();
+    runSearch();
+}
+
+// 航班数据变化，索引需重建
+void FlightSearchController::invalidateIndex()
+{
+    m_indexValid = false;
+    ++m_indexEpoch;
+}
+
+// 下单/退票：就地修改索引中的余票（正在执行的过滤持有旧快照，修改时写时复制）
+// 重建期间无法确定读取的快照是否已包含这次变化，按失效处理
+void FlightSearchController::applySeatDelta(const QString &flightId, int delta)
+{
+    if (m_indexBuilding) {
+        ++m_indexEpoch;
+        return;
+    }
+    if (!m_indexValid)
+        return;
+    for (QVariantMap &flight : m_index) {
+        if (flight.value("Flight_id").toString() != flightId)
+            continue;
+        flight["remain_seats"] = flight.value("remain_seats").toInt() + delta;
+        return;
+    }
+}
+
+QVariantList FlightSearchController::results() const
+{
+    return m_results;
+}
+
+bool FlightSearchController::isSearching() const
+{
+    return m_searching;
+}
+
+int FlightSearchController::debounceMs() const
+{
+    return m_debounce.interval();
+}
+
+void FlightSearchController::setDebounceMs(int ms)
+{
+    if (ms == m_debounce.interval())
+        return;
+    m_debounce.setInterval(qMax(0, ms));
+    emit debounceMsChanged();
+}
+
+// 执行一次查询：优先使用内存索引；索引失效时先在后台重建，完成后再执行；未连接时回退到数据库查询
+void FlightSearchController::runSearch()
+{
+    const quint64 generation = ++m_generation;
+    cancelInflight();
+    m_inflight = CancellationToken();
+    const Criteria criteria = m_pending;
+    setSearching(true);
+
+    if (!m_indexValid) {
+        if (m_db->isConnected())
+            rebuildIndex();
+        else
+            searchDatabase();
+        return;
+    }
+
+    // 在工作线程中过滤索引快照（隐式共享，不拷贝数据）
+    const QVector<QVariantMap> snapshot = m_index;
+    const CancellationToken token = m_inflight;
+    auto *watcher = new QFutureWatcher<QVariantList>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, generation]() {
+        // 开始前已被新查询取消的任务没有结果，新查询会发布自己的结果
+        if (!watcher->isCanceled())
+            publish(generation, watcher->result());
+        watcher->deleteLater();
+    });
+    // 交互路径，高优先级
+    watcher->setFuture(Executor::instance()->run(Executor::High, token, [snapshot, criteria, token]() {
+        return filterIndex(snapshot, criteria, token);
+    }));
+}
+
+// 在执行器上重建索引：完成时若期间没有再失效则启用，并按最新条件重新查询；重建失败时回退到数据库查询
+void FlightSearchController::rebuildIndex()
+{
+    if (m_indexBuilding)
+        return;
+    m_indexBuilding = true;
+    const quint64 epoch = m_indexEpoch;
+    auto *watcher = new QFutureWatcher<IndexSnapshot>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, epoch]() {
+        watcher->deleteLater();
+        m_indexBuilding = false;
+        const IndexSnapshot snapshot = watcher->isCanceled() ? IndexSnapshot() : watcher->result();
+        if (epoch != m_indexEpoch) {
+            rebuildIndex(); // 重建期间航班又有变化
+            return;
+        }
+        if (!snapshot.ok) {
+            searchDatabase();
+            return;
+        }
+        m_index = snapshot.rows;
+        m_indexValid = true;
+        runSearch();
+    });
+    // 重建结果供之后所有查询使用，不带查询的取消令牌（新输入不会打断重建）
+    watcher->setFuture(Executor::instance()->run(Executor::High, []() { return buildIndex(); }));
+}
+
+// 索引不可用时查询数据库（当前代次）：在执行器上用独立连接执行，新输入可通过 KILL QUERY 终止
+// 未连接时走 DBManager 的同步接口，只为给出“未连接”的提示，不访问数据库
+void FlightSearchController::searchDatabase()
+{
+    const quint64 generation = m_generation;
+    const Criteria criteria = m_pending;
+    if (!m_db->isConnected()) {
+        const QVariantList rows = criteria.flightId.isEmpty()
+                                      ? m_db->queryFlightsByCondition(criteria.departure,
+                                                                      criteria.destination,
+                                                                      criteria.departDate)
+                                      : m_db->queryFlightByNum(criteria.flightId);
+        publish(generation, rows);
+        return;
+    }
+
+    // 截止时间与 DBManager 的默认截止时间一致
+    const qint64 remaining = m_db->makeQueryContext().remainingMs();
+    const int timeoutMs = remaining < 0 ? 0 : int(qMax<qint64>(1, remaining));
+    const CancellationToken token = m_inflight;
+    const auto connectionId = std::make_shared<std::atomic<qint64>>(0);
+    m_dbQuery = connectionId;
+    auto *watcher = new QFutureWatcher<QVariantList>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, generation]() {
+        if (!watcher->isCanceled())
+            publish(generation, watcher->result());
+        watcher->deleteLater();
+    });
+    watcher->setFuture(Executor::instance()->run(Executor::High, token, [criteria, timeoutMs, connectionId, token]() {
+        return queryDatabase(criteria, timeoutMs, connectionId, token);
+    }));
+}
+
+// 取消当前查询：令牌让排队中的任务不再执行、过滤循环提前返回；
+// 数据库查询已在执行时，对其连接发 KILL QUERY 让服务端立即停止
+void FlightSearchController::cancelInflight()
+{
+    m_inflight.cancel();
+    if (!m_dbQuery)
+        return;
+    const qint64 connectionId = m_dbQuery->exchange(-1);
+    m_dbQuery.reset();
+    if (connectionId > 0)
+        Executor::instance()->run(Executor::High, [connectionId]() { killQuery(connectionId); });
+}
+
+// 工作线程：临时复制主连接查询，用完即删除
+// 先登记连接号再执行；登记时发现已被取消则不执行，取消方看到连接号则终止该语句，二者必居其一
+QVariantList FlightSearchController::queryDatabase(const Criteria &criteria,
+                                                   int timeoutMs,
+                                                   const std::shared_ptr<std::atomic<qint64>> &connectionId,
+                                                   const CancellationToken &token)
+{
+    QVariantList rows;
+    const QString connectionName = QString("flight_search_%1").arg(quintptr(QThread::currentThreadId()));
+    {
+        QSqlDatabase db = QSqlDatabase::cloneDatabase("QT_ODBC_CONN", connectionName);
+        if (db.open()) {
+            QSqlQuery session(db);
+            session.exec(QString("SET SESSION MAX_EXECUTION_TIME = %1").arg(timeoutMs));
+            qint64 id = 0;
+            if (session.exec("SELECT CONNECTION_ID()") && session.next())
+                id = session.value(0).toLongLong();
+            qint64 expected = 0;
+            if (id > 0 && !token.isCancelled() && connectionId->compare_exchange_strong(expected, id)) {
+                QSqlQuery query(db);
+                query.setForwardOnly(true);
+                if (prepareSearch(query, criteria) && query.exec()) {
+                    while (query.next()) {
+                        if (token.isCancelled()) {
+                            rows.clear();
+                            break;
+                        }
+                        rows.append(flightRow(query));
+                    }
+                } else if (!token.isCancelled()) {
+                    FLOG_DEBUG("db") << "查询航班失败：" << query.lastError().text();
+                }
+                // 语句已结束，之后的取消不再需要终止
+                expected = id;
+                connectionId->compare_exchange_strong(expected, 0);
+            }
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+    return rows;
+}
+
+// 工作线程：用临时连接终止指定连接上正在执行的语句（语句已结束时服务端忽略）
+void FlightSearchController::killQuery(qint64 connectionId)
+{
+    const QString connectionName = QString("flight_search_kill_%1").arg(quintptr(QThread::currentThreadId()));
+    {
+        QSqlDatabase db = QSqlDatabase::cloneDatabase("QT_ODBC_CONN", connectionName);
+        if (db.open()) {
+            QSqlQuery query(db);
+            if (!query.exec(QString("KILL QUERY %1").arg(connectionId)))
+                FLOG_DEBUG("db") << "终止查询失败：" << query.lastError().text();
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+}
+
+// 工作线程：界面线程的连接不能跨线程使用，临时复制主连接的参数读取全部航班，用完即删除
+FlightSearchController::IndexSnapshot FlightSearchController::buildIndex()
+{
+    IndexSnapshot snapshot;
+    const QString connectionName = QString("flight_index_%1").arg(quintptr(QThread::currentThreadId()));
+    {
+        QSqlDatabase db = QSqlDatabase::cloneDatabase("QT_ODBC_CONN", connectionName);
+        if (db.open()) {
+            QSqlQuery query(db);
+            query.setForwardOnly(true);
+            if (query.exec(Sql::kStatements[std::size_t(Sql::Id::AllFlights)].sql)) {
+                snapshot.ok = true;
+                while (query.next())
+                    snapshot.rows.append(flightRow(query));
+            }
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+
+    // 与 queryFlightsByCondition 保持一致：按起飞时间升序
+    std::stable_sort(snapshot.rows.begin(), snapshot.rows.end(), [](const QVariantMap &a, const QVariantMap &b) {
+        return a.value("depart_time").toString() < b.value("depart_time").toString();
+    });
+    return snapshot;
+}
+
+// 在索引快照中过滤
+QVariantList FlightSearchController::filterIndex(const QVector<QVariantMap> &index,
+                                                 const Criteria &criteria,
+                                                 const CancellationToken &token)
+{
+    QVariantList result;
+    for (int i = 0; i < index.size(); ++i) {
+        // 每 256 条检查一次是否已被新查询取代
+        if ((i & 0xFF) == 0 && token.isCancelled())
+            return QVariantList();
+
+        const QVariantMap &flight = index.at(i);
+        if (!criteria.flightId.isEmpty()) {
+            // 航班号优先（与按钮搜索逻辑一致），逐键输入时按前缀匹配
+            if (!flight.value("Flight_id").toString().startsWith(criteria.flightId, Qt::CaseInsensitive))
+                continue;
+        } else {
+            if (!criteria.departure.isEmpty() && flight.value("Departure").toString() != criteria.departure)
+                continue;
+            if (!criteria.destination.isEmpty()
+                && flight.value("Destination").toString() != criteria.destination)
+                continue;
+            if (!criteria.departDate.isEmpty()
+                && !flight.value("depart_time").toString().startsWith(criteria.departDate))
+                continue;
+        }
+        result.append(flight);
+    }
+    return result;
+}
+
+// 仅发布最新代次的结果，过期结果直接丢弃
+void FlightSearchController::publish(quint64 generation, const QVariantList &rows)
+{
+    if (generation != m_generation)
+        return;
+    setSearching(false);
+    m_results = rows;
+    emit resultsChanged();
+}
+
+void FlightSearchController::setSearching(bool searching)
+{
+    if (m_searching == searching)
+        return;
+    m_searching = searching;
+    emit searchingChanged();
+}
@@ -0,0 +1,97 @@
+#ifndef FLIGHTSEARCHCONTROLLER_H
+#define FLIGHTSEARCHCONTROLLER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QVariantList>
+#include <QVector>
+#include <atomic>
+#include <memory>
+#include "QueryContext.h"
+
+class DBManager;
+
+// 边输边搜控制器：接收逐键输入的查询条件，去抖后在内存航班索引中检索
+// 新查询会取消仍在执行的旧查询，只有属于最新代次的结果才会发布到界面
+// 索引不可用时回退到数据库查询，同样在执行器上用独立连接执行，取消时对该连接发 KILL QUERY
+// 索引在执行器上用独立连接重建，界面线程不等待数据库；重建完成后重新执行当前查询
+// 航班增删改时索引重建，下单/退票只改索引中对应航班的余票
+class FlightSearchController : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QVariantList results READ results NOTIFY resultsChanged)
+    Q_PROPERTY(bool searching READ isSearching NOTIFY searchingChanged)
+    Q_PROPERTY(int debounceMs READ debounceMs WRITE setDebounceMs NOTIFY debounceMsChanged)
+public:
+    explicit FlightSearchController(QObject *parent = nullptr);
+
+    // 查询条件
+    struct Criteria
+    {
+        QString flightId;    // 航班号（前缀匹配，忽略大小写）
+        QString departure;   // 出发地
+        QString destination; // 目的地
+        QString departDate;  // 出发日期 yyyy-MM-dd
+    };
+
+    Q_INVOKABLE void updateQuery(const QString &flightId,
+                                 const QString &departure,
+                                 const QString &destination,
+                                 const QString &departDate); // 更新查询条件（去抖后执行）
+    Q_INVOKABLE void searchNow();                            // 立即执行当前条件
+    Q_INVOKABLE void invalidateIndex();                      // 航班数据变化，索引需重建
+    void applySeatDelta(const QString &flightId, int delta); // 下单/退票：就地修改索引中的余票
+
+    QVariantList results() const;
+    bool isSearching() const;
+    int debounceMs() const;
+    void setDebounceMs(int ms);
+
+    // 在索引快照中过滤（可在工作线程执行）
+    static QVariantList filterIndex(const QVector<QVariantMap> &index,
+                                    const Criteria &criteria,
+                                    const CancellationToken &token);
+
+signals:
+    void resultsChanged();
+    void searchingChanged();
+    void debounceMsChanged();
+
+private:
+    // 重建结果（ok 为 false 表示连接或查询失败）
+    struct IndexSnapshot
+    {
+        bool ok = false;
+        QVector<QVariantMap> rows;
+    };
+
+    void runSearch();                                       // 执行一次查询（新代次）
+    void rebuildIndex();                                    // 在执行器上重建索引（已在重建时忽略）
+    void searchDatabase();                                  // 索引不可用时在执行器上查询数据库
+    void cancelInflight();                                  // 取消当前查询（数据库查询正在执行时终止该语句）
+    static IndexSnapshot buildIndex();                      // 工作线程：读取全部航班并排序
+    // 工作线程：按条件查询数据库；connectionId 记录执行语句的连接，供取消时 KILL QUERY
+    static QVariantList queryDatabase(const Criteria &criteria,
+                                      int timeoutMs,
+                                      const std::shared_ptr<std::atomic<qint64>> &connectionId,
+                                      const CancellationToken &token);
+    static void killQuery(qint64 connectionId);             // 工作线程：终止指定连接上正在执行的语句
+    void publish(quint64 generation, const QVariantList &rows); // 仅发布最新代次的结果
+    void setSearching(bool searching);
+
+    DBManager *m_db;
+    QTimer m_debounce;           // 去抖定时器
+    Criteria m_pending;          // 最近一次输入的条件
+    quint64 m_generation;        // 当前查询代次
+    CancellationToken m_inflight; // 当前查询的取消令牌
+    // 正在执行的数据库查询所在连接：0 尚未执行，> 0 执行中，-1 已取消
+    std::shared_ptr<std::atomic<qint64>> m_dbQuery;
+    QVector<QVariantMap> m_index; // 航班索引（按起飞时间升序）
+    bool m_indexValid;
+    bool m_indexBuilding;         // 正在重建
+    quint64 m_indexEpoch;         // 索引失效次数，重建期间失效则结果作废
+    QVariantList m_results;
+    bool m_searching;
+};
+
+#endif // FLIGHTSEARCHCONTROLLER_H
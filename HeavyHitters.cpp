@@ -0,0 +1,172 @@
+#include "HeavyHitters.h"
+#include <QVariantMap>
+#include <algorithm>
+#include <limits>
+
+namespace {
+// 每行使用不同的哈希种子
+constexpr size_t kRowSeeds[] = {0x9E3779B9u, 0x85EBCA6Bu, 0xC2B2AE35u, 0x27D4EB2Fu,
+                                0x165667B1u, 0xD3A2646Cu, 0xFD7046C5u, 0xB55A4F09u};
+constexpr int kMaxDepth = sizeof(kRowSeeds) / sizeof(kRowSeeds[0]);
+} // namespace
+
+HeavyHitters::HeavyHitters(int topK, int depth, int width)
+    : m_topK(qMax(1, topK))
+    , m_depth(qBound(1, depth, kMaxDepth))
+    , m_width(qMax(16, width))
+    , m_counters(static_cast<size_t>(m_depth) * m_width, 0)
+    , m_total(0)
+{
+    m_heap.reserve(m_topK);
+    m_heapPos.reserve(m_topK);
+}
+
+// 记录一次访问
+void HeavyHitters::record(const QString &key, quint32 weight)
+{
+    if (key.isEmpty() || weight == 0)
+        return;
+
+    QMutexLocker locker(&m_lock);
+    m_total += weight;
+
+    // 保守更新：只增加当前最小的计数器，降低高估
+    quint32 current = estimateLocked(key);
+    const quint32 target = current + weight;
+    for (int row = 0; row < m_depth; ++row) {
+        quint32 &cell = m_counters[static_cast<size_t>(row) * m_width
+                                   + qHash(key, kRowSeeds[row]) % m_width];
+        cell = qMax(cell, target);
+    }
+
+    // 维护 Top-K 小顶堆
+    auto pos = m_heapPos.constFind(key);
+    if (pos != m_heapPos.constEnd()) {
+        m_heap[*pos].count = target;
+        siftDown(*pos);
+        return;
+    }
+    if (static_cast<int>(m_heap.size()) < m_topK) {
+        m_heap.push_back({key, target});
+        m_heapPos.insert(key, static_cast<int>(m_heap.size()) - 1);
+        siftUp(static_cast<int>(m_heap.size()) - 1);
+        return;
+    }
+    if (target > m_heap.front().count) {
+        m_heapPos.remove(m_heap.front().key);
+        m_heap.front() = {key, target};
+        m_heapPos.insert(key, 0);
+        siftDown(0);
+    }
+}
+
+// 估计访问次数
+quint32 HeavyHitters::estimate(const QString &key) const
+{
+    QMutexLocker locker(&m_lock);
+    return estimateLocked(key);
+}
+
+// 访问最多的 k 个键（降序）
+QStringList HeavyHitters::topKeys(int k) const
+{
+    QStringList keys;
+    for (const Candidate &c : sortedCandidates()) {
+        if (keys.size() >= k)
+            break;
+        keys.append(c.key);
+    }
+    return keys;
+}
+
+// 访问最多的 k 个键及估计次数
+QVariantList HeavyHitters::topEntries(int k) const
+{
+    QVariantList entries;
+    for (const Candidate &c : sortedCandidates()) {
+        if (entries.size() >= k)
+            break;
+        QVariantMap entry;
+        entry["key"] = c.key;
+        entry["count"] = c.count;
+        entries.append(entry);
+    }
+    return entries;
+}
+
+// 计数减半，使统计偏向近期流量
+void HeavyHitters::decay()
+{
+    QMutexLocker locker(&m_lock);
+    for (quint32 &cell : m_counters) {
+        cell >>= 1;
+    }
+    for (Candidate &c : m_heap) {
+        c.count >>= 1;
+    }
+    m_total >>= 1;
+}
+
+// 记录总次数
+quint64 HeavyHitters::totalCount() const
+{
+    QMutexLocker locker(&m_lock);
+    return m_total;
+}
+
+quint32 HeavyHitters::estimateLocked(const QString &key) const
+{
+    quint32 result = std::numeric_limits<quint32>::max();
+    for (int row = 0; row < m_depth; ++row) {
+        result = qMin(result,
+                      m_counters[static_cast<size_t>(row) * m_width
+                                 + qHash(key, kRowSeeds[row]) % m_width]);
+    }
+    return result;
+}
+
+void HeavyHitters::siftUp(int i)
+{
+    while (i > 0) {
+        const int parent = (i - 1) / 2;
+        if (m_heap[parent].count <= m_heap[i].count)
+            break;
+        swapNodes(parent, i);
+        i = parent;
+    }
+}
+
+void HeavyHitters::siftDown(int i)
+{
+    const int n = static_cast<int>(m_heap.size());
+    for (;;) {
+        const int left = 2 * i + 1;
+        const int right = left + 1;
+        int smallest = i;
+        if (left < n && m_heap[left].count < m_heap[smallest].count)
+            smallest = left;
+        if (right < n && m_heap[right].count < m_heap[smallest].count)
+            smallest = right;
+        if (smallest == i)
+            break;
+        swapNodes(i, smallest);
+        i = smallest;
+    }
+}
+
+void HeavyHitters::swapNodes(int a, int b)
+{
+    std::swap(m_heap[a], m_heap[b]);
+    m_heapPos[m_heap[a].key] = a;
+    m_heapPos[m_heap[b].key] = b;
+}
+
+std::vector<HeavyHitters::Candidate> HeavyHitters::sortedCandidates() const
+{
+    QMutexLocker locker(&m_lock);
+    std::vector<Candidate> sorted = m_heap;
+    std::sort(sorted.begin(), sorted.end(), [](const Candidate &a, const Candidate &b) {
+        return a.count > b.count;
+    });
+    return sorted;
+}
@@ -0,0 +1,48 @@
+#ifndef HEAVYHITTERS_H
+#define HEAVYHITTERS_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVariantList>
+#include <vector>
+
+// 热点统计：Count-Min Sketch 估计访问频次 + 小顶堆维护 Top-K
+// 内存固定（depth * width 个计数器 + K 个候选），与访问量无关
+class HeavyHitters
+{
+public:
+    explicit HeavyHitters(int topK = 32, int depth = 4, int width = 2048);
+
+    void record(const QString &key, quint32 weight = 1); // 记录一次访问
+    quint32 estimate(const QString &key) const;          // 估计访问次数
+    QStringList topKeys(int k) const;                    // 访问最多的 k 个键（降序）
+    QVariantList topEntries(int k) const;                // 同上，带估计次数（用于监控）
+    void decay();                                        // 计数减半（让热点反映近期流量）
+    quint64 totalCount() const;                          // 记录总次数
+
+private:
+    struct Candidate
+    {
+        QString key;
+        quint32 count;
+    };
+
+    quint32 estimateLocked(const QString &key) const;
+    void siftUp(int i);
+    void siftDown(int i);
+    void swapNodes(int a, int b);
+    std::vector<Candidate> sortedCandidates() const;
+
+    mutable QMutex m_lock;
+    int m_topK;
+    int m_depth;
+    int m_width;
+    std::vector<quint32> m_counters; // depth 行 * width 列
+    std::vector<Candidate> m_heap;   // 小顶堆（堆顶为 Top-K 中最冷的键）
+    QHash<QString, int> m_heapPos;   // 键 -> 堆中位置
+    quint64 m_total;
+};
+
+#endif // HEAVYHITTERS_H
@@ -0,0 +1,138 @@
+#include "IdempotencyCache.h"
+#include <QDateTime>
+
+IdempotencyCache::IdempotencyCache(int capacity, qint64 ttlMs)
+    : m_capacity(qMax(1, capacity))
+    , m_ttlMs(ttlMs)
+{
+    MemoryGovernor::instance()->registerCache(this);
+}
+
+IdempotencyCache::~IdempotencyCache()
+{
+    MemoryGovernor::instance()->unregisterCache(this);
+}
+
+// 尝试占用幂等键
+IdempotencyCache::State IdempotencyCache::begin(const QString &key, QVariant *result)
+{
+    {
+        QMutexLocker locker(&m_lock);
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+        auto it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            if (it->done && it->expireAt <= now) {
+                // 已过期，视为新请求
+                m_lruList.erase(it->lru);
+                m_entries.erase(it);
+            } else {
+                touch(*it, key);
+                if (!it->done)
+                    return InFlight;
+                if (result)
+                    *result = it->result;
+                return Completed;
+            }
+        }
+
+        m_lruList.push_front(key);
+        Entry entry;
+        entry.lru = m_lruList.begin();
+        m_entries.insert(key, entry);
+        evictIfNeeded();
+    }
+    // 释放自身锁后再通知，避免与全局淘汰互相等待
+    MemoryGovernor::instance()->notifyGrowth();
+    return New;
+}
+
+// 记录执行结果
+void IdempotencyCache::complete(const QString &key, const QVariant &result)
+{
+    QMutexLocker locker(&m_lock);
+    auto it = m_entries.find(key);
+    if (it == m_entries.end())
+        return;
+    it->result = result;
+    it->done = true;
+    it->expireAt = QDateTime::currentMSecsSinceEpoch() + m_ttlMs;
+    touch(*it, key);
+}
+
+// 放弃占用（操作因连接等瞬时原因未执行，允许客户端重试）
+void IdempotencyCache::abandon(const QString &key)
+{
+    QMutexLocker locker(&m_lock);
+    auto it = m_entries.find(key);
+    if (it == m_entries.end() || it->done)
+        return;
+    m_lruList.erase(it->lru);
+    m_entries.erase(it);
+}
+
+// 清空缓存
+void IdempotencyCache::clear()
+{
+    QMutexLocker locker(&m_lock);
+    m_entries.clear();
+    m_lruList.clear();
+}
+
+// 当前记录数
+int IdempotencyCache::size() const
+{
+    QMutexLocker locker(&m_lock);
+    return m_entries.size();
+}
+
+// 当前估计占用
+qint64 IdempotencyCache::bytesUsed() const
+{
+    QMutexLocker locker(&m_lock);
+    qint64 bytes = 0;
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        bytes += entryBytes(it.key());
+    }
+    return bytes;
+}
+
+// 内存预算不足：从 LRU 尾部淘汰已完成的记录
+qint64 IdempotencyCache::evictBytes(qint64 bytes)
+{
+    QMutexLocker locker(&m_lock);
+    qint64 freed = 0;
+    auto rit = m_lruList.end();
+    while (freed < bytes && rit != m_lruList.begin()) {
+        --rit;
+        auto it = m_entries.find(*rit);
+        if (it == m_entries.end() || !it->done)
+            continue;
+        freed += entryBytes(it.key());
+        rit = m_lruList.erase(rit);
+        m_entries.erase(it);
+    }
+    return freed;
+}
+
+// 移到 LRU 头部
+void IdempotencyCache::touch(Entry &entry, const QString &key)
+{
+    m_lruList.erase(entry.lru);
+    m_lruList.push_front(key);
+    entry.lru = m_lruList.begin();
+}
+
+// 超出容量时从尾部淘汰，执行中的记录不淘汰
+void IdempotencyCache::evictIfNeeded()
+{
+    auto rit = m_lruList.end();
+    while (m_entries.size() > m_capacity && rit != m_lruList.begin()) {
+        --rit;
+        auto it = m_entries.find(*rit);
+        if (it == m_entries.end() || !it->done)
+            continue;
+        rit = m_lruList.erase(rit);
+        m_entries.erase(it);
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef IDEMPOTENCYCACHE_H
+#define IDEMPOTENCYCACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVariant>
+#include <list>
+#include "MemoryGovernor.h"
+
+// 幂等键缓存：记录客户端幂等键与首次执行结果（LRU + 过期时间）
+// 客户端超时重试时携带相同的键，直接返回首次结果，避免重复执行（下单的幂等键随订单写入数据库，不用这里）；只记录最终结果，暂时性失败由调用方 abandon 后可重试
+// 向 MemoryGovernor 注册；淘汰会让重试失去去重保护，因此淘汰代价设得较高
+class IdempotencyCache : public GovernedCache
+{
+public:
+    enum State {
+        New,       // 首次出现，调用方需要执行操作
+        InFlight,  // 相同键的请求正在执行
+        Completed  // 已执行完毕，result 中为首次执行结果
+    };
+
+    explicit IdempotencyCache(int capacity = 4096, qint64 ttlMs = 10 * 60 * 1000);
+    ~IdempotencyCache() override;
+
+    State begin(const QString &key, QVariant *result); // 尝试占用幂等键
+    void complete(const QString &key, const QVariant &result); // 记录执行结果
+    void abandon(const QString &key);                  // 放弃占用（允许客户端重试）
+    void clear();                                      // 清空缓存
+    int size() const;                                  // 当前记录数
+
+    // GovernedCache
+    QString cacheName() const override { return "idempotency_keys"; }
+    qint64 bytesUsed() const override;
+    qint64 evictBytes(qint64 bytes) override;
+    double evictionCost() const override { return 8.0; }
+
+private:
+    struct Entry
+    {
+        QVariant result;                  // 首次执行结果
+        qint64 expireAt = 0;              // 过期时间（毫秒时间戳）
+        bool done = false;                // 是否已执行完毕
+        std::list<QString>::iterator lru; // 在 LRU 链表中的位置
+    };
+
+    void touch(Entry &entry, const QString &key); // 移到 LRU 头部
+    void evictIfNeeded();                         // 超出容量时淘汰最久未用的已完成记录
+    static qint64 entryBytes(const QString &key) { return 128 + key.size() * 4; } // 估计单条占用
+
+    mutable QMutex m_lock;
+    QHash<QString, Entry> m_entries;
+    std::list<QString> m_lruList; // 头部为最近使用
+    int m_capacity;
+    qint64 m_ttlMs;
+};
+
+#endif // IDEMPOTENCYCACHE_H
@@ -0,0 +1,211 @@
+#include "ImageCodec.h"
+#include "AsyncLogger.h"
+#include "Executor.h"
+#include <QBuffer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QImageWriter>
+#include <QSet>
+#include <atomic>
+#include <vector>
+
+namespace {
+
+// 截图类图片的采样颜色上限（采样 64x64 网格）
+constexpr int kGraphicColorLimit = 256;
+
+// 旧策略对比编码只抽样执行（每 N 次上传一次），统计节省量不需要每次多编码一遍
+constexpr unsigned kLegacySampleEvery = 16;
+std::atomic<unsigned> g_legacySampleTick{0};
+
+// 编码为指定格式，失败返回空
+QByteArray encodeAs(const QImage &img, const char *format, int quality)
+{
+    QByteArray blob;
+    QBuffer buffer(&blob);
+    buffer.open(QIODevice::WriteOnly);
+    if (!img.save(&buffer, format, quality))
+        return QByteArray();
+    return blob;
+}
+
+} // namespace
+
+// 解码图片，长宽不超过 bound
+QImage ImageCodec::decodeBounded(const QString &imgPath, const QSize &bound, QString *error, qint64 *peakBytes)
+{
+    QImageReader reader(imgPath);
+    reader.setAutoTransform(true); // 按 EXIF 方向旋转
+
+    const QSize sourceSize = reader.size();
+    QSize target = sourceSize;
+    if (sourceSize.isValid()
+        && (sourceSize.width() > bound.width() || sourceSize.height() > bound.height())) {
+        target = sourceSize.scaled(bound, Qt::KeepAspectRatio);
+        // 解码器支持时直接输出缩小后的图像（JPEG 为 DCT 域缩放，不生成全尺寸像素）
+        if (reader.supportsOption(QImageIOHandler::ScaledSize))
+            reader.setScaledSize(dctScaledSize(sourceSize, target));
+    }
+
+    QImage img = reader.read();
+    if (img.isNull()) {
+        if (error)
+            *error = reader.errorString();
+        return QImage();
+    }
+    qint64 peak = img.sizeInBytes();
+
+    // 剩余比例（< 2 倍）做面积平均缩放；32 位格式走 Qt 的 SIMD 平滑缩放路径
+    if (img.width() > bound.width() || img.height() > bound.height()) {
+        if (img.format() != QImage::Format_RGB32 && img.format() != QImage::Format_ARGB32_Premultiplied) {
+            img.convertTo(img.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                : QImage::Format_RGB32);
+            peak = qMax(peak, img.sizeInBytes());
+        }
+        img = img.scaled(bound, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        peak = qMax(peak, img.sizeInBytes());
+    }
+    if (peakBytes)
+        *peakBytes = peak;
+    return img;
+}
+
+// 读取图片文件为二进制（带压缩）
+QByteArray ImageCodec::readImageToBlob(const QString &imgPath, int quality, QString *format)
+{
+    Encoded encoded = encodeFile(imgPath, quality);
+    if (format)
+        *format = encoded.format;
+    return encoded.blob;
+}
+
+// 读取并按存储策略编码图片文件
+ImageCodec::Encoded ImageCodec::encodeFile(const QString &imgPath, int quality)
+{
+    // 检查文件是否存在
+    QFile file(imgPath);
+    if (!file.exists()) {
+        FLOG_DEBUG("image") << "图片文件不存在：" << imgPath;
+        return Encoded();
+    }
+
+    // 按存储上限直接解码缩小后的图像
+    QString error;
+    qint64 peakBytes = 0;
+    QImage img = decodeBounded(imgPath, QSize(kMaxWidth, kMaxHeight), &error, &peakBytes);
+    if (img.isNull()) {
+        FLOG_DEBUG("image") << "不是有效图片文件：" << imgPath << error;
+        return Encoded();
+    }
+
+    Encoded encoded = encodeForStorage(img, quality);
+    encoded.sourceBytes = QFileInfo(imgPath).size();
+    encoded.peakDecodedBytes = peakBytes;
+
+    // 旧策略按后缀选择 PNG/JPG，仅用于统计节省量：结果相同时直接取用，否则抽样重新编码，未抽中为 -1
+    const QString fileSuffix = imgPath.split(".").last().toLower();
+    if (fileSuffix == "png" && encoded.format == "png")
+        encoded.legacyBytes = encoded.blob.size();
+    else if (g_legacySampleTick.fetch_add(1, std::memory_order_relaxed) % kLegacySampleEvery == 0)
+        encoded.legacyBytes = encodeAs(img, fileSuffix == "png" ? "PNG" : "JPG", quality).size();
+    else
+        encoded.legacyBytes = -1;
+
+    FLOG_DEBUG("image") << "图片读取成功，格式：" << encoded.format << "压缩后大小：" << encoded.blob.size()
+             << "字节，原策略：" << encoded.legacyBytes << "字节";
+    return encoded;
+}
+
+// 存储编码策略
+ImageCodec::Encoded ImageCodec::encodeForStorage(const QImage &img, int quality)
+{
+    const Analysis analysis = analyze(img);
+    const bool webp = webpAvailable();
+
+    // 候选格式（格式名, 存库格式, 质量）
+    struct Candidate
+    {
+        const char *writerFormat;
+        const char *storedFormat;
+        int quality;
+    };
+    QList<Candidate> candidates;
+    if (analysis.content == Content::Graphic) {
+        // 截图类只用无损格式，Qt 的 WebP 插件在质量 100 时使用无损模式
+        if (webp)
+            candidates.append({"WEBP", "webp", 100});
+        candidates.append({"PNG", "png", quality});
+    } else {
+        if (webp)
+            candidates.append({"WEBP", "webp", quality});
+        if (analysis.hasAlpha) {
+            if (!webp)
+                candidates.append({"PNG", "png", quality});
+        } else {
+            candidates.append({"JPG", "jpg", quality});
+        }
+    }
+
+    // 各候选格式在执行器上并行编码（QImage 只读共享）
+    std::vector<QByteArray> blobs(size_t(candidates.size()));
+    Executor::instance()->parallelFor(int(candidates.size()), Executor::Normal, [&](int i) {
+        blobs[size_t(i)] = encodeAs(img, candidates.at(i).writerFormat, candidates.at(i).quality);
+    });
+
+    Encoded best;
+    for (int i = 0; i < candidates.size(); ++i) {
+        const QByteArray &blob = blobs[size_t(i)];
+        if (!blob.isEmpty() && (best.isNull() || blob.size() < best.blob.size())) {
+            best.blob = blob;
+            best.format = candidates.at(i).storedFormat;
+        }
+    }
+    return best;
+}
+
+// 分析透明度与内容类型
+ImageCodec::Analysis ImageCodec::analyze(const QImage &img)
+{
+    Analysis analysis;
+    if (img.isNull())
+        return analysis;
+
+    const bool alphaFormat = img.hasAlphaChannel();
+    const int stepX = qMax(1, img.width() / 64);
+    const int stepY = qMax(1, img.height() / 64);
+    QSet<QRgb> colors;
+    for (int y = 0; y < img.height(); y += stepY) {
+        for (int x = 0; x < img.width(); x += stepX) {
+            const QRgb pixel = img.pixel(x, y);
+            if (alphaFormat && qAlpha(pixel) != 255)
+                analysis.hasAlpha = true;
+            if (colors.size() <= kGraphicColorLimit)
+                colors.insert(pixel);
+        }
+    }
+    analysis.sampledColors = colors.size();
+    analysis.content = colors.size() <= kGraphicColorLimit ? Content::Graphic : Content::Photo;
+    return analysis;
+}
+
+// 当前 Qt 是否带 WebP 编码插件
+bool ImageCodec::webpAvailable()
+{
+    static const bool available = QImageWriter::supportedImageFormats().contains("webp");
+    return available;
+}
+
+// DCT 域缩放后的中间尺寸
+QSize ImageCodec::dctScaledSize(const QSize &source, const QSize &target)
+{
+    QSize scaled = source;
+    // libjpeg 最多缩小到 1/8
+    for (int k = 0; k < 3; ++k) {
+        const QSize half((scaled.width() + 1) / 2, (scaled.height() + 1) / 2);
+        if (half.width() < target.width() || half.height() < target.height())
+            break;
+        scaled = half;
+    }
+    return scaled;
+}
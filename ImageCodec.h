@@ -0,0 +1,70 @@
+#ifndef IMAGECODEC_H
+#define IMAGECODEC_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+// 图片编解码工具：上传图片时按目标尺寸直接解码，避免先解码整张大图；
+// 入库前按内容选择体积最小的可接受格式（有 WebP 插件时优先 WebP，否则 JPEG/PNG）
+class ImageCodec
+{
+public:
+    static constexpr int kMaxWidth = 1920;  // 存储图片最大宽度
+    static constexpr int kMaxHeight = 1080; // 存储图片最大高度
+
+    // 图片内容类型
+    enum class Content {
+        Photo,   // 照片：颜色丰富，适合有损压缩
+        Graphic, // 截图/图标：颜色少、边缘锐利，有损压缩会产生明显振铃
+    };
+
+    // 内容分析结果
+    struct Analysis
+    {
+        bool hasAlpha = false; // 存在非不透明像素
+        Content content = Content::Photo;
+        int sampledColors = 0; // 采样到的不同颜色数
+    };
+
+    // 编码结果
+    struct Encoded
+    {
+        QByteArray blob;
+        QString format;          // 存库格式：webp / jpg / png
+        qint64 sourceBytes = 0;  // 原文件大小
+        qint64 legacyBytes = -1; // 旧策略（按后缀 PNG/JPG）编码后的大小，用于统计节省量（抽样，未测为 -1）
+        qint64 peakDecodedBytes = 0; // 解码过程中最大的中间 QImage 字节数
+        bool isNull() const { return blob.isEmpty(); }
+    };
+
+    // 解码图片，长宽不超过 bound（保持比例）
+    // JPEG 先在 DCT 域按 1/2、1/4、1/8 缩小解码，剩余比例再做一次平滑缩放
+    // peakBytes 返回解码、格式转换、缩放各步中最大的 QImage 字节数
+    static QImage decodeBounded(const QString &imgPath,
+                                const QSize &bound,
+                                QString *error = nullptr,
+                                qint64 *peakBytes = nullptr);
+
+    // 读取图片文件为压缩后的二进制（长宽不超过 1920x1080），格式由 encodeForStorage 决定
+    static QByteArray readImageToBlob(const QString &imgPath, int quality = 80, QString *format = nullptr);
+
+    // 读取并按存储策略编码图片文件
+    static Encoded encodeFile(const QString &imgPath, int quality = 80);
+
+    // 存储编码策略：照片优先有损 WebP，无插件时 JPEG（带透明则 PNG）；
+    // 截图类在无损 WebP 与 PNG 中取较小者；所有候选都编码后取体积最小的
+    static Encoded encodeForStorage(const QImage &img, int quality = 80);
+
+    // 分析透明度与内容类型（按网格采样，不遍历整张图）
+    static Analysis analyze(const QImage &img);
+
+    // 当前 Qt 是否带 WebP 编码插件
+    static bool webpAvailable();
+
+    // DCT 域缩放后的中间尺寸：源尺寸除以 2^k 后仍不小于目标的最小尺寸
+    static QSize dctScaledSize(const QSize &source, const QSize &target);
+};
+
+#endif // IMAGECODEC_H
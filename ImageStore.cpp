@@ -0,0 +1,169 @@
+#include "ImageStore.h"
+#include <QBuffer>
+#include <QImageReader>
+
+ImageStore::ImageStore(qint64 maxBytes)
+    : m_bytes(0)
+    , m_maxBytes(maxBytes)
+    , m_tick(0)
+{
+    MemoryGovernor::instance()->registerCache(this);
+}
+
+ImageStore::~ImageStore()
+{
+    MemoryGovernor::instance()->unregisterCache(this);
+}
+
+QString ImageStore::postKey(int postId)
+{
+    return QString("post/%1").arg(postId);
+}
+
+QString ImageStore::avatarKey(int userId)
+{
+    return QString("avatar/%1").arg(userId);
+}
+
+// 存入编码数据并返回 image:// 地址（空数据返回空地址）
+QString ImageStore::put(const QString &key, const QByteArray &blob, const QString &format)
+{
+    if (blob.isEmpty()) {
+        remove(key);
+        return QString();
+    }
+
+    QString url;
+    {
+        QMutexLocker locker(&m_lock);
+        auto it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            m_bytes -= it->blob.size();
+            // 内容相同则沿用原地址，QML 可继续使用已解码的纹理
+            if (it->blob != blob || it->format != format)
+                it->version = ++m_versions[key];
+        } else {
+            Entry entry;
+            entry.version = ++m_versions[key];
+            it = m_entries.insert(key, entry);
+        }
+        it->blob = blob;
+        it->format = format;
+        it->lastUsed = ++m_tick;
+        m_bytes += blob.size();
+
+        // 自身上限（全局预算由 MemoryGovernor 负责）
+        while (m_bytes > m_maxBytes && m_entries.size() > 1) {
+            if (evictOneLocked() == 0)
+                break;
+        }
+        auto current = m_entries.constFind(key);
+        if (current != m_entries.constEnd())
+            url = urlLocked(key, *current);
+    }
+    MemoryGovernor::instance()->notifyGrowth();
+    return url;
+}
+
+// 取出编码数据
+bool ImageStore::get(const QString &key, QByteArray *blob, QString *format)
+{
+    QMutexLocker locker(&m_lock);
+    auto it = m_entries.find(key);
+    if (it == m_entries.end())
+        return false;
+    it->lastUsed = ++m_tick;
+    if (blob)
+        *blob = it->blob;
+    if (format)
+        *format = it->format;
+    return true;
+}
+
+// 已缓存则返回地址
+QString ImageStore::urlFor(const QString &key) const
+{
+    QMutexLocker locker(&m_lock);
+    auto it = m_entries.constFind(key);
+    return it == m_entries.constEnd() ? QString() : urlLocked(key, *it);
+}
+
+void ImageStore::remove(const QString &key)
+{
+    QMutexLocker locker(&m_lock);
+    auto it = m_entries.find(key);
+    if (it == m_entries.end())
+        return;
+    m_bytes -= it->blob.size();
+    m_entries.erase(it);
+}
+
+qint64 ImageStore::bytesUsed() const
+{
+    QMutexLocker locker(&m_lock);
+    return m_bytes;
+}
+
+qint64 ImageStore::evictBytes(qint64 bytes)
+{
+    QMutexLocker locker(&m_lock);
+    qint64 freed = 0;
+    while (freed < bytes) {
+        const qint64 released = evictOneLocked();
+        if (released == 0)
+            break;
+        freed += released;
+    }
+    return freed;
+}
+
+QString ImageStore::urlLocked(const QString &key, const Entry &entry) const
+{
+    return QString("image://blobs/%1?v=%2").arg(key).arg(entry.version);
+}
+
+qint64 ImageStore::evictOneLocked()
+{
+    auto victim = m_entries.end();
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (victim == m_entries.end() || it->lastUsed < victim->lastUsed)
+            victim = it;
+    }
+    if (victim == m_entries.end())
+        return 0;
+    // 至少按 1 字节计，避免空条目导致调用方误判无可淘汰
+    const qint64 released = qMax<qint64>(1, victim->blob.size());
+    m_bytes -= victim->blob.size();
+    m_entries.erase(victim);
+    return released;
+}
+
+BlobImageProvider::BlobImageProvider(ImageStore *store)
+    : QQuickImageProvider(QQuickImageProvider::Image)
+    , m_store(store)
+{}
+
+// 解码 ImageStore 中的图片；请求了尺寸时按比例缩放
+QImage BlobImageProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
+{
+    const QString key = id.section('?', 0, 0);
+    QByteArray blob;
+    QString format;
+    if (!m_store->get(key, &blob, &format))
+        return QImage();
+
+    QBuffer buffer(&blob);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer, format.toUtf8());
+    if (requestedSize.isValid() && !requestedSize.isEmpty()) {
+        QSize scaled = reader.size();
+        if (scaled.isValid()) {
+            scaled.scale(requestedSize, Qt::KeepAspectRatio);
+            reader.setScaledSize(scaled);
+        }
+    }
+    QImage image = reader.read();
+    if (size)
+        *size = image.size();
+    return image;
+}
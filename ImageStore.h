@@ -0,0 +1,65 @@
+#ifndef IMAGESTORE_H
+#define IMAGESTORE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QQuickImageProvider>
+#include <QString>
+#include "MemoryGovernor.h"
+
+// C++ 侧图片缓存：保存帖子图片、头像的原始编码数据，QML 只拿到 image://blobs/<key> 形式的地址，
+// 图片字节不再进入 JS 堆（原来 QByteArray -> ArrayBuffer -> base64 要跨边界拷贝两次）
+class ImageStore : public GovernedCache
+{
+public:
+    explicit ImageStore(qint64 maxBytes = 64LL * 1024 * 1024);
+    ~ImageStore() override;
+
+    static QString postKey(int postId);   // post/<id>
+    static QString avatarKey(int userId); // avatar/<uid>
+
+    QString put(const QString &key, const QByteArray &blob, const QString &format); // 存入并返回地址
+    bool get(const QString &key, QByteArray *blob, QString *format);               // 取出编码数据
+    QString urlFor(const QString &key) const;                                       // 已缓存则返回地址，否则返回空
+    void remove(const QString &key);
+
+    // GovernedCache
+    QString cacheName() const override { return "image_store"; }
+    qint64 bytesUsed() const override;
+    qint64 evictBytes(qint64 bytes) override;
+    double evictionCost() const override { return 2.0; } // 需要重新从数据库读取大字段
+
+private:
+    struct Entry
+    {
+        QByteArray blob;
+        QString format;
+        quint32 version = 0; // 内容变化时递增，地址随之变化，使 QML 图片缓存失效
+        qint64 lastUsed = 0;
+    };
+
+    QString urlLocked(const QString &key, const Entry &entry) const;
+    qint64 evictOneLocked(); // 淘汰最久未用的条目
+
+    mutable QMutex m_lock;
+    QHash<QString, Entry> m_entries;
+    QHash<QString, quint32> m_versions; // 被淘汰后仍保留版本号，避免地址复用到旧内容
+    qint64 m_bytes;
+    qint64 m_maxBytes;
+    qint64 m_tick;
+};
+
+// image://blobs/<key>?v=<version> 的图片提供者，从 ImageStore 解码图片
+class BlobImageProvider : public QQuickImageProvider
+{
+public:
+    explicit BlobImageProvider(ImageStore *store);
+
+    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override;
+
+private:
+    ImageStore *m_store;
+};
+
+#endif // IMAGESTORE_H
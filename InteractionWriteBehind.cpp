@@ -0,0 +1,112 @@
+#include "InteractionWriteBehind.h"
+
+InteractionWriteBehind::InteractionWriteBehind()
+    : m_version(0)
+    , m_recorded(0)
+    , m_coalesced(0)
+    , m_flushed(0)
+{}
+
+// 查询待写入的状态
+bool InteractionWriteBehind::pendingState(const Key &key, bool *state) const
+{
+    QMutexLocker locker(&m_lock);
+    auto it = m_pending.constFind(key);
+    if (it == m_pending.constEnd())
+        return false;
+    if (state)
+        *state = it->desired;
+    return true;
+}
+
+// 记录意图
+void InteractionWriteBehind::record(const Key &key, bool desired, bool original)
+{
+    QMutexLocker locker(&m_lock);
+    ++m_recorded;
+    auto it = m_pending.find(key);
+    if (it == m_pending.end()) {
+        if (desired == original) {
+            ++m_coalesced;
+            return;
+        }
+        Pending pending;
+        pending.original = original;
+        it = m_pending.insert(key, pending);
+    }
+    // 点了又取消：与数据库一致，整对操作都不必写库
+    if (desired == it->original) {
+        m_pending.erase(it);
+        m_coalesced += 2;
+        return;
+    }
+    it->desired = desired;
+    it->version = ++m_version;
+}
+
+// 取出全部待写入变更
+QList<InteractionWriteBehind::Change> InteractionWriteBehind::takeAll()
+{
+    QMutexLocker locker(&m_lock);
+    QList<Change> changes;
+    changes.reserve(m_pending.size());
+    for (auto it = m_pending.constBegin(); it != m_pending.constEnd(); ++it) {
+        Change change;
+        change.key = it.key();
+        change.desired = it->desired;
+        change.version = it->version;
+        changes.append(change);
+    }
+    m_flushed += changes.size();
+    m_pending.clear();
+    return changes;
+}
+
+// 写库失败时放回
+void InteractionWriteBehind::restore(const QList<Change> &changes)
+{
+    QMutexLocker locker(&m_lock);
+    for (const Change &change : changes) {
+        if (m_pending.contains(change.key))
+            continue; // 取出后用户又操作过，以新的意图为准
+        Pending pending;
+        pending.desired = change.desired;
+        pending.original = !change.desired;
+        pending.version = change.version;
+        m_pending.insert(change.key, pending);
+    }
+    m_flushed -= qMin<quint64>(m_flushed, changes.size());
+}
+
+// 丢弃某个用户的全部待写入意图
+int InteractionWriteBehind::discardUser(int userId)
+{
+    QMutexLocker locker(&m_lock);
+    int discarded = 0;
+    for (auto it = m_pending.begin(); it != m_pending.end();) {
+        if (it.key().userId == userId) {
+            it = m_pending.erase(it);
+            ++discarded;
+        } else {
+            ++it;
+        }
+    }
+    return discarded;
+}
+
+int InteractionWriteBehind::pendingCount() const
+{
+    QMutexLocker locker(&m_lock);
+    return m_pending.size();
+}
+
+QVariantMap InteractionWriteBehind::stats() const
+{
+    QMutexLocker locker(&m_lock);
+    QVariantMap map;
+    map["pending"] = m_pending.size();
+    map["recorded"] = m_recorded;
+    map["coalesced"] = m_coalesced;
+    map["flushed"] = m_flushed;
+    return map;
+}
@@ -0,0 +1,69 @@
+#ifndef INTERACTIONWRITEBEHIND_H
+#define INTERACTIONWRITEBEHIND_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QVariantMap>
+#include <QtGlobal>
+
+// 点赞/喜欢的延迟写入队列：每个 (用户, 帖子, 类型) 只记录最终意图，
+// 来回切换时互相抵消（回到数据库原状态则直接丢弃），由 DBManager 定时批量写库；
+// 查询是否点赞/喜欢时先看这里，用户立即看到自己的操作
+class InteractionWriteBehind
+{
+public:
+    enum Kind { Like = 0, Favorite = 1 };
+
+    struct Key
+    {
+        int userId = 0;
+        int postId = 0;
+        Kind kind = Like;
+        bool operator==(const Key &other) const
+        {
+            return userId == other.userId && postId == other.postId && kind == other.kind;
+        }
+    };
+
+    struct Change
+    {
+        Key key;
+        bool desired = false; // 最终状态：true 为已点赞/已喜欢
+        quint64 version = 0;  // 写库失败放回队列时用来判断是否已被更新的意图覆盖
+    };
+
+    InteractionWriteBehind();
+
+    // 查询待写入的状态，有待写入意图时返回 true
+    bool pendingState(const Key &key, bool *state) const;
+    // 记录意图；original 为数据库中的当前状态。回到原状态时撤销待写入记录
+    void record(const Key &key, bool desired, bool original);
+    QList<Change> takeAll();                    // 取出全部待写入变更（写库用）
+    void restore(const QList<Change> &changes); // 写库失败时放回（已有更新意图的不覆盖）
+    int discardUser(int userId);                // 丢弃某个用户的全部待写入意图（删除用户前），返回丢弃条数
+    int pendingCount() const;
+    QVariantMap stats() const;
+
+private:
+    struct Pending
+    {
+        bool desired = false;
+        bool original = false;
+        quint64 version = 0;
+    };
+
+    mutable QMutex m_lock;
+    QHash<Key, Pending> m_pending;
+    quint64 m_version;
+    quint64 m_recorded;  // 记录的意图总数
+    quint64 m_coalesced; // 因抵消而不必写库的次数
+    quint64 m_flushed;   // 已取出写库的变更数
+};
+
+inline size_t qHash(const InteractionWriteBehind::Key &key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.userId, key.postId, int(key.kind));
+}
+
+#endif // INTERACTIONWRITEBEHIND_H
@@ -0,0 +1,207 @@
+#include "MemoryGovernor.h"
+#include "AsyncLogger.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QRegularExpression>
+#ifdef Q_OS_WIN
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+namespace {
+constexpr qint64 kDefaultBudget = 256LL * 1024 * 1024; // 默认全局预算 256 MB
+constexpr double kPressureRatio = 0.10;                 // 可用内存低于 10% 视为内存紧张
+} // namespace
+
+MemoryGovernor::MemoryGovernor()
+    : m_configuredBudget(kDefaultBudget)
+    , m_underPressure(false)
+    , m_evictions(0)
+    , m_evictedBytes(0)
+    , m_pressureTimer(this)
+{
+    m_pressureTimer.setInterval(5000);
+    connect(&m_pressureTimer, &QTimer::timeout, this, &MemoryGovernor::checkSystemPressure);
+
+    // 第一次使用可能在工作线程（缓存随工作线程对象创建）：对象连同定时器移到主线程，
+    // 定时器在主线程启动，否则工作线程没有事件循环或退出后压力检查不会再执行
+    QCoreApplication *app = QCoreApplication::instance();
+    if (app && thread() != app->thread()) {
+        moveToThread(app->thread());
+        QMetaObject::invokeMethod(this, [this]() { m_pressureTimer.start(); }, Qt::QueuedConnection);
+    } else {
+        m_pressureTimer.start();
+    }
+}
+
+// 进程内唯一实例（有意不释放，保证各缓存析构时仍可注销）
+MemoryGovernor *MemoryGovernor::instance()
+{
+    static MemoryGovernor *governor = new MemoryGovernor();
+    return governor;
+}
+
+void MemoryGovernor::registerCache(GovernedCache *cache)
+{
+    QMutexLocker locker(&m_lock);
+    if (!m_caches.contains(cache))
+        m_caches.append(cache);
+}
+
+void MemoryGovernor::unregisterCache(GovernedCache *cache)
+{
+    QMutexLocker locker(&m_lock);
+    m_caches.removeAll(cache);
+}
+
+// 设置全局字节预算
+void MemoryGovernor::setBudget(qint64 bytes)
+{
+    {
+        QMutexLocker locker(&m_lock);
+        m_configuredBudget = qMax<qint64>(1024 * 1024, bytes);
+    }
+    enforce();
+}
+
+// 当前生效预算：内存紧张时减半
+qint64 MemoryGovernor::budget() const
+{
+    QMutexLocker locker(&m_lock);
+    return m_underPressure ? m_configuredBudget / 2 : m_configuredBudget;
+}
+
+// 缓存增长后调用
+void MemoryGovernor::notifyGrowth()
+{
+    enforce();
+}
+
+// 按预算加权淘汰：每轮按“占用 / 淘汰代价”分摊需要释放的字节数
+void MemoryGovernor::enforce()
+{
+    QMutexLocker locker(&m_lock);
+    const qint64 limit = m_underPressure ? m_configuredBudget / 2 : m_configuredBudget;
+
+    for (int round = 0; round < 4; ++round) {
+        const qint64 over = totalBytesLocked() - limit;
+        if (over <= 0)
+            return;
+
+        double totalWeight = 0;
+        for (GovernedCache *cache : std::as_const(m_caches)) {
+            totalWeight += cache->bytesUsed() / qMax(0.01, cache->evictionCost());
+        }
+        if (totalWeight <= 0)
+            return;
+
+        qint64 freed = 0;
+        for (GovernedCache *cache : std::as_const(m_caches)) {
+            const double weight = cache->bytesUsed() / qMax(0.01, cache->evictionCost());
+            const qint64 share = static_cast<qint64>(over * (weight / totalWeight)) + 1;
+            if (weight <= 0)
+                continue;
+            const qint64 released = cache->evictBytes(share);
+            if (released > 0) {
+                freed += released;
+                ++m_evictions;
+            }
+        }
+        m_evictedBytes += freed;
+        if (freed == 0) {
+            FLOG_WARN("memory") << "[Memory] 缓存占用超出预算，但已无可淘汰条目";
+            return;
+        }
+    }
+}
+
+// 各缓存占用与淘汰统计
+QVariantMap MemoryGovernor::stats() const
+{
+    QMutexLocker locker(&m_lock);
+    QVariantMap result;
+    QVariantMap caches;
+    for (GovernedCache *cache : m_caches) {
+        QVariantMap entry;
+        entry["bytes"] = cache->bytesUsed();
+        entry["eviction_cost"] = cache->evictionCost();
+        caches[cache->cacheName()] = entry;
+    }
+    result["caches"] = caches;
+    result["total_bytes"] = totalBytesLocked();
+    result["budget_bytes"] = m_underPressure ? m_configuredBudget / 2 : m_configuredBudget;
+    result["under_pressure"] = m_underPressure;
+    result["evictions"] = m_evictions;
+    result["evicted_bytes"] = m_evictedBytes;
+    return result;
+}
+
+// 检查系统可用内存，紧张时收紧预算并立即淘汰
+void MemoryGovernor::checkSystemPressure()
+{
+    qint64 total = 0;
+    qint64 available = 0;
+    if (!readSystemMemory(&total, &available) || total <= 0)
+        return;
+
+    const bool pressure = available < static_cast<qint64>(total * kPressureRatio);
+    bool changed = false;
+    {
+        QMutexLocker locker(&m_lock);
+        changed = pressure != m_underPressure;
+        m_underPressure = pressure;
+    }
+    if (changed) {
+        FLOG_WARN("memory") << "[Memory] 系统内存" << (pressure ? "紧张，缓存预算减半" : "恢复正常");
+        emit memoryPressureChanged(pressure);
+    }
+    if (pressure)
+        enforce();
+}
+
+qint64 MemoryGovernor::totalBytesLocked() const
+{
+    qint64 total = 0;
+    for (GovernedCache *cache : m_caches) {
+        total += cache->bytesUsed();
+    }
+    return total;
+}
+
+// 读取系统总内存与可用内存
+bool MemoryGovernor::readSystemMemory(qint64 *totalBytes, qint64 *availableBytes)
+{
+#if defined(Q_OS_WIN)
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (!GlobalMemoryStatusEx(&status))
+        return false;
+    *totalBytes = static_cast<qint64>(status.ullTotalPhys);
+    *availableBytes = static_cast<qint64>(status.ullAvailPhys);
+    return true;
+#elif defined(Q_OS_LINUX)
+    QFile meminfo("/proc/meminfo");
+    if (!meminfo.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+    static const QRegularExpression lineRegex(R"(^(\w+):\s+(\d+) kB)");
+    *totalBytes = 0;
+    *availableBytes = 0;
+    while (!meminfo.atEnd()) {
+        const QString line = QString::fromLatin1(meminfo.readLine());
+        const QRegularExpressionMatch match = lineRegex.match(line);
+        if (!match.hasMatch())
+            continue;
+        if (match.captured(1) == "MemTotal")
+            *totalBytes = match.captured(2).toLongLong() * 1024;
+        else if (match.captured(1) == "MemAvailable")
+            *availableBytes = match.captured(2).toLongLong() * 1024;
+    }
+    return *totalBytes > 0 && *availableBytes > 0;
+#else
+    Q_UNUSED(totalBytes)
+    Q_UNUSED(availableBytes)
+    return false;
+#endif
+}
@@ -0,0 +1,58 @@
+#ifndef MEMORYGOVERNOR_H
+#define MEMORYGOVERNOR_H
+
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QVariantMap>
+
+// 受全局内存预算管理的缓存需要实现的接口
+// 注意：缓存在持有自身锁时不要调用 MemoryGovernor（淘汰时会反过来加锁缓存）
+class GovernedCache
+{
+public:
+    virtual ~GovernedCache() = default;
+    virtual QString cacheName() const = 0;          // 缓存名称（监控用）
+    virtual qint64 bytesUsed() const = 0;           // 当前占用字节数（估计值）
+    virtual qint64 evictBytes(qint64 bytes) = 0;    // 尽量释放指定字节数，返回实际释放量
+    virtual double evictionCost() const { return 1.0; } // 淘汰代价权重，越大越晚被淘汰
+};
+
+// 全局内存预算管理：所有进程内缓存向其注册，超出预算时按“占用/代价”加权淘汰，
+// 系统可用内存不足时自动收紧预算
+class MemoryGovernor : public QObject
+{
+    Q_OBJECT
+public:
+    static MemoryGovernor *instance();
+
+    void registerCache(GovernedCache *cache);
+    void unregisterCache(GovernedCache *cache);
+
+    void setBudget(qint64 bytes); // 设置全局字节预算
+    qint64 budget() const;        // 当前生效预算（内存紧张时低于配置值）
+    void notifyGrowth();          // 缓存增长后调用，超出预算时立即淘汰
+    void enforce();               // 按预算淘汰
+    QVariantMap stats() const;    // 各缓存占用与淘汰统计
+
+signals:
+    void memoryPressureChanged(bool underPressure);
+
+private:
+    MemoryGovernor();
+    void checkSystemPressure();           // 检查系统可用内存
+    qint64 totalBytesLocked() const;
+    static bool readSystemMemory(qint64 *totalBytes, qint64 *availableBytes);
+
+    mutable QMutex m_lock;
+    QList<GovernedCache *> m_caches;
+    qint64 m_configuredBudget;
+    bool m_underPressure;
+    quint64 m_evictions;
+    qint64 m_evictedBytes;
+    QTimer m_pressureTimer; // 子对象，随本对象留在主线程
+};
+
+#endif // MEMORYGOVERNOR_H
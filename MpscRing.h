@@ -0,0 +1,86 @@
+#ifndef MPSCRING_H
+#define MPSCRING_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+// 有界无锁环形队列（多生产者单消费者，Vyukov 序号方案）
+// 生产者用一次 CAS 抢占槽位，队列满时 tryPush 立即返回 false，从不阻塞；
+// tryPop 只能由唯一的消费者线程调用
+template<typename T, quint64 Capacity>
+class MpscRing
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity 必须是 2 的幂");
+
+public:
+    MpscRing()
+        : m_slots(new Slot[Capacity])
+        , m_enqueuePos(0)
+        , m_dequeuePos(0)
+    {
+        for (quint64 i = 0; i < Capacity; ++i)
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    // 入队（任意线程）
+    bool tryPush(T value)
+    {
+        quint64 pos = m_enqueuePos.load(std::memory_order_relaxed);
+        Slot *slot = nullptr;
+        for (;;) {
+            slot = &m_slots[pos & (Capacity - 1)];
+            const quint64 seq = slot->sequence.load(std::memory_order_acquire);
+            const qint64 diff = qint64(seq) - qint64(pos);
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false; // 已满
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        slot->value = std::move(value);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 出队（仅消费者线程）
+    bool tryPop(T *value)
+    {
+        const quint64 pos = m_dequeuePos.load(std::memory_order_relaxed);
+        Slot &slot = m_slots[pos & (Capacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+            return false;
+        *value = std::move(slot.value);
+        slot.value = T();
+        slot.sequence.store(pos + Capacity, std::memory_order_release);
+        m_dequeuePos.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 估计的排队数量（任意线程，监控和生产者唤醒判断用）
+    quint64 approximateSize() const
+    {
+        const quint64 dequeued = m_dequeuePos.load(std::memory_order_acquire);
+        const quint64 enqueued = m_enqueuePos.load(std::memory_order_relaxed);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    static constexpr quint64 capacity() { return Capacity; }
+
+private:
+    struct Slot
+    {
+        std::atomic<quint64> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Slot[]> m_slots;
+    std::atomic<quint64> m_enqueuePos;
+    std::atomic<quint64> m_dequeuePos; // 只由消费者写入，approximateSize 可在任意线程读取
+};
+
+#endif // MPSCRING_H
@@ -36,7 +36,7 @@ ColumnLayout{
                         "id":post.id,
                         "title":post.title,
                         "content":post.content,
-                        "image_url":DBManager.blobToImage(post.img_blob,post.img_format)
+                        "image_url":post.image_url
                     }
                 }
             }
@@ -64,7 +64,7 @@ ColumnLayout{
                             "id":post.id,
                             "title":post.title,
                             "content":post.content,
-                            "image_url":DBManager.blobToImage(post.img_blob,post.img_format)
+                            "image_url":post.image_url
                         }
                     }
 
@@ -104,7 +104,7 @@ ColumnLayout{
                         "id":post.id,
                         "title":post.title,
                         "content":post.content,
-                        "image_url":DBManager.blobToImage(post.img_blob,post.img_format)
+                        "image_url":post.image_url
                     }
                 }
             }
@@ -321,15 +321,7 @@ ColumnLayout{
             let succ=DBManager.addFlight(add_data.flight_id,add_data.departure,add_data.destination,add_data.depart_time,add_data.arrive_time,add_data.price,add_data.total_seats,add_data.remain_seats)
             if(!succ)
             {
-                console.log("添加失败")
-                console.log(add_data.flight_id)
-                console.log(add_data.departure)
-                console.log(add_data.destination)
-                console.log(add_data.depart_time)
-                console.log(add_data.arrive_time)
-                console.log(add_data.price)
-                console.log(add_data.total_seats)
-                console.log(add_data.remain_seats)
+                console.warn("添加失败", JSON.stringify(add_data))
             }
 
             close()
@@ -69,7 +69,7 @@ HusWindow{
                     HusAvatar{
                         id:avatar
                         size: 80
-                        imageSource: DBManager.blobToImage(DBManager.getUserAvatarBlob(DBManager.getCurrentUserId()),DBManager.getUserAvatarFormat(DBManager.getCurrentUserId()))
+                        imageSource: DBManager.getUserAvatarUrl(DBManager.getCurrentUserId())
                         imageMipmap: true
                     }
                     //名字
@@ -188,7 +188,7 @@ HusWindow{
 
             function onOperateResult(success,message){
                 if(message.includes("头像上传成功") && success){
-                    avatar.imageSource = DBManager.blobToImage(DBManager.getUserAvatarBlob(DBManager.getCurrentUserId()),DBManager.getUserAvatarFormat(DBManager.getCurrentUserId()))
+                    avatar.imageSource = DBManager.getUserAvatarUrl(DBManager.getCurrentUserId())
                 }
                 if(message.includes("用户名更新成功") && success){
                     user_name.text = qsTr(DBManager.getCurrentUserName())
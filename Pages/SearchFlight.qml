@@ -32,9 +32,9 @@ ColumnLayout{
         {value:"深圳",label:qsTr("深圳")}
     ]
 
-    // 航班号结果
-    ListModel{
-        id:flightList
+    // 边输边搜：去抖 + 取消过期查询，结果只保留最新一次输入
+    FlightSearchController{
+        id:live_search
     }
 
     Layout.fillWidth: true
@@ -69,7 +69,10 @@ ColumnLayout{
                 Layout.fillHeight: true
                 radiusBg.all: 5
                 placeholderText: "输入航班号"
-                onTextChanged: search_data.flight_id=text
+                onTextChanged: {
+                    search_data.flight_id=text
+                    updateSearch()
+                }
             }
 
             HusIconButton {
@@ -98,7 +101,10 @@ ColumnLayout{
                 Layout.fillHeight: true
                 clearEnabled: false
                 model: departureList
-                onActivated: search_data.departure=currentValue
+                onActivated: {
+                    search_data.departure=currentValue
+                    updateSearch()
+                }
             }
             HusSelect{
                 id:destination
@@ -107,7 +113,10 @@ ColumnLayout{
                 Layout.fillHeight: true
                 clearEnabled: false
                 model: destinationList
-                onActivated: search_data.destination=currentValue
+                onActivated: {
+                    search_data.destination=currentValue
+                    updateSearch()
+                }
             }
             HusDateTimePicker{
                 id:pick
@@ -118,7 +127,10 @@ ColumnLayout{
                 showTime: false
                 placeholderText: qsTr("请选择始发日期")
                 format: qsTr("yyyy-MM-dd")
-                onTextChanged: search_data.depart_time=text
+                onTextChanged: {
+                    search_data.depart_time=text
+                    updateSearch()
+                }
             }
         }
     }
@@ -130,7 +142,7 @@ ColumnLayout{
         Layout.fillWidth: true
         clip: true
         spacing: 5
-        model: flightList
+        model: live_search.results
 
         delegate: FlightInformationCard{
             required property var modelData
@@ -149,28 +161,13 @@ ColumnLayout{
         }
     }
 
-    function searchFlight(){
-        //优先处理航班号
-        if(search_my_flight_input.text!==""){
-            let flight =DBManager.queryFlightByNum(search_data.flight_id)
-            flightList.clear();
-            for(let i=0;i<flight.length;i++)
-            {
-                console.log(flight[i]["Flight_id"]);
-                flightList.append(flight[i]);
-            }
-
-            return ;
-        }
-        //console.log(destination.currentValue)
-        let flights=DBManager.queryFlightsByCondition(departure.currentValue,destination.currentValue,pick.text);
-        flightList.clear();
-        for(let j=0;j<flights.length;j++)
-        {
-            console.log(flights[j]["Flight_id"]);
-            flightList.append(flights[j]);
-        }
+    function updateSearch(){
+        live_search.updateQuery(search_data.flight_id,departure.currentValue,destination.currentValue,pick.text)
+    }
 
+    function searchFlight(){
+        updateSearch()
+        live_search.searchNow()
     }
 
 
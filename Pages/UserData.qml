@@ -40,7 +40,7 @@ ColumnLayout{
             id:userImage
             size:100
             anchors.centerIn: parent
-            imageSource:DBManager.blobToImage(DBManager.getUserAvatarBlob(DBManager.getCurrentUserId()),DBManager.getUserAvatarFormat(DBManager.getCurrentUserId()))
+            imageSource:DBManager.getUserAvatarUrl(DBManager.getCurrentUserId())
         }
     }
 
@@ -124,8 +124,8 @@ ColumnLayout{
         title: "选择图片文件"
         nameFilters: ["图片文件 (*.jpg *.png)"]
         onAccepted: {
+            // 图片在后台编码，上传成功后再刷新头像
             DBManager.uploadUserAvatar(DBManager.getCurrentUserId(),selectedFile)
-            userImage.imageSource=DBManager.blobToImage(DBManager.getUserAvatarBlob(DBManager.getCurrentUserId()),DBManager.getUserAvatarFormat(DBManager.getCurrentUserId()))
         }
     }
 
@@ -150,6 +150,12 @@ ColumnLayout{
                 usernameInput.text = DBManager.getCurrentUserName();
             }
         }
+
+        function onOperateResult(success,message){
+            if(message.includes("头像上传成功") && success){
+                userImage.imageSource=DBManager.getUserAvatarUrl(DBManager.getCurrentUserId())
+            }
+        }
     }
 
 
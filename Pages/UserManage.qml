@@ -24,6 +24,8 @@ ColumnLayout{
     ListModel{
         id:userList
     }
+    // uid -> 头像图集格子
+    property var avatarSlots: ({})
 
     ListView{
         Layout.fillHeight: true
@@ -35,6 +37,7 @@ ColumnLayout{
         delegate: UserCard{
             required property var modelData
             height: 150
+            avatar_slot: avatarSlots[String(modelData.Uid)]
             user_data: {
                 "uid":modelData.Uid,
                 "username":modelData.User_name,
@@ -48,16 +51,25 @@ ColumnLayout{
     function updateData()
     {
         let users=DBManager.queryAllUser()
+        let ids=[]
         userList.clear()
         for(let i=0;i<users.length;i++)
         {
             userList.append(users[i])
+            ids.push(users[i].Uid)
         }
+        // 所有头像一次查询取回并打包成图集（未缓存的头像解码后经 avatarAtlasUpdated 补上）
+        avatarSlots=DBManager.loadAvatarAtlas(ids)
     }
 
     Connections{
         target:DBManager
 
+        function onAvatarAtlasUpdated(slots)
+        {
+            avatarSlots=slots
+        }
+
         function onOperateResult(success,message)
         {
             if(message.includes("用户删除成功")&&success)
@@ -0,0 +1,39 @@
+#ifndef QUERYCONTEXT_H
+#define QUERYCONTEXT_H
+
+#include <QDeadlineTimer>
+#include <QString>
+#include <atomic>
+#include <memory>
+
+// 取消令牌：复制后共享同一个取消标志，任意线程调用 cancel() 后所有副本可见
+class CancellationToken
+{
+public:
+    CancellationToken()
+        : m_flag(std::make_shared<std::atomic_bool>(false))
+    {}
+
+    void cancel() { m_flag->store(true, std::memory_order_release); }
+    bool isCancelled() const { return m_flag->load(std::memory_order_acquire); }
+
+private:
+    std::shared_ptr<std::atomic_bool> m_flag;
+};
+
+// 查询上下文：一次请求的截止时间，由请求内的每条语句共享（见 DBManager::execWithDeadline）
+// DBManager 的查询接口在界面线程上同步执行，执行期间不会有取消发生，因此上下文不带取消令牌；
+// 调用方（含 QML）通过查询接口的 timeoutMs 参数指定本次的截止时间。
+// 需要中途取消的查询（边输边搜的数据库回退）在执行器上用独立连接执行，由 CancellationToken 和 KILL QUERY 取消
+struct QueryContext
+{
+    QDeadlineTimer deadline{QDeadlineTimer::Forever};
+
+    // 已超时
+    bool expired() const { return deadline.hasExpired(); }
+
+    // 剩余毫秒数（无截止时间返回 -1）
+    qint64 remainingMs() const { return deadline.isForever() ? -1 : deadline.remainingTime(); }
+};
+
+#endif // QUERYCONTEXT_H
@@ -0,0 +1,255 @@
+#include "ShardRouter.h"
+#include "AsyncLogger.h"
+#include <QSqlError>
+#include <algorithm>
+#include <queue>
+
+namespace {
+// 按用户分片的表（分片库中按主库同名表的结构建表）
+const char *const kShardTables[] = {"user_info", "order", "user_collect_flights", "user_post_likes",
+                                    "user_post_favorites"};
+} // namespace
+
+ShardRouter::ShardRouter(int virtualNodes)
+    : m_virtualNodes(qMax(1, virtualNodes))
+    , m_scatters(0)
+{
+}
+
+ShardRouter::~ShardRouter()
+{
+    close();
+}
+
+// FNV-1a 后再做一次混合，连续的用户 Id 也能均匀散开
+quint32 ShardRouter::hash(const QByteArray &key)
+{
+    quint32 h = 2166136261u;
+    for (char c : key) {
+        h ^= quint8(c);
+        h *= 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h;
+}
+
+// 重建哈希环：分片 i 的虚拟节点为 hash("<分片名>#<序号>")
+void ShardRouter::configure(const QStringList &shards)
+{
+    close();
+    m_shards.clear();
+    m_ring.clear();
+    for (const QString &name : shards) {
+        const QString trimmed = name.trimmed();
+        if (trimmed.isEmpty())
+            continue;
+        auto shard = std::make_unique<Shard>();
+        shard->name = trimmed;
+        m_shards.push_back(std::move(shard));
+    }
+    m_ring.reserve(m_shards.size() * size_t(m_virtualNodes));
+    for (int i = 0; i < shardCount(); ++i) {
+        for (int node = 0; node < m_virtualNodes; ++node)
+            m_ring.emplace_back(hash(QString("%1#%2").arg(m_shards[size_t(i)]->name).arg(node).toUtf8()), i);
+    }
+    std::sort(m_ring.begin(), m_ring.end());
+}
+
+int ShardRouter::shardOf(int userId) const
+{
+    if (m_ring.empty())
+        return -1;
+    const quint32 h = hash(QByteArray::number(userId));
+    auto it = std::lower_bound(m_ring.begin(), m_ring.end(), std::make_pair(h, 0));
+    if (it == m_ring.end())
+        it = m_ring.begin(); // 环尾绕回环首
+    QMutexLocker locker(&m_statsLock);
+    ++m_shards[size_t(it->second)]->routed;
+    return it->second;
+}
+
+// 各分片连接复制主连接（驱动、地址、账号），库名/DSN 换成分片名
+bool ShardRouter::open(const QSqlDatabase &home)
+{
+    bool ok = true;
+    for (int i = 0; i < shardCount(); ++i) {
+        Shard &shard = *m_shards[size_t(i)];
+        shard.connectionName = QString("%1_shard%2").arg(home.connectionName()).arg(i);
+        QSqlDatabase db = QSqlDatabase::contains(shard.connectionName)
+                              ? QSqlDatabase::database(shard.connectionName, false)
+                              : QSqlDatabase::cloneDatabase(home, shard.connectionName);
+        db.setDatabaseName(shard.name);
+        if (!db.isOpen() && !db.open()) {
+            FLOG_ERROR("db") << "[DB] 分片" << shard.name << "连接失败：" << db.lastError().text();
+            ok = false;
+            continue;
+        }
+        ok = ensureSchema(home, db) && ok;
+    }
+
+    // 主库用户目录：分配全局 Uid，保证用户名/邮箱全局唯一，登录时按用户名找到 Uid
+    QSqlQuery query(home);
+    bool schema = query.exec(R"(
+        CREATE TABLE IF NOT EXISTS user_directory (
+            Uid INT NOT NULL AUTO_INCREMENT PRIMARY KEY,
+            User_name VARCHAR(255) NOT NULL,
+            Email VARCHAR(255) NOT NULL,
+            create_time TIMESTAMP NOT NULL DEFAULT CURRENT_TIMESTAMP,
+            UNIQUE KEY uk_user_name (User_name),
+            UNIQUE KEY uk_email (Email)
+        ) ENGINE = InnoDB
+    )");
+    // 座位变更意图：余票（主库）与订单（分片）不在同一个事务里，变更前登记、完成后删除，
+    // 进程中途退出留下的意图由 DBManager::reconcileSeatIntents 按订单是否存在补做或撤销；
+    // kind 0/1 为未决的占座/释放意图，2/3 为对账留下的裁决（已释放座位/保留座位），供迟到的写入方读取
+    schema = schema && query.exec(R"(
+        CREATE TABLE IF NOT EXISTS seat_intents (
+            order_id VARCHAR(32) NOT NULL PRIMARY KEY,
+            flight_id VARCHAR(64) NOT NULL,
+            shard INT NOT NULL,
+            kind TINYINT NOT NULL,
+            create_time TIMESTAMP NOT NULL DEFAULT CURRENT_TIMESTAMP,
+            KEY idx_create_time (create_time)
+        ) ENGINE = InnoDB
+    )");
+    if (!schema)
+        FLOG_ERROR("db") << "[DB] 创建用户目录/座位意图表失败：" << query.lastError().text();
+    FLOG_INFO("db") << "[DB] 分片" << shardCount() << "个，每个分片虚拟节点" << m_virtualNodes << "个";
+    return ok && schema;
+}
+
+// 主库 user_info 中仍有用户：这些用户的数据尚未迁移到分片（迁移需离线把用户及其订单、收藏、点赞/喜欢
+// 移到所属分片并登记用户目录），此时不能启用分片，否则这些用户按 Uid 路由到分片后无法访问
+bool ShardRouter::homeHasUsers(const QSqlDatabase &home)
+{
+    QSqlQuery query(home);
+    if (!query.exec("SELECT 1 FROM user_info LIMIT 1")) {
+        FLOG_ERROR("db") << "[DB] 检查主库用户失败：" << query.lastError().text();
+        return true;
+    }
+    return query.next();
+}
+
+// 分片库中缺少的表按主库同名表结构创建（CREATE TABLE ... LIKE，不复制外键）
+bool ShardRouter::ensureSchema(const QSqlDatabase &home, QSqlDatabase &shard)
+{
+    QSqlQuery homeQuery(home);
+    if (!homeQuery.exec("SELECT DATABASE()") || !homeQuery.next())
+        return false;
+    const QString homeName = homeQuery.value(0).toString();
+    QSqlQuery query(shard);
+    for (const char *table : kShardTables) {
+        if (!query.exec(QString("CREATE TABLE IF NOT EXISTS `%1` LIKE `%2`.`%1`").arg(table, homeName))) {
+            FLOG_ERROR("db") << "[DB] 分片建表失败：" << table << query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+void ShardRouter::close()
+{
+    for (const auto &shard : m_shards) {
+        for (std::unique_ptr<QSqlQuery> &slot : shard->statements)
+            slot.reset();
+        if (!shard->connectionName.isEmpty() && QSqlDatabase::contains(shard->connectionName))
+            QSqlDatabase::database(shard->connectionName, false).close();
+    }
+    m_failedStatement.reset();
+}
+
+QSqlDatabase ShardRouter::database(int shard) const
+{
+    return QSqlDatabase::database(m_shards[size_t(shard)]->connectionName, false);
+}
+
+QSqlQuery &ShardRouter::statement(int shard, Sql::Id id)
+{
+    std::unique_ptr<QSqlQuery> &slot = m_shards[size_t(shard)]->statements[std::size_t(id)];
+    if (slot) {
+        slot->finish(); // 释放上一次的结果集
+        return *slot;
+    }
+    const Sql::Entry &entry = Sql::kStatements[std::size_t(id)];
+    slot.reset(new QSqlQuery(database(shard)));
+    if (!slot->prepare(entry.sql)) {
+        FLOG_ERROR("db") << "[DB] 分片预处理失败：" << entry.name << slot->lastError().text();
+        QSqlQuery &failed = *slot;
+        m_failedStatement = std::move(slot); // 保留到下次调用，供调用方读取错误信息
+        return failed;
+    }
+    return *slot;
+}
+
+void ShardRouter::recordScatter() const
+{
+    QMutexLocker locker(&m_statsLock);
+    ++m_scatters;
+}
+
+// 小顶堆保存各分片当前最靠前的一行，每次弹出全局最靠前的一行；前 offset 行只计数不保留
+QVariantList ShardRouter::mergeSorted(const QList<QVariantList> &parts,
+                                      const std::function<bool(const QVariant &, const QVariant &)> &before,
+                                      int offset,
+                                      int limit)
+{
+    QVariantList result;
+    if (limit == 0)
+        return result;
+
+    using Cursor = std::pair<int, int>; // (分片序号, 行号)
+    auto later = [&](const Cursor &a, const Cursor &b) {
+        const QVariant &x = parts[a.first][a.second];
+        const QVariant &y = parts[b.first][b.second];
+        if (before(y, x))
+            return true;
+        if (before(x, y))
+            return false;
+        return a.first > b.first; // 相等时按分片序号，结果稳定
+    };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(later)> heap(later);
+    for (int i = 0; i < parts.size(); ++i) {
+        if (!parts[i].isEmpty())
+            heap.push({i, 0});
+    }
+
+    int skipped = 0;
+    while (!heap.empty()) {
+        const Cursor cursor = heap.top();
+        heap.pop();
+        if (skipped < offset) {
+            ++skipped;
+        } else {
+            result.append(parts[cursor.first][cursor.second]);
+            if (limit > 0 && result.size() >= limit)
+                break;
+        }
+        if (cursor.second + 1 < parts[cursor.first].size())
+            heap.push({cursor.first, cursor.second + 1});
+    }
+    return result;
+}
+
+QVariantMap ShardRouter::stats() const
+{
+    QMutexLocker locker(&m_statsLock);
+    QVariantMap map;
+    map["enabled"] = isEnabled();
+    map["virtual_nodes"] = m_virtualNodes;
+    map["scatters"] = m_scatters;
+    QVariantList shards;
+    for (const auto &shard : m_shards) {
+        QVariantMap entry;
+        entry["name"] = shard->name;
+        entry["routed"] = shard->routed;
+        entry["open"] = !shard->connectionName.isEmpty()
+                        && QSqlDatabase::database(shard->connectionName, false).isOpen();
+        shards.append(entry);
+    }
+    map["shards"] = shards;
+    return map;
+}
@@ -0,0 +1,78 @@
+#ifndef SHARDROUTER_H
+#define SHARDROUTER_H
+
+#include <QMutex>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+#include <QStringList>
+#include <QVariantList>
+#include <QVariantMap>
+#include <array>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "SqlStatements.h"
+
+// 按用户水平分片：user_info、订单、航班收藏、帖子点赞/喜欢按用户 Id 落到某个分片库，
+// 航班、帖子、管理员、图片分块等全局表以及用户目录（user_directory）留在主库
+//
+// 一致性哈希：每个分片在哈希环上放 virtualNodes 个虚拟节点，用户 Id 顺时针遇到的第一个虚拟节点即所属分片；
+// 增加一个分片只有约 1/N 的用户改变归属，虚拟节点使各分片分到的用户数接近均匀
+// 分片连接复制主连接的驱动和账号，只替换库名（QMYSQL）或 DSN（QODBC），因此可用同一服务器上的多个库测试
+// 只有主库 user_info 已为空（已有用户全部迁移到分片）时才启用分片，见 homeHasUsers
+class ShardRouter
+{
+public:
+    explicit ShardRouter(int virtualNodes = 128);
+    ~ShardRouter();
+
+    void configure(const QStringList &shards); // 设置分片（库名或 DSN 列表），为空表示不分片
+    bool isEnabled() const { return !m_shards.empty(); }
+    int shardCount() const { return int(m_shards.size()); }
+    int shardOf(int userId) const; // 用户所属分片
+
+    bool open(const QSqlDatabase &home); // 主库连接后打开各分片连接，补建分片表、主库用户目录和座位意图表
+    static bool homeHasUsers(const QSqlDatabase &home); // 主库是否仍有未迁移的用户（查询失败也视为有）
+    void close();
+    QSqlDatabase database(int shard) const;
+    QSqlQuery &statement(int shard, Sql::Id id); // 分片上的登记语句（第一次使用时预处理）
+    template<Sql::Id ID, typename... Args>
+    QSqlQuery &bound(int shard, Args &&...args)
+    {
+        QSqlQuery &query = statement(shard, ID);
+        Sql::bind<ID>(query, std::forward<Args>(args)...);
+        return query;
+    }
+    void recordScatter() const; // 统计一次扫全部分片的查询
+
+    // 多路归并：各分片结果已按 before 排好序，合并后跳过 offset 条，最多取 limit 条（limit < 0 不限）
+    static QVariantList mergeSorted(const QList<QVariantList> &parts,
+                                    const std::function<bool(const QVariant &, const QVariant &)> &before,
+                                    int offset,
+                                    int limit);
+
+    QVariantMap stats() const;
+
+private:
+    struct Shard
+    {
+        QString name;           // 库名或 DSN
+        QString connectionName; // QSqlDatabase 连接名
+        std::array<std::unique_ptr<QSqlQuery>, std::size_t(Sql::Id::Count)> statements;
+        quint64 routed = 0;     // 路由到该分片的次数
+    };
+
+    static quint32 hash(const QByteArray &key);
+    bool ensureSchema(const QSqlDatabase &home, QSqlDatabase &shard);
+
+    int m_virtualNodes;
+    std::vector<std::unique_ptr<Shard>> m_shards;
+    std::vector<std::pair<quint32, int>> m_ring; // (虚拟节点哈希, 分片序号)，按哈希升序
+    std::unique_ptr<QSqlQuery> m_failedStatement; // 最近一次预处理失败的语句（保留错误信息）
+    mutable QMutex m_statsLock;
+    mutable quint64 m_scatters;
+};
+
+#endif // SHARDROUTER_H
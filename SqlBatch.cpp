@@ -0,0 +1,64 @@
+#include "SqlBatch.h"
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStringList>
+
+// n 行 m 列的元组列表
+QString SqlBatch::placeholders(int rows, int columns)
+{
+    QStringList marks;
+    for (int c = 0; c < columns; ++c)
+        marks.append("?");
+    const QString tuple = "(" + marks.join(", ") + ")";
+    QStringList tuples;
+    for (int r = 0; r < rows; ++r)
+        tuples.append(tuple);
+    return tuples.join(", ");
+}
+
+// 按列参数改写为多行语句执行
+bool SqlBatch::exec(QSqlDatabase &db,
+                    const QString &prefix,
+                    const QList<QVariantList> &columns,
+                    const QString &suffix,
+                    int maxRows,
+                    QString *error)
+{
+    if (columns.isEmpty() || columns.first().isEmpty())
+        return true;
+    const int columnCount = columns.size();
+    const int rowCount = columns.first().size();
+    for (const QVariantList &column : columns) {
+        if (column.size() != rowCount) {
+            if (error)
+                *error = "各列参数个数不一致";
+            return false;
+        }
+    }
+    maxRows = qBound(1, maxRows, kMaxParameters / columnCount);
+
+    // 满行语句复用同一个预处理句柄，最后不足一批的单独预处理
+    QSqlQuery full(db);
+    QSqlQuery tail(db);
+    for (int offset = 0; offset < rowCount; offset += maxRows) {
+        const int rows = qMin(maxRows, rowCount - offset);
+        QSqlQuery &query = (rows == maxRows) ? full : tail;
+        if (query.lastQuery().isEmpty() // 尚未预处理
+            && !query.prepare(prefix + placeholders(rows, columnCount) + suffix)) {
+            if (error)
+                *error = query.lastError().text();
+            return false;
+        }
+        int index = 0;
+        for (int r = offset; r < offset + rows; ++r) {
+            for (int c = 0; c < columnCount; ++c)
+                query.bindValue(index++, columns.at(c).at(r));
+        }
+        if (!query.exec()) {
+            if (error)
+                *error = query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,34 @@
+#ifndef SQLBATCH_H
+#define SQLBATCH_H
+
+#include <QList>
+#include <QSqlDatabase>
+#include <QString>
+#include <QVariantList>
+
+// 多行批量执行：QSqlQuery::execBatch 在 QODBC / QMYSQL 驱动里都是逐行执行（每行一次往返），
+// 这里把按列组织的参数（与 execBatch 相同）改写成 VALUES (?, ?), (?, ?) ... 形式的多行语句，
+// 每条语句最多 maxRows 行；满行的语句只预处理一次，原生驱动下走服务端二进制协议重复执行
+//
+// prefix / suffix 夹住行元组列表，例如：
+//   "INSERT INTO t (a, b) VALUES " + 元组 + ""
+//   "DELETE FROM t WHERE (a, b) IN (" + 元组 + ")"
+class SqlBatch
+{
+public:
+    static constexpr int kDefaultRows = 500;      // 默认每条语句行数
+    static constexpr int kMaxParameters = 65535;  // MySQL 单条预处理语句的占位符上限
+
+    // columns 为列数组，每列长度相同；出错时返回 false 并写入 error（不负责事务）
+    static bool exec(QSqlDatabase &db,
+                     const QString &prefix,
+                     const QList<QVariantList> &columns,
+                     const QString &suffix = QString(),
+                     int maxRows = kDefaultRows,
+                     QString *error = nullptr);
+
+    // n 行 m 列的元组列表："(?, ?), (?, ?)"
+    static QString placeholders(int rows, int columns);
+};
+
+#endif // SQLBATCH_H
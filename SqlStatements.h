@@ -0,0 +1,259 @@
+#ifndef SQLSTATEMENTS_H
+#define SQLSTATEMENTS_H
+
+#include <QSqlQuery>
+#include <QString>
+#include <QVariant>
+#include <cstddef>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// SQL 语句登记表：每条语句有编号、SQL 文本和参数类型（写成函数类型 void(参数...)），
+// 编译期检查占位符个数与参数个数一致，绑定时检查实参个数和类型；
+// 连接建立后按表逐条预处理，第一次点击不再付出 prepare 的往返
+//
+// 新增语句只需在下表加一行；SQL 只使用 ? 占位符。DBManager 中固定文本的语句都在这里登记，
+// 只有 IN 列表长度随参数变化的语句（批量取航班、头像图集、点赞批量写入）在调用处拼接
+//
+// 组合查询条件不用 (? = '' OR col = ?)：这种写法让优化器无法使用索引，
+// 每种条件组合单独登记一条语句，调用方按非空条件选择；日期条件写成 depart_time 的范围，可走索引
+#define FLIGHT_SQL_FLIGHT_COLUMNS \
+    "Flight_id, Departure, Destination, depart_time, arrive_time, status, price, total_seats, remain_seats"
+#define FLIGHT_SQL_DAY_RANGE(column) column " >= ? AND " column " < DATE_ADD(?, INTERVAL 1 DAY)"
+#define FLIGHT_SQL_SEARCH(where) \
+    "SELECT " FLIGHT_SQL_FLIGHT_COLUMNS " FROM flight" where " ORDER BY depart_time ASC"
+#define FLIGHT_SQL_COLLECTED(where) \
+    "SELECT f.* FROM flight f INNER JOIN user_collect_flights ucf ON f.Flight_id = ucf.flight_id " \
+    "WHERE ucf.user_id = ?" where " ORDER BY ucf.create_time DESC"
+#define FLIGHT_SQL_STATEMENTS(X) \
+    X(AllFlights, void(), "SELECT " FLIGHT_SQL_FLIGHT_COLUMNS " FROM flight ORDER BY depart_time DESC") \
+    X(FlightById, void(QString), "SELECT " FLIGHT_SQL_FLIGHT_COLUMNS " FROM flight WHERE Flight_id = ?") \
+    X(FlightSearch, void(), FLIGHT_SQL_SEARCH("")) \
+    X(FlightSearchDep, void(QString), FLIGHT_SQL_SEARCH(" WHERE Departure = ?")) \
+    X(FlightSearchDest, void(QString), FLIGHT_SQL_SEARCH(" WHERE Destination = ?")) \
+    X(FlightSearchRoute, void(QString, QString), FLIGHT_SQL_SEARCH(" WHERE Departure = ? AND Destination = ?")) \
+    X(FlightSearchDate, void(QString, QString), FLIGHT_SQL_SEARCH(" WHERE " FLIGHT_SQL_DAY_RANGE("depart_time"))) \
+    X(FlightSearchDepDate, void(QString, QString, QString), \
+      FLIGHT_SQL_SEARCH(" WHERE Departure = ? AND " FLIGHT_SQL_DAY_RANGE("depart_time"))) \
+    X(FlightSearchDestDate, void(QString, QString, QString), \
+      FLIGHT_SQL_SEARCH(" WHERE Destination = ? AND " FLIGHT_SQL_DAY_RANGE("depart_time"))) \
+    X(FlightSearchRouteDate, void(QString, QString, QString, QString), \
+      FLIGHT_SQL_SEARCH(" WHERE Departure = ? AND Destination = ? AND " FLIGHT_SQL_DAY_RANGE("depart_time"))) \
+    X(FlightExists, void(QString), "SELECT 1 FROM flight WHERE Flight_id = ? LIMIT 1") \
+    X(FlightTotalSeats, void(QString), "SELECT total_seats FROM flight WHERE Flight_id = ?") \
+    X(FlightForUpdate, void(QString), \
+      "SELECT price, remain_seats, status FROM flight WHERE Flight_id = ? FOR UPDATE") \
+    X(InsertFlight, void(QString, QString, QString, QString, QString, double, int, int), \
+      "INSERT INTO flight (Flight_id, Departure, Destination, depart_time, arrive_time, price, total_seats, " \
+      "remain_seats) VALUES (?, ?, ?, ?, ?, ?, ?, ?)") \
+    X(UpdateFlightPrice, void(double, QString), "UPDATE flight SET price = ? WHERE Flight_id = ?") \
+    X(UpdateFlightSeats, void(int, QString), "UPDATE flight SET remain_seats = ? WHERE Flight_id = ?") \
+    X(UpdateFlightStatus, void(int, QString), "UPDATE flight SET status = ? WHERE Flight_id = ?") \
+    X(DeleteFlight, void(QString), "DELETE FROM flight WHERE Flight_id = ?") \
+    X(CollectedFlights, void(int), FLIGHT_SQL_COLLECTED("")) \
+    X(CollectedFlightById, void(int, QString), FLIGHT_SQL_COLLECTED(" AND ucf.flight_id = ?")) \
+    X(CollectedFlightsDep, void(int, QString), FLIGHT_SQL_COLLECTED(" AND f.Departure = ?")) \
+    X(CollectedFlightsDest, void(int, QString), FLIGHT_SQL_COLLECTED(" AND f.Destination = ?")) \
+    X(CollectedFlightsRoute, void(int, QString, QString), \
+      FLIGHT_SQL_COLLECTED(" AND f.Departure = ? AND f.Destination = ?")) \
+    X(CollectedFlightsDate, void(int, QString, QString), \
+      FLIGHT_SQL_COLLECTED(" AND " FLIGHT_SQL_DAY_RANGE("f.depart_time"))) \
+    X(CollectedFlightsDepDate, void(int, QString, QString, QString), \
+      FLIGHT_SQL_COLLECTED(" AND f.Departure = ? AND " FLIGHT_SQL_DAY_RANGE("f.depart_time"))) \
+    X(CollectedFlightsDestDate, void(int, QString, QString, QString), \
+      FLIGHT_SQL_COLLECTED(" AND f.Destination = ? AND " FLIGHT_SQL_DAY_RANGE("f.depart_time"))) \
+    X(CollectedFlightsRouteDate, void(int, QString, QString, QString, QString), \
+      FLIGHT_SQL_COLLECTED(" AND f.Departure = ? AND f.Destination = ? AND " FLIGHT_SQL_DAY_RANGE("f.depart_time"))) \
+    X(ShardCollectedIds, void(int), \
+      "SELECT flight_id FROM user_collect_flights WHERE user_id = ? ORDER BY create_time DESC") \
+    X(ShardCollectedId, void(int, QString), \
+      "SELECT flight_id FROM user_collect_flights WHERE user_id = ? AND flight_id = ? ORDER BY create_time DESC") \
+    X(FlightCollected, void(int, QString), \
+      "SELECT 1 FROM user_collect_flights WHERE user_id = ? AND flight_id = ? LIMIT 1") \
+    X(CollectFlight, void(int, QString), "INSERT INTO user_collect_flights (user_id, flight_id) VALUES (?, ?)") \
+    X(UncollectFlight, void(int, QString), "DELETE FROM user_collect_flights WHERE user_id = ? AND flight_id = ?") \
+    X(MyOrders, void(int), \
+      "SELECT o.order_id, o.flight_id, o.passenger_name, o.passenger_idcard, o.order_time, o.status AS o_status, " \
+      "f.Departure, f.Destination, f.depart_time, f.arrive_time, f.status AS f_status, f.price, f.remain_seats " \
+      "FROM `order` o INNER JOIN flight f ON o.flight_id = f.Flight_id WHERE o.user_id = ? " \
+      "ORDER BY o.order_time DESC") \
+    X(AllOrdersPage, void(int, int), \
+      "SELECT o.order_id, o.flight_id, o.passenger_name, o.passenger_idcard, o.order_time, o.status AS o_status, " \
+      "f.Departure, f.Destination, f.depart_time, f.arrive_time, f.status AS f_status, f.price, f.remain_seats " \
+      "FROM `order` o INNER JOIN flight f ON o.flight_id = f.Flight_id " \
+      "ORDER BY o.order_time DESC, o.order_id DESC LIMIT ? OFFSET ?") \
+    X(ShardOrders, void(int), \
+      "SELECT order_id, flight_id, passenger_name, passenger_idcard, order_time, status AS o_status " \
+      "FROM `order` WHERE user_id = ? ORDER BY order_time DESC") \
+    X(ShardOrdersTop, void(int), \
+      "SELECT order_id, flight_id, passenger_name, passenger_idcard, order_time, status AS o_status " \
+      "FROM `order` ORDER BY order_time DESC, order_id DESC LIMIT ?") \
+    X(UserByName, void(QString), "SELECT Uid, Email, Password, phone, idcard FROM user_info WHERE User_name = ?") \
+    X(UserNameTaken, void(QString), "SELECT 1 FROM user_info WHERE User_name = ? LIMIT 1") \
+    X(UserEmailTaken, void(QString), "SELECT 1 FROM user_info WHERE Email = ? LIMIT 1") \
+    X(UserExists, void(int), "SELECT 1 FROM user_info WHERE Uid = ? LIMIT 1") \
+    X(UserSummary, void(int), "SELECT Uid, User_name, Email FROM user_info WHERE Uid = ?") \
+    X(UserNameByEmail, void(QString), "SELECT User_name FROM user_info WHERE Email = ?") \
+    X(AllUsers, void(), \
+      "SELECT Uid, User_name, phone, Email, idcard, create_time FROM user_info ORDER BY create_time DESC") \
+    X(InsertUser, void(QString, QString, QString), \
+      "INSERT INTO user_info (Email, User_name, Password) VALUES (?, ?, ?)") \
+    X(InsertUserWithUid, void(int, QString, QString, QString), \
+      "INSERT INTO user_info (Uid, Email, User_name, Password) VALUES (?, ?, ?, ?)") \
+    X(UpdatePasswordByEmail, void(QString, QString), "UPDATE user_info SET Password = ? WHERE Email = ?") \
+    X(UpdateUserName, void(QString, int), "UPDATE user_info SET User_name = ? WHERE Uid = ?") \
+    X(UpdateUserEmail, void(QString, int), "UPDATE user_info SET Email = ? WHERE Uid = ?") \
+    X(UpdateUserPhone, void(QString, int), "UPDATE user_info SET phone = ? WHERE Uid = ?") \
+    X(UpdateUserIdCard, void(QString, int), "UPDATE user_info SET idcard = ? WHERE Uid = ?") \
+    X(UserAvatar, void(int), "SELECT avatar_blob, avatar_format FROM user_info WHERE Uid = ?") \
+    X(UserAvatarBlob, void(int), "SELECT avatar_blob FROM user_info WHERE Uid = ?") \
+    X(UserAvatarFormat, void(int), "SELECT avatar_format FROM user_info WHERE Uid = ?") \
+    X(SetAvatarFormat, void(QString, int), \
+      "UPDATE user_info SET avatar_blob = NULL, avatar_format = ? WHERE Uid = ?") \
+    X(ClearAvatar, void(int), "UPDATE user_info SET avatar_blob = NULL, avatar_format = NULL WHERE Uid = ?") \
+    X(DeleteUserCollects, void(int), "DELETE FROM user_collect_flights WHERE user_id = ?") \
+    X(DeleteUserBlobChunks, void(int, int), \
+      "DELETE FROM blob_chunks WHERE (owner_kind = 'post' AND owner_id IN (SELECT id FROM posts WHERE user_id = ?)) " \
+      "OR (owner_kind = 'avatar' AND owner_id = ?)") \
+    X(DeleteUserPosts, void(int), "DELETE FROM posts WHERE user_id = ?") \
+    X(DeleteUserLikes, void(int), "DELETE FROM user_post_likes WHERE user_id = ?") \
+    X(DeleteUserFavorites, void(int), "DELETE FROM user_post_favorites WHERE user_id = ?") \
+    X(DeleteUserOrders, void(int), "DELETE FROM `order` WHERE user_id = ?") \
+    X(DeleteUser, void(int), "DELETE FROM user_info WHERE Uid = ?") \
+    X(DirectoryNameTaken, void(QString), "SELECT 1 FROM user_directory WHERE User_name = ? LIMIT 1") \
+    X(DirectoryEmailTaken, void(QString), "SELECT 1 FROM user_directory WHERE Email = ? LIMIT 1") \
+    X(DirectoryUidByName, void(QString), "SELECT Uid FROM user_directory WHERE User_name = ?") \
+    X(DirectoryUidByEmail, void(QString), "SELECT Uid FROM user_directory WHERE Email = ?") \
+    X(InsertDirectory, void(QString, QString), "INSERT INTO user_directory (User_name, Email) VALUES (?, ?)") \
+    X(UpdateDirectoryName, void(QString, int), "UPDATE user_directory SET User_name = ? WHERE Uid = ?") \
+    X(UpdateDirectoryEmail, void(QString, int), "UPDATE user_directory SET Email = ? WHERE Uid = ?") \
+    X(DeleteDirectory, void(int), "DELETE FROM user_directory WHERE Uid = ?") \
+    X(AdminLogin, void(QString, QString), "SELECT Aid, Admin_name FROM admin_info WHERE Admin_name = ? AND Password = ?") \
+    X(TakeSeat, void(QString), \
+      "UPDATE flight SET remain_seats = remain_seats - 1 WHERE Flight_id = ? AND remain_seats > 0") \
+    X(InsertOrder, void(QString, int, QString, QString, QString, QString, QString), \
+      "INSERT INTO `order` (order_id, user_id, flight_id, passenger_name, passenger_idcard, request_key, request_hash) " \
+      "VALUES (?, ?, ?, ?, ?, NULLIF(?, ''), NULLIF(?, ''))") \
+    X(OrderByRequestKey, void(QString), "SELECT order_id, request_hash FROM `order` WHERE request_key = ? LIMIT 1") \
+    X(OrderFlight, void(QString), "SELECT flight_id FROM `order` WHERE order_id = ? LIMIT 1") \
+    X(DeleteOrder, void(QString), "DELETE FROM `order` WHERE order_id = ?") \
+    X(DeleteFlightOrders, void(QString), "DELETE FROM `order` WHERE flight_id = ?") \
+    X(DeleteFlightCollects, void(QString), "DELETE FROM user_collect_flights WHERE flight_id = ?") \
+    X(ReleaseSeat, void(QString), \
+      "UPDATE flight SET remain_seats = remain_seats + 1 WHERE Flight_id = ? AND remain_seats < total_seats") \
+    X(InsertSeatIntent, void(QString, QString, int, int), \
+      "INSERT INTO seat_intents (order_id, flight_id, shard, kind) VALUES (?, ?, ?, ?)") \
+    X(DeleteSeatIntent, void(QString), "DELETE FROM seat_intents WHERE order_id = ? AND kind < 2") \
+    X(ResolveSeatIntent, void(int, QString, int), "UPDATE seat_intents SET kind = ? WHERE order_id = ? AND kind = ?") \
+    X(SeatIntentKind, void(QString), "SELECT kind FROM seat_intents WHERE order_id = ?") \
+    X(ForgetSeatIntent, void(QString), "DELETE FROM seat_intents WHERE order_id = ?") \
+    X(PurgeSeatIntents, void(int), "DELETE FROM seat_intents WHERE kind >= 2 AND create_time < NOW() - INTERVAL ? SECOND") \
+    X(StaleSeatIntents, void(int), \
+      "SELECT order_id, flight_id, shard, kind, TIMESTAMPDIFF(SECOND, create_time, NOW()) AS age " \
+      "FROM seat_intents WHERE kind < 2 AND create_time < NOW() - INTERVAL ? SECOND LIMIT 200") \
+    X(InsertPost, void(QString, QString, int, QString), \
+      "INSERT INTO posts (title, content, user_id, img_blob, img_format) VALUES (?, ?, ?, NULL, ?)") \
+    X(LastInsertId, void(), "SELECT LAST_INSERT_ID()") \
+    X(LatestPostId, void(), "SELECT MAX(id) AS latest_id FROM posts") \
+    X(PostDetail, void(int), \
+      "SELECT id, title, content, create_time, img_blob, img_format FROM posts WHERE id = ? AND status = 'normal'") \
+    X(PostDetailNoImage, void(int), \
+      "SELECT id, title, content, create_time, img_format FROM posts WHERE id = ? AND status = 'normal'") \
+    X(PostLiked, void(int, int), "SELECT 1 FROM user_post_likes WHERE user_id = ? AND post_id = ? LIMIT 1") \
+    X(PostFavorited, void(int, int), "SELECT 1 FROM user_post_favorites WHERE user_id = ? AND post_id = ? LIMIT 1") \
+    X(BookSeat, void(QString, int, QString, QString, QString, QString, QString), \
+      "CALL sp_book_seat(?, ?, ?, ?, ?, ?, ?, @sp_book_seat_error)")
+
+namespace Sql {
+
+// 语句编号
+enum class Id {
+#define FLIGHT_SQL_ID(name, signature, text) name,
+    FLIGHT_SQL_STATEMENTS(FLIGHT_SQL_ID)
+#undef FLIGHT_SQL_ID
+        Count
+};
+
+// 统计 ? 占位符个数（忽略单引号字符串中的 ?）
+constexpr int countPlaceholders(const char *sql)
+{
+    int count = 0;
+    bool quoted = false;
+    for (const char *p = sql; *p; ++p) {
+        if (*p == '\'')
+            quoted = !quoted;
+        else if (*p == '?' && !quoted)
+            ++count;
+    }
+    return count;
+}
+
+// 从 void(参数...) 取出参数类型
+template<typename Signature>
+struct SignatureTraits;
+
+template<typename... Params>
+struct SignatureTraits<void(Params...)>
+{
+    using Tuple = std::tuple<Params...>;
+    static constexpr int count = int(sizeof...(Params));
+};
+
+// 每条语句的编译期信息
+template<Id>
+struct Statement;
+
+#define FLIGHT_SQL_TRAITS(name, signature, text) \
+    template<> \
+    struct Statement<Id::name> \
+    { \
+        static constexpr const char *sql = text; \
+        using Params = SignatureTraits<signature>::Tuple; \
+        static constexpr int paramCount = SignatureTraits<signature>::count; \
+        static_assert(countPlaceholders(text) == paramCount, "SQL 占位符个数与参数类型不符：" #name); \
+    };
+FLIGHT_SQL_STATEMENTS(FLIGHT_SQL_TRAITS)
+#undef FLIGHT_SQL_TRAITS
+
+// 运行期遍历用（预处理、监控）
+struct Entry
+{
+    Id id;
+    const char *name;
+    const char *sql;
+    int paramCount;
+};
+
+inline constexpr Entry kStatements[] = {
+#define FLIGHT_SQL_ENTRY(name, signature, text) {Id::name, #name, text, SignatureTraits<signature>::count},
+    FLIGHT_SQL_STATEMENTS(FLIGHT_SQL_ENTRY)
+#undef FLIGHT_SQL_ENTRY
+};
+static_assert(std::size(kStatements) == std::size_t(Id::Count), "语句表与编号不一致");
+
+namespace detail {
+
+template<typename Params, typename... Args, std::size_t... I>
+void bindAll(QSqlQuery &query, std::index_sequence<I...>, Args &&...args)
+{
+    static_assert((std::is_convertible_v<Args, std::tuple_element_t<I, Params>> && ...),
+                  "绑定的实参类型与登记的参数类型不符");
+    (query.bindValue(int(I), QVariant::fromValue(std::tuple_element_t<I, Params>(std::forward<Args>(args)))), ...);
+}
+
+} // namespace detail
+
+// 按登记的参数类型依次绑定（个数或类型不符时编译失败）
+template<Id ID, typename... Args>
+void bind(QSqlQuery &query, Args &&...args)
+{
+    using Params = typename Statement<ID>::Params;
+    static_assert(int(sizeof...(Args)) == Statement<ID>::paramCount, "绑定的实参个数与登记的参数个数不符");
+    detail::bindAll<Params>(query, std::index_sequence_for<Args...>{}, std::forward<Args>(args)...);
+}
+
+} // namespace Sql
+
+#endif // SQLSTATEMENTS_H
@@ -0,0 +1,492 @@
+#include "WorkloadTrace.h"
+#include "AsyncLogger.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMetaMethod>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+
+std::atomic<bool> WorkloadTrace::s_recording{false};
+std::atomic<qint64> WorkloadTrace::s_originUs{0};
+const char *WorkloadTrace::kReplayPassword = "Replay0000"; // 满足密码强度校验
+
+namespace {
+
+constexpr char kMagic[4] = {'F', 'L', 'T', 'R'};
+constexpr int kLongTextChars = 64; // 超过该长度的普通字符串换成等长填充
+
+enum RecordType : quint8 { MethodDef = 1, CallRecord = 2 };
+enum ValueTag : quint8 { Null = 0, Bool, Int, Double, String, Bytes, List, Map };
+
+// 嵌套调用深度（只记录最外层）
+thread_local int t_depth = 0;
+
+// 当前线程的会话号（-1 表示尚未分配）
+thread_local int t_session = -1;
+std::atomic<int> s_nextSession{0};
+
+void writeVarint(QByteArray &out, quint64 value)
+{
+    do {
+        quint8 byte = value & 0x7f;
+        value >>= 7;
+        if (value)
+            byte |= 0x80;
+        out.append(char(byte));
+    } while (value);
+}
+
+void writeString(QByteArray &out, const QString &text)
+{
+    const QByteArray utf8 = text.toUtf8();
+    writeVarint(out, quint64(utf8.size()));
+    out.append(utf8);
+}
+
+void writeValue(QByteArray &out, const QVariant &value)
+{
+    switch (value.typeId()) {
+    case QMetaType::UnknownType:
+        out.append(char(Null));
+        break;
+    case QMetaType::Bool:
+        out.append(char(Bool));
+        out.append(char(value.toBool() ? 1 : 0));
+        break;
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong: {
+        const qint64 n = value.toLongLong();
+        out.append(char(Int));
+        writeVarint(out, (quint64(n) << 1) ^ quint64(n >> 63)); // zigzag
+        break;
+    }
+    case QMetaType::Double:
+    case QMetaType::Float: {
+        out.append(char(Double));
+        const double d = value.toDouble();
+        quint64 bits;
+        memcpy(&bits, &d, sizeof bits);
+        for (int i = 0; i < 8; ++i)
+            out.append(char((bits >> (8 * i)) & 0xff));
+        break;
+    }
+    case QMetaType::QByteArray:
+        out.append(char(Bytes));
+        writeVarint(out, quint64(value.toByteArray().size()));
+        break;
+    case QMetaType::QVariantList:
+    case QMetaType::QStringList: {
+        const QVariantList list = value.toList();
+        out.append(char(List));
+        writeVarint(out, quint64(list.size()));
+        for (const QVariant &item : list)
+            writeValue(out, item);
+        break;
+    }
+    case QMetaType::QVariantMap: {
+        const QVariantMap map = value.toMap();
+        out.append(char(Map));
+        writeVarint(out, quint64(map.size()));
+        for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+            writeString(out, it.key());
+            writeValue(out, it.value());
+        }
+        break;
+    }
+    default:
+        out.append(char(String));
+        writeString(out, value.toString());
+        break;
+    }
+}
+
+// 按顺序解码
+class Reader
+{
+public:
+    explicit Reader(const QByteArray &data)
+        : m_data(data)
+    {}
+
+    bool atEnd() const { return m_pos >= m_data.size(); }
+    bool failed() const { return m_failed; }
+
+    quint8 byte()
+    {
+        if (m_pos >= m_data.size()) {
+            m_failed = true;
+            return 0;
+        }
+        return quint8(m_data.at(m_pos++));
+    }
+
+    quint64 varint()
+    {
+        quint64 value = 0;
+        for (int shift = 0; shift < 64 && !m_failed; shift += 7) {
+            const quint8 b = byte();
+            value |= quint64(b & 0x7f) << shift;
+            if (!(b & 0x80))
+                return value;
+        }
+        m_failed = true;
+        return 0;
+    }
+
+    QString string()
+    {
+        const quint64 size = varint();
+        if (m_failed || size > quint64(m_data.size() - m_pos)) {
+            m_failed = true;
+            return QString();
+        }
+        const QString text = QString::fromUtf8(m_data.constData() + m_pos, qsizetype(size));
+        m_pos += qsizetype(size);
+        return text;
+    }
+
+    QVariant value(int depth = 0)
+    {
+        if (depth > 16) {
+            m_failed = true;
+            return QVariant();
+        }
+        switch (byte()) {
+        case Null:
+            return QVariant();
+        case Bool:
+            return QVariant(byte() != 0);
+        case Int: {
+            const quint64 z = varint();
+            const qint64 n = qint64(z >> 1) ^ -qint64(z & 1);
+            if (n >= std::numeric_limits<int>::min() && n <= std::numeric_limits<int>::max())
+                return QVariant(int(n));
+            return QVariant(n);
+        }
+        case Double: {
+            quint64 bits = 0;
+            for (int i = 0; i < 8; ++i)
+                bits |= quint64(byte()) << (8 * i);
+            double d;
+            memcpy(&d, &bits, sizeof d);
+            return QVariant(d);
+        }
+        case String:
+            return QVariant(string());
+        case Bytes:
+            return QVariant(QByteArray(qsizetype(qMin<quint64>(varint(), 64 * 1024 * 1024)), '\0'));
+        case List: {
+            QVariantList list;
+            for (quint64 n = varint(); n > 0 && !m_failed; --n)
+                list.append(value(depth + 1));
+            return list;
+        }
+        case Map: {
+            QVariantMap map;
+            for (quint64 n = varint(); n > 0 && !m_failed; --n) {
+                const QString key = string();
+                map.insert(key, value(depth + 1));
+            }
+            return map;
+        }
+        default:
+            m_failed = true;
+            return QVariant();
+        }
+    }
+
+private:
+    const QByteArray &m_data;
+    qsizetype m_pos = 0;
+    bool m_failed = false;
+};
+
+// 稳定假名：同一个原值得到同一个假名（保留数据分布，不泄露原值）
+QByteArray pseudonymDigest(const QString &value)
+{
+    return QCryptographicHash::hash("flight-trace:" + value.toUtf8(), QCryptographicHash::Sha1);
+}
+
+QString digits(const QByteArray &digest, int count)
+{
+    QString text;
+    for (int i = 0; text.size() < count; ++i)
+        text.append(QChar('0' + quint8(digest.at(i % digest.size())) % 10));
+    return text;
+}
+
+} // namespace
+
+// 进程内唯一实例，退出时不析构（可能仍有线程在记录）
+WorkloadTrace *WorkloadTrace::instance()
+{
+    static WorkloadTrace *trace = new WorkloadTrace();
+    return trace;
+}
+
+WorkloadTrace::WorkloadTrace()
+    : m_dropped(0)
+    , m_startEpochMs(0)
+{}
+
+// 开始录制
+bool WorkloadTrace::start(const QString &path, const QMetaObject *meta)
+{
+    if (s_recording.load() || m_writer.joinable())
+        return false;
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    m_path = path;
+    m_parameterNames.clear();
+    m_methodIds.clear();
+    for (int i = meta ? meta->methodOffset() : 0; meta && i < meta->methodCount(); ++i) {
+        const QMetaMethod method = meta->method(i);
+        QStringList names;
+        for (const QByteArray &name : method.parameterNames())
+            names.append(QString::fromLatin1(name));
+        m_parameterNames.insert(method.name() + '/' + QByteArray::number(method.parameterCount()), names);
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        FLOG_ERROR("trace") << "无法创建录制文件：" << path << file.errorString();
+        return false;
+    }
+    m_startEpochMs = QDateTime::currentMSecsSinceEpoch();
+    QByteArray header(kMagic, sizeof kMagic);
+    header.append(char(kVersion));
+    writeVarint(header, quint64(m_startEpochMs));
+    file.write(header);
+    file.close();
+
+    s_originUs.store(nowUs());
+    s_recording.store(true);
+    m_writer = std::thread([this]() { writerLoop(); });
+    FLOG_INFO("trace") << "开始录制工作负载：" << path;
+    return true;
+}
+
+// 写完队列后退出后台线程
+void WorkloadTrace::stop()
+{
+    if (!s_recording.exchange(false))
+        return;
+    m_wake.notify_one();
+    if (m_writer.joinable())
+        m_writer.join();
+    FLOG_INFO("trace") << "工作负载录制结束，丢弃" << m_dropped.load() << "条";
+}
+
+// 入队：队列满时丢弃并计数
+void WorkloadTrace::record(const char *method, qint64 startUs, qint64 latencyUs, QVariantList args)
+{
+    Record record;
+    record.method = method;
+    record.startUs = startUs;
+    record.latencyUs = latencyUs;
+    record.thread = threadIndex();
+    record.session = sessionIndex();
+    record.args = std::move(args);
+    if (!m_ring.tryPush(std::move(record)))
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+// 按参数名脱敏
+QVariant WorkloadTrace::sanitize(const QString &parameterName, const QVariant &value)
+{
+    const QString name = parameterName.toLower();
+    if (value.typeId() == QMetaType::QByteArray)
+        return value; // 编码时只写长度
+    if (value.typeId() == QMetaType::QVariantList) {
+        QVariantList list = value.toList();
+        for (QVariant &item : list)
+            item = sanitize(parameterName, item);
+        return list;
+    }
+    if (value.typeId() == QMetaType::QVariantMap) {
+        QVariantMap map = value.toMap();
+        for (auto it = map.begin(); it != map.end(); ++it)
+            it.value() = sanitize(it.key(), it.value());
+        return map;
+    }
+    if (value.typeId() != QMetaType::QString)
+        return value;
+
+    const QString text = value.toString();
+    if (text.isEmpty())
+        return value;
+    if (name.contains("password"))
+        return QString::fromLatin1(kReplayPassword); // 回放工具按该密码准备录制中登录的用户
+    if (name.contains("verifycode"))
+        return text == "0000" ? value : QVariant(QString("xxxx")); // 只保留是否为正确验证码
+    const QByteArray digest = pseudonymDigest(text);
+    if (name.contains("idcard"))
+        return digits(digest, 17) + "X";
+    if (name.contains("phone"))
+        return "1" + digits(digest, 10);
+    if (name.contains("email"))
+        return QString("u%1@example.invalid").arg(QString::fromLatin1(digest.toHex().left(10)));
+    if (name.contains("passenger") || name.contains("username") || name.contains("user_name")
+        || name.contains("adminname"))
+        return "user_" + QString::fromLatin1(digest.toHex().left(8));
+    if (name.contains("path"))
+        return "file." + QFileInfo(text).suffix().toLower();
+    if (text.size() > kLongTextChars)
+        return QString(text.size(), QChar('x'));
+    return value;
+}
+
+// 读取录制文件
+bool WorkloadTrace::read(QIODevice *device, qint64 *startEpochMs, QList<Call> *calls, QString *error)
+{
+    const QByteArray data = device->readAll();
+    if (data.size() < 5 || memcmp(data.constData(), kMagic, sizeof kMagic) != 0) {
+        *error = "不是工作负载录制文件";
+        return false;
+    }
+    const quint8 version = quint8(data.at(4));
+    if (version < 1 || version > kVersion) {
+        *error = QString("不支持的录制文件版本：%1").arg(quint8(data.at(4)));
+        return false;
+    }
+
+    Reader reader(data);
+    for (int i = 0; i < 5; ++i)
+        reader.byte();
+    *startEpochMs = qint64(reader.varint());
+
+    QHash<quint64, QString> methods;
+    while (!reader.atEnd() && !reader.failed()) {
+        const quint8 type = reader.byte();
+        if (type == MethodDef) {
+            const quint64 id = reader.varint();
+            methods.insert(id, reader.string());
+        } else if (type == CallRecord) {
+            Call call;
+            call.method = methods.value(reader.varint());
+            call.startUs = qint64(reader.varint());
+            call.latencyUs = qint64(reader.varint());
+            call.thread = int(reader.varint());
+            // 版本 1 没有会话号，整个线程视为一个会话
+            call.session = version >= 2 ? int(reader.varint()) : call.thread;
+            call.args = reader.value().toList();
+            if (!reader.failed())
+                calls->append(call);
+        } else {
+            *error = QString("未知记录类型：%1").arg(type);
+            return false;
+        }
+    }
+    // 文件末尾可能有未写完的记录（进程被强制结束），保留已读出的部分
+    if (reader.failed())
+        *error = "录制文件末尾不完整，已忽略最后一条记录";
+    std::sort(calls->begin(), calls->end(), [](const Call &a, const Call &b) { return a.startUs < b.startUs; });
+    return true;
+}
+
+void WorkloadTrace::writerLoop()
+{
+    QFile file(m_path);
+    file.open(QIODevice::Append);
+    while (s_recording.load(std::memory_order_relaxed)) {
+        if (!drainOnce(file)) {
+            std::unique_lock<std::mutex> lock(m_wakeLock);
+            m_wake.wait_for(lock, std::chrono::milliseconds(100));
+        }
+    }
+    drainOnce(file);
+    file.close();
+}
+
+// 脱敏、编码并写出当前队列中的全部记录
+bool WorkloadTrace::drainOnce(QFile &file)
+{
+    QByteArray out;
+    Record entry;
+    while (m_ring.tryPop(&entry)) {
+        const QByteArray method(entry.method);
+        auto id = m_methodIds.constFind(method);
+        if (id == m_methodIds.constEnd()) {
+            id = m_methodIds.insert(method, quint32(m_methodIds.size()));
+            out.append(char(MethodDef));
+            writeVarint(out, id.value());
+            writeString(out, QString::fromLatin1(method));
+        }
+
+        const QStringList names = m_parameterNames.value(method + '/' + QByteArray::number(entry.args.size()));
+        QVariantList args;
+        for (int i = 0; i < entry.args.size(); ++i)
+            args.append(sanitize(names.value(i), entry.args.at(i)));
+
+        out.append(char(CallRecord));
+        writeVarint(out, id.value());
+        writeVarint(out, quint64(qMax<qint64>(0, entry.startUs)));
+        writeVarint(out, quint64(qMax<qint64>(0, entry.latencyUs)));
+        writeVarint(out, quint64(entry.thread));
+        writeVarint(out, quint64(entry.session));
+        writeValue(out, args);
+    }
+    if (out.isEmpty())
+        return false;
+    if (file.isOpen())
+        file.write(out);
+    file.flush();
+    return true;
+}
+
+// 单调时钟（微秒）
+qint64 WorkloadTrace::nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// 线程序号：每个线程第一次记录时分配
+int WorkloadTrace::threadIndex()
+{
+    static std::atomic<int> next{0};
+    thread_local int index = next.fetch_add(1);
+    return index;
+}
+
+// 会话号：每个线程第一次记录时分配，登录时重新分配
+int WorkloadTrace::sessionIndex()
+{
+    if (t_session < 0)
+        t_session = s_nextSession.fetch_add(1);
+    return t_session;
+}
+
+void WorkloadTrace::beginSession()
+{
+    if (recording())
+        t_session = s_nextSession.fetch_add(1);
+}
+
+WorkloadTrace::Scope::Scope(const char *method)
+    : m_method(method)
+    , m_active(WorkloadTrace::recording() && t_depth == 0)
+    , m_startUs(0)
+{
+    ++t_depth;
+    if (m_active)
+        m_startUs = nowUs();
+}
+
+WorkloadTrace::Scope::~Scope()
+{
+    --t_depth;
+    if (!m_active || !WorkloadTrace::recording())
+        return;
+    const qint64 end = nowUs();
+    WorkloadTrace::instance()->record(m_method, m_startUs - s_originUs.load(std::memory_order_relaxed),
+                                      end - m_startUs, std::move(m_args));
+}
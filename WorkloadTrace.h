@@ -0,0 +1,126 @@
+#ifndef WORKLOADTRACE_H
+#define WORKLOADTRACE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QIODevice>
+#include <QMetaObject>
+#include <QString>
+#include <QStringList>
+#include <QVariantList>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "MpscRing.h"
+
+// 工作负载录制：记录 DBManager 每个公开调用（方法、脱敏后的参数、开始时间、耗时、线程），
+// 调用线程只把记录放入无锁环形队列，后台线程编码写入紧凑的二进制文件；未开启录制时只有一次原子读
+// tools/trace_replay 读取该文件，按原速或加速、指定并发重放并对比延迟分布
+//
+// 文件格式（小端，整数用 LEB128 变长编码）：
+//   头部  "FLTR" u8 版本 varint 录制开始时间(epoch ms)
+//   记录  u8 类型
+//         1 = 方法定义：varint 方法号, 字符串 方法名
+//         2 = 调用：varint 方法号, varint 开始时间(相对头部, us), varint 耗时(us), varint 线程号,
+//             varint 会话号（版本 2 起）, 参数列表
+//   值    u8 标签 + 内容：0 空, 1 布尔, 2 整数(zigzag), 3 双精度, 4 字符串(varint 长度 + UTF-8),
+//         5 字节数组（只记长度）, 6 列表(varint 个数 + 值), 7 映射(varint 个数 + 字符串键 + 值)
+class WorkloadTrace
+{
+public:
+    // 一次调用
+    struct Call
+    {
+        QString method;
+        qint64 startUs = 0;   // 相对录制开始
+        qint64 latencyUs = 0;
+        int thread = 0;       // 录制进程内的线程序号（从 0 开始）
+        int session = 0;      // 会话号：同一线程上一次登录到下一次登录之间的调用（回放时在同一进程内按序执行）
+        QVariantList args;    // 已脱敏
+    };
+
+    static WorkloadTrace *instance();
+
+    // 开始录制到文件；参数名取自 meta（用于按参数名脱敏），一般传 &DBManager::staticMetaObject
+    bool start(const QString &path, const QMetaObject *meta);
+    void stop(); // 写完队列中的记录后关闭文件
+
+    static bool recording() { return s_recording.load(std::memory_order_relaxed); }
+    quint64 droppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    // 当前线程开始新会话（用户/管理员登录时调用），之后的调用记入新会话号
+    static void beginSession();
+
+    // 记录一次调用（入队，写线程按 meta 中的参数名脱敏后编码）
+    void record(const char *method, qint64 startUs, qint64 latencyUs, QVariantList args);
+
+    // 按参数名脱敏：密码替换为固定值 kReplayPassword（回放前按此密码准备用户），
+    // 身份证/手机号/邮箱/乘客姓名替换为稳定的假名（同值同假名），
+    // 文件路径只保留后缀，长文本换成等长填充，字节数组只保留长度
+    static QVariant sanitize(const QString &parameterName, const QVariant &value);
+    static const char *kReplayPassword;
+
+    // 调用范围：构造时计时，析构时记录；嵌套调用只记录最外层
+    class Scope
+    {
+    public:
+        explicit Scope(const char *method);
+        template<typename MakeArgs>
+        Scope(const char *method, MakeArgs makeArgs)
+            : Scope(method)
+        {
+            if (m_active)
+                m_args = makeArgs(); // 未录制时不构造参数
+        }
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        const char *m_method;
+        bool m_active;
+        qint64 m_startUs;
+        QVariantList m_args;
+    };
+
+    // 读取录制文件（回放工具使用）；出错返回 false 并写入 error
+    static bool read(QIODevice *device, qint64 *startEpochMs, QList<Call> *calls, QString *error);
+
+private:
+    WorkloadTrace();
+
+    struct Record
+    {
+        const char *method = nullptr;
+        qint64 startUs = 0;
+        qint64 latencyUs = 0;
+        int thread = 0;
+        int session = 0;
+        QVariantList args;
+    };
+
+    static constexpr quint8 kVersion = 2;
+
+    void writerLoop();
+    bool drainOnce(class QFile &file);
+    static qint64 nowUs();
+    static int threadIndex();
+    static int sessionIndex();
+
+    static std::atomic<bool> s_recording;
+    static std::atomic<qint64> s_originUs; // 录制开始时刻（单调时钟）
+
+    MpscRing<Record, 8192> m_ring;
+    std::atomic<quint64> m_dropped;
+
+    QString m_path;
+    qint64 m_startEpochMs;
+    QHash<QByteArray, QStringList> m_parameterNames; // "方法/参数个数" -> 参数名（仅写线程访问）
+    QHash<QByteArray, quint32> m_methodIds;          // 方法名 -> 方法号（仅写线程访问）
+    std::thread m_writer;
+    std::mutex m_wakeLock; // 只用于后台线程休眠，生产者不获取
+    std::condition_variable m_wake;
+};
+
+#endif // WORKLOADTRACE_H
@@ -5,24 +5,53 @@
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
 #include <QQmlEngine> // 新增：用于QML单例注册
+#include "AsyncLogger.h"
 #include "DBManager.h"
+#include "Executor.h"
+#include "FlightSearchController.h"
 #include "HuskarUI/husapp.h"
+#include "WorkloadTrace.h"
 
 int main(int argc, char *argv[])
 {
     QGuiApplication app(argc, argv);
 
+    // 异步日志：qDebug/console.log 统一写入 JSON Lines 文件，级别由 FLIGHT_LOG_LEVEL 指定（默认 info）
+    const QByteArray logLevel = qgetenv("FLIGHT_LOG_LEVEL").toLower();
+    AsyncLogger::Level minLevel = AsyncLogger::Info;
+    if (logLevel == "debug")
+        minLevel = AsyncLogger::Debug;
+    else if (logLevel == "warning")
+        minLevel = AsyncLogger::Warning;
+    else if (logLevel == "error")
+        minLevel = AsyncLogger::Error;
+    AsyncLogger::instance()->start(QString(), minLevel);
+    // 共享 CPU 执行器先于日志停止，未开始的任务被丢弃
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, []() { Executor::instance()->stop(); });
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, []() { AsyncLogger::instance()->stop(); });
+
+    // 工作负载录制：FLIGHT_TRACE 指定文件时记录 DBManager 的全部公开调用（供 tools/trace_replay 回放）
+    const QString tracePath = qEnvironmentVariable("FLIGHT_TRACE");
+    if (!tracePath.isEmpty()) {
+        WorkloadTrace::instance()->start(tracePath, &DBManager::staticMetaObject);
+        QObject::connect(&app, &QCoreApplication::aboutToQuit, []() { WorkloadTrace::instance()->stop(); });
+    }
+
     // 获取DBManager单例
     DBManager *dbManager = DBManager::getInstance(&app);
     bool connectSuccess = dbManager->connectDB();
     if (!connectSuccess) {
-        qCritical() << "数据库连接失败！=";
+        FLOG_ERROR("app") << "数据库连接失败！=";
     }
 
     QQmlApplicationEngine engine;
 
     qmlRegisterType<QImage>("QImageType", 1, 0, "QImage");
     engine.rootContext()->setContextProperty("DBManager", DBManager::getInstance());
+    // 帖子图片、头像通过 image://blobs/ 从 C++ 缓存加载，图片字节不进入 JS 堆
+    engine.addImageProvider("blobs", new BlobImageProvider(dbManager->imageStore()));
+    // 用户列表头像打包成图集，通过 image://avatars/ 共用一张纹理
+    engine.addImageProvider("avatars", new AvatarAtlasProvider(dbManager->avatarAtlas()));
     engine.load(QUrl(QStringLiteral("qrc:/main.qml")));
 
     // ========== 核心：注册DBManager为QML单例（修复捕获问题） ==========
@@ -38,6 +67,8 @@ int main(int argc, char *argv[])
                                             return DBManager::getInstance(
                                                 QGuiApplication::instance());
                                         });
+    // 边输边搜控制器（SearchFlight.qml 中实例化）
+    qmlRegisterType<FlightSearchController>("com.flight.db", 1, 0, "FlightSearchController");
     qmlRegisterSingletonType(QUrl("qrc:/GlobalSettings.qml"),
                              "com.flight.globalVars",
                              1,
@@ -0,0 +1,313 @@
+// 组提交基准：多个并发客户端下单，对比直接执行（与 DBManager::createOrder 相同：共享一个连接，逐个事务）
+// 与 BookingPipeline 组提交（并发请求合并为一个事务）的吞吐、延迟和实际批次大小
+// 用法：booking_pipeline_bench --scratch-database 库名 [--clients 1,4,16,64] [--orders 每轮下单数]
+//       [--flights 航班数] [--window-ms 组提交窗口] [--max-batch 单批上限] ...
+// 只支持 QMYSQL：组提交线程复制连接参数另开连接，须落在同一个临时库中；
+// 临时库中建 flight / `order` 两张表（只含下单语句用到的列），每轮开始前清空订单、重置余票
+// 客户端数为 1 时组提交的批次只有 1 个请求，可看到保存点与跨线程等待带来的额外开销
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTextStream>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../BookingPipeline.h"
+#include "../SqlStatements.h"
+
+namespace {
+
+const QString kSourceConnection = "bench_source";
+
+struct Config
+{
+    QString host;
+    int port = 3306;
+    QString user;
+    QString password;
+    QString scratch; // 建表与下单使用的库（须显式指定）
+    QList<int> clients;
+    int orders = 2000;
+    int flights = 8;
+    int windowMs = 2;
+    int maxBatch = 32;
+};
+
+struct Sample
+{
+    QString mode;
+    int clients = 0;
+    int ok = 0;
+    int failed = 0;
+    qint64 totalNs = 0;
+    QList<qint64> latencies; // 单笔下单耗时（纳秒）
+    double avgBatch = 1;
+    quint64 maxBatch = 1;
+};
+
+double percentileUs(QList<qint64> samples, double p)
+{
+    if (samples.isEmpty())
+        return 0;
+    std::sort(samples.begin(), samples.end());
+    const int index = qBound(0, int(p * (samples.size() - 1) + 0.5), int(samples.size()) - 1);
+    return samples.at(index) / 1e3;
+}
+
+QString flightId(int i)
+{
+    return QString("BENCH%1").arg(i, 3, 10, QChar('0'));
+}
+
+bool prepareSchema(QSqlDatabase &db, const Config &config, QString *error)
+{
+    QSqlQuery query(db);
+    const bool ok = query.exec(R"(
+        CREATE TABLE IF NOT EXISTS flight (
+            Flight_id VARCHAR(64) NOT NULL PRIMARY KEY,
+            total_seats INT NOT NULL,
+            remain_seats INT NOT NULL
+        ) ENGINE = InnoDB
+    )") && query.exec(R"(
+        CREATE TABLE IF NOT EXISTS `order` (
+            order_id VARCHAR(32) NOT NULL PRIMARY KEY,
+            user_id INT NOT NULL,
+            flight_id VARCHAR(64) NOT NULL,
+            passenger_name VARCHAR(64) NOT NULL,
+            passenger_idcard VARCHAR(32) NOT NULL,
+            request_key VARCHAR(64) NULL,
+            request_hash CHAR(40) NULL,
+            UNIQUE KEY uk_request_key (request_key),
+            KEY idx_flight (flight_id)
+        ) ENGINE = InnoDB
+    )");
+    if (!ok) {
+        *error = query.lastError().text();
+        return false;
+    }
+    QSqlQuery insert(db);
+    insert.prepare("INSERT IGNORE INTO flight (Flight_id, total_seats, remain_seats) VALUES (?, 0, 0)");
+    for (int i = 0; i < config.flights; ++i) {
+        insert.addBindValue(flightId(i));
+        if (!insert.exec()) {
+            *error = insert.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+// 每轮开始前清空订单并把余票重置为足够本轮使用（不出现售罄）
+bool resetRound(QSqlDatabase &db, const Config &config)
+{
+    QSqlQuery query(db);
+    return query.exec("TRUNCATE TABLE `order`")
+           && query.exec(QString("UPDATE flight SET total_seats = %1, remain_seats = %1").arg(config.orders + 1));
+}
+
+using Booker = std::function<bool(int)>; // 执行第 i 笔下单，返回是否成功
+
+// clients 个线程分摊 orders 笔下单；client(c, run) 在第 c 个线程上准备好自己的资源后调用 run(booker)
+Sample runClients(const QString &mode,
+                  int clients,
+                  const Config &config,
+                  const std::function<void(int, const std::function<void(const Booker &)> &)> &client)
+{
+    Sample sample;
+    sample.mode = mode;
+    sample.clients = clients;
+    std::atomic<int> next(0);
+    std::atomic<int> ok(0);
+    std::mutex latencyLock;
+    QElapsedTimer total;
+    total.start();
+    std::vector<std::thread> threads;
+    for (int c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c]() {
+            client(c, [&](const Booker &book) {
+                QList<qint64> latencies;
+                for (int i = next.fetch_add(1); i < config.orders; i = next.fetch_add(1)) {
+                    QElapsedTimer timer;
+                    timer.start();
+                    if (book(i)) {
+                        latencies.append(timer.nsecsElapsed());
+                        ok.fetch_add(1);
+                    }
+                }
+                std::lock_guard<std::mutex> locker(latencyLock);
+                sample.latencies.append(latencies);
+            });
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+    sample.totalNs = total.nsecsElapsed();
+    sample.ok = ok.load();
+    sample.failed = config.orders - sample.ok;
+    return sample;
+}
+
+// 直接执行：与 createOrder 的事务路径相同；DBManager 的主连接由 m_mutex 串行，这里每个客户端线程
+// 用自己的连接（连接不能跨线程使用），整笔事务持有同一把锁，效果与共享一个连接相同
+Sample runDirect(int clients, const Config &config)
+{
+    std::mutex connectionLock;
+    return runClients("direct", clients, config, [&](int c, const std::function<void(const Booker &)> &run) {
+        const QString name = QString("bench_direct_%1").arg(c);
+        {
+            QSqlDatabase db = QSqlDatabase::cloneDatabase(kSourceConnection, name);
+            if (!db.open()) {
+                run([](int) { return false; });
+                return;
+            }
+            QSqlQuery seatQuery(db);
+            QSqlQuery orderQuery(db);
+            seatQuery.prepare(Sql::Statement<Sql::Id::TakeSeat>::sql);
+            orderQuery.prepare(Sql::Statement<Sql::Id::InsertOrder>::sql);
+            run([&](int i) {
+                std::lock_guard<std::mutex> locker(connectionLock);
+                using BookingProtocol::Outcome;
+                using BookingProtocol::Step;
+                BookingProtocol::Create protocol;
+                while (!protocol.finished()) {
+                    Outcome outcome = Outcome::Ok;
+                    switch (protocol.step()) {
+                    case Step::Begin:
+                        outcome = db.transaction() ? Outcome::Ok : Outcome::Failed;
+                        break;
+                    case Step::TakeSeat:
+                        Sql::bind<Sql::Id::TakeSeat>(seatQuery, flightId(i % config.flights));
+                        outcome = BookingPipeline::outcome(seatQuery, seatQuery.exec());
+                        break;
+                    case Step::InsertOrder:
+                        Sql::bind<Sql::Id::InsertOrder>(orderQuery, BookingPipeline::nextOrderId(), i,
+                                                        flightId(i % config.flights), QString("bench"), QString("0"),
+                                                        QString(), QString());
+                        outcome = orderQuery.exec() ? Outcome::Ok : BookingPipeline::classify(orderQuery.lastError());
+                        break;
+                    case Step::Commit:
+                        outcome = db.commit() ? Outcome::Ok : Outcome::Failed;
+                        break;
+                    case Step::Rollback:
+                        db.rollback();
+                        break;
+                    default:
+                        break;
+                    }
+                    protocol.advance(outcome);
+                }
+                return protocol.result() == BookingProtocol::Create::Booked;
+            });
+            db.close();
+        }
+        QSqlDatabase::removeDatabase(name);
+    });
+}
+
+// 组提交：每轮一个新的 BookingPipeline，批次统计只含本轮
+Sample runPipeline(int clients, const Config &config)
+{
+    BookingPipeline pipeline;
+    BookingPipeline::Options options;
+    options.sourceConnection = kSourceConnection;
+    options.windowMs = config.windowMs;
+    options.maxBatch = config.maxBatch;
+    pipeline.start(options);
+    Sample sample = runClients("pipeline", clients, config, [&](int, const std::function<void(const Booker &)> &run) {
+        run([&](int i) {
+            BookingPipeline::Request request;
+            request.userId = i;
+            request.flightId = flightId(i % config.flights);
+            request.passengerName = "bench";
+            request.passengerIdcard = "0";
+            return pipeline.book(request).success; // 阻塞到所在批次提交
+        });
+    });
+    pipeline.stop();
+    const QVariantMap stats = pipeline.stats();
+    sample.avgBatch = stats.value("avg_batch").toDouble();
+    sample.maxBatch = stats.value("max_batch").toULongLong();
+    return sample;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"host", "MySQL 地址", "host", "127.0.0.1"});
+    parser.addOption({"port", "MySQL 端口", "port", "3306"});
+    parser.addOption({"user", "用户名", "name", "GYT"});
+    parser.addOption({"password", "密码", "password", "123456"});
+    parser.addOption({"scratch-database", "建表与下单使用的库（必填，不能是业务库）", "name"});
+    parser.addOption({"clients", "并发客户端数（逗号分隔，每个取值跑一轮）", "list", "1,4,16,64"});
+    parser.addOption({"orders", "每轮下单数", "n", "2000"});
+    parser.addOption({"flights", "航班数（下单按航班轮转）", "n", "8"});
+    parser.addOption({"window-ms", "组提交窗口（毫秒）", "ms", "2"});
+    parser.addOption({"max-batch", "组提交单批上限", "n", "32"});
+    parser.process(app);
+
+    Config config;
+    config.host = parser.value("host");
+    config.port = parser.value("port").toInt();
+    config.user = parser.value("user");
+    config.password = parser.value("password");
+    config.scratch = parser.value("scratch-database").trimmed();
+    config.orders = qMax(1, parser.value("orders").toInt());
+    config.flights = qMax(1, parser.value("flights").toInt());
+    config.windowMs = qMax(0, parser.value("window-ms").toInt());
+    config.maxBatch = qMax(1, parser.value("max-batch").toInt());
+    for (const QString &value : parser.value("clients").split(',', Qt::SkipEmptyParts))
+        config.clients.append(qMax(1, value.trimmed().toInt()));
+
+    QTextStream err(stderr);
+    if (config.scratch.isEmpty() || config.scratch == "flight_manage_system_db") {
+        err << "须用 --scratch-database 指定业务库以外的临时库\n";
+        return 1;
+    }
+    if (!QSqlDatabase::isDriverAvailable("QMYSQL")) {
+        err << "QMYSQL 驱动不可用\n";
+        return 1;
+    }
+    QSqlDatabase db = QSqlDatabase::addDatabase("QMYSQL", kSourceConnection);
+    db.setHostName(config.host);
+    db.setPort(config.port);
+    db.setDatabaseName(config.scratch);
+    db.setUserName(config.user);
+    db.setPassword(config.password);
+    QString error;
+    if (!db.open() || !prepareSchema(db, config, &error)) {
+        err << "连接或建表失败：" << (error.isEmpty() ? db.lastError().text() : error) << '\n';
+        return 1;
+    }
+
+    QTextStream out(stdout);
+    out << "mode\tclients\tok\tfailed\ttotal_ms\torders_per_s\tp50_us\tp99_us\tavg_batch\tmax_batch\n";
+    for (const int clients : config.clients) {
+        for (const QString &mode : {QString("direct"), QString("pipeline")}) {
+            if (!resetRound(db, config)) {
+                err << "重置临时表失败：" << db.lastError().text() << '\n';
+                return 1;
+            }
+            const Sample sample = mode == "direct" ? runDirect(clients, config) : runPipeline(clients, config);
+            const double totalMs = sample.totalNs / 1e6;
+            out << sample.mode << '\t' << sample.clients << '\t' << sample.ok << '\t' << sample.failed << '\t'
+                << QString::number(totalMs, 'f', 1) << '\t'
+                << QString::number(totalMs > 0 ? sample.ok / (totalMs / 1e3) : 0, 'f', 0) << '\t'
+                << QString::number(percentileUs(sample.latencies, 0.50), 'f', 1) << '\t'
+                << QString::number(percentileUs(sample.latencies, 0.99), 'f', 1) << '\t'
+                << QString::number(sample.avgBatch, 'f', 2) << '\t' << sample.maxBatch << '\n';
+            out.flush();
+        }
+    }
+    db.close();
+    return 0;
+}
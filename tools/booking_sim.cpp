@@ -0,0 +1,951 @@
+// 订票并发确定性仿真：把 createOrder / deleteOrder / 组提交批次的语句序列放到内存数据库上执行，
+// 由带种子的调度器决定各会话语句的交错顺序并注入故障（连接中断、提交应答丢失），
+// 每次提交后和每个调度结束时检查不变式；失败的调度可用同一种子逐步复现
+//
+// 用法：booking_sim [--schedules N] [--seed 起始种子] [--clients N] [--pipelines N] [--flights N]
+//                   [--seats N] [--ops N] [--batch N] [--fault-rate p] [--lock-timeout 步数]
+//                   [--trace] [--keep-going]
+//   第 i 个调度的种子为 seed + i；复现：booking_sim --seed <失败种子> --schedules 1 --trace
+//
+// 内存数据库按 InnoDB 的语义建模：写语句对行加排他锁直到事务结束；等锁成环时请求方作为死锁牺牲者，
+// 整个事务回滚；锁等待超时只让当前语句失败；SELECT 为不加锁的一致性读（已提交值或自己的修改）；
+// 回滚到保存点保留已加的锁；事务被回滚后会话仍处于非自动提交状态，后续语句隐式开启新事务
+//
+// 会话执行的是 BookingProtocol 中的 Create / Delete / Batch 协议，与 DBManager::createOrder（事务路径）、
+// DBManager::deleteOrder（单库路径）和 BookingPipeline::executeBatch 是同一份代码；仿真只负责把协议的每一步
+// 翻译成内存数据库的语句，并按与真实代码相同的规则把结果归类为 Outcome
+//
+// 不变式：
+//   0. 订单号不重复（订单号的生成方式与 BookingPipeline::nextOrderId 相同，重复即报错）
+//   1. 每次提交后：0 <= 余票 <= 总座位，且 余票 + 该航班订单数 == 总座位
+//   2. 调度结束时：告知成功的订单存在，告知失败或已删除的订单不存在；
+//      提交返回错误的操作结果不确定（可能是应答丢失），不参与检查
+//   3. 调度结束时没有会话仍持有锁
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../BookingProtocol.h"
+
+namespace {
+
+// 仿真订单号：高位为进程标记，低位为 BookingProtocol::nextSequence 生成的序号
+constexpr int kTagShift = 40;
+constexpr std::int64_t kSequenceMask = (std::int64_t(1) << kTagShift) - 1;
+
+struct Config
+{
+    int clients = 4;      // 会话数（含组提交会话）
+    int pipelines = 1;    // 其中执行组提交批次的会话数（模拟多个客户端进程各自的订票线程）
+    int flights = 3;
+    int seats = 4;
+    int ops = 8;          // 每个会话的操作数
+    int batch = 4;        // 组提交单批请求数
+    double faultRate = 0.01; // 每条语句发生连接中断的概率
+    int lockTimeout = 200;   // 锁等待超时（调度步数）
+    int maxSteps = 100000;   // 超过即视为活锁
+};
+
+// 全部调度的统计
+struct Stats
+{
+    std::uint64_t schedules = 0;
+    std::uint64_t steps = 0;
+    std::uint64_t statements = 0;
+    std::uint64_t commits = 0;
+    std::uint64_t deadlocks = 0;
+    std::uint64_t lockTimeouts = 0;
+    std::uint64_t faults = 0;
+    std::uint64_t ackLost = 0;
+    std::uint64_t duplicates = 0;
+    std::uint64_t booked = 0;
+    std::uint64_t soldOut = 0;
+    std::uint64_t deleted = 0;
+    std::uint64_t uncertain = 0;
+};
+
+enum class Stmt { Begin, Commit, Rollback, Savepoint, RollbackToSavepoint, ReleaseSavepoint,
+                  TakeSeat, ReleaseSeat, InsertOrder, OrderFlight, DeleteOrder };
+
+enum class Status { Ok, Blocked, Deadlock, LockTimeout, Duplicate, ConnectionLost, NoSavepoint };
+
+const char *stmtName(Stmt stmt)
+{
+    static const char *names[] = {"BEGIN", "COMMIT", "ROLLBACK", "SAVEPOINT", "ROLLBACK TO SAVEPOINT",
+                                  "RELEASE SAVEPOINT", "TakeSeat", "ReleaseSeat", "InsertOrder",
+                                  "OrderFlight", "DeleteOrder"};
+    return names[int(stmt)];
+}
+
+const char *statusName(Status status)
+{
+    static const char *names[] = {"ok", "blocked", "deadlock", "lock-timeout", "duplicate", "connection-lost",
+                                  "no-savepoint"};
+    return names[int(status)];
+}
+
+// 一行：已提交值 + 持锁会话的未提交值
+struct Row
+{
+    bool exists = false;
+    int value = 0;    // 航班：余票；订单：航班号
+    int attempt = -1; // 订单：写入它的下单尝试
+    bool newExists = false;
+    int newValue = 0;
+    int newAttempt = -1;
+    int owner = -1;   // 持有排他锁的会话
+};
+
+struct Request
+{
+    Stmt stmt;
+    int flight = -1;
+    std::int64_t orderId = 0;
+    int savepoint = 0;
+    int attempt = -1;
+};
+
+struct Reply
+{
+    Status status = Status::Ok;
+    int rows = 0;
+    bool found = false;
+    int value = -1;
+};
+
+// 内存数据库
+class Database
+{
+public:
+    Database(const Config &config, Stats *stats)
+        : m_config(config)
+        , m_stats(stats)
+        , m_flights(config.flights)
+        , m_sessions(config.clients)
+    {
+        for (Row &row : m_flights) {
+            row.exists = true;
+            row.value = config.seats;
+        }
+    }
+
+    // 执行一条语句；返回 Blocked 时会话进入等锁状态，调度器之后重试同一条语句
+    Reply exec(int s, const Request &request, std::mt19937_64 &rng)
+    {
+        Session &session = m_sessions[s];
+        Reply reply;
+        if (session.waitingFor) {
+            const bool held = session.waitingFor->owner != -1;
+            session.waitingFor = nullptr;
+            if (held && session.waitSteps > m_config.lockTimeout) {
+                session.waitSteps = 0;
+                ++m_stats->lockTimeouts;
+                reply.status = Status::LockTimeout; // 只有本条语句失败，事务保留
+                return reply;
+            }
+        }
+        session.waitSteps = 0;
+        ++m_stats->statements;
+        if (session.dead) {
+            reply.status = Status::ConnectionLost;
+            return reply;
+        }
+        if (request.stmt != Stmt::Rollback && std::bernoulli_distribution(m_config.faultRate)(rng)) {
+            // 连接中断：服务端回滚未提交事务；提交语句有一半概率是已提交但应答丢失
+            ++m_stats->faults;
+            if (request.stmt == Stmt::Commit && session.inTrx && std::bernoulli_distribution(0.5)(rng)) {
+                ++m_stats->ackLost;
+                commit(s);
+            } else {
+                abort(s);
+            }
+            session.dead = true;
+            reply.status = Status::ConnectionLost;
+            return reply;
+        }
+
+        switch (request.stmt) {
+        case Stmt::Begin:
+            session.autocommitOff = true; // 与 MySQL 一致，第一条语句时才真正开启事务
+            return reply;
+        case Stmt::Commit:
+            commit(s);
+            session.autocommitOff = false;
+            return reply;
+        case Stmt::Rollback:
+            abort(s);
+            session.autocommitOff = false;
+            return reply;
+        case Stmt::Savepoint:
+            session.inTrx = true;
+            dropSavepoint(session, request.savepoint, false);
+            session.savepoints.push_back({request.savepoint, session.undo.size()});
+            return reply;
+        case Stmt::RollbackToSavepoint:
+        case Stmt::ReleaseSavepoint: {
+            const size_t position = dropSavepoint(session, request.savepoint, true);
+            if (position == size_t(-1)) {
+                reply.status = Status::NoSavepoint; // 事务已被回滚时保存点随之消失
+                return reply;
+            }
+            if (request.stmt == Stmt::RollbackToSavepoint) {
+                undo(session, position);
+                session.savepoints.push_back({request.savepoint, position});
+            }
+            return reply;
+        }
+        default:
+            break;
+        }
+
+        session.inTrx = true;
+        reply = data(s, request);
+        if (reply.status == Status::Blocked || session.autocommitOff || !session.inTrx)
+            return reply;
+        // 自动提交模式：语句即事务
+        if (reply.status == Status::Ok)
+            commit(s);
+        else
+            abort(s);
+        return reply;
+    }
+
+    // 会话能否被调度：未在等锁，或锁已释放，或已等待超时
+    bool runnable(int s) const
+    {
+        const Session &session = m_sessions[s];
+        return !session.waitingFor || session.waitingFor->owner == -1 || session.waitSteps > m_config.lockTimeout;
+    }
+
+    void tickWaits()
+    {
+        for (Session &session : m_sessions) {
+            if (session.waitingFor)
+                ++session.waitSteps;
+        }
+    }
+
+    // 重新连接（组提交的 ensureConnection；界面线程的调用也视为重新取得可用连接）
+    void reconnect(int s)
+    {
+        Session &session = m_sessions[s];
+        if (session.dead)
+            session = Session();
+    }
+
+    bool holdsLocks(int s) const { return !m_sessions[s].locks.empty() || m_sessions[s].inTrx; }
+    const std::string &violation() const { return m_violation; }
+    const std::map<std::int64_t, Row> &orders() const { return m_orders; }
+
+private:
+    struct Undo
+    {
+        Row *row;
+        bool exists;
+        int value;
+        int attempt;
+    };
+
+    struct Session
+    {
+        bool autocommitOff = false;
+        bool inTrx = false;
+        bool dead = false;
+        std::vector<Row *> locks;
+        std::vector<Undo> undo;
+        std::vector<std::pair<int, size_t>> savepoints; // 保存点名 -> undo 位置
+        Row *waitingFor = nullptr;
+        int waitSteps = 0;
+    };
+
+    // 数据语句（都在事务内）
+    Reply data(int s, const Request &request)
+    {
+        Session &session = m_sessions[s];
+        Reply reply;
+        switch (request.stmt) {
+        case Stmt::TakeSeat:
+        case Stmt::ReleaseSeat: {
+            Row &row = m_flights[request.flight];
+            if ((reply.status = lock(s, row)) != Status::Ok)
+                return reply;
+            const bool take = request.stmt == Stmt::TakeSeat;
+            if (take ? row.newValue > 0 : row.newValue < m_config.seats) {
+                remember(session, row);
+                row.newValue += take ? -1 : 1;
+                reply.rows = 1;
+            }
+            return reply;
+        }
+        case Stmt::InsertOrder: {
+            Row &row = m_orders[request.orderId];
+            if ((reply.status = lock(s, row)) != Status::Ok)
+                return reply;
+            if (row.newExists) {
+                ++m_stats->duplicates;
+                if (m_violation.empty()) {
+                    std::ostringstream text;
+                    text << "订单号重复：ORD" << (request.orderId >> kTagShift) << '-'
+                         << (request.orderId & kSequenceMask);
+                    m_violation = text.str();
+                }
+                reply.status = Status::Duplicate;
+                return reply;
+            }
+            remember(session, row);
+            row.newExists = true;
+            row.newValue = request.flight;
+            row.newAttempt = request.attempt;
+            reply.rows = 1;
+            return reply;
+        }
+        case Stmt::OrderFlight: {
+            const auto it = m_orders.find(request.orderId);
+            if (it != m_orders.end()) {
+                const Row &row = it->second;
+                reply.found = row.owner == s ? row.newExists : row.exists;
+                reply.value = row.owner == s ? row.newValue : row.value;
+            }
+            return reply;
+        }
+        case Stmt::DeleteOrder: {
+            const auto it = m_orders.find(request.orderId);
+            if (it == m_orders.end())
+                return reply;
+            Row &row = it->second;
+            if ((reply.status = lock(s, row)) != Status::Ok)
+                return reply;
+            if (row.newExists) {
+                remember(session, row);
+                row.newExists = false;
+                reply.rows = 1;
+            }
+            return reply;
+        }
+        default:
+            return reply;
+        }
+    }
+
+    // 加排他锁；成环则请求方作为死锁牺牲者回滚整个事务
+    Status lock(int s, Row &row)
+    {
+        Session &session = m_sessions[s];
+        if (row.owner == s)
+            return Status::Ok;
+        if (row.owner == -1) {
+            row.owner = s;
+            row.newExists = row.exists;
+            row.newValue = row.value;
+            row.newAttempt = row.attempt;
+            session.locks.push_back(&row);
+            return Status::Ok;
+        }
+        int owner = row.owner;
+        for (size_t hops = 0; owner != -1 && hops <= m_sessions.size(); ++hops) {
+            if (owner == s) {
+                ++m_stats->deadlocks;
+                abort(s);
+                return Status::Deadlock;
+            }
+            const Row *waiting = m_sessions[owner].waitingFor;
+            owner = waiting ? waiting->owner : -1;
+        }
+        session.waitingFor = &row;
+        return Status::Blocked;
+    }
+
+    void remember(Session &session, const Row &row)
+    {
+        session.undo.push_back({const_cast<Row *>(&row), row.newExists, row.newValue, row.newAttempt});
+    }
+
+    void undo(Session &session, size_t position)
+    {
+        while (session.undo.size() > position) {
+            const Undo &entry = session.undo.back();
+            entry.row->newExists = entry.exists;
+            entry.row->newValue = entry.value;
+            entry.row->newAttempt = entry.attempt;
+            session.undo.pop_back();
+        }
+    }
+
+    // 删除保存点（及其后的保存点），返回其 undo 位置；不存在返回 -1
+    size_t dropSavepoint(Session &session, int name, bool withLater)
+    {
+        for (size_t i = 0; i < session.savepoints.size(); ++i) {
+            if (session.savepoints[i].first != name)
+                continue;
+            const size_t position = session.savepoints[i].second;
+            if (withLater)
+                session.savepoints.resize(i);
+            else
+                session.savepoints.erase(session.savepoints.begin() + long(i));
+            return position;
+        }
+        return size_t(-1);
+    }
+
+    void commit(int s)
+    {
+        Session &session = m_sessions[s];
+        if (!session.inTrx)
+            return;
+        for (Row *row : session.locks) {
+            row->exists = row->newExists;
+            row->value = row->newValue;
+            row->attempt = row->newAttempt;
+        }
+        ++m_stats->commits;
+        endTransaction(session);
+        checkCommitted();
+    }
+
+    void abort(int s)
+    {
+        endTransaction(m_sessions[s]);
+    }
+
+    // 释放锁并清理不存在的订单行（等待这些行的会话改为重试）
+    void endTransaction(Session &session)
+    {
+        for (Row *row : session.locks)
+            row->owner = -1;
+        session.locks.clear();
+        session.undo.clear();
+        session.savepoints.clear();
+        session.inTrx = false;
+        for (auto it = m_orders.begin(); it != m_orders.end();) {
+            if (it->second.owner == -1 && !it->second.exists) {
+                for (Session &other : m_sessions) {
+                    if (other.waitingFor == &it->second)
+                        other.waitingFor = nullptr;
+                }
+                it = m_orders.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // 不变式 1（已提交状态）
+    void checkCommitted()
+    {
+        if (!m_violation.empty())
+            return;
+        std::vector<int> orders(m_flights.size(), 0);
+        for (const auto &entry : m_orders) {
+            if (entry.second.exists)
+                ++orders[size_t(entry.second.value)];
+        }
+        for (size_t f = 0; f < m_flights.size(); ++f) {
+            const int remain = m_flights[f].value;
+            if (remain < 0 || remain > m_config.seats || remain + orders[f] != m_config.seats) {
+                std::ostringstream text;
+                text << "航班 F" << f << "：余票 " << remain << " + 订单 " << orders[f] << " != 总座位 "
+                     << m_config.seats;
+                m_violation = text.str();
+                return;
+            }
+        }
+    }
+
+    const Config &m_config;
+    Stats *m_stats;
+    std::vector<Row> m_flights;
+    std::map<std::int64_t, Row> m_orders; // 结点地址稳定，锁与等待直接持有行指针
+    std::vector<Session> m_sessions;
+    std::string m_violation;
+};
+
+// 下单尝试及客户端得到的结果
+struct Attempt
+{
+    enum Belief { Pending, Booked, Failed, Deleted, Uncertain };
+    std::int64_t orderId = 0;
+    int flight = 0;
+    Belief belief = Pending;
+};
+
+struct Op
+{
+    bool create = true;
+    int flight = 0;
+};
+
+// 一个会话：普通会话执行 createOrder / deleteOrder，组提交会话执行下单批次
+struct Client
+{
+    enum Kind { Idle, Create, Delete, Batch, Done };
+
+    struct Item
+    {
+        int flight = 0;
+        int attempt = -1; // 本次尝试的下单记录（整批重试时换新）
+    };
+
+    int session = 0;
+    bool pipeline = false;
+    std::vector<Op> ops;
+    size_t next = 0;
+    Kind kind = Idle;
+    std::int64_t lastSequence = 0;
+
+    // 与真实代码相同的协议对象
+    BookingProtocol::Create create;
+    BookingProtocol::Delete remove;
+    std::unique_ptr<BookingProtocol::Batch> batch;
+
+    int flight = 0;
+    int attempt = -1; // 下单：本次尝试；删除：目标尝试
+    std::int64_t orderId = 0;
+    std::vector<Item> items;
+    bool blocked = false; // 当前语句在等锁，下次调度时原样重试
+    Request pending{Stmt::Begin};
+};
+
+class Simulation
+{
+public:
+    Simulation(const Config &config, std::uint64_t seed, Stats *stats, std::ostream *trace)
+        : m_config(config)
+        , m_rng(seed)
+        , m_stats(stats)
+        , m_db(config, stats)
+        , m_trace(trace)
+    {
+        m_clients.resize(size_t(config.clients));
+        for (int i = 0; i < config.clients; ++i) {
+            Client &client = m_clients[size_t(i)];
+            client.session = i;
+            client.pipeline = i < config.pipelines;
+            for (int k = 0; k < config.ops; ++k) {
+                Op op;
+                op.create = client.pipeline || std::bernoulli_distribution(0.65)(m_rng);
+                op.flight = std::uniform_int_distribution<int>(0, config.flights - 1)(m_rng);
+                client.ops.push_back(op);
+            }
+        }
+    }
+
+    // 执行整个调度；返回违反的不变式（空表示通过）
+    std::string run()
+    {
+        std::vector<int> runnable;
+        for (;;) {
+            runnable.clear();
+            bool pending = false;
+            for (int i = 0; i < int(m_clients.size()); ++i) {
+                if (m_clients[size_t(i)].kind == Client::Done)
+                    continue;
+                pending = true;
+                if (m_db.runnable(i))
+                    runnable.push_back(i);
+            }
+            if (!pending)
+                break;
+            if (runnable.empty())
+                return "全部会话都在等锁但没有检测到死锁";
+            if (++m_steps > m_config.maxSteps)
+                return "调度超过 " + std::to_string(m_config.maxSteps) + " 步仍未结束";
+            ++m_stats->steps;
+            const int chosen = runnable[std::uniform_int_distribution<size_t>(0, runnable.size() - 1)(m_rng)];
+            step(m_clients[size_t(chosen)]);
+            m_db.tickWaits();
+            if (!m_db.violation().empty())
+                return m_db.violation();
+        }
+        return finalCheck();
+    }
+
+private:
+    // 执行一条语句；被阻塞返回 false（下次调度到时重试）
+    bool exec(Client &client, const Request &request, Reply *reply)
+    {
+        *reply = m_db.exec(client.session, request, m_rng);
+        if (m_trace) {
+            *m_trace << m_steps << "\tS" << client.session << '\t' << stmtName(request.stmt);
+            if (request.flight >= 0)
+                *m_trace << " F" << request.flight;
+            if (request.orderId)
+                *m_trace << " ORD" << (request.orderId >> kTagShift) << '-' << (request.orderId & kSequenceMask);
+            if (request.stmt == Stmt::Savepoint || request.stmt == Stmt::RollbackToSavepoint
+                || request.stmt == Stmt::ReleaseSavepoint)
+                *m_trace << " b" << request.savepoint;
+            *m_trace << "\t-> " << statusName(reply->status);
+            if (reply->status == Status::Ok && request.stmt >= Stmt::TakeSeat)
+                *m_trace << " rows=" << reply->rows << (reply->found ? " found" : "");
+            *m_trace << '\n';
+        }
+        return reply->status != Status::Blocked;
+    }
+
+    Request request(Stmt stmt, int flight = -1, std::int64_t orderId = 0) const
+    {
+        Request result{stmt};
+        result.flight = flight;
+        result.orderId = orderId;
+        return result;
+    }
+
+    // 与 BookingPipeline::nextOrderId 相同：进程内按 BookingProtocol::nextSequence 单调递增，
+    // 高位为进程标记（每个会话模拟一个客户端进程），不同进程同一时刻的订单号不相同
+    std::int64_t nextOrderId(Client &client)
+    {
+        client.lastSequence = BookingProtocol::nextSequence(client.lastSequence, 1 + m_steps / 8);
+        return (std::int64_t(client.session + 1) << kTagShift) | client.lastSequence;
+    }
+
+    int newAttempt(std::int64_t orderId, int flight)
+    {
+        Attempt attempt;
+        attempt.orderId = orderId;
+        attempt.flight = flight;
+        m_attempts.push_back(attempt);
+        return int(m_attempts.size()) - 1;
+    }
+
+    void settle(int attempt, Attempt::Belief belief)
+    {
+        if (attempt < 0)
+            return;
+        m_attempts[size_t(attempt)].belief = belief;
+        if (belief == Attempt::Booked)
+            ++m_stats->booked;
+        else if (belief == Attempt::Uncertain)
+            ++m_stats->uncertain;
+    }
+
+    // 与 BookingPipeline::classify / outcome 相同的归类：让事务失效的错误为 Aborted，
+    // 写语句按影响行数、OrderFlight 按是否找到区分 Ok / NoRows
+    static BookingProtocol::Outcome outcomeOf(const Request &request, const Reply &reply)
+    {
+        using BookingProtocol::Outcome;
+        switch (reply.status) {
+        case Status::Ok:
+            if (request.stmt == Stmt::OrderFlight)
+                return reply.found ? Outcome::Ok : Outcome::NoRows;
+            if (request.stmt >= Stmt::TakeSeat)
+                return reply.rows > 0 ? Outcome::Ok : Outcome::NoRows;
+            return Outcome::Ok;
+        case Status::Duplicate:
+            return Outcome::Failed;
+        default:
+            return Outcome::Aborted; // 死锁、锁等待超时、连接中断、保存点已不存在
+        }
+    }
+
+    BookingProtocol::Step currentStep(const Client &client) const
+    {
+        switch (client.kind) {
+        case Client::Create:
+            return client.create.step();
+        case Client::Delete:
+            return client.remove.step();
+        default:
+            return client.batch->step();
+        }
+    }
+
+    // 协议的下一步对应的语句（有副作用：生成订单号、下单记录；组提交每次尝试开始时重新取连接）
+    Request toRequest(Client &client, BookingProtocol::Step step)
+    {
+        using BookingProtocol::Step;
+        const int item = client.kind == Client::Batch ? client.batch->item() : 0;
+        switch (step) {
+        case Step::Begin:
+            if (client.kind == Client::Batch)
+                m_db.reconnect(client.session); // BookingPipeline::ensureConnection
+            return request(Stmt::Begin);
+        case Step::Savepoint:
+        case Step::ReleaseSavepoint:
+        case Step::RollbackToSavepoint: {
+            Request result = request(step == Step::Savepoint          ? Stmt::Savepoint
+                                     : step == Step::ReleaseSavepoint ? Stmt::ReleaseSavepoint
+                                                                      : Stmt::RollbackToSavepoint);
+            result.savepoint = item;
+            return result;
+        }
+        case Step::TakeSeat:
+            return request(Stmt::TakeSeat, client.kind == Client::Batch ? client.items[size_t(item)].flight
+                                                                        : client.flight);
+        case Step::InsertOrder: {
+            const int flight = client.kind == Client::Batch ? client.items[size_t(item)].flight : client.flight;
+            const std::int64_t orderId = nextOrderId(client);
+            const int attempt = newAttempt(orderId, flight);
+            if (client.kind == Client::Batch)
+                client.items[size_t(item)].attempt = attempt;
+            else
+                client.attempt = attempt;
+            Request insert = request(Stmt::InsertOrder, flight, orderId);
+            insert.attempt = attempt;
+            return insert;
+        }
+        case Step::OrderFlight:
+            return request(Stmt::OrderFlight, -1, client.orderId);
+        case Step::DeleteOrder:
+            return request(Stmt::DeleteOrder, -1, client.orderId);
+        case Step::ReleaseSeat:
+            return request(Stmt::ReleaseSeat, client.flight);
+        case Step::Commit:
+            return request(Stmt::Commit);
+        default:
+            return request(Stmt::Rollback);
+        }
+    }
+
+    // 客户端前进一条语句：按协议取下一步执行，结果归类后交回协议
+    void step(Client &client)
+    {
+        if (client.kind == Client::Idle && !startOp(client))
+            return;
+        if (!client.blocked)
+            client.pending = toRequest(client, currentStep(client));
+        Reply reply;
+        client.blocked = !exec(client, client.pending, &reply);
+        if (client.blocked)
+            return;
+        const BookingProtocol::Outcome outcome = outcomeOf(client.pending, reply);
+        if (client.pending.stmt == Stmt::TakeSeat && outcome == BookingProtocol::Outcome::NoRows)
+            ++m_stats->soldOut;
+        if (client.pending.stmt == Stmt::OrderFlight && outcome == BookingProtocol::Outcome::Ok)
+            client.flight = reply.value;
+
+        switch (client.kind) {
+        case Client::Create:
+            client.create.advance(outcome);
+            if (client.create.finished())
+                finishCreate(client);
+            return;
+        case Client::Delete:
+            client.remove.advance(outcome);
+            if (client.remove.finished())
+                finishDelete(client);
+            return;
+        default:
+            client.batch->advance(outcome);
+            if (client.batch->finished())
+                finishBatch(client);
+            return;
+        }
+    }
+
+    // 取下一个操作；没有可做的操作时结束
+    bool startOp(Client &client)
+    {
+        for (;;) {
+            if (client.next >= client.ops.size()) {
+                client.kind = Client::Done;
+                return false;
+            }
+            if (client.pipeline) {
+                client.items.clear();
+                while (client.next < client.ops.size() && int(client.items.size()) < m_config.batch) {
+                    Client::Item item;
+                    item.flight = client.ops[client.next++].flight;
+                    client.items.push_back(item);
+                }
+                client.batch.reset(new BookingProtocol::Batch(int(client.items.size())));
+                client.kind = Client::Batch;
+                return true;
+            }
+            m_db.reconnect(client.session); // 界面线程的调用视为重新取得可用连接
+            const Op &op = client.ops[client.next++];
+            client.flight = op.flight;
+            client.attempt = -1;
+            client.orderId = 0;
+            if (op.create) {
+                client.create = BookingProtocol::Create();
+                client.kind = Client::Create;
+                return true;
+            }
+            // 删除一个已告知成功的订单（可能是别的会话的，模拟用户与管理员同时删除）
+            std::vector<int> booked;
+            for (size_t i = 0; i < m_attempts.size(); ++i) {
+                if (m_attempts[i].belief == Attempt::Booked)
+                    booked.push_back(int(i));
+            }
+            if (booked.empty())
+                continue;
+            client.attempt = booked[std::uniform_int_distribution<size_t>(0, booked.size() - 1)(m_rng)];
+            client.orderId = m_attempts[size_t(client.attempt)].orderId;
+            client.remove = BookingProtocol::Delete();
+            client.kind = Client::Delete;
+            return true;
+        }
+    }
+
+    // DBManager::createOrder 告知调用方的结果
+    void finishCreate(Client &client)
+    {
+        switch (client.create.result()) {
+        case BookingProtocol::Create::Booked:
+            settle(client.attempt, Attempt::Booked);
+            break;
+        case BookingProtocol::Create::CommitFailed:
+            settle(client.attempt, Attempt::Uncertain);
+            break;
+        default:
+            settle(client.attempt, Attempt::Failed);
+            break;
+        }
+        client.kind = Client::Idle;
+    }
+
+    // DBManager::deleteOrder：删除失败不改变订单的已知状态；提交结果不确定时该订单不再参与检查
+    void finishDelete(Client &client)
+    {
+        if (client.remove.result() == BookingProtocol::Delete::Deleted) {
+            ++m_stats->deleted;
+            settle(client.attempt, Attempt::Deleted);
+        } else if (client.remove.result() == BookingProtocol::Delete::CommitFailed) {
+            settle(client.attempt, Attempt::Uncertain);
+        }
+        client.kind = Client::Idle;
+    }
+
+    // BookingPipeline::executeBatch：提交成功后按各请求的结果告知；提交失败时已写入的请求结果不确定，
+    // 其余失败（开启事务失败、多次被整体回滚）整批告知失败
+    void finishBatch(Client &client)
+    {
+        const BookingProtocol::Batch &batch = *client.batch;
+        for (size_t i = 0; i < client.items.size(); ++i) {
+            const int attempt = client.items[i].attempt;
+            if (batch.committed())
+                settle(attempt, batch.succeeded(int(i)) ? Attempt::Booked : Attempt::Failed);
+            else if (batch.failure() == BookingProtocol::Batch::CommitFailed
+                     && batch.verdict(int(i)) == BookingProtocol::Batch::Booked)
+                settle(attempt, Attempt::Uncertain);
+            else
+                settle(attempt, Attempt::Failed);
+        }
+        client.kind = Client::Idle;
+    }
+
+    // 不变式 2、3
+    std::string finalCheck() const
+    {
+        std::ostringstream text;
+        for (int i = 0; i < int(m_clients.size()); ++i) {
+            if (m_db.holdsLocks(i)) {
+                text << "会话 S" << i << " 结束时仍有未结束的事务";
+                return text.str();
+            }
+        }
+        for (const auto &entry : m_db.orders()) {
+            const Row &row = entry.second;
+            if (!row.exists || row.attempt < 0)
+                continue;
+            const Attempt &attempt = m_attempts[size_t(row.attempt)];
+            if (attempt.belief == Attempt::Failed || attempt.belief == Attempt::Pending) {
+                text << "订单 ORD" << entry.first << "（F" << row.value << "）已生效，但客户端被告知下单失败";
+                return text.str();
+            }
+            if (attempt.belief == Attempt::Deleted) {
+                text << "订单 ORD" << entry.first << " 已告知删除成功，但仍然存在";
+                return text.str();
+            }
+        }
+        for (size_t i = 0; i < m_attempts.size(); ++i) {
+            const Attempt &attempt = m_attempts[i];
+            if (attempt.belief != Attempt::Booked)
+                continue;
+            const auto it = m_db.orders().find(attempt.orderId);
+            if (it == m_db.orders().end() || !it->second.exists || it->second.attempt != int(i)) {
+                text << "订单 ORD" << attempt.orderId << "（F" << attempt.flight << "）已告知下单成功，但不存在";
+                return text.str();
+            }
+        }
+        return std::string();
+    }
+
+    const Config &m_config;
+    std::mt19937_64 m_rng;
+    Stats *m_stats;
+    Database m_db;
+    std::ostream *m_trace;
+    std::vector<Client> m_clients;
+    std::vector<Attempt> m_attempts;
+    int m_steps = 0;
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"schedules", "调度个数", "n", "10000"});
+    parser.addOption({"seed", "起始种子（第 i 个调度为 seed + i）", "n", "1"});
+    parser.addOption({"clients", "会话数", "n", "4"});
+    parser.addOption({"pipelines", "其中组提交会话数", "n", "1"});
+    parser.addOption({"flights", "航班数", "n", "3"});
+    parser.addOption({"seats", "每个航班座位数", "n", "4"});
+    parser.addOption({"ops", "每个会话的操作数", "n", "8"});
+    parser.addOption({"batch", "组提交单批请求数", "n", "4"});
+    parser.addOption({"fault-rate", "每条语句连接中断的概率", "p", "0.01"});
+    parser.addOption({"lock-timeout", "锁等待超时（调度步数）", "n", "200"});
+    parser.addOption({"trace", "打印每条语句的执行过程（用于复现单个种子）"});
+    parser.addOption({"keep-going", "发现失败后继续，最后汇总"});
+    parser.process(app);
+
+    Config config;
+    config.clients = qMax(1, parser.value("clients").toInt());
+    config.pipelines = qBound(0, parser.value("pipelines").toInt(), config.clients);
+    config.flights = qMax(1, parser.value("flights").toInt());
+    config.seats = qMax(1, parser.value("seats").toInt());
+    config.ops = qMax(1, parser.value("ops").toInt());
+    config.batch = qMax(1, parser.value("batch").toInt());
+    config.faultRate = qBound(0.0, parser.value("fault-rate").toDouble(), 1.0);
+    config.lockTimeout = qMax(1, parser.value("lock-timeout").toInt());
+    const quint64 schedules = qMax(1ULL, parser.value("schedules").toULongLong());
+    const quint64 seed = parser.value("seed").toULongLong();
+    const bool trace = parser.isSet("trace");
+    const bool keepGoing = parser.isSet("keep-going");
+
+    QTextStream out(stdout);
+    Stats stats;
+    QList<QPair<quint64, QString>> failures;
+    QElapsedTimer timer;
+    timer.start();
+    for (quint64 i = 0; i < schedules; ++i) {
+        std::ostringstream steps;
+        Simulation simulation(config, seed + i, &stats, trace ? &steps : nullptr);
+        const std::string violation = simulation.run();
+        ++stats.schedules;
+        if (trace)
+            out << QString::fromStdString(steps.str());
+        if (violation.empty())
+            continue;
+        failures.append({seed + i, QString::fromStdString(violation)});
+        if (!keepGoing)
+            break;
+    }
+    const double seconds = qMax<qint64>(1, timer.elapsed()) / 1000.0;
+
+    out << "# " << stats.schedules << " 个调度，" << QString::number(stats.schedules / seconds, 'f', 0)
+        << " 个/秒；语句 " << stats.statements << "，提交 " << stats.commits << "，死锁 " << stats.deadlocks
+        << "，锁等待超时 " << stats.lockTimeouts << "，连接中断 " << stats.faults << "（其中提交应答丢失 "
+        << stats.ackLost << "），订单号重复 " << stats.duplicates << '\n';
+    out << "# 下单成功 " << stats.booked << "，无余票 " << stats.soldOut << "，删除成功 " << stats.deleted
+        << "，结果不确定 " << stats.uncertain << '\n';
+    for (const auto &failure : failures) {
+        out << "FAIL seed=" << failure.first << "：" << failure.second << '\n'
+            << "  复现：booking_sim --seed " << failure.first << " --schedules 1 --trace --clients "
+            << config.clients << " --pipelines " << config.pipelines << " --flights " << config.flights
+            << " --seats " << config.seats << " --ops " << config.ops << " --batch " << config.batch
+            << " --fault-rate " << config.faultRate << " --lock-timeout " << config.lockTimeout << '\n';
+    }
+    if (failures.isEmpty())
+        out << "全部通过\n";
+    return failures.isEmpty() ? 0 : 1;
+}
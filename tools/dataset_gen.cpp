@@ -0,0 +1,868 @@
+// 合成数据集生成：按随机种子生成可复现的航班、用户、订单、帖子及收藏/点赞/喜欢数据，
+// 分布接近线上：航线热度按城市规模的引力模型高度倾斜，航班按季节和星期排班，
+// 用户活跃度服从幂律（少数用户贡献大部分订单、帖子和点赞），部分帖子带图片
+//
+// 用法：
+//   dataset_gen --out 目录 [规模参数]    写出 LOAD DATA 格式的 TSV 文件和 load.sql
+//   dataset_gen --db [规模参数]          经 SqlBatch 多行语句直接写入数据库（FLIGHT_DB_* 环境变量指定）
+// 同一种子、同一规模参数生成的数据逐字节相同；各表使用独立的随机流，调整一张表的规模不影响其他表
+// 配置了分片（--shards，默认取 FLIGHT_DB_SHARDS）时按 ShardRouter 的路由写入：用户、订单、收藏、点赞/喜欢
+// 写到用户所在分片，主库登记用户目录；--out 时各分片写到 shard<序号> 子目录，各自有 load.sql
+#include <QBuffer>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDate>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QSet>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <limits>
+#include "../BlobStore.h"
+#include "../ShardRouter.h"
+#include "../SqlBatch.h"
+
+namespace {
+
+// 城市及规模权重（近似旅客吞吐量，单位百万）
+struct City
+{
+    const char *name;
+    double weight;
+};
+
+const City kCities[] = {
+    {"北京", 100}, {"上海", 96}, {"广州", 77}, {"深圳", 61}, {"成都", 58}, {"重庆", 45},
+    {"昆明", 48},  {"杭州", 41}, {"西安", 47}, {"南京", 30}, {"厦门", 27}, {"长沙", 28},
+    {"武汉", 27},  {"青岛", 26}, {"海口", 24}, {"三亚", 21}, {"郑州", 29}, {"乌鲁木齐", 24},
+    {"天津", 23},  {"哈尔滨", 20}, {"贵阳", 21}, {"沈阳", 19}, {"大连", 18}, {"济南", 17},
+    {"福州", 15},  {"南宁", 15}, {"兰州", 15}, {"太原", 13}, {"长春", 15}, {"呼和浩特", 12},
+    {"南昌", 13},  {"宁波", 12}, {"合肥", 12}, {"温州", 10}, {"珠海", 9},  {"拉萨", 5},
+    {"西宁", 7},   {"银川", 9},  {"丽江", 7},  {"桂林", 8},
+};
+
+const char *const kAirlines[] = {"CA", "MU", "CZ", "HU", "3U", "ZH", "MF", "SC", "FM", "HO"};
+const int kSeatOptions[] = {158, 174, 186, 220, 264, 301};
+
+// 月份客流系数（春运、暑运、国庆为高峰）
+const double kMonthFactor[] = {1.25, 1.30, 0.90, 0.95, 1.00, 0.95, 1.30, 1.35, 0.95, 1.20, 0.85, 0.90};
+// 星期客流系数（周一 .. 周日）
+const double kWeekdayFactor[] = {1.05, 0.90, 0.90, 0.95, 1.15, 1.00, 1.10};
+
+struct Options
+{
+    quint64 seed = 20240601;
+    int users = 100000;
+    int routes = 400;      // 取引力最高的前 N 条有向航线
+    int days = 60;         // 排班天数
+    QDate startDate;       // 排班起始日期（默认固定日期，同一命令在不同日期运行结果相同）
+    int flightsPerDay = 1500; // 平均每天航班数（按季节、星期、航线热度分配）
+    int orders = 500000;
+    int posts = 50000;
+    double imageRatio = 0.3; // 带图片的帖子比例
+    int likes = 400000;
+    int favorites = 150000;
+    int collects = 200000;
+    int userIdBase = 1000000; // 生成用户的 Uid 起点（避免与现有数据冲突）
+    int postIdBase = 1000000;
+    int batchRows = 2000;     // 直接写库时每个事务的行数
+};
+
+// 随机流：各分布在 mt19937_64 的输出上手工实现。mt19937_64 与 seed_seq 的输出由标准规定，
+// 而 std::*_distribution 的算法由标准库实现决定，换编译器会生成不同的数据
+class Random
+{
+public:
+    explicit Random(std::mt19937_64 engine)
+        : m_engine(engine)
+    {}
+
+    // [0, 1)，取高 53 位
+    double uniform() { return double(m_engine() >> 11) * 0x1.0p-53; }
+    double uniform(double low, double high) { return low + (high - low) * uniform(); }
+
+    // [low, high] 上的整数，拒绝采样消除取模偏差
+    int uniformInt(int low, int high)
+    {
+        const quint64 span = quint64(qint64(high) - low) + 1;
+        const quint64 max = std::numeric_limits<quint64>::max();
+        const quint64 limit = max - max % span;
+        quint64 x = m_engine();
+        while (x >= limit)
+            x = m_engine();
+        return int(low + qint64(x % span));
+    }
+
+    bool bernoulli(double p) { return uniform() < p; }
+    double exponential(double mean) { return -mean * std::log(1.0 - uniform()); }
+
+    // Box-Muller，每次取两个均匀数只用一个结果，不保留状态
+    double normal(double mean, double stddev)
+    {
+        const double u1 = 1.0 - uniform(); // (0, 1]
+        const double u2 = uniform();
+        return mean + stddev * std::sqrt(-2.0 * std::log(u1)) * std::cos(kTwoPi * u2);
+    }
+
+private:
+    static constexpr double kTwoPi = 6.283185307179586;
+    std::mt19937_64 m_engine;
+};
+
+// 按权重抽样（累积分布 + 二分查找）
+class WeightedPicker
+{
+public:
+    void add(double weight)
+    {
+        m_total += weight;
+        m_cumulative.push_back(m_total);
+    }
+    int pick(Random &rng) const
+    {
+        const double r = rng.uniform(0, m_total);
+        return int(std::upper_bound(m_cumulative.begin(), m_cumulative.end(), r) - m_cumulative.begin())
+               % int(m_cumulative.size());
+    }
+    int size() const { return int(m_cumulative.size()); }
+
+private:
+    std::vector<double> m_cumulative;
+    double m_total = 0;
+};
+
+// 每张表独立的随机流（表名用 FNV-1a 散列，跨平台结果一致）
+Random streamFor(quint64 seed, const char *table)
+{
+    quint32 hash = 2166136261u;
+    for (const char *p = table; *p; ++p)
+        hash = (hash ^ quint8(*p)) * 16777619u;
+    std::seed_seq sequence{quint32(seed), quint32(seed >> 32), hash};
+    return Random(std::mt19937_64(sequence));
+}
+
+// 输出目标：TSV 文件或数据库
+class Sink
+{
+public:
+    virtual ~Sink() = default;
+    virtual bool begin(const QString &table, const QStringList &columns) = 0;
+    virtual bool row(const QVariantList &values) = 0;
+    virtual bool end() = 0;
+    virtual QString error() const { return m_error; }
+    qint64 rows() const { return m_rows; }
+
+protected:
+    QString m_error;
+    qint64 m_rows = 0;
+};
+
+// LOAD DATA 默认格式：制表符分隔，\N 表示 NULL，反斜杠转义；字节数组写成十六进制由 load.sql 解码
+class TsvSink : public Sink
+{
+public:
+    explicit TsvSink(const QString &dir)
+        : m_dir(dir)
+    {
+        QDir().mkpath(dir);
+    }
+
+    bool begin(const QString &table, const QStringList &columns) override
+    {
+        m_file.setFileName(QDir(m_dir).filePath(table + ".tsv"));
+        if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            m_error = m_file.errorString();
+            return false;
+        }
+        QStringList targets;
+        QStringList assignments;
+        for (const QString &column : columns) {
+            if (column == "data") { // blob_chunks.data
+                targets.append("@data_hex");
+                assignments.append("data = UNHEX(@data_hex)");
+            } else {
+                targets.append(QString("`%1`").arg(column));
+            }
+        }
+        m_script += QString("LOAD DATA LOCAL INFILE '%1.tsv' IGNORE INTO TABLE `%1` (%2)%3;\n")
+                        .arg(table, targets.join(", "),
+                             assignments.isEmpty() ? QString() : " SET " + assignments.join(", "));
+        m_buffer.clear();
+        return true;
+    }
+
+    bool row(const QVariantList &values) override
+    {
+        for (int i = 0; i < values.size(); ++i) {
+            if (i)
+                m_buffer.append('\t');
+            const QVariant &value = values.at(i);
+            if (value.isNull())
+                m_buffer.append("\\N");
+            else if (value.typeId() == QMetaType::QByteArray)
+                m_buffer.append(value.toByteArray().toHex());
+            else if (value.typeId() == QMetaType::QDateTime)
+                m_buffer.append(value.toDateTime().toString("yyyy-MM-dd HH:mm:ss").toLatin1());
+            else
+                appendEscaped(value.toString().toUtf8());
+        }
+        m_buffer.append('\n');
+        ++m_rows;
+        if (m_buffer.size() >= 4 * 1024 * 1024)
+            flush();
+        return true;
+    }
+
+    bool end() override
+    {
+        flush();
+        m_file.close();
+        return true;
+    }
+
+    // 写出导入脚本（在输出目录下执行：mysql --local-infile=1 数据库 < load.sql）
+    bool writeScript() const
+    {
+        QFile script(QDir(m_dir).filePath("load.sql"));
+        if (!script.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            return false;
+        script.write("SET foreign_key_checks = 0;\nSET unique_checks = 0;\n");
+        script.write(m_script.toUtf8());
+        script.write("SET unique_checks = 1;\nSET foreign_key_checks = 1;\n");
+        return true;
+    }
+
+private:
+    void appendEscaped(const QByteArray &text)
+    {
+        for (char c : text) {
+            switch (c) {
+            case '\t':
+                m_buffer.append("\\t");
+                break;
+            case '\n':
+                m_buffer.append("\\n");
+                break;
+            case '\\':
+                m_buffer.append("\\\\");
+                break;
+            default:
+                m_buffer.append(c);
+            }
+        }
+    }
+
+    void flush()
+    {
+        m_file.write(m_buffer);
+        m_buffer.clear();
+    }
+
+    QString m_dir;
+    QFile m_file;
+    QByteArray m_buffer;
+    QString m_script;
+};
+
+// 经 SqlBatch 多行语句写库，每 batchRows 行一个事务
+class DbSink : public Sink
+{
+public:
+    DbSink(QSqlDatabase db, int batchRows)
+        : m_db(db)
+        , m_batchRows(qMax(1, batchRows))
+    {}
+
+    bool begin(const QString &table, const QStringList &columns) override
+    {
+        QStringList quoted;
+        for (const QString &column : columns)
+            quoted.append(QString("`%1`").arg(column));
+        m_prefix = QString("INSERT IGNORE INTO `%1` (%2) VALUES ").arg(table, quoted.join(", "));
+        m_columns = QList<QVariantList>(columns.size());
+        return true;
+    }
+
+    bool row(const QVariantList &values) override
+    {
+        for (int i = 0; i < values.size(); ++i)
+            m_columns[i].append(values.at(i));
+        ++m_rows;
+        return m_columns.first().size() < m_batchRows || flush();
+    }
+
+    bool end() override { return flush(); }
+
+private:
+    bool flush()
+    {
+        if (m_columns.isEmpty() || m_columns.first().isEmpty())
+            return true;
+        m_db.transaction();
+        // 带图片分块的行很大，每条语句少放几行
+        const int rowsPerStatement = m_prefix.contains("blob_chunks") ? 8 : SqlBatch::kDefaultRows;
+        if (!SqlBatch::exec(m_db, m_prefix, m_columns, QString(), rowsPerStatement, &m_error)) {
+            m_db.rollback();
+            return false;
+        }
+        m_db.commit();
+        for (QVariantList &column : m_columns)
+            column.clear();
+        return true;
+    }
+
+    QSqlDatabase m_db;
+    int m_batchRows;
+    QString m_prefix;
+    QList<QVariantList> m_columns;
+};
+
+// 分片输出：分片表（见 ShardRouter）的行按用户 Id 写到所属分片，其余表写主库；
+// user_info 的每一行同时在主库 user_directory 登记（Uid、用户名、邮箱），与 DBManager 注册用户时一致
+class ShardedSink : public Sink
+{
+public:
+    ShardedSink(std::unique_ptr<Sink> home, std::vector<std::unique_ptr<Sink>> shards, const ShardRouter *router)
+        : m_home(std::move(home))
+        , m_shards(std::move(shards))
+        , m_router(router)
+    {}
+
+    bool begin(const QString &table, const QStringList &columns) override
+    {
+        static const QStringList kShardTables{"user_info", "order", "user_collect_flights", "user_post_likes",
+                                              "user_post_favorites"};
+        m_userColumn = -1;
+        m_directory = false;
+        if (!kShardTables.contains(table))
+            return m_home->begin(table, columns);
+        m_userColumn = columns.indexOf(table == "user_info" ? "Uid" : "user_id");
+        for (const auto &shard : m_shards) {
+            if (!shard->begin(table, columns))
+                return false;
+        }
+        if (table == "user_info") {
+            m_directory = true;
+            m_nameColumn = columns.indexOf("User_name");
+            m_emailColumn = columns.indexOf("Email");
+            return m_home->begin("user_directory", {"Uid", "User_name", "Email"});
+        }
+        return true;
+    }
+
+    bool row(const QVariantList &values) override
+    {
+        ++m_rows;
+        if (m_userColumn < 0)
+            return m_home->row(values);
+        const int userId = values.at(m_userColumn).toInt();
+        if (!m_shards[size_t(m_router->shardOf(userId))]->row(values))
+            return false;
+        return !m_directory || m_home->row({userId, values.at(m_nameColumn), values.at(m_emailColumn)});
+    }
+
+    bool end() override
+    {
+        bool ok = true;
+        if (m_userColumn >= 0) {
+            for (const auto &shard : m_shards)
+                ok = shard->end() && ok;
+        }
+        if (m_userColumn < 0 || m_directory)
+            ok = m_home->end() && ok;
+        return ok;
+    }
+
+    QString error() const override
+    {
+        for (const auto &shard : m_shards) {
+            if (!shard->error().isEmpty())
+                return shard->error();
+        }
+        return m_home->error();
+    }
+
+private:
+    std::unique_ptr<Sink> m_home;
+    std::vector<std::unique_ptr<Sink>> m_shards;
+    const ShardRouter *m_router;
+    int m_userColumn = -1; // 路由用的用户 Id 列，-1 表示写主库
+    bool m_directory = false;
+    int m_nameColumn = -1;
+    int m_emailColumn = -1;
+};
+
+// 幂律活跃度：Pareto(alpha) 权重
+WeightedPicker paretoUsers(int count, double alpha, Random &rng)
+{
+    WeightedPicker picker;
+    for (int i = 0; i < count; ++i)
+        picker.add(std::pow(rng.uniform(1e-9, 1.0), -1.0 / alpha));
+    return picker;
+}
+
+// 生成的航班（订单与收藏需要引用）
+struct FlightRow
+{
+    QString id;
+    int route = 0;
+    QDateTime depart;
+    int totalSeats = 0;
+    int sold = 0;
+};
+
+QString digits(Random &rng, int count)
+{
+    QString text;
+    for (int i = 0; i < count; ++i)
+        text.append(QChar('0' + rng.uniformInt(0, 9)));
+    return text;
+}
+
+// 一小组测试图片（照片类：渐变 + 噪声），帖子按序号复用，避免生成百万张图片
+QList<QByteArray> makeImagePool(Random &rng, int count)
+{
+    QList<QByteArray> pool;
+    for (int n = 0; n < count; ++n) {
+        QImage img(480, 320, QImage::Format_RGB32);
+        const QColor a = QColor::fromHsv(rng.uniformInt(0, 359), 120, 220);
+        const QColor b = QColor::fromHsv(rng.uniformInt(0, 359), 160, 140);
+        for (int y = 0; y < img.height(); ++y) {
+            QRgb *line = reinterpret_cast<QRgb *>(img.scanLine(y));
+            const double t = double(y) / img.height();
+            for (int x = 0; x < img.width(); ++x) {
+                const int d = rng.uniformInt(-12, 12);
+                line[x] = qRgb(qBound(0, int(a.red() * (1 - t) + b.red() * t) + d, 255),
+                               qBound(0, int(a.green() * (1 - t) + b.green() * t) + d, 255),
+                               qBound(0, int(a.blue() * (1 - t) + b.blue() * t) + d, 255));
+            }
+        }
+        QByteArray blob;
+        QBuffer buffer(&blob);
+        buffer.open(QIODevice::WriteOnly);
+        img.save(&buffer, "JPG", 80);
+        pool.append(blob);
+    }
+    return pool;
+}
+
+class Generator
+{
+public:
+    Generator(const Options &options, Sink *sink)
+        : m_options(options)
+        , m_sink(sink)
+    {}
+
+    bool run(QTextStream &log)
+    {
+        struct Step
+        {
+            const char *table;
+            bool (Generator::*generate)();
+        };
+        const Step steps[] = {
+            {"flight", &Generator::flights},
+            {"user_info", &Generator::users},
+            {"order", &Generator::orders},
+            {"posts", &Generator::posts},
+            {"blob_chunks", &Generator::postImages},
+            {"user_collect_flights", &Generator::collects},
+            {"user_post_likes", &Generator::likes},
+            {"user_post_favorites", &Generator::favorites},
+        };
+        for (const Step &step : steps) {
+            QElapsedTimer timer;
+            timer.start();
+            const qint64 before = m_sink->rows();
+            if (!(this->*step.generate)() || !m_sink->end()) {
+                log << step.table << "\t失败：" << m_sink->error() << '\n';
+                return false;
+            }
+            const qint64 rows = m_sink->rows() - before;
+            const double seconds = qMax<qint64>(1, timer.elapsed()) / 1e3;
+            log << step.table << '\t' << rows << " 行\t" << QString::number(seconds, 'f', 1) << " s\t"
+                << QString::number(rows / seconds / 1e6 * 60, 'f', 2) << " 百万行/分钟\n";
+            log.flush();
+        }
+        return true;
+    }
+
+private:
+    // 航线（引力模型）+ 按季节、星期排班；余票 = 座位数 - 订单数，在生成订单后回填，因此航班先在内存中生成
+    bool flights()
+    {
+        Random rng = streamFor(m_options.seed, "flight");
+        const int cityCount = int(std::size(kCities));
+        struct Route
+        {
+            int from;
+            int to;
+            double weight;
+        };
+        std::vector<Route> routes;
+        for (int i = 0; i < cityCount; ++i) {
+            for (int j = 0; j < cityCount; ++j) {
+                if (i != j)
+                    routes.push_back({i, j, kCities[i].weight * kCities[j].weight});
+            }
+        }
+        std::sort(routes.begin(), routes.end(), [](const Route &a, const Route &b) { return a.weight > b.weight; });
+        routes.resize(std::min<size_t>(routes.size(), size_t(qMax(1, m_options.routes))));
+        m_routes.clear();
+        WeightedPicker routePicker;
+        for (const Route &route : routes) {
+            m_routes.append({route.from, route.to});
+            routePicker.add(route.weight);
+        }
+
+        // 每条航线固定航司和航班号（同一航班号每天一班）
+        QStringList routeCodes;
+        for (int r = 0; r < m_routes.size(); ++r) {
+            const char *airline = kAirlines[rng.uniformInt(0, int(std::size(kAirlines)) - 1)];
+            routeCodes.append(QString("%1%2").arg(airline).arg(rng.uniformInt(1000, 9999)));
+        }
+
+        m_flights.clear();
+        QHash<QString, int> dailySerial;
+        for (int day = 0; day < m_options.days; ++day) {
+            const QDate date = m_options.startDate.addDays(day);
+            const double factor = kMonthFactor[date.month() - 1] * kWeekdayFactor[date.dayOfWeek() - 1];
+            const int count = int(m_options.flightsPerDay * factor);
+            for (int n = 0; n < count; ++n) {
+                const int route = routePicker.pick(rng);
+                const int serial = dailySerial[QString("%1/%2").arg(day).arg(route)]++;
+                if (serial >= 10)
+                    continue; // 同航线同日最多 10 班
+                FlightRow flight;
+                // 航班号 + 当日序号 + 排班日序号（Flight_id 为主键，同航班号每天一行）
+                flight.id = QString("%1%2%3").arg(routeCodes.at(route)).arg(serial).arg(day, 3, 10, QChar('0'));
+                flight.route = route;
+                // 起飞时刻：早晚两个高峰
+                const double hour = qBound(6.0, rng.bernoulli(0.55) ? rng.normal(8.5, 1.5) : rng.normal(18.5, 2.0),
+                                           23.5);
+                flight.depart = QDateTime(date, QTime(0, 0)).addSecs(qint64(hour * 3600) / 300 * 300);
+                flight.totalSeats = kSeatOptions[rng.uniformInt(0, int(std::size(kSeatOptions)) - 1)];
+                m_flights.append(flight);
+                m_flightPicker.add(routes[size_t(route)].weight * rng.uniform(0.85, 1.15));
+            }
+        }
+
+        // 订单先生成以确定余票
+        Random orderRng = streamFor(m_options.seed, "order");
+        m_orderFlights.clear();
+        m_orderFlights.reserve(m_options.orders);
+        for (int i = 0; i < m_options.orders && !m_flights.isEmpty(); ++i) {
+            int index = m_flightPicker.pick(orderRng);
+            // 售罄则顺延到下一班
+            for (int probe = 0; probe < 8 && m_flights[index].sold >= m_flights[index].totalSeats; ++probe)
+                index = (index + 1) % m_flights.size();
+            if (m_flights[index].sold >= m_flights[index].totalSeats)
+                continue;
+            ++m_flights[index].sold;
+            m_orderFlights.append(index);
+        }
+
+        if (!m_sink->begin("flight",
+                           {"Flight_id", "Departure", "Destination", "depart_time", "arrive_time", "status", "price",
+                            "total_seats", "remain_seats"}))
+            return false;
+        for (const FlightRow &flight : m_flights) {
+            const QPair<int, int> route = m_routes.at(flight.route);
+            const int minutes = rng.uniformInt(80, 280);
+            // 票价：里程近似按时长，季节高峰上浮
+            const double season = kMonthFactor[flight.depart.date().month() - 1];
+            const double price = std::round((300 + minutes * 6.5) * season * rng.uniform(0.85, 1.15) / 10) * 10;
+            const QVariantList row{flight.id,
+                                   QString::fromUtf8(kCities[route.first].name),
+                                   QString::fromUtf8(kCities[route.second].name),
+                                   flight.depart,
+                                   flight.depart.addSecs(minutes * 60),
+                                   0,
+                                   price,
+                                   flight.totalSeats,
+                                   flight.totalSeats - flight.sold};
+            if (!m_sink->row(row))
+                return false;
+        }
+        return true;
+    }
+
+    bool users()
+    {
+        Random rng = streamFor(m_options.seed, "user_info");
+        m_userActivity = paretoUsers(m_options.users, 1.2, rng);
+        if (!m_sink->begin("user_info", {"Uid", "Email", "User_name", "Password", "phone", "idcard"}))
+            return false;
+        // 所有生成用户的密码均为 Passw0rd1（登录压测用）
+        const QString password = QCryptographicHash::hash("Passw0rd1", QCryptographicHash::Sha256).toHex();
+        for (int i = 0; i < m_options.users; ++i) {
+            const int uid = m_options.userIdBase + i;
+            const bool profile = rng.bernoulli(0.7);
+            const QVariantList row{uid,
+                                   QString("user%1@example.com").arg(uid),
+                                   QString("user%1").arg(uid),
+                                   password,
+                                   profile ? QVariant("1" + digits(rng, 10)) : QVariant(),
+                                   profile ? QVariant(digits(rng, 17) + "X") : QVariant()};
+            if (!m_sink->row(row))
+                return false;
+        }
+        return true;
+    }
+
+    bool orders()
+    {
+        Random rng = streamFor(m_options.seed, "order/rows");
+        if (!m_sink->begin("order",
+                           {"order_id", "user_id", "flight_id", "passenger_name", "passenger_idcard", "order_time"}))
+            return false;
+        const char *surnames[] = {"王", "李", "张", "刘", "陈", "杨", "黄", "赵", "吴", "周"};
+        const char *givenNames[] = {"伟", "芳", "娜", "敏", "静", "磊", "洋", "勇", "艳", "杰", "涛", "明"};
+        for (int i = 0; i < m_orderFlights.size(); ++i) {
+            const FlightRow &flight = m_flights.at(m_orderFlights.at(i));
+            const int uid = m_options.userIdBase + m_userActivity.pick(rng);
+            // 平均提前两周订票
+            const QDateTime orderTime = flight.depart.addSecs(-qint64((rng.exponential(14) + 0.1) * 86400));
+            // ORD + 下单日期 + 9 位序号（20 位），比 BookingPipeline::nextOrderId 短，不会与其重复
+            const QString orderId = QString("ORD%1%2")
+                                        .arg(orderTime.date().toString("yyyyMMdd"))
+                                        .arg(i, 9, 10, QChar('0'));
+            const QVariantList row{orderId,
+                                   uid,
+                                   flight.id,
+                                   QString::fromUtf8(surnames[rng.uniformInt(0, int(std::size(surnames)) - 1)])
+                                       + QString::fromUtf8(givenNames[rng.uniformInt(0, int(std::size(givenNames)) - 1)]),
+                                   digits(rng, 17) + "X",
+                                   orderTime};
+            if (!m_sink->row(row))
+                return false;
+        }
+        return true;
+    }
+
+    bool posts()
+    {
+        Random rng = streamFor(m_options.seed, "posts");
+        if (!m_sink->begin("posts", {"id", "title", "content", "user_id", "img_blob", "img_format", "create_time", "status"}))
+            return false;
+        const QDateTime now(m_options.startDate, QTime(12, 0));
+        m_postsWithImage.clear();
+        for (int i = 0; i < m_options.posts; ++i) {
+            const int id = m_options.postIdBase + i;
+            const bool image = rng.bernoulli(m_options.imageRatio);
+            const QString place = QString::fromUtf8(kCities[rng.uniformInt(0, int(std::size(kCities)) - 1)].name);
+            QString content;
+            for (int p = rng.uniformInt(1, 6); p > 0; --p)
+                content += QString("在%1的第%2天，天气很好，推荐大家去看看。\n").arg(place).arg(p);
+            if (image)
+                m_postsWithImage.append(id);
+            const QVariantList row{id,
+                                   QString("%1游记 #%2").arg(place).arg(i),
+                                   content,
+                                   m_options.userIdBase + m_userActivity.pick(rng),
+                                   QVariant(), // 图片写入 blob_chunks
+                                   image ? QVariant("jpg") : QVariant(),
+                                   now.addSecs(-qint64(rng.uniformInt(0, 365 * 24 * 60)) * 60),
+                                   "normal"};
+            if (!m_sink->row(row))
+                return false;
+        }
+        return true;
+    }
+
+    bool postImages()
+    {
+        Random rng = streamFor(m_options.seed, "blob_chunks");
+        const QList<QByteArray> pool = makeImagePool(rng, 32);
+        if (!m_sink->begin("blob_chunks", {"owner_kind", "owner_id", "seq", "data"}))
+            return false;
+        for (int i = 0; i < m_postsWithImage.size(); ++i) {
+            const QByteArray &blob = pool.at(i % pool.size());
+            for (int seq = 0, offset = 0; offset < blob.size(); ++seq, offset += BlobStore::kChunkSize) {
+                const QVariantList row{QString(BlobStore::kPost), m_postsWithImage.at(i), seq,
+                                       blob.mid(offset, BlobStore::kChunkSize)};
+                if (!m_sink->row(row))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    bool collects()
+    {
+        Random rng = streamFor(m_options.seed, "user_collect_flights");
+        if (!m_sink->begin("user_collect_flights", {"user_id", "flight_id"}))
+            return false;
+        for (int i = 0; i < m_options.collects && !m_flights.isEmpty(); ++i) {
+            const QVariantList row{m_options.userIdBase + m_userActivity.pick(rng),
+                                   m_flights.at(m_flightPicker.pick(rng)).id};
+            if (!m_sink->row(row))
+                return false;
+        }
+        return true;
+    }
+
+    bool likes() { return interactions("user_post_likes", m_options.likes); }
+    bool favorites() { return interactions("user_post_favorites", m_options.favorites); }
+
+    // 帖子热度服从 Zipf（s = 1.1），用户按活跃度抽样；重复的 (user, post) 由 IGNORE 去重
+    bool interactions(const char *table, int count)
+    {
+        Random rng = streamFor(m_options.seed, table);
+        if (m_postPicker.size() != m_options.posts) {
+            m_postPicker = WeightedPicker();
+            for (int i = 0; i < m_options.posts; ++i)
+                m_postPicker.add(1.0 / std::pow(i + 1, 1.1));
+        }
+        if (!m_sink->begin(table, {"user_id", "post_id"}))
+            return false;
+        for (int i = 0; i < count && m_options.posts > 0; ++i) {
+            const QVariantList row{m_options.userIdBase + m_userActivity.pick(rng),
+                                   m_options.postIdBase + m_postPicker.pick(rng)};
+            if (!m_sink->row(row))
+                return false;
+        }
+        return true;
+    }
+
+    Options m_options;
+    Sink *m_sink;
+    QList<QPair<int, int>> m_routes; // (出发城市, 到达城市)
+    QList<FlightRow> m_flights;
+    WeightedPicker m_flightPicker;   // 按航线热度抽航班
+    QList<int> m_orderFlights;       // 每个订单对应的航班下标
+    WeightedPicker m_userActivity;   // 用户活跃度（幂律）
+    WeightedPicker m_postPicker;     // 帖子热度（Zipf）
+    QList<int> m_postsWithImage;
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"out", "写出 TSV 与 load.sql 的目录", "dir"});
+    parser.addOption({"db", "直接写入数据库（FLIGHT_DB_DRIVER/DSN/NAME/HOST/PORT/USER/PASSWORD）"});
+    parser.addOption({"seed", "随机种子", "n", "20240601"});
+    parser.addOption({"users", "用户数", "n", "100000"});
+    parser.addOption({"routes", "航线数（引力最高的前 N 条）", "n", "400"});
+    parser.addOption({"days", "排班天数", "n", "60"});
+    // 默认起始日期固定，不取当天：数据只由种子和参数决定
+    parser.addOption({"start-date", "排班起始日期", "yyyy-MM-dd", "2024-06-01"});
+    parser.addOption({"flights-per-day", "平均每天航班数", "n", "1500"});
+    parser.addOption({"orders", "订单数", "n", "500000"});
+    parser.addOption({"posts", "帖子数", "n", "50000"});
+    parser.addOption({"image-ratio", "带图片的帖子比例", "r", "0.3"});
+    parser.addOption({"likes", "点赞数", "n", "400000"});
+    parser.addOption({"favorites", "喜欢数", "n", "150000"});
+    parser.addOption({"collects", "航班收藏数", "n", "200000"});
+    parser.addOption({"user-id-base", "生成用户的 Uid 起点", "n", "1000000"});
+    parser.addOption({"post-id-base", "生成帖子的 id 起点", "n", "1000000"});
+    parser.addOption({"shards", "分片库名或 DSN，逗号分隔（与应用的 FLIGHT_DB_SHARDS 一致）", "list",
+                      qEnvironmentVariable("FLIGHT_DB_SHARDS")});
+    parser.process(app);
+
+    Options options;
+    options.seed = parser.value("seed").toULongLong();
+    options.users = qMax(1, parser.value("users").toInt());
+    options.routes = parser.value("routes").toInt();
+    options.days = qMax(1, parser.value("days").toInt());
+    options.startDate = QDate::fromString(parser.value("start-date"), Qt::ISODate);
+    options.flightsPerDay = qMax(1, parser.value("flights-per-day").toInt());
+    options.orders = qMax(0, parser.value("orders").toInt());
+    options.posts = qMax(0, parser.value("posts").toInt());
+    options.imageRatio = qBound(0.0, parser.value("image-ratio").toDouble(), 1.0);
+    options.likes = qMax(0, parser.value("likes").toInt());
+    options.favorites = qMax(0, parser.value("favorites").toInt());
+    options.collects = qMax(0, parser.value("collects").toInt());
+    options.userIdBase = parser.value("user-id-base").toInt();
+    options.postIdBase = parser.value("post-id-base").toInt();
+    if (!options.startDate.isValid()) {
+        QTextStream(stderr) << "起始日期无效\n";
+        return 1;
+    }
+
+    QTextStream log(stderr);
+    // 与 DBManager 相同的分片配置和虚拟节点数，用户落到的分片与应用路由一致
+    ShardRouter router;
+    router.configure(parser.value("shards").split(',', Qt::SkipEmptyParts));
+    std::unique_ptr<Sink> sink;
+    QList<TsvSink *> tsvs;
+    if (parser.isSet("db")) {
+        const QString driver = qEnvironmentVariable("FLIGHT_DB_DRIVER", "QODBC").toUpper();
+        QSqlDatabase db = QSqlDatabase::addDatabase(driver, "dataset_gen");
+        if (driver == "QMYSQL") {
+            db.setHostName(qEnvironmentVariable("FLIGHT_DB_HOST", "127.0.0.1"));
+            db.setPort(qEnvironmentVariableIsSet("FLIGHT_DB_PORT") ? qEnvironmentVariableIntValue("FLIGHT_DB_PORT")
+                                                                   : 3306);
+            db.setDatabaseName(qEnvironmentVariable("FLIGHT_DB_NAME", "flight_manage_system_db"));
+        } else {
+            db.setDatabaseName(qEnvironmentVariable("FLIGHT_DB_DSN", "QtODBC_MySQL"));
+        }
+        db.setUserName(qEnvironmentVariable("FLIGHT_DB_USER", "GYT"));
+        db.setPassword(qEnvironmentVariable("FLIGHT_DB_PASSWORD", "123456"));
+        if (!db.open()) {
+            log << "连接失败：" << db.lastError().text() << '\n';
+            return 1;
+        }
+        BlobStore::ensureSchema(db);
+        QSqlQuery(db).exec("SET unique_checks = 0");
+        sink.reset(new DbSink(db, options.batchRows));
+        if (router.isEnabled()) {
+            // 打开分片连接并补建分片表、主库用户目录（与应用连接时相同）
+            if (!router.open(db)) {
+                log << "分片连接或建表失败\n";
+                return 1;
+            }
+            std::vector<std::unique_ptr<Sink>> shards;
+            for (int i = 0; i < router.shardCount(); ++i) {
+                QSqlDatabase shard = router.database(i);
+                QSqlQuery(shard).exec("SET unique_checks = 0");
+                shards.push_back(std::make_unique<DbSink>(shard, options.batchRows));
+            }
+            sink.reset(new ShardedSink(std::move(sink), std::move(shards), &router));
+        }
+    } else if (parser.isSet("out")) {
+        const QString out = parser.value("out");
+        tsvs.append(new TsvSink(out));
+        sink.reset(tsvs.first());
+        if (router.isEnabled()) {
+            // 主库需已有 user_directory 表（以同样的分片配置启动一次应用即会创建），分片库需已有分片表
+            std::vector<std::unique_ptr<Sink>> shards;
+            for (int i = 0; i < router.shardCount(); ++i) {
+                tsvs.append(new TsvSink(QDir(out).filePath(QString("shard%1").arg(i))));
+                shards.emplace_back(tsvs.last());
+            }
+            sink.reset(new ShardedSink(std::move(sink), std::move(shards), &router));
+        }
+    } else {
+        parser.showHelp(1);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    Generator generator(options, sink.get());
+    if (!generator.run(log))
+        return 1;
+    for (TsvSink *tsv : tsvs) {
+        if (!tsv->writeScript()) {
+            log << "写出 load.sql 失败\n";
+            return 1;
+        }
+    }
+    log << "合计 " << sink->rows() << " 行，" << QString::number(timer.elapsed() / 1e3, 'f', 1) << " s\n";
+    return 0;
+}
@@ -0,0 +1,264 @@
+// 数据库后端基准：同一工作负载分别经 QODBC 与 QMYSQL 执行，对比往返延迟与批量写入吞吐
+// 用法：db_backend_bench [--backends QODBC,QMYSQL] [--iterations 次数] [--rows 行数]
+//       [--scratch-database 库名] ...
+// 工作负载：按航班号点查（预处理语句重复执行）、条件搜索、三种方式批量插入临时表
+// （逐行 exec / QSqlQuery::execBatch / SqlBatch 多行语句）；插入的延迟按每 --batch 行一组统计
+// 临时表建在 --scratch-database 指定的库中，未指定时跳过插入负载（不在业务库里建表/删表）
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTextStream>
+#include <algorithm>
+#include <functional>
+#include "../SqlBatch.h"
+#include "../SqlStatements.h"
+
+namespace {
+
+struct Config
+{
+    QString dsn;
+    QString host;
+    int port = 3306;
+    QString database;
+    QString user;
+    QString password;
+    QString scratch; // 插入负载使用的库（须显式指定）
+    int iterations = 2000;
+    int rows = 20000;
+    int batchRows = 200;
+};
+
+// 一项工作负载的统计
+struct Sample
+{
+    QString workload;
+    int ops = 0;
+    qint64 totalNs = 0;
+    QList<qint64> latencies; // 单次操作耗时（纳秒）
+};
+
+double percentileUs(QList<qint64> samples, double p)
+{
+    if (samples.isEmpty())
+        return 0;
+    std::sort(samples.begin(), samples.end());
+    const int index = qBound(0, int(p * (samples.size() - 1) + 0.5), int(samples.size()) - 1);
+    return samples.at(index) / 1e3;
+}
+
+// 按驱动建立连接
+QSqlDatabase openBackend(const QString &driver, const Config &config, QString *error)
+{
+    QSqlDatabase db = QSqlDatabase::addDatabase(driver, "bench_" + driver);
+    if (driver == "QMYSQL") {
+        db.setHostName(config.host);
+        db.setPort(config.port);
+        db.setDatabaseName(config.database);
+    } else {
+        db.setDatabaseName(config.dsn);
+    }
+    db.setUserName(config.user);
+    db.setPassword(config.password);
+    if (!db.open())
+        *error = db.lastError().text();
+    return db;
+}
+
+// 重复执行 op 并记录每次耗时
+Sample measure(const QString &workload, int count, const std::function<bool(int)> &op)
+{
+    Sample sample;
+    sample.workload = workload;
+    QElapsedTimer total;
+    total.start();
+    for (int i = 0; i < count; ++i) {
+        QElapsedTimer timer;
+        timer.start();
+        if (!op(i))
+            break;
+        sample.latencies.append(timer.nsecsElapsed());
+        ++sample.ops;
+    }
+    sample.totalNs = total.nsecsElapsed();
+    return sample;
+}
+
+// 批量插入的三种方式，整批一个事务，返回一个样本（ops 为行数，延迟为每组 batchRows 行的耗时）
+// op(begin, count) 写入第 begin 行起的 count 行
+Sample measureInsert(QSqlDatabase &db,
+                     const QString &table,
+                     const QString &workload,
+                     int rows,
+                     int batchRows,
+                     const std::function<bool(int, int)> &op)
+{
+    QSqlQuery(db).exec("TRUNCATE TABLE " + table);
+    Sample sample;
+    sample.workload = workload;
+    QElapsedTimer total;
+    total.start();
+    db.transaction();
+    bool ok = true;
+    for (int begin = 0; ok && begin < rows; begin += batchRows) {
+        const int count = qMin(batchRows, rows - begin);
+        QElapsedTimer timer;
+        timer.start();
+        ok = op(begin, count);
+        if (ok)
+            sample.latencies.append(timer.nsecsElapsed());
+    }
+    ok ? db.commit() : db.rollback();
+    sample.totalNs = total.nsecsElapsed();
+    sample.ops = ok ? rows : 0;
+    if (!ok)
+        sample.latencies.clear();
+    return sample;
+}
+
+QList<Sample> runBackend(QSqlDatabase &db, const Config &config)
+{
+    QList<Sample> samples;
+
+    // 取一个真实航班号做点查
+    QString flightId;
+    QSqlQuery first(db);
+    if (first.exec("SELECT Flight_id FROM flight LIMIT 1") && first.next())
+        flightId = first.value(0).toString();
+
+    QSqlQuery point(db);
+    point.prepare(Sql::Statement<Sql::Id::FlightById>::sql);
+    samples.append(measure("point_select", config.iterations, [&](int) {
+        Sql::bind<Sql::Id::FlightById>(point, flightId);
+        if (!point.exec())
+            return false;
+        while (point.next()) {}
+        return true;
+    }));
+
+    QSqlQuery search(db);
+    search.prepare(Sql::Statement<Sql::Id::FlightSearch>::sql);
+    samples.append(measure("search", qMax(1, config.iterations / 10), [&](int) {
+        if (!search.exec())
+            return false;
+        while (search.next()) {}
+        return true;
+    }));
+
+    // 批量插入临时表：只在显式指定的库中建表
+    if (config.scratch.isEmpty())
+        return samples;
+    const QString table = QString("`%1`.bench_batch").arg(config.scratch);
+    QSqlQuery ddl(db);
+    if (!ddl.exec(QString("CREATE TABLE IF NOT EXISTS %1 (id INT NOT NULL, payload VARCHAR(64) NOT NULL)")
+                      .arg(table))) {
+        QTextStream(stderr) << "创建临时表失败：" << ddl.lastError().text() << '\n';
+        return samples;
+    }
+    QVariantList ids;
+    QVariantList payloads;
+    for (int i = 0; i < config.rows; ++i) {
+        ids.append(i);
+        payloads.append(QString("payload-%1").arg(i));
+    }
+
+    const QString insert = QString("INSERT INTO %1 (id, payload) VALUES ").arg(table);
+    QSqlQuery rowQuery(db);
+    rowQuery.prepare(insert + "(?, ?)");
+    samples.append(measureInsert(db, table, "insert_row_by_row", config.rows, config.batchRows, [&](int begin, int count) {
+        for (int i = begin; i < begin + count; ++i) {
+            rowQuery.bindValue(0, ids.at(i));
+            rowQuery.bindValue(1, payloads.at(i));
+            if (!rowQuery.exec())
+                return false;
+        }
+        return true;
+    }));
+    QSqlQuery batchQuery(db);
+    batchQuery.prepare(insert + "(?, ?)");
+    samples.append(measureInsert(db, table, "insert_execBatch", config.rows, config.batchRows, [&](int begin, int count) {
+        batchQuery.bindValue(0, ids.mid(begin, count));
+        batchQuery.bindValue(1, payloads.mid(begin, count));
+        return batchQuery.execBatch();
+    }));
+    samples.append(measureInsert(db, table, "insert_multi_row", config.rows, config.batchRows, [&](int begin, int count) {
+        return SqlBatch::exec(db, insert, {ids.mid(begin, count), payloads.mid(begin, count)}, QString(), count);
+    }));
+
+    ddl.exec("DROP TABLE IF EXISTS " + table);
+    return samples;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"backends", "要对比的驱动（逗号分隔）", "list", "QODBC,QMYSQL"});
+    parser.addOption({"dsn", "ODBC DSN", "name", "QtODBC_MySQL"});
+    parser.addOption({"host", "MySQL 地址（QMYSQL）", "host", "127.0.0.1"});
+    parser.addOption({"port", "MySQL 端口（QMYSQL）", "port", "3306"});
+    parser.addOption({"database", "数据库名（QMYSQL）", "name", "flight_manage_system_db"});
+    parser.addOption({"user", "用户名", "name", "GYT"});
+    parser.addOption({"password", "密码", "password", "123456"});
+    parser.addOption({"iterations", "点查次数（搜索为其 1/10）", "n", "2000"});
+    parser.addOption({"rows", "批量插入行数", "n", "20000"});
+    parser.addOption({"batch", "插入延迟统计的每组行数", "n", "200"});
+    parser.addOption({"scratch-database", "插入负载建临时表的库（不指定则跳过插入负载）", "name"});
+    parser.process(app);
+
+    Config config;
+    config.dsn = parser.value("dsn");
+    config.host = parser.value("host");
+    config.port = parser.value("port").toInt();
+    config.database = parser.value("database");
+    config.user = parser.value("user");
+    config.password = parser.value("password");
+    config.iterations = qMax(1, parser.value("iterations").toInt());
+    config.rows = qMax(1, parser.value("rows").toInt());
+    config.batchRows = qMax(1, parser.value("batch").toInt());
+    config.scratch = parser.value("scratch-database").trimmed();
+
+    QTextStream err(stderr);
+    if (config.scratch.isEmpty()) {
+        err << "未指定 --scratch-database，跳过插入负载\n";
+    } else if (config.scratch == config.database) {
+        err << "--scratch-database 不能是业务库 " << config.database << '\n';
+        return 1;
+    }
+    err.flush();
+
+    QTextStream out(stdout);
+    out << "backend\tworkload\tops\ttotal_ms\tops_per_s\tp50_us\tp99_us\n";
+
+    const QStringList backends = parser.value("backends").split(',', Qt::SkipEmptyParts);
+    for (const QString &raw : backends) {
+        const QString driver = raw.trimmed().toUpper();
+        if (!QSqlDatabase::isDriverAvailable(driver)) {
+            out << driver << "\t驱动不可用\n";
+            continue;
+        }
+        QString error;
+        QSqlDatabase db = openBackend(driver, config, &error);
+        if (!db.isOpen()) {
+            out << driver << "\t连接失败：" << error << '\n';
+            continue;
+        }
+        for (const Sample &sample : runBackend(db, config)) {
+            const double totalMs = sample.totalNs / 1e6;
+            out << driver << '\t' << sample.workload << '\t' << sample.ops << '\t'
+                << QString::number(totalMs, 'f', 1) << '\t'
+                << QString::number(totalMs > 0 ? sample.ops / (totalMs / 1e3) : 0, 'f', 0) << '\t'
+                << QString::number(percentileUs(sample.latencies, 0.50), 'f', 1) << '\t'
+                << QString::number(percentileUs(sample.latencies, 0.99), 'f', 1) << '\n';
+            out.flush();
+        }
+        db.close();
+    }
+    return 0;
+}
@@ -0,0 +1,473 @@
+// 故障注入代理：监听本地端口，把连接转发到 MySQL，并在转发路径上注入延迟、抖动、带宽上限、
+// 连接重置/挂死和拒绝连接，用于观察重试、超时与缓存在劣化网络下的表现
+//
+// 用法：fault_proxy [--listen 13306] [--upstream 127.0.0.1:3306] [--latency ms] [--jitter ms]
+//                   [--bandwidth KB/s] [--fault-rate 次/分钟] [--fault reset|stall] [--refuse 比例]
+//                   [--control 端口] [--seed 种子]
+// 应用经代理连接：FLIGHT_DB_DRIVER=QMYSQL FLIGHT_DB_HOST=127.0.0.1 FLIGHT_DB_PORT=13306
+// （ODBC 则把 DSN 的服务器端口指向代理）；基准工具同理
+//
+// 控制端口（可选）接受一行一条的文本命令，便于压测过程中改变网络状况：
+//   latency <ms> | jitter <ms> | bandwidth <KB/s> | fault-rate <次/分钟> | fault reset|stall
+//   refuse <0~1> | kill（重置全部现有连接）| heal（清除全部故障）| stats
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTextStream>
+#include <QTimer>
+#include <algorithm>
+#include <deque>
+#include <random>
+#ifdef Q_OS_WIN
+#include <winsock2.h>
+#else
+#include <sys/socket.h>
+#endif
+
+namespace {
+
+// 可在运行中修改的故障参数
+struct Faults
+{
+    int latencyMs = 0;      // 单向附加延迟
+    int jitterMs = 0;       // 延迟在 ±jitter 内均匀抖动
+    int bandwidthKBps = 0;  // 每连接每方向带宽上限，0 为不限
+    double faultRate = 0;   // 每连接每分钟发生故障的期望次数
+    bool stall = false;     // 故障方式：false 为重置连接，true 为挂死（不再转发也不关闭）
+    double refuse = 0;      // 新连接被直接重置的比例
+};
+
+// 统计
+struct Counters
+{
+    quint64 accepted = 0;
+    quint64 refused = 0;
+    quint64 resets = 0;
+    quint64 stalls = 0;
+    quint64 upstreamErrors = 0;
+    quint64 bytesUp = 0;   // 客户端 → 数据库
+    quint64 bytesDown = 0; // 数据库 → 客户端
+};
+
+constexpr qint64 kMaxBuffered = 1 << 20; // 每方向最多缓冲 1 MB，超出后停止读取，靠 TCP 窗口反压
+
+// 以 RST 关闭连接（SO_LINGER=0），模拟网络中断而不是正常断开
+void resetSocket(QTcpSocket *socket)
+{
+    if (socket->socketDescriptor() != -1) {
+        linger option{1, 0};
+        ::setsockopt(socket->socketDescriptor(), SOL_SOCKET, SO_LINGER, reinterpret_cast<const char *>(&option),
+                     sizeof(option));
+    }
+    socket->abort();
+}
+
+// 一个方向的转发：数据带到期时间入队，到期后按令牌桶限速写出
+class Pipe
+{
+public:
+    Pipe(QTcpSocket *from, QTcpSocket *to, quint64 *bytes)
+        : m_from(from)
+        , m_to(to)
+        , m_bytes(bytes)
+    {}
+
+    // 读取可用数据并按当前延迟设置到期时间
+    void read(qint64 nowMs, const Faults &faults, std::mt19937_64 &rng)
+    {
+        while (m_from->bytesAvailable() > 0 && m_queued + m_to->bytesToWrite() < kMaxBuffered) {
+            QByteArray data = m_from->read(kMaxBuffered - m_queued);
+            if (data.isEmpty())
+                break;
+            qint64 delay = faults.latencyMs;
+            if (faults.jitterMs > 0)
+                delay += std::uniform_int_distribution<int>(-faults.jitterMs, faults.jitterMs)(rng);
+            // TCP 保序：抖动不能让后到的数据先送达
+            m_lastDueMs = qMax(m_lastDueMs, nowMs + qMax<qint64>(0, delay));
+            m_queued += data.size();
+            m_chunks.push_back({std::move(data), m_lastDueMs});
+        }
+    }
+
+    // 写出已到期的数据
+    void pump(qint64 nowMs, const Faults &faults)
+    {
+        if (m_to->state() != QAbstractSocket::ConnectedState)
+            return;
+        if (faults.bandwidthKBps > 0) {
+            const double rate = faults.bandwidthKBps * 1024.0 / 1000.0; // 字节/毫秒
+            m_tokens = qMin(m_tokens + (nowMs - m_refillMs) * rate, qMax(rate * 50, 1460.0)); // 突发上限 50 ms
+        }
+        m_refillMs = nowMs;
+        while (!m_chunks.empty() && m_chunks.front().dueMs <= nowMs) {
+            Chunk &chunk = m_chunks.front();
+            qint64 size = chunk.data.size() - chunk.offset;
+            if (faults.bandwidthKBps > 0) {
+                size = qMin(size, qint64(m_tokens));
+                if (size <= 0)
+                    break;
+                m_tokens -= size;
+            }
+            m_to->write(chunk.data.constData() + chunk.offset, size);
+            *m_bytes += quint64(size);
+            m_queued -= size;
+            chunk.offset += size;
+            if (chunk.offset < chunk.data.size())
+                break;
+            m_chunks.pop_front();
+        }
+        // 来源已关闭且数据已全部送出：把关闭传给另一端
+        if (m_fromClosed && m_chunks.empty() && m_from->bytesAvailable() == 0 && !m_closeForwarded) {
+            m_closeForwarded = true;
+            m_to->disconnectFromHost();
+        }
+    }
+
+    void markFromClosed() { m_fromClosed = true; }
+    bool hasQueued() const { return !m_chunks.empty(); } // 还有未到期或受限速未写出的数据
+
+private:
+    struct Chunk
+    {
+        QByteArray data;
+        qint64 dueMs = 0;
+        qint64 offset = 0;
+    };
+
+    QTcpSocket *m_from;
+    QTcpSocket *m_to;
+    quint64 *m_bytes;
+    std::deque<Chunk> m_chunks;
+    qint64 m_queued = 0;
+    qint64 m_lastDueMs = 0;
+    double m_tokens = 0;
+    qint64 m_refillMs = 0;
+    bool m_fromClosed = false;
+    bool m_closeForwarded = false;
+};
+
+// 一条被代理的连接：客户端与上游各一个套接字，两个方向各一个 Pipe
+class Link : public QObject
+{
+public:
+    Link(QTcpSocket *client, const QString &host, quint16 port, qint64 faultAtMs, Counters *counters,
+         QObject *parent)
+        : QObject(parent)
+        , m_client(client)
+        , m_upstream(new QTcpSocket(this))
+        , m_up(client, m_upstream, &counters->bytesUp)
+        , m_down(m_upstream, client, &counters->bytesDown)
+        , m_faultAtMs(faultAtMs)
+        , m_counters(counters)
+    {
+        m_client->setParent(this);
+        m_client->setReadBufferSize(kMaxBuffered);
+        m_upstream->setReadBufferSize(kMaxBuffered);
+        m_client->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        m_upstream->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        QObject::connect(m_client, &QTcpSocket::disconnected, this, [this]() { m_up.markFromClosed(); });
+        QObject::connect(m_upstream, &QTcpSocket::disconnected, this, [this]() { m_down.markFromClosed(); });
+        QObject::connect(m_upstream, &QTcpSocket::errorOccurred, this, [this](QAbstractSocket::SocketError error) {
+            if (error != QAbstractSocket::RemoteHostClosedError && m_upstream->state() != QAbstractSocket::ConnectedState) {
+                ++m_counters->upstreamErrors;
+                resetSocket(m_client);
+            }
+        });
+        m_upstream->connectToHost(host, port);
+    }
+
+    // 每个时钟周期调用：读、写、检查是否到了故障时刻；返回连接是否已结束
+    bool tick(qint64 nowMs, const Faults &faults, std::mt19937_64 &rng)
+    {
+        if (m_stalled) {
+            // 挂死期间任一端放弃连接，另一端随之关闭
+            if (m_client->state() == QAbstractSocket::UnconnectedState)
+                m_upstream->abort();
+            else if (m_upstream->state() == QAbstractSocket::UnconnectedState)
+                m_client->abort();
+            return finished();
+        }
+        if (m_faultAtMs >= 0 && nowMs >= m_faultAtMs) {
+            m_faultAtMs = -1;
+            if (faults.stall) {
+                ++m_counters->stalls;
+                m_stalled = true; // 数据留在内核缓冲区，双方都收不到任何东西
+                return false;
+            }
+            kill();
+            return true;
+        }
+        m_up.read(nowMs, faults, rng);
+        m_down.read(nowMs, faults, rng);
+        m_up.pump(nowMs, faults);
+        m_down.pump(nowMs, faults);
+        return finished();
+    }
+
+    void kill()
+    {
+        ++m_counters->resets;
+        resetSocket(m_client);
+        resetSocket(m_upstream);
+    }
+
+    QTcpSocket *client() const { return m_client; }
+    QTcpSocket *upstream() const { return m_upstream; }
+    // 需要时钟驱动：有排队等待到期/限速的数据，或有尚未发生的故障
+    bool needsClock() const { return m_up.hasQueued() || m_down.hasQueued() || m_faultAtMs >= 0; }
+
+private:
+    bool finished() const
+    {
+        return m_client->state() == QAbstractSocket::UnconnectedState
+               && m_upstream->state() == QAbstractSocket::UnconnectedState;
+    }
+
+    QTcpSocket *m_client;
+    QTcpSocket *m_upstream;
+    Pipe m_up;
+    Pipe m_down;
+    qint64 m_faultAtMs; // 故障时刻，-1 为不发生
+    bool m_stalled = false;
+    Counters *m_counters;
+};
+
+class Proxy : public QObject
+{
+public:
+    Proxy(const QString &host, quint16 port, const Faults &faults, quint64 seed)
+        : m_host(host)
+        , m_port(port)
+        , m_faults(faults)
+        , m_rng(seed)
+    {
+        m_clock.start();
+        QObject::connect(&m_server, &QTcpServer::newConnection, this, [this]() { accept(); });
+        QObject::connect(&m_control, &QTcpServer::newConnection, this, [this]() { acceptControl(); });
+        // 收发由套接字事件驱动，没有延迟时数据到达即转发；1 ms 精度的统一时钟只在有连接
+        // 需要它时运行（数据排队等待延迟到期或限速令牌、故障时刻未到）
+        m_ticker.setTimerType(Qt::PreciseTimer);
+        m_ticker.setInterval(1);
+        QObject::connect(&m_ticker, &QTimer::timeout, this, [this]() { tick(); });
+    }
+
+    bool listen(quint16 port, quint16 controlPort, QString *error)
+    {
+        if (!m_server.listen(QHostAddress::LocalHost, port)) {
+            *error = m_server.errorString();
+            return false;
+        }
+        if (controlPort != 0 && !m_control.listen(QHostAddress::LocalHost, controlPort)) {
+            *error = m_control.errorString();
+            return false;
+        }
+        return true;
+    }
+
+    QString stats() const
+    {
+        return QString("t=%1s active=%2 accepted=%3 refused=%4 resets=%5 stalls=%6 upstream_errors=%7 "
+                       "up=%8KB down=%9KB latency=%10ms jitter=%11ms bandwidth=%12KB/s fault_rate=%13/min fault=%14 refuse=%15")
+            .arg(m_clock.elapsed() / 1000)
+            .arg(m_links.size())
+            .arg(m_counters.accepted)
+            .arg(m_counters.refused)
+            .arg(m_counters.resets)
+            .arg(m_counters.stalls)
+            .arg(m_counters.upstreamErrors)
+            .arg(m_counters.bytesUp / 1024)
+            .arg(m_counters.bytesDown / 1024)
+            .arg(m_faults.latencyMs)
+            .arg(m_faults.jitterMs)
+            .arg(m_faults.bandwidthKBps)
+            .arg(m_faults.faultRate)
+            .arg(m_faults.stall ? "stall" : "reset")
+            .arg(m_faults.refuse);
+    }
+
+private:
+    void accept()
+    {
+        while (QTcpSocket *client = m_server.nextPendingConnection()) {
+            ++m_counters.accepted;
+            if (m_faults.refuse > 0 && std::uniform_real_distribution<double>(0, 1)(m_rng) < m_faults.refuse) {
+                ++m_counters.refused;
+                resetSocket(client);
+                client->deleteLater();
+                continue;
+            }
+            Link *link = new Link(client, m_host, m_port, drawFaultTime(), &m_counters, this);
+            m_links.append(link);
+            for (QTcpSocket *socket : {link->client(), link->upstream()}) {
+                QObject::connect(socket, &QTcpSocket::readyRead, link, [this, link]() { service(link); });
+                QObject::connect(socket, &QTcpSocket::bytesWritten, link, [this, link]() { service(link); });
+                QObject::connect(socket, &QTcpSocket::connected, link, [this, link]() { service(link); });
+                // 排队执行：abort()/disconnectFromHost() 会在 tick 内同步发出 disconnected
+                QObject::connect(socket, &QTcpSocket::disconnected, link, [this, link]() { service(link); },
+                                 Qt::QueuedConnection);
+            }
+        }
+        updateTicker();
+    }
+
+    // 套接字事件：立即收发一次（数据没有延迟时当场转发），连接结束则移除
+    void service(Link *link)
+    {
+        if (!m_links.contains(link))
+            return;
+        if (link->tick(m_clock.elapsed(), m_faults, m_rng)) {
+            m_links.removeOne(link);
+            link->deleteLater();
+        }
+        updateTicker();
+    }
+
+    void updateTicker()
+    {
+        const bool needed = std::any_of(m_links.cbegin(), m_links.cend(), [](const Link *link) {
+            return link->needsClock();
+        });
+        if (needed && !m_ticker.isActive())
+            m_ticker.start();
+        else if (!needed && m_ticker.isActive())
+            m_ticker.stop();
+    }
+
+    // 按指数分布抽取连接的故障时刻（泊松过程）
+    qint64 drawFaultTime()
+    {
+        if (m_faults.faultRate <= 0)
+            return -1;
+        const double lifetimeMs = std::exponential_distribution<double>(m_faults.faultRate / 60000.0)(m_rng);
+        return m_clock.elapsed() + qint64(lifetimeMs);
+    }
+
+    void tick()
+    {
+        const qint64 now = m_clock.elapsed();
+        for (int i = m_links.size() - 1; i >= 0; --i) {
+            if (m_links.at(i)->tick(now, m_faults, m_rng)) {
+                m_links.at(i)->deleteLater();
+                m_links.removeAt(i);
+            }
+        }
+        updateTicker();
+    }
+
+    void acceptControl()
+    {
+        while (QTcpSocket *socket = m_control.nextPendingConnection()) {
+            socket->setParent(this);
+            QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            QObject::connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+                while (socket->canReadLine()) {
+                    const QString line = QString::fromUtf8(socket->readLine()).trimmed();
+                    socket->write((command(line) + '\n').toUtf8());
+                }
+            });
+        }
+    }
+
+    // 执行一条控制命令，返回应答
+    QString command(const QString &line)
+    {
+        const QStringList words = line.split(' ', Qt::SkipEmptyParts);
+        if (words.isEmpty())
+            return "error empty";
+        const QString name = words.first().toLower();
+        const QString value = words.value(1);
+        bool ok = true;
+        if (name == "latency") {
+            m_faults.latencyMs = qMax(0, value.toInt(&ok));
+        } else if (name == "jitter") {
+            m_faults.jitterMs = qMax(0, value.toInt(&ok));
+        } else if (name == "bandwidth") {
+            m_faults.bandwidthKBps = qMax(0, value.toInt(&ok));
+        } else if (name == "fault-rate") {
+            m_faults.faultRate = qMax(0.0, value.toDouble(&ok));
+        } else if (name == "fault") {
+            ok = value == "reset" || value == "stall";
+            if (ok)
+                m_faults.stall = value == "stall";
+        } else if (name == "refuse") {
+            m_faults.refuse = qBound(0.0, value.toDouble(&ok), 1.0);
+        } else if (name == "kill") {
+            for (Link *link : std::as_const(m_links))
+                link->kill();
+        } else if (name == "heal") {
+            m_faults = Faults();
+        } else if (name != "stats") {
+            return "error unknown command: " + name;
+        }
+        if (!ok)
+            return "error bad value: " + line;
+        QTextStream(stdout) << "# " << line << '\n';
+        return "ok " + stats();
+    }
+
+    QString m_host;
+    quint16 m_port;
+    Faults m_faults;
+    Counters m_counters;
+    std::mt19937_64 m_rng;
+    QTcpServer m_server;
+    QTcpServer m_control;
+    QTimer m_ticker;
+    QElapsedTimer m_clock;
+    QList<Link *> m_links;
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"listen", "本地监听端口", "port", "13306"});
+    parser.addOption({"upstream", "数据库地址 host:port", "addr", "127.0.0.1:3306"});
+    parser.addOption({"latency", "单向附加延迟（毫秒）", "ms", "0"});
+    parser.addOption({"jitter", "延迟抖动幅度（毫秒）", "ms", "0"});
+    parser.addOption({"bandwidth", "每连接每方向带宽上限（KB/s，0 为不限）", "kbps", "0"});
+    parser.addOption({"fault-rate", "每连接每分钟故障次数期望", "n", "0"});
+    parser.addOption({"fault", "故障方式：reset（重置连接）或 stall（挂死）", "kind", "reset"});
+    parser.addOption({"refuse", "新连接被拒绝的比例（0~1）", "ratio", "0"});
+    parser.addOption({"control", "控制端口（0 为不开启）", "port", "0"});
+    parser.addOption({"report", "统计输出间隔（秒）", "s", "10"});
+    parser.addOption({"seed", "随机种子（故障时刻与抖动可复现）", "n", "1"});
+    parser.process(app);
+
+    const QString upstream = parser.value("upstream");
+    const int colon = upstream.lastIndexOf(':');
+    const QString host = colon > 0 ? upstream.left(colon) : upstream;
+    const quint16 port = colon > 0 ? quint16(upstream.mid(colon + 1).toUInt()) : 3306;
+
+    Faults faults;
+    faults.latencyMs = qMax(0, parser.value("latency").toInt());
+    faults.jitterMs = qMax(0, parser.value("jitter").toInt());
+    faults.bandwidthKBps = qMax(0, parser.value("bandwidth").toInt());
+    faults.faultRate = qMax(0.0, parser.value("fault-rate").toDouble());
+    faults.stall = parser.value("fault") == "stall";
+    faults.refuse = qBound(0.0, parser.value("refuse").toDouble(), 1.0);
+
+    Proxy proxy(host, port, faults, parser.value("seed").toULongLong());
+    QString error;
+    if (!proxy.listen(quint16(parser.value("listen").toUInt()), quint16(parser.value("control").toUInt()), &error)) {
+        QTextStream(stderr) << "监听失败：" << error << '\n';
+        return 1;
+    }
+
+    QTextStream out(stdout);
+    out << "# " << parser.value("listen") << " -> " << upstream << '\n' << proxy.stats() << '\n';
+    out.flush();
+    QTimer report;
+    QObject::connect(&report, &QTimer::timeout, &proxy, [&]() {
+        out << proxy.stats() << '\n';
+        out.flush();
+    });
+    report.start(qMax(1, parser.value("report").toInt()) * 1000);
+    return app.exec();
+}
@@ -0,0 +1,165 @@
+// 图片上传入库基准：对比旧路径（全尺寸解码 + 平滑缩放）与 ImageCodec 缩小解码路径
+// 用法：image_ingest_bench [--dir 夹具目录] [--runs 次数]
+// 夹具不存在时自动生成（4800 万像素 JPEG、1200 万像素 JPEG、4K PNG 截图）
+#include <QBuffer>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGuiApplication>
+#include <QPainter>
+#include <QRandomGenerator>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <algorithm>
+#include "../ImageCodec.h"
+
+namespace {
+
+struct Fixture
+{
+    QString name;
+    QSize size;
+    QByteArray format;
+    bool photo; // 照片类（噪声 + 渐变）或截图类（色块 + 文字）
+};
+
+// 生成测试图片
+bool generateFixture(const QString &path, const Fixture &fixture)
+{
+    QImage img(fixture.size, QImage::Format_RGB32);
+    QPainter painter(&img);
+    if (fixture.photo) {
+        QLinearGradient gradient(0, 0, fixture.size.width(), fixture.size.height());
+        gradient.setColorAt(0, QColor(30, 90, 160));
+        gradient.setColorAt(1, QColor(220, 180, 90));
+        painter.fillRect(img.rect(), gradient);
+        painter.end();
+        // 加入噪声，使 JPEG 体积接近真实照片
+        QRandomGenerator rng(42);
+        for (int y = 0; y < img.height(); ++y) {
+            QRgb *line = reinterpret_cast<QRgb *>(img.scanLine(y));
+            for (int x = 0; x < img.width(); ++x) {
+                const int n = int(rng.bounded(24)) - 12;
+                const QRgb p = line[x];
+                line[x] = qRgb(qBound(0, qRed(p) + n, 255),
+                               qBound(0, qGreen(p) + n, 255),
+                               qBound(0, qBlue(p) + n, 255));
+            }
+        }
+    } else {
+        painter.fillRect(img.rect(), QColor(245, 245, 245));
+        for (int i = 0; i < 40; ++i) {
+            painter.fillRect(QRect(i * 90 % fixture.size.width(), i * 50 % fixture.size.height(), 600, 120),
+                             QColor::fromHsv(i * 37 % 360, 120, 230));
+            painter.drawText(QPoint(40, 60 + i * 50), QString("航班 CA%1 北京 -> 上海").arg(1000 + i));
+        }
+        painter.end();
+    }
+    return img.save(path, fixture.format.constData(), 92);
+}
+
+// 旧路径：QImage::load 全尺寸解码后平滑缩放
+QByteArray legacyIngest(const QString &path, qint64 *peakDecodedBytes)
+{
+    QImage img;
+    if (!img.load(path))
+        return QByteArray();
+    *peakDecodedBytes = img.sizeInBytes();
+    if (img.width() > ImageCodec::kMaxWidth || img.height() > ImageCodec::kMaxHeight) {
+        img = img.scaled(ImageCodec::kMaxWidth, ImageCodec::kMaxHeight, Qt::KeepAspectRatio,
+                         Qt::SmoothTransformation);
+        *peakDecodedBytes = qMax(*peakDecodedBytes, img.sizeInBytes());
+    }
+    QByteArray blob;
+    QBuffer buffer(&blob);
+    buffer.open(QIODevice::WriteOnly);
+    img.save(&buffer, path.endsWith(".png") ? "PNG" : "JPG", 80);
+    return blob;
+}
+
+// 新路径：与上传入库相同的 ImageCodec::encodeFile（一次缩小解码 + 存储编码），峰值为最大的中间图像
+QByteArray reducedIngest(const QString &path, qint64 *peakDecodedBytes)
+{
+    const ImageCodec::Encoded encoded = ImageCodec::encodeFile(path, 80);
+    *peakDecodedBytes = encoded.peakDecodedBytes;
+    return encoded.blob;
+}
+
+// 进程峰值常驻内存（仅 Linux，单调递增，因此先跑新路径再跑旧路径）
+qint64 peakRssKb()
+{
+    QFile status("/proc/self/status");
+    if (!status.open(QIODevice::ReadOnly | QIODevice::Text))
+        return -1;
+    while (!status.atEnd()) {
+        const QByteArray line = status.readLine();
+        if (line.startsWith("VmHWM:"))
+            return line.mid(6).trimmed().split(' ').first().toLongLong();
+    }
+    return -1;
+}
+
+double medianMs(QList<qint64> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    return samples.isEmpty() ? 0 : samples.at(samples.size() / 2) / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({"dir", "夹具目录", "path",
+                      QDir(QStandardPaths::writableLocation(QStandardPaths::TempLocation))
+                          .filePath("flight_image_fixtures")});
+    parser.addOption({"runs", "每个夹具的重复次数", "n", "5"});
+    parser.process(app);
+
+    const QString dir = parser.value("dir");
+    const int runs = qMax(1, parser.value("runs").toInt());
+    QDir().mkpath(dir);
+
+    const QList<Fixture> fixtures = {
+        {"photo_48mp.jpg", QSize(8000, 6000), "JPG", true},
+        {"photo_12mp.jpg", QSize(4032, 3024), "JPG", true},
+        {"screenshot_4k.png", QSize(3840, 2160), "PNG", false},
+    };
+
+    QTextStream out(stdout);
+    out << "fixture\tpath\tmedian_ms\tpeak_decoded_MB\tblob_KB\tpeak_rss_MB\n";
+
+    for (const Fixture &fixture : fixtures) {
+        const QString path = QDir(dir).filePath(fixture.name);
+        if (!QFile::exists(path) && !generateFixture(path, fixture)) {
+            out << fixture.name << "\t夹具生成失败\n";
+            continue;
+        }
+
+        const QList<QPair<QString, QByteArray (*)(const QString &, qint64 *)>> paths = {
+            {"reduced", &reducedIngest},
+            {"legacy", &legacyIngest},
+        };
+        for (const auto &entry : paths) {
+            QList<qint64> samples;
+            qint64 decodedBytes = 0;
+            QByteArray blob;
+            for (int i = 0; i < runs; ++i) {
+                QElapsedTimer timer;
+                timer.start();
+                blob = entry.second(path, &decodedBytes);
+                samples.append(timer.nsecsElapsed());
+            }
+            out << fixture.name << '\t' << entry.first << '\t'
+                << QString::number(medianMs(samples), 'f', 1) << '\t'
+                << QString::number(decodedBytes / 1048576.0, 'f', 1) << '\t'
+                << blob.size() / 1024 << '\t'
+                << QString::number(peakRssKb() / 1024.0, 'f', 1) << '\n';
+            out.flush();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,489 @@
+// 多步骤用户旅程压测：场景脚本（JSON）描述若干旅程及其权重，每个旅程是一串 DBManager 操作
+// （login → queryFlightsByCondition → collectFlight → createOrder → queryMyOrders，管理员报表等），
+// 步骤之间有思考时间；报告各步骤延迟分位数和随时间变化的吞吐
+//
+// 用法：scenario_runner <场景.json> [--users N] [--duration 秒]
+// 数据库由 FLIGHT_DB_* 环境变量指定；虚拟用户取 Uid 最大的 N 个用户（dataset_gen 生成的用户密码为 Passw0rd1）
+//
+// 与 trace_replay 相同，每个步骤直接调用真实的 DBManager（幂等、缓存、分片等都在路径上）；
+// DBManager 是每进程一个连接的单例，因此每个虚拟用户一个子进程。数据库的 max_connections 需大于虚拟用户数
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include <random>
+#include "../DBManager.h"
+
+namespace {
+
+struct StepSpec
+{
+    QString op;
+    int thinkMinMs = 1000;
+    int thinkMaxMs = 3000;
+};
+
+struct Journey
+{
+    QString name;
+    double weight = 1;
+    QList<StepSpec> steps;
+};
+
+struct Scenario
+{
+    int users = 100;
+    int durationS = 120;
+    int rampUpS = 30;
+    int reportIntervalS = 10;
+    QString password = "Passw0rd1";
+    bool bookingProcedure = false; // createOrder 走 sp_book_seat（否则走事务 + 两条语句）
+    QList<Journey> journeys;
+};
+
+// 虚拟用户状态
+struct VirtualUser
+{
+    int userId = 0;
+    QString userName;
+    QString idcard;
+    QString flightId; // 搜索结果中选中的航班
+    std::mt19937_64 rng;
+};
+
+// 步骤统计
+struct StepStats
+{
+    QList<qint64> latenciesUs;
+    int errors = 0;
+    QString lastError;
+};
+
+// 时间窗口统计
+struct Window
+{
+    quint64 ops = 0;
+    quint64 errors = 0;
+    quint64 journeys = 0;
+};
+
+qint64 percentile(QList<qint64> &sorted, double p)
+{
+    if (sorted.isEmpty())
+        return 0;
+    return sorted.at(qBound(0, int(p * (sorted.size() - 1) + 0.5), int(sorted.size()) - 1));
+}
+
+// 等待到指定时刻，期间让 DBManager 的定时器（批量写库、热点预热等）照常运行
+void waitUntil(qint64 epochMs)
+{
+    for (;;) {
+        const qint64 remaining = epochMs - QDateTime::currentMSecsSinceEpoch();
+        if (remaining <= 0)
+            return;
+        QCoreApplication::processEvents();
+        QThread::msleep(quint64(qMin<qint64>(remaining, 50)));
+    }
+}
+
+bool loadScenario(const QString &path, Scenario *scenario, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+    QJsonParseError parseError;
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll(), &parseError).object();
+    if (parseError.error != QJsonParseError::NoError) {
+        *error = parseError.errorString();
+        return false;
+    }
+    scenario->users = root.value("users").toInt(scenario->users);
+    scenario->durationS = root.value("duration_s").toInt(scenario->durationS);
+    scenario->rampUpS = root.value("ramp_up_s").toInt(scenario->rampUpS);
+    scenario->reportIntervalS = qMax(1, root.value("report_interval_s").toInt(scenario->reportIntervalS));
+    scenario->password = root.value("password").toString(scenario->password);
+    scenario->bookingProcedure = root.value("booking").toString() == "procedure";
+
+    static const QStringList kOps = {"login", "queryFlightsByCondition", "collectFlight", "createOrder",
+                                     "queryMyOrders", "queryAllOrders", "queryAllFlights"};
+    for (const QJsonValue &value : root.value("journeys").toArray()) {
+        const QJsonObject object = value.toObject();
+        Journey journey;
+        journey.name = object.value("name").toString();
+        journey.weight = object.value("weight").toDouble(1);
+        for (const QJsonValue &stepValue : object.value("steps").toArray()) {
+            const QJsonObject stepObject = stepValue.toObject();
+            StepSpec step;
+            step.op = stepObject.value("op").toString();
+            if (!kOps.contains(step.op)) {
+                *error = QString("旅程 %1 中的未知操作：%2").arg(journey.name, step.op);
+                return false;
+            }
+            const QJsonArray think = stepObject.value("think_ms").toArray();
+            if (think.size() == 2) {
+                step.thinkMinMs = think.at(0).toInt();
+                step.thinkMaxMs = think.at(1).toInt();
+            }
+            journey.steps.append(step);
+        }
+        if (journey.steps.isEmpty() || journey.weight <= 0) {
+            *error = QString("旅程 %1 没有步骤或权重无效").arg(journey.name);
+            return false;
+        }
+        scenario->journeys.append(journey);
+    }
+    if (scenario->journeys.isEmpty()) {
+        *error = "场景中没有旅程";
+        return false;
+    }
+    return true;
+}
+
+// 准备压测计划（虚拟用户与可搜索航线），写入文件供各子进程读取
+// 航线（出发地、目的地、日期）按航班数加权，只取未起飞的航班
+bool writePlan(DBManager *db, int users, const QString &path, QString *error)
+{
+    QVariantList allUsers = db->queryAllUser();
+    std::sort(allUsers.begin(), allUsers.end(), [](const QVariant &a, const QVariant &b) {
+        return a.toMap().value("Uid").toInt() > b.toMap().value("Uid").toInt();
+    });
+    QJsonArray userArray;
+    for (int i = 0; i < allUsers.size() && i < users; ++i) {
+        const QVariantMap user = allUsers.at(i).toMap();
+        userArray.append(QJsonArray{user.value("Uid").toInt(), user.value("User_name").toString(),
+                                    user.value("idcard").toString()});
+    }
+    if (userArray.isEmpty()) {
+        *error = "没有用户，可先用 dataset_gen 生成数据";
+        return false;
+    }
+
+    const QString now = QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss");
+    QMap<QStringList, int> routeFlights;
+    for (const QVariant &value : db->queryAllFlights()) {
+        const QVariantMap flight = value.toMap();
+        const QString departTime = flight.value("depart_time").toString();
+        if (departTime < now)
+            continue;
+        ++routeFlights[{flight.value("Departure").toString(), flight.value("Destination").toString(),
+                        departTime.left(10)}];
+    }
+    QList<QPair<int, QStringList>> routes;
+    for (auto it = routeFlights.constBegin(); it != routeFlights.constEnd(); ++it)
+        routes.append({it.value(), it.key()});
+    std::stable_sort(routes.begin(), routes.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+    QJsonArray routeArray;
+    for (int i = 0; i < routes.size() && i < 2000; ++i) {
+        const QStringList &route = routes.at(i).second;
+        routeArray.append(QJsonArray{route.at(0), route.at(1), route.at(2), routes.at(i).first});
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(QJsonObject{{"users", userArray}, {"routes", routeArray}}).toJson());
+    QTextStream(stderr) << "加载 " << userArray.size() << " 个用户、" << routeArray.size() << " 条可搜索航线\n";
+    return true;
+}
+
+// 虚拟用户子进程：从 startAt 开始（按序号爬坡）循环执行旅程，到时长结束为止
+// 每个步骤输出一行：步骤\t相对开始的毫秒\t耗时us\t是否成功\t是否完成旅程\t错误信息
+class VirtualUserRunner
+{
+public:
+    VirtualUserRunner(const Scenario &scenario, const QJsonObject &plan, int index)
+        : m_scenario(scenario)
+        , m_db(DBManager::getInstance())
+        , m_out(stdout)
+    {
+        const QJsonArray users = plan.value("users").toArray();
+        const QJsonArray user = users.at(index % users.size()).toArray();
+        m_vu.userId = user.at(0).toInt();
+        m_vu.userName = user.at(1).toString();
+        m_vu.idcard = user.at(2).toString();
+        if (m_vu.idcard.isEmpty())
+            m_vu.idcard = QString("%1").arg(m_vu.userId, 18, 10, QChar('0'));
+        m_vu.rng.seed(quint64(index) * 7919 + 17);
+        for (const QJsonValue &value : plan.value("routes").toArray())
+            m_routes.append(value.toArray());
+        for (const Journey &journey : scenario.journeys)
+            m_journeyWeights.push_back(journey.weight);
+        for (const QJsonArray &route : m_routes)
+            m_routeWeights.push_back(route.at(3).toDouble());
+
+        // 步骤期间 DBManager 报告的失败（超时、数据库错误等）
+        QObject::connect(m_db, &DBManager::operateResult, [this](bool success, const QString &msg) {
+            if (!success) {
+                m_failed = true;
+                m_error = msg;
+            }
+        });
+        QObject::connect(m_db, &DBManager::orderCreatedFailed, [this](const QString &msg) { m_error = msg; });
+    }
+
+    int run(qint64 startAtMs, int index)
+    {
+        if (!m_db->connectDB())
+            return 2;
+        if (m_scenario.bookingProcedure && !m_db->setBookingProcedureEnabled(true))
+            QTextStream(stderr) << "存储过程下单不可用，改走事务\n";
+
+        const qint64 endMs = startAtMs + qint64(m_scenario.durationS) * 1000;
+        waitUntil(startAtMs + qint64(m_scenario.rampUpS) * 1000 * index / qMax(1, m_scenario.users));
+        while (QDateTime::currentMSecsSinceEpoch() < endMs) {
+            const Journey &journey = m_scenario.journeys.at(pick(m_journeyWeights));
+            m_vu.flightId.clear();
+            for (int i = 0; i < journey.steps.size(); ++i) {
+                const StepSpec &step = journey.steps.at(i);
+                m_failed = false;
+                m_error.clear();
+                const qint64 at = QDateTime::currentMSecsSinceEpoch() - startAtMs;
+                QElapsedTimer timer;
+                timer.start();
+                const bool ok = execute(step.op) && !m_failed;
+                m_out << journey.name << '/' << step.op << '\t' << at << '\t' << timer.nsecsElapsed() / 1000 << '\t'
+                      << (ok ? 1 : 0) << '\t' << (i + 1 == journey.steps.size() ? 1 : 0) << '\t'
+                      << QString(m_error).replace('\t', ' ').replace('\n', ' ') << '\n';
+                const int think = std::uniform_int_distribution<int>(
+                    step.thinkMinMs, qMax(step.thinkMinMs, step.thinkMaxMs))(m_vu.rng);
+                waitUntil(qMin(endMs, QDateTime::currentMSecsSinceEpoch() + think));
+                if (QDateTime::currentMSecsSinceEpoch() >= endMs)
+                    break;
+            }
+        }
+        m_out.flush();
+        m_db->flushInteractions();
+        m_db->disconnectDB();
+        return 0;
+    }
+
+private:
+    bool execute(const QString &op)
+    {
+        if (op == "login") {
+            const int code = m_db->userLogin(m_vu.userName, m_scenario.password);
+            if (code != 4 && m_error.isEmpty())
+                m_error = QString("登录返回 %1").arg(code);
+            return code == 4;
+        }
+        if (op == "queryFlightsByCondition") {
+            if (m_routes.isEmpty()) {
+                m_error = "没有可搜索的航线";
+                return false;
+            }
+            const QJsonArray &route = m_routes.at(pick(m_routeWeights));
+            const QVariantList flights = m_db->queryFlightsByCondition(route.at(0).toString(), route.at(1).toString(),
+                                                                       route.at(2).toString());
+            QStringList available;
+            for (const QVariant &value : flights) {
+                const QVariantMap flight = value.toMap();
+                if (flight.value("remain_seats").toInt() > 0)
+                    available.append(flight.value("Flight_id").toString());
+            }
+            if (!available.isEmpty())
+                m_vu.flightId = available.at(std::uniform_int_distribution<int>(0, available.size() - 1)(m_vu.rng));
+            return true;
+        }
+        if (op == "collectFlight") {
+            if (m_vu.flightId.isEmpty())
+                return true; // 没搜到有票的航班，跳过
+            const int code = m_db->collectFlight(m_vu.userId, m_vu.flightId, m_db->newRequestKey());
+            m_failed = false; // 已收藏（401）也算正常结果
+            return code == 100 || code == 401;
+        }
+        if (op == "createOrder") {
+            if (m_vu.flightId.isEmpty())
+                return true;
+            return m_db->createOrder(m_vu.userId, m_vu.flightId, m_vu.userName, m_vu.idcard, m_db->newRequestKey());
+        }
+        if (op == "queryMyOrders") {
+            m_db->queryMyOrders(m_vu.userId);
+            return true;
+        }
+        if (op == "queryAllOrders") {
+            m_db->queryAllOrders();
+            return true;
+        }
+        if (op == "queryAllFlights") {
+            m_db->queryAllFlights();
+            return true;
+        }
+        m_error = "未知操作：" + op;
+        return false;
+    }
+
+    int pick(const std::vector<double> &weights)
+    {
+        return std::discrete_distribution<int>(weights.begin(), weights.end())(m_vu.rng);
+    }
+
+    const Scenario &m_scenario;
+    DBManager *m_db;
+    QTextStream m_out;
+    VirtualUser m_vu;
+    QList<QJsonArray> m_routes; // [出发地, 目的地, 日期, 航班数]
+    std::vector<double> m_journeyWeights;
+    std::vector<double> m_routeWeights;
+    bool m_failed = false;
+    QString m_error;
+};
+
+// 汇总各子进程的输出：按时间窗口打印吞吐，最后打印各步骤的延迟分位数
+void report(const Scenario &scenario, const QTemporaryDir &outputDir, int users, QTextStream &out)
+{
+    QMap<QString, StepStats> stats;
+    QMap<qint64, Window> windows;
+    quint64 ops = 0;
+    quint64 journeys = 0;
+    for (int i = 0; i < users; ++i) {
+        QFile output(outputDir.filePath(QString("vu-%1.tsv").arg(i)));
+        if (!output.open(QIODevice::ReadOnly))
+            continue;
+        const QList<QByteArray> lines = output.readAll().split('\n');
+        for (const QByteArray &line : lines) {
+            const QList<QByteArray> fields = line.split('\t');
+            if (fields.size() != 6)
+                continue;
+            const bool ok = fields.at(3) == "1";
+            const bool journeyDone = fields.at(4) == "1";
+            StepStats &step = stats[QString::fromUtf8(fields.at(0))];
+            step.latenciesUs.append(fields.at(2).toLongLong());
+            Window &window = windows[fields.at(1).toLongLong() / (qint64(scenario.reportIntervalS) * 1000)];
+            ++window.ops;
+            ++ops;
+            if (!ok) {
+                ++step.errors;
+                step.lastError = QString::fromUtf8(fields.at(5));
+                ++window.errors;
+            }
+            if (journeyDone) {
+                ++window.journeys;
+                ++journeys;
+            }
+        }
+    }
+
+    out << "t_s\tops_per_s\terrors\tjourneys\n";
+    for (auto it = windows.constBegin(); it != windows.constEnd(); ++it) {
+        out << (it.key() + 1) * scenario.reportIntervalS << '\t'
+            << QString::number(it->ops / double(scenario.reportIntervalS), 'f', 1) << '\t' << it->errors << '\t'
+            << it->journeys << '\n';
+    }
+
+    const double seconds = qMax(1, scenario.durationS);
+    out << "\n# " << users << " 个虚拟用户（进程），" << scenario.durationS << " s，共 " << ops << " 步，"
+        << journeys << " 个完整旅程\n";
+    out << "step\tcount\terrors\tops_per_s\tp50_ms\tp95_ms\tp99_ms\tmax_ms\tlast_error\n";
+    for (auto it = stats.begin(); it != stats.end(); ++it) {
+        QList<qint64> &samples = it->latenciesUs;
+        std::sort(samples.begin(), samples.end());
+        auto ms = [](qint64 us) { return QString::number(us / 1e3, 'f', 2); };
+        out << it.key() << '\t' << samples.size() << '\t' << it->errors << '\t'
+            << QString::number(samples.size() / seconds, 'f', 1) << '\t' << ms(percentile(samples, 0.50)) << '\t'
+            << ms(percentile(samples, 0.95)) << '\t' << ms(percentile(samples, 0.99)) << '\t'
+            << ms(samples.isEmpty() ? 0 : samples.last()) << '\t' << it->lastError << '\n';
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 压测不需要窗口，图片相关代码只用到 QImage
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addPositionalArgument("scenario", "场景脚本（JSON，见 tools/scenarios/）");
+    parser.addOption({"users", "覆盖虚拟用户数", "n"});
+    parser.addOption({"duration", "覆盖压测时长（秒）", "s"});
+    parser.addOption({"worker", "（内部）虚拟用户序号", "i"});
+    parser.addOption({"plan", "（内部）压测计划文件", "path"});
+    parser.addOption({"start-at", "（内部）统一开始时刻 epoch ms", "ms"});
+    parser.process(app);
+    if (parser.positionalArguments().isEmpty())
+        parser.showHelp(1);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    const QString scenarioPath = parser.positionalArguments().first();
+    Scenario scenario;
+    QString error;
+    if (!loadScenario(scenarioPath, &scenario, &error)) {
+        err << "场景脚本无效：" << error << '\n';
+        return 1;
+    }
+    if (parser.isSet("users"))
+        scenario.users = parser.value("users").toInt();
+    if (parser.isSet("duration"))
+        scenario.durationS = parser.value("duration").toInt();
+    scenario.users = qMax(1, scenario.users);
+
+    if (parser.isSet("worker")) {
+        QFile planFile(parser.value("plan"));
+        if (!planFile.open(QIODevice::ReadOnly))
+            return 1;
+        const QJsonObject plan = QJsonDocument::fromJson(planFile.readAll()).object();
+        const int index = parser.value("worker").toInt();
+        VirtualUserRunner runner(scenario, plan, index);
+        return runner.run(parser.value("start-at").toLongLong(), index);
+    }
+
+    QTemporaryDir outputDir;
+    const QString planPath = outputDir.filePath("plan.json");
+    {
+        DBManager *db = DBManager::getInstance();
+        if (!db->connectDB()) {
+            err << "无法连接数据库\n";
+            return 1;
+        }
+        const bool planned = writePlan(db, scenario.users, planPath, &error);
+        db->disconnectDB();
+        if (!planned) {
+            err << error << '\n';
+            return 1;
+        }
+    }
+
+    // 子进程统一在启动全部进程之后开始（每个进程约需几十毫秒完成连接），再按序号爬坡
+    const qint64 startAt = QDateTime::currentMSecsSinceEpoch() + 2000 + scenario.users * 20;
+    // 子进程结果写入临时文件，避免管道写满后子进程阻塞
+    QList<QProcess *> workers;
+    for (int i = 0; i < scenario.users; ++i) {
+        auto *process = new QProcess(&app);
+        process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        process->setStandardOutputFile(outputDir.filePath(QString("vu-%1.tsv").arg(i)));
+        process->start(QCoreApplication::applicationFilePath(),
+                       {scenarioPath, "--worker", QString::number(i), "--users", QString::number(scenario.users),
+                        "--duration", QString::number(scenario.durationS), "--plan", planPath, "--start-at",
+                        QString::number(startAt)});
+        workers.append(process);
+    }
+    err << "启动 " << workers.size() << " 个虚拟用户进程\n";
+    err.flush();
+    int failed = 0;
+    for (QProcess *process : workers) {
+        process->waitForFinished(-1);
+        if (process->exitCode() != 0)
+            ++failed;
+    }
+    if (failed > 0)
+        err << failed << " 个虚拟用户进程失败（连接失败时检查 max_connections）\n";
+
+    report(scenario, outputDir, scenario.users, out);
+    return 0;
+}
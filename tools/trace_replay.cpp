@@ -0,0 +1,270 @@
+// 工作负载回放：读取 FLIGHT_TRACE 录制的文件，对测试库重新发出同样的 DBManager 调用，
+// 对比录制时与回放时各方法的延迟分布
+// 用法：trace_replay <录制文件> [--speed 倍速] [--concurrency 并发] [--summary] [--no-seed]
+//   --speed 1 按原速，10 为十倍速，0 为不等待尽快发出
+//   --concurrency N 启动 N 个回放子进程（DBManager 每进程一个连接）；录制的会话（一次登录及其后的调用）
+//                   按首次出现顺序轮流分给各进程，同一会话的调用在同一进程内按序执行，登录状态不会错乱
+//   --summary 只打印录制文件的统计，不回放
+//   --no-seed 不准备登录用户。默认在回放前为录制中登录（且不是录制中注册）的每个用户名注册
+//             <用户名>@replay.invalid，密码为脱敏后的固定密码；已存在则按该邮箱重置密码
+// 测试库通过 FLIGHT_DB_DRIVER / FLIGHT_DB_DSN / FLIGHT_DB_NAME / FLIGHT_DB_HOST 等环境变量指定
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGuiApplication>
+#include <QMetaMethod>
+#include <QProcess>
+#include <QSet>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <algorithm>
+#include "../DBManager.h"
+#include "../WorkloadTrace.h"
+
+namespace {
+
+// 一个方法的延迟样本（微秒）
+struct Latencies
+{
+    QList<qint64> recorded;
+    QList<qint64> replayed;
+    int errors = 0;
+};
+
+qint64 percentile(QList<qint64> samples, double p)
+{
+    if (samples.isEmpty())
+        return 0;
+    std::sort(samples.begin(), samples.end());
+    const int index = qBound(0, int(p * (samples.size() - 1) + 0.5), int(samples.size()) - 1);
+    return samples.at(index);
+}
+
+// 按方法名和参数个数找到 DBManager 的可调用方法
+QMetaMethod findMethod(const QString &name, int argc)
+{
+    const QMetaObject &meta = DBManager::staticMetaObject;
+    for (int i = meta.methodOffset(); i < meta.methodCount(); ++i) {
+        const QMetaMethod method = meta.method(i);
+        if (method.methodType() == QMetaMethod::Method && method.name() == name.toLatin1()
+            && method.parameterCount() == argc)
+            return method;
+    }
+    return QMetaMethod();
+}
+
+// 按方法签名转换参数并直接调用；返回是否调用成功（不代表业务成功）
+bool invoke(DBManager *db, const WorkloadTrace::Call &call)
+{
+    const QMetaMethod method = findMethod(call.method, call.args.size());
+    if (!method.isValid() || call.args.size() > 10)
+        return false;
+
+    QVariantList args = call.args;
+    QGenericArgument generic[10];
+    for (int i = 0; i < args.size(); ++i) {
+        if (!args[i].convert(method.parameterMetaType(i)))
+            return false;
+        generic[i] = QGenericArgument(method.parameterTypeName(i).constData(), args[i].constData());
+    }
+    QVariant result(method.returnMetaType());
+    QGenericReturnArgument ret;
+    if (method.returnMetaType().id() != QMetaType::Void)
+        ret = QGenericReturnArgument(method.typeName(), result.data());
+    return method.invoke(db, Qt::DirectConnection, ret, generic[0], generic[1], generic[2], generic[3],
+                         generic[4], generic[5], generic[6], generic[7], generic[8], generic[9]);
+}
+
+// 会话 -> 回放进程：按会话首次出现的顺序轮流分配（各进程读同一文件，结果一致）
+QHash<int, int> assignSessions(const QList<WorkloadTrace::Call> &calls, int count)
+{
+    QHash<int, int> workers;
+    for (const WorkloadTrace::Call &call : calls) {
+        if (!workers.contains(call.session))
+            workers.insert(call.session, int(workers.size()) % count);
+    }
+    return workers;
+}
+
+// 准备录制中登录的用户：录制的密码已统一脱敏为 WorkloadTrace::kReplayPassword
+void seedUsers(DBManager *db, const QList<WorkloadTrace::Call> &calls)
+{
+    QSet<QString> registered;
+    QSet<QString> loggedIn;
+    for (const WorkloadTrace::Call &call : calls) {
+        if (call.method == "userRegister" && call.args.size() == 3)
+            registered.insert(call.args.at(1).toString());
+        else if (call.method == "userLogin" && call.args.size() == 2)
+            loggedIn.insert(call.args.at(0).toString());
+    }
+    const QString password = QString::fromLatin1(WorkloadTrace::kReplayPassword);
+    int created = 0;
+    int reset = 0;
+    for (const QString &name : loggedIn) {
+        if (name.isEmpty() || registered.contains(name))
+            continue; // 录制中注册的用户由回放自己创建
+        const QString email = name + "@replay.invalid";
+        const int code = db->userRegister(email, name, password);
+        if (code == 5)
+            ++created;
+        else if (db->forgetPassword(email, "0000", password) == 7)
+            ++reset;
+        else
+            QTextStream(stderr) << "无法准备回放用户 " << name << "（注册返回 " << code << "）\n";
+    }
+    QTextStream(stderr) << "# 准备回放用户：新建 " << created << "，重置密码 " << reset << '\n';
+}
+
+// 回放子进程：按时间表发出分给自己的会话中的调用，每条结果输出一行：方法\t耗时us\t是否成功
+int runWorker(const QList<WorkloadTrace::Call> &calls, int index, int count, double speed, qint64 startAtMs)
+{
+    DBManager *db = DBManager::getInstance();
+    if (!db->connectDB())
+        return 2;
+
+    QTextStream out(stdout);
+    while (QDateTime::currentMSecsSinceEpoch() < startAtMs)
+        QThread::msleep(1);
+    QElapsedTimer clock;
+    clock.start();
+    const QHash<int, int> workers = assignSessions(calls, count);
+    for (const WorkloadTrace::Call &call : calls) {
+        if (workers.value(call.session) != index)
+            continue;
+        if (call.method == "connectDB" || call.method == "disconnectDB")
+            continue; // 连接由回放进程自己管理
+        if (speed > 0) {
+            const qint64 dueUs = qint64(call.startUs / speed);
+            const qint64 waitUs = dueUs - clock.nsecsElapsed() / 1000;
+            if (waitUs > 0)
+                QThread::usleep(quint64(waitUs));
+        }
+        QElapsedTimer timer;
+        timer.start();
+        const bool ok = invoke(db, call);
+        out << call.method << '\t' << timer.nsecsElapsed() / 1000 << '\t' << (ok ? 1 : 0) << '\n';
+        QCoreApplication::processEvents(); // 让 DBManager 的定时器（批量写库等）照常运行
+    }
+    out.flush();
+    db->flushInteractions();
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 回放不需要窗口，图片相关代码只用到 QImage
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addPositionalArgument("trace", "录制文件");
+    parser.addOption({"speed", "回放倍速（0 为尽快发出）", "x", "1"});
+    parser.addOption({"concurrency", "回放子进程数", "n", "1"});
+    parser.addOption({"summary", "只打印录制统计"});
+    parser.addOption({"no-seed", "不在回放前准备登录用户"});
+    parser.addOption({"worker", "（内部）子进程序号", "i"});
+    parser.addOption({"start-at", "（内部）统一开始时刻 epoch ms", "ms"});
+    parser.process(app);
+
+    if (parser.positionalArguments().isEmpty())
+        parser.showHelp(1);
+    const QString path = parser.positionalArguments().first();
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        QTextStream(stderr) << "无法打开录制文件：" << path << '\n';
+        return 1;
+    }
+    qint64 recordedAtMs = 0;
+    QList<WorkloadTrace::Call> calls;
+    QString error;
+    if (!WorkloadTrace::read(&file, &recordedAtMs, &calls, &error)) {
+        QTextStream(stderr) << error << '\n';
+        return 1;
+    }
+    if (!error.isEmpty())
+        QTextStream(stderr) << error << '\n';
+
+    const double speed = qMax(0.0, parser.value("speed").toDouble());
+    const int concurrency = qMax(1, parser.value("concurrency").toInt());
+
+    if (parser.isSet("worker")) {
+        return runWorker(calls, parser.value("worker").toInt(), concurrency, speed,
+                         parser.value("start-at").toLongLong());
+    }
+
+    QMap<QString, Latencies> byMethod;
+    for (const WorkloadTrace::Call &call : calls)
+        byMethod[call.method].recorded.append(call.latencyUs);
+
+    QTextStream out(stdout);
+    const qint64 spanUs = calls.isEmpty() ? 0 : calls.last().startUs;
+    out << "# 录制于 " << QDateTime::fromMSecsSinceEpoch(recordedAtMs).toString(Qt::ISODate) << "，" << calls.size()
+        << " 次调用，" << assignSessions(calls, 1).size() << " 个会话，跨度 "
+        << QString::number(spanUs / 1e6, 'f', 1) << " s\n";
+
+    qint64 wallMs = 0;
+    if (!parser.isSet("summary")) {
+        if (!parser.isSet("no-seed")) {
+            DBManager *db = DBManager::getInstance();
+            if (!db->connectDB()) {
+                QTextStream(stderr) << "无法连接测试库\n";
+                return 1;
+            }
+            seedUsers(db, calls);
+            db->disconnectDB();
+        }
+        // 子进程统一在 1 秒后开始，保证各进程时间表对齐
+        const qint64 startAt = QDateTime::currentMSecsSinceEpoch() + 1000;
+        // 子进程结果写入临时文件，避免管道写满后子进程阻塞
+        QTemporaryDir outputDir;
+        QList<QProcess *> workers;
+        for (int i = 0; i < concurrency; ++i) {
+            auto *process = new QProcess(&app);
+            process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+            process->setStandardOutputFile(outputDir.filePath(QString("worker-%1.tsv").arg(i)));
+            process->start(QCoreApplication::applicationFilePath(),
+                           {path, "--worker", QString::number(i), "--concurrency", QString::number(concurrency),
+                            "--speed", QString::number(speed), "--start-at", QString::number(startAt)});
+            workers.append(process);
+        }
+        for (int i = 0; i < workers.size(); ++i) {
+            QProcess *process = workers.at(i);
+            process->waitForFinished(-1);
+            if (process->exitCode() != 0)
+                QTextStream(stderr) << "回放子进程失败，退出码 " << process->exitCode() << '\n';
+            QFile output(outputDir.filePath(QString("worker-%1.tsv").arg(i)));
+            output.open(QIODevice::ReadOnly);
+            const QList<QByteArray> lines = output.readAll().split('\n');
+            for (const QByteArray &line : lines) {
+                const QList<QByteArray> fields = line.split('\t');
+                if (fields.size() != 3)
+                    continue;
+                Latencies &latencies = byMethod[QString::fromUtf8(fields.at(0))];
+                latencies.replayed.append(fields.at(1).toLongLong());
+                if (fields.at(2) != "1")
+                    ++latencies.errors;
+            }
+        }
+        wallMs = QDateTime::currentMSecsSinceEpoch() - startAt;
+        out << "# 回放 " << concurrency << " 个进程，倍速 " << speed << "，耗时 "
+            << QString::number(wallMs / 1e3, 'f', 1) << " s\n";
+    }
+
+    out << "method\tcalls\trec_p50_us\trec_p95_us\trec_p99_us\trep_p50_us\trep_p95_us\trep_p99_us\tp99_ratio\terrors\n";
+    for (auto it = byMethod.constBegin(); it != byMethod.constEnd(); ++it) {
+        const Latencies &l = it.value();
+        const qint64 recP99 = percentile(l.recorded, 0.99);
+        const qint64 repP99 = percentile(l.replayed, 0.99);
+        out << it.key() << '\t' << l.recorded.size() << '\t' << percentile(l.recorded, 0.50) << '\t'
+            << percentile(l.recorded, 0.95) << '\t' << recP99 << '\t' << percentile(l.replayed, 0.50) << '\t'
+            << percentile(l.replayed, 0.95) << '\t' << repP99 << '\t'
+            << (recP99 > 0 && !l.replayed.isEmpty() ? QString::number(double(repP99) / recP99, 'f', 2) : "-")
+            << '\t' << l.errors << '\n';
+    }
+    return 0;
+}